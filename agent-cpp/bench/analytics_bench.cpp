@@ -0,0 +1,41 @@
+#include "bench_points.hpp"
+#include "local_analytics.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// One metric update (rolling moments, sorted window, median/MAD, z-score)
+// across window sizes
+static void BM_UpdateMetric(benchmark::State& state) {
+    size_t window = static_cast<size_t>(state.range(0));
+    std::vector<MetricPoint> points = bench::makePoints(4096);
+    LocalAnalytics analytics(window);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analytics.updateMetric(MetricId::Temperature, points[i].temperature_c));
+        i = (i + 1) & 4095;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UpdateMetric)->Arg(10)->Arg(50)->Arg(200)->Arg(1000)->Arg(5000);
+
+// One updateAll() pass with 1 to kMetricCount metrics enabled
+static void BM_UpdateAll(benchmark::State& state) {
+    size_t metrics = static_cast<size_t>(state.range(0));
+    size_t window = static_cast<size_t>(state.range(1));
+    std::vector<MetricPoint> points = bench::makePoints(4096);
+    MetricMask enabled = (MetricMask(1) << metrics) - 1;
+    LocalAnalytics analytics(window, 3.0, enabled);
+    size_t i = 0;
+    for (auto _ : state) {
+        const MetricPoint& p = points[i];
+        MetricValues values{};
+        values[metricIndex(MetricId::Temperature)] = p.temperature_c;
+        values[metricIndex(MetricId::Vibration)] = p.vibration_g;
+        values[metricIndex(MetricId::Humidity)] = p.humidity_pct;
+        values[metricIndex(MetricId::Voltage)] = p.voltage_v;
+        benchmark::DoNotOptimize(analytics.updateAll(values));
+        i = (i + 1) & 4095;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(metrics));
+}
+BENCHMARK(BM_UpdateAll)->ArgsProduct({{1, 2, 3, static_cast<int64_t>(kMetricCount)}, {200, 1000}});
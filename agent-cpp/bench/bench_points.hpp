@@ -0,0 +1,49 @@
+#ifndef BENCH_POINTS_HPP
+#define BENCH_POINTS_HPP
+
+#include "metric_point.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/**
+ * Deterministic inputs shared by the benchmarks, so runs compare like
+ * with like across commits
+ */
+namespace bench {
+
+// Points shaped like the simulator's: slow sines plus sensor noise, 1 s apart
+inline std::vector<MetricPoint> makePoints(size_t count, uint32_t seed = 42) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<MetricPoint> points(count);
+    const int64_t start_ms = 1760000000000;
+    for (size_t i = 0; i < count; ++i) {
+        double t = static_cast<double>(i);
+        MetricPoint& p = points[i];
+        p.ts_ms = start_ms + static_cast<int64_t>(i) * 1000;
+        p.temperature_c = 22.0 + 2.0 * std::sin(t / 600.0) + 0.3 * noise(gen);
+        p.vibration_g = 0.02 + 0.005 * std::abs(noise(gen));
+        p.humidity_pct = 45.0 + 5.0 * std::sin(t / 900.0) + 0.8 * noise(gen);
+        p.voltage_v = 4.9 + 0.01 * noise(gen);
+    }
+    return points;
+}
+
+// Vibration-like signal: a 50 Hz tone, a weaker harmonic and noise
+inline std::vector<double> makeSignal(size_t count, double sample_rate_hz = 1000.0, uint32_t seed = 7) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> noise(0.0, 0.01);
+    std::vector<double> signal(count);
+    for (size_t i = 0; i < count; ++i) {
+        double t = static_cast<double>(i) / sample_rate_hz;
+        signal[i] = 0.02 * std::sin(2.0 * M_PI * 50.0 * t) + 0.005 * std::sin(2.0 * M_PI * 120.0 * t) + noise(gen);
+    }
+    return signal;
+}
+
+} // namespace bench
+
+#endif // BENCH_POINTS_HPP
@@ -0,0 +1,229 @@
+#include "bench_points.hpp"
+#include "fft_analyzer.hpp"
+#include "fft_plan.hpp"
+#include "multichannel_analyzer.hpp"
+#include "sliding_dft.hpp"
+#include "spectral_baseline.hpp"
+#include "spectral_features.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+// Real-input transform alone, the core of every analyzed frame
+static void BM_RealFFTForward(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<double> signal = bench::makeSignal(n);
+    RealFFTPlan plan(n);
+    std::vector<double> re(plan.bins());
+    std::vector<double> im(plan.bins());
+    for (auto _ : state) {
+        plan.forward(signal.data(), n, re.data(), im.data());
+        benchmark::DoNotOptimize(re.data());
+        benchmark::DoNotOptimize(im.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_RealFFTForward)->RangeMultiplier(2)->Range(64, 8192);
+
+// Single-precision variant of the same transform
+static void BM_RealFFTForwardFloat(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<double> signal = bench::makeSignal(n);
+    RealFFTPlanF plan(n);
+    std::vector<float> re(plan.bins());
+    std::vector<float> im(plan.bins());
+    for (auto _ : state) {
+        plan.forward(signal.data(), n, re.data(), im.data());
+        benchmark::DoNotOptimize(re.data());
+        benchmark::DoNotOptimize(im.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_RealFFTForwardFloat)->RangeMultiplier(2)->Range(64, 8192);
+
+// One full analyzed frame through FFTAnalyzer (transform, magnitudes and
+// anomaly stats); hop == window, so every window-th sample analyzes
+static void BM_FFTAnalyzerFrame(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<double> signal = bench::makeSignal(4 * n);
+    FFTAnalyzer analyzer(n, 1000.0, n);
+    size_t i = 0;
+    for (auto _ : state) {
+        for (size_t k = 0; k < n; ++k) {
+            const auto& result = analyzer.process(signal[i]);
+            benchmark::DoNotOptimize(&result);
+            i = (i + 1 == signal.size()) ? 0 : i + 1;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+    state.counters["frames"] = static_cast<double>(analyzer.result().frames);
+}
+BENCHMARK(BM_FFTAnalyzerFrame)->RangeMultiplier(2)->Range(64, 8192);
+
+// Per-sample cost at the vibration sensor's settings (256 window, 50% hop)
+static void BM_FFTAnalyzerSensorRate(benchmark::State& state) {
+    std::vector<double> signal = bench::makeSignal(4096);
+    FFTAnalyzer analyzer(256, 1000.0, 128);
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& result = analyzer.process(signal[i]);
+        benchmark::DoNotOptimize(&result);
+        i = (i + 1) & 4095;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FFTAnalyzerSensorRate);
+
+// Feature stage on one 256-sample frame at the vibration sensor's rate:
+// time-domain stats, centroid and shaft-harmonic band powers, then with
+// the envelope spectrum (one complex inverse and one real FFT more)
+static void BM_SpectralFeatures(benchmark::State& state) {
+    const size_t n = 256;
+    std::vector<double> signal = bench::makeSignal(n);
+    RealFFTPlan plan(n);
+    std::vector<double> re(plan.bins());
+    std::vector<double> im(plan.bins());
+    std::vector<double> mags(plan.bins());
+    plan.forward(signal.data(), n, re.data(), im.data());
+    for (size_t k = 0; k < mags.size(); ++k) {
+        mags[k] = std::hypot(re[k], im[k]);
+    }
+
+    SpectralFeatureExtractor::Options options;
+    options.bands = SpectralFeatureExtractor::harmonicBands(30.0);
+    if (state.range(0)) {
+        options.envelope = FeatureBand{100.0, 400.0};
+        options.defect_hz = {60.0, 150.0};
+    }
+    SpectralFeatureExtractor extractor(n, 1000.0, options);
+    SpectralFeatures features;
+    for (auto _ : state) {
+        extractor.compute(signal.data(), n, re.data(), im.data(), mags.data(), n / 2, features);
+        benchmark::DoNotOptimize(&features);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpectralFeatures)->Arg(0)->Arg(1)->ArgName("envelope");
+
+// Sliding DFT per sample for K Hann-windowed targets: the targets mode's
+// alternative to a full transform per sample
+static void BM_SlidingDFTUpdate(benchmark::State& state) {
+    size_t targets = static_cast<size_t>(state.range(0));
+    const size_t n = 256;
+    std::vector<double> signal = bench::makeSignal(4096);
+    std::vector<double> target_hz;
+    for (size_t i = 0; i < targets; ++i) {
+        target_hz.push_back(30.0 * static_cast<double>(i + 1));
+    }
+    SlidingDFT sliding(n, 1000.0, target_hz, WindowType::Hann);
+    size_t i = 0;
+    for (auto _ : state) {
+        sliding.update(signal[i], signal[(i + 4096 - n) & 4095]);
+        i = (i + 1) & 4095;
+    }
+    benchmark::DoNotOptimize(sliding.amplitudes().data());
+    state.SetItemsProcessed(state.iterations());
+    state.counters["resonators"] = static_cast<double>(sliding.resonators());
+}
+BENCHMARK(BM_SlidingDFTUpdate)->Arg(1)->Arg(4)->Arg(16);
+
+// Per-sample cost of the targets mode at 10 kHz: sliding DFT on 4
+// targets, time-domain features every hop, no FFT
+static void BM_FFTAnalyzerTargets(benchmark::State& state) {
+    std::vector<double> signal = bench::makeSignal(4096);
+    FFTAnalyzer analyzer(256, 10000.0, 128);
+    FFTAnalyzer::SpectrumOptions options;
+    options.window = WindowType::Hann;
+    options.target_hz = {30.0, 60.0, 90.0, 150.0};
+    options.targets_only = true;
+    analyzer.configureSpectrum(options);
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& result = analyzer.process(signal[i]);
+        benchmark::DoNotOptimize(&result);
+        i = (i + 1) & 4095;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FFTAnalyzerTargets);
+
+// Scoring and learning one warm frame of bins magnitudes; the state
+// update should cost about as much as a vector add over the bins
+static void BM_SpectralBaselineUpdate(benchmark::State& state) {
+    size_t bins = static_cast<size_t>(state.range(0));
+    std::vector<double> signal = bench::makeSignal(bins * 8);
+    for (double& v : signal) v = std::abs(v);
+    BaselineOptions options;
+    options.warmup_frames = 1;
+    SpectralBaseline baseline(1, bins, options);
+    size_t f = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(baseline.update(0, signal.data() + f * bins));
+        f = (f + 1) & 7;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(bins));
+}
+BENCHMARK(BM_SpectralBaselineUpdate)->Arg(128)->Arg(1024)->Arg(4096);
+
+// One hop (128 new frames, 256 window) of N synchronously sampled
+// channels in one batch; items are channel samples, so a flat rate across
+// channel counts means cost linear in channels. Second arg: pool threads
+template <typename Analyzer>
+static void BM_MultiChannelHop(benchmark::State& state) {
+    size_t channels = static_cast<size_t>(state.range(0));
+    size_t threads = static_cast<size_t>(state.range(1));
+    const size_t window = 256;
+    const size_t hop = window / 2;
+    std::vector<double> signal = bench::makeSignal(8 * hop);
+    std::vector<double> interleaved(signal.size() * channels);
+    for (size_t f = 0; f < signal.size(); ++f) {
+        for (size_t c = 0; c < channels; ++c) interleaved[f * channels + c] = signal[(f + 31 * c) % signal.size()];
+    }
+    Analyzer analyzer(channels, window, 1000.0, hop, threads);
+    analyzer.pushFrames(interleaved.data(), window);
+    size_t h = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzer.pushFrames(interleaved.data() + h * hop * channels, hop));
+        h = (h + 1) & 7;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(hop * channels));
+}
+BENCHMARK_TEMPLATE(BM_MultiChannelHop, MultiChannelAnalyzer)
+    ->ArgsProduct({{1, 3, 8, 24, 64}, {0}})
+    ->Args({24, 3})
+    ->Args({64, 3})
+    ->ArgNames({"channels", "threads"});
+BENCHMARK_TEMPLATE(BM_MultiChannelHop, MultiChannelAnalyzerF)
+    ->ArgsProduct({{1, 3, 8, 24, 64}, {0}})
+    ->Args({24, 3})
+    ->Args({64, 3})
+    ->ArgNames({"channels", "threads"});
+
+// The same hop with one FFTAnalyzer per channel, for comparison; it also
+// computes the spectral features the batched analyzer leaves out
+static void BM_FFTAnalyzerPerChannel(benchmark::State& state) {
+    size_t channels = static_cast<size_t>(state.range(0));
+    const size_t window = 256;
+    const size_t hop = window / 2;
+    std::vector<double> signal = bench::makeSignal(8 * hop);
+    std::vector<FFTAnalyzer> analyzers;
+    analyzers.reserve(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        analyzers.emplace_back(window, 1000.0, hop);
+        for (size_t k = 0; k < window; ++k) analyzers[c].process(signal[(k + 31 * c) % signal.size()]);
+    }
+    size_t h = 0;
+    for (auto _ : state) {
+        for (size_t c = 0; c < channels; ++c) {
+            for (size_t k = 0; k < hop; ++k) {
+                const auto& result = analyzers[c].process(signal[(h * hop + k + 31 * c) % signal.size()]);
+                benchmark::DoNotOptimize(&result);
+            }
+        }
+        h = (h + 1) & 7;
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(hop * channels));
+}
+BENCHMARK(BM_FFTAnalyzerPerChannel)->Arg(1)->Arg(8)->Arg(24)->Arg(64)->ArgName("channels");
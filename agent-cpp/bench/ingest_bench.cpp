@@ -0,0 +1,101 @@
+#include "bench_points.hpp"
+#include "http_client.hpp"
+#include "loopback_server.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bench::LoopbackServer& server() {
+    static bench::LoopbackServer instance;
+    return instance;
+}
+
+HttpClientOptions options(WireFormat format) {
+    HttpClientOptions opts;
+    opts.wire_format = format;
+    opts.max_linger_ms = 0;
+    opts.timeout_ms = 5000;
+    return opts;
+}
+
+} // namespace
+
+// Blocking postMetrics() on one kept-alive connection: encode, send and
+// wait for the 200, per batch size
+static void BM_IngestBlocking(benchmark::State& state) {
+    if (!server().ok()) {
+        state.SkipWithError("loopback server could not listen");
+        return;
+    }
+    size_t batch = static_cast<size_t>(state.range(0));
+    WireFormat format = static_cast<WireFormat>(state.range(1));
+    std::vector<MetricPoint> points = bench::makePoints(batch);
+    HttpClient client(server().baseUrl(), options(format));
+    for (auto _ : state) {
+        if (!client.postMetrics("bench-device", points)) {
+            state.SkipWithError(client.getLastError().c_str());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch));
+}
+BENCHMARK(BM_IngestBlocking)
+    ->ArgsProduct({{1, 100, 1000}, {static_cast<int64_t>(WireFormat::Json), static_cast<int64_t>(WireFormat::Columnar)}})
+    ->ArgNames({"batch", "format"})
+    ->UseRealTime();
+
+// The agents' path: points pushed one at a time through a MetricProducer,
+// batched by the upload worker and sent asynchronously; each iteration
+// ends once the backend has acknowledged every point pushed
+static void BM_IngestProducer(benchmark::State& state) {
+    if (!server().ok()) {
+        state.SkipWithError("loopback server could not listen");
+        return;
+    }
+    const size_t kPointsPerIteration = 1000;
+    WireFormat format = static_cast<WireFormat>(state.range(0));
+    std::vector<MetricPoint> points = bench::makePoints(kPointsPerIteration);
+    HttpClient client(server().baseUrl(), options(format));
+    std::atomic<uint64_t> acknowledged{0};
+    std::atomic<uint64_t> failed{0};
+    client.setCompletionCallback([&](const UploadResult& result) {
+        if (result.outcome == SendOutcome::Sent) {
+            acknowledged.fetch_add(result.points, std::memory_order_relaxed);
+        } else {
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    MetricProducer producer = client.createProducer("bench-device");
+
+    uint64_t pushed = 0;
+    uint64_t full = 0;
+    uint64_t requests_before = server().requests();
+    for (auto _ : state) {
+        for (const MetricPoint& p : points) {
+            while (!producer.push(p)) {
+                ++full;
+                std::this_thread::yield();
+            }
+        }
+        pushed += kPointsPerIteration;
+        while (acknowledged.load(std::memory_order_relaxed) < pushed) {
+            if (failed.load(std::memory_order_relaxed) > 0) {
+                state.SkipWithError(client.getLastError().c_str());
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kPointsPerIteration));
+    state.counters["requests"] = static_cast<double>(server().requests() - requests_before);
+    state.counters["ring_full"] = static_cast<double>(full);
+}
+BENCHMARK(BM_IngestProducer)
+    ->Arg(static_cast<int64_t>(WireFormat::Json))
+    ->Arg(static_cast<int64_t>(WireFormat::Columnar))
+    ->ArgName("format")
+    ->UseRealTime();
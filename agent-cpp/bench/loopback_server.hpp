@@ -0,0 +1,170 @@
+#ifndef LOOPBACK_SERVER_HPP
+#define LOOPBACK_SERVER_HPP
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Stub ingest backend on 127.0.0.1 for end-to-end upload benchmarks
+ *
+ * Answers every request with 200 and an empty JSON body as soon as the
+ * request body has arrived, on a thread per connection with keep-alive,
+ * so what is measured is the client: batching, encoding, curl and the
+ * loopback TCP stack, with no backend work. Counts requests and body bytes.
+ */
+class LoopbackServer {
+public:
+    LoopbackServer() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd_, 64) != 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return;
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::thread(&LoopbackServer::acceptLoop, this);
+    }
+
+    ~LoopbackServer() {
+        stop_.store(true);
+        if (acceptor_.joinable()) acceptor_.join();
+        if (listen_fd_ >= 0) close(listen_fd_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& t : connections_) t.join();
+    }
+
+    LoopbackServer(const LoopbackServer&) = delete;
+    LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+    bool ok() const { return listen_fd_ >= 0; }
+
+    std::string baseUrl() const { return "http://127.0.0.1:" + std::to_string(port_); }
+
+    uint64_t requests() const { return requests_.load(std::memory_order_relaxed); }
+    uint64_t bodyBytes() const { return body_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    void acceptLoop() {
+        while (!stop_.load()) {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 100) <= 0) continue;
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_.emplace_back(&LoopbackServer::serve, this, fd);
+        }
+    }
+
+    static size_t contentLength(const std::string& headers) {
+        std::string lower(headers.size(), '\0');
+        for (size_t i = 0; i < headers.size(); ++i) {
+            lower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(headers[i])));
+        }
+        size_t pos = lower.find("\r\ncontent-length:");
+        if (pos == std::string::npos) return 0;
+        return static_cast<size_t>(std::strtoull(lower.c_str() + pos + 17, nullptr, 10));
+    }
+
+    static bool expectsContinue(const std::string& headers) {
+        for (size_t i = 0; i + 12 <= headers.size(); ++i) {
+            if (strncasecmp(headers.c_str() + i, "100-continue", 12) == 0) return true;
+        }
+        return false;
+    }
+
+    void serve(int fd) {
+        handle(fd);
+        close(fd);
+    }
+
+    // Answer requests on fd until the peer closes or the server stops
+    void handle(int fd) {
+        static const char kResponse[] =
+            "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+        std::string buffer;
+        char chunk[65536];
+        while (!stop_.load()) {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                if (!readSome(fd, chunk, sizeof(chunk), buffer)) return;
+            }
+            std::string headers = buffer.substr(0, header_end);
+            size_t body = contentLength(headers);
+            size_t total = header_end + 4 + body;
+            if (expectsContinue(headers) && buffer.size() < total) {
+                static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                if (!writeAll(fd, kContinue, sizeof(kContinue) - 1)) return;
+            }
+            while (buffer.size() < total) {
+                if (!readSome(fd, chunk, sizeof(chunk), buffer)) return;
+            }
+            buffer.erase(0, total);
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            body_bytes_.fetch_add(body, std::memory_order_relaxed);
+            if (!writeAll(fd, kResponse, sizeof(kResponse) - 1)) return;
+        }
+    }
+
+    bool readSome(int fd, char* chunk, size_t size, std::string& buffer) {
+        while (!stop_.load()) {
+            pollfd pfd{fd, POLLIN, 0};
+            int rc = poll(&pfd, 1, 100);
+            if (rc == 0) continue;
+            if (rc < 0) return false;
+            ssize_t n = read(fd, chunk, size);
+            if (n <= 0) return false;
+            buffer.append(chunk, static_cast<size_t>(n));
+            return true;
+        }
+        return false;
+    }
+
+    static bool writeAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> body_bytes_{0};
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<std::thread> connections_;
+};
+
+} // namespace bench
+
+#endif // LOOPBACK_SERVER_HPP
@@ -0,0 +1,77 @@
+#include "bench_points.hpp"
+#include "bounded_queue.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Mutex queue used for postMetricsAsync: push a burst, then drain it
+static void BM_BoundedQueuePushDrain(benchmark::State& state) {
+    size_t burst = static_cast<size_t>(state.range(0));
+    std::vector<MetricPoint> points = bench::makePoints(burst);
+    BoundedQueue<MetricPoint> queue(burst * 2);
+    std::vector<MetricPoint> out;
+    out.reserve(burst);
+    for (auto _ : state) {
+        for (const MetricPoint& p : points) queue.push(p);
+        out.clear();
+        queue.drain(out, std::chrono::steady_clock::now());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(burst));
+}
+BENCHMARK(BM_BoundedQueuePushDrain)->Arg(1)->Arg(64)->Arg(1024);
+
+// Producer ring behind MetricProducer and the pipeline stages, on one
+// thread: the cost of the operations without cache-line transfers
+static void BM_SpscRingPushPop(benchmark::State& state) {
+    size_t burst = static_cast<size_t>(state.range(0));
+    std::vector<MetricPoint> points = bench::makePoints(burst);
+    SpscRing<MetricPoint> ring(burst);
+    std::vector<MetricPoint> out(burst);
+    for (auto _ : state) {
+        for (const MetricPoint& p : points) ring.tryPush(p);
+        benchmark::DoNotOptimize(ring.pop(out.data(), out.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(burst));
+}
+BENCHMARK(BM_SpscRingPushPop)->Arg(1)->Arg(64)->Arg(1024);
+
+// Sustained throughput with a consumer thread popping in batches of 64,
+// as the upload worker does; counts pushes refused because the ring was full
+static void BM_SpscRingCrossThread(benchmark::State& state) {
+    size_t capacity = static_cast<size_t>(state.range(0));
+    MetricPoint point = bench::makePoints(1)[0];
+    SpscRing<MetricPoint> ring(capacity);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> popped{0};
+    std::thread consumer([&] {
+        std::vector<MetricPoint> out(64);
+        uint64_t total = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            size_t n = ring.pop(out.data(), out.size());
+            total += n;
+            if (n == 0) std::this_thread::yield();
+        }
+        while (size_t n = ring.pop(out.data(), out.size())) total += n;
+        popped.store(total, std::memory_order_relaxed);
+    });
+
+    uint64_t full = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < 1024; ++i) {
+            while (!ring.tryPush(point)) {
+                ++full;
+                std::this_thread::yield();
+            }
+        }
+    }
+    stop.store(true, std::memory_order_relaxed);
+    consumer.join();
+    state.SetItemsProcessed(state.iterations() * 1024);
+    state.counters["full_retries"] = static_cast<double>(full);
+    benchmark::DoNotOptimize(popped.load());
+}
+BENCHMARK(BM_SpscRingCrossThread)->Arg(1024)->Arg(16384)->UseRealTime();
@@ -0,0 +1,72 @@
+#include "bench_points.hpp"
+#include "body_compressor.hpp"
+#include "columnar_codec.hpp"
+#include "metric_json.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+const std::string kDeviceId = "sim-device-001";
+} // namespace
+
+// JSON ingest body for batches of 1 to 10k points
+static void BM_MetricsJson(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<MetricPoint> points = bench::makePoints(n);
+    MetricsJsonWriter writer;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::string_view body = writer.write(kDeviceId, points.data(), n);
+        benchmark::DoNotOptimize(body.data());
+        bytes = body.size();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+    state.counters["body_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_MetricsJson)->RangeMultiplier(10)->Range(1, 10000);
+
+// Columnar (Gorilla-style) body for the same batches
+static void BM_ColumnarEncode(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<MetricPoint> points = bench::makePoints(n);
+    columnar::Encoder encoder;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::string_view body = encoder.encode(kDeviceId, points.data(), n);
+        benchmark::DoNotOptimize(body.data());
+        bytes = body.size();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+    state.counters["body_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_ColumnarEncode)->RangeMultiplier(10)->Range(1, 10000);
+
+// Compressing a 1000-point JSON body; skipped when the codec is not built in
+static void BM_CompressJson(benchmark::State& state) {
+    Compression compression = static_cast<Compression>(state.range(0));
+    if (!compressionAvailable(compression)) {
+        state.SkipWithError("codec not available in this build");
+        return;
+    }
+    std::vector<MetricPoint> points = bench::makePoints(1000);
+    MetricsJsonWriter writer;
+    std::string body(writer.write(kDeviceId, points.data(), points.size()));
+    BodyCompressor compressor;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::string_view out;
+        compressor.compress(compression, body, out);
+        benchmark::DoNotOptimize(out.data());
+        bytes = out.size();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(body.size()));
+    state.counters["ratio"] = bytes > 0 ? static_cast<double>(body.size()) / static_cast<double>(bytes) : 0.0;
+}
+BENCHMARK(BM_CompressJson)
+    ->Arg(static_cast<int>(Compression::Gzip))
+    ->Arg(static_cast<int>(Compression::Zstd))
+    ->ArgName("codec");
@@ -0,0 +1,199 @@
+#ifndef AGENT_METRICS_HPP
+#define AGENT_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Hot-path instrumentation: sharded counters and latency histograms
+ *
+ * Every recording thread gets a shard slot on first use, so a record is
+ * one uncontended relaxed fetch_add on memory no other thread writes
+ * (threads beyond kMetricShards share slots, which costs contention but
+ * stays correct). Readers merge the shards; nothing on the recording
+ * side ever locks or allocates.
+ */
+constexpr size_t kMetricShards = 8;
+
+inline size_t metricsThreadSlot() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return slot;
+}
+
+inline uint64_t monotonicNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+class ShardedCounter {
+public:
+    void add(uint64_t n = 1) {
+        shards_[metricsThreadSlot()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> shards_;
+};
+
+/**
+ * Log-linear latency histogram in nanoseconds (HDR-style)
+ *
+ * Values below 32 ns get exact buckets; above, each power of two is split
+ * into 16 sub-buckets, so any recorded value is known to within 1/16
+ * (~6%) up to about 18 minutes. Beyond that, values land in the top bucket.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr unsigned kMaxExponent = 40;
+    static constexpr size_t kLinear = size_t(2) << kSubBits; // 32
+    // Sub-bucketed powers of two 2^5 .. 2^39, then one overflow bucket
+    static constexpr size_t kBuckets = kLinear + (kMaxExponent - kSubBits - 1) * (size_t(1) << kSubBits) + 1;
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+
+        // Upper bound of the bucket holding quantile q (0..1); 0 if empty
+        uint64_t quantileNs(double q) const;
+        uint64_t maxNs() const { return quantileNs(1.0); }
+        // Recorded values <= bound_ns, to bucket precision
+        uint64_t countAtOrBelow(uint64_t bound_ns) const;
+    };
+
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < kLinear) return static_cast<size_t>(ns);
+        unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+        if (exponent >= kMaxExponent) return kBuckets - 1;
+        size_t sub = static_cast<size_t>(ns >> (exponent - kSubBits)) & ((size_t(1) << kSubBits) - 1);
+        return kLinear + (exponent - kSubBits - 1) * (size_t(1) << kSubBits) + sub;
+    }
+
+    // Largest value that maps to bucket
+    static uint64_t bucketUpperNs(size_t bucket);
+
+    void record(uint64_t ns) {
+        Shard& shard = shards_[metricsThreadSlot()];
+        shard.counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+        std::atomic<uint64_t> sum_ns{0};
+    };
+    std::array<Shard, kMetricShards> shards_;
+};
+
+/**
+ * Records the lifetime of the timer into a histogram
+ */
+class StageTimer {
+public:
+    explicit StageTimer(LatencyHistogram& histogram) : histogram_(histogram), start_ns_(monotonicNowNs()) {}
+    ~StageTimer() { histogram_.record(monotonicNowNs() - start_ns_); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    LatencyHistogram& histogram_;
+    uint64_t start_ns_;
+};
+
+enum class Stage : int {
+    Generate = 0,  // Acquire / simulate one sample (or sensor block)
+    Analytics,     // LocalAnalytics update
+    Fft,           // FFT frame analysis
+    Serialize,     // Encode + compress one upload body
+    Enqueue,       // Producer hand-off to the upload worker
+    HttpRoundTrip, // Request start to response
+    MqttRoundTrip, // QoS 1 PUBLISH to PUBACK
+};
+
+constexpr size_t kStageCount = 7;
+
+const char* stageName(Stage stage);
+
+/**
+ * Process-wide agent metrics
+ *
+ * The fixed set below is recorded from the hot paths. Gauges are read
+ * through callbacks registered by whoever owns the state (queue depth,
+ * spool backlog) only when rendered.
+ */
+class AgentMetrics {
+public:
+    static AgentMetrics& global();
+
+    LatencyHistogram& stage(Stage stage) { return stages_[static_cast<size_t>(stage)]; }
+
+    // Upload outcomes (see SendOutcome) and what they carried
+    ShardedCounter uploads_sent;
+    ShardedCounter uploads_retried;
+    ShardedCounter uploads_rejected;
+    ShardedCounter upload_points;
+    ShardedCounter upload_bytes; // Request bodies after compression
+    ShardedCounter transport_errors; // CURL or MQTT client failures (no response)
+    ShardedCounter http_errors;      // Non-2xx responses
+
+    ShardedCounter samples;          // Acquired samples
+    ShardedCounter samples_missed;   // Sampling deadlines skipped
+    ShardedCounter pipeline_dropped; // Samples a pipeline stage had no room for
+
+    /**
+     * Register a gauge read on every render; owner identifies it for
+     * removeGauges(), which must run before whatever read() touches dies
+     */
+    void addGauge(const void* owner, const std::string& name, const std::string& help,
+                  std::function<double()> read);
+    void removeGauges(const void* owner);
+
+    /**
+     * Prometheus text exposition format (version 0.0.4)
+     */
+    std::string renderPrometheus() const;
+
+    /**
+     * One human-readable line per active stage plus a counter line
+     */
+    std::vector<std::string> summaryLines() const;
+
+private:
+    AgentMetrics() = default;
+
+    struct Gauge {
+        const void* owner;
+        std::string name;
+        std::string help;
+        std::function<double()> read;
+    };
+
+    std::array<LatencyHistogram, kStageCount> stages_;
+    mutable std::mutex gauges_mutex_;
+    std::vector<Gauge> gauges_;
+};
+
+#endif // AGENT_METRICS_HPP
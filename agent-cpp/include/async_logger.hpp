@@ -0,0 +1,146 @@
+#ifndef ASYNC_LOGGER_HPP
+#define ASYNC_LOGGER_HPP
+
+#include "metric_point.hpp"
+#include "spsc_ring.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogLevel : int {
+    Debug = 0,
+    Info,
+    Warn,
+    Error,
+    Off,
+};
+
+/**
+ * Message type, rate limited independently
+ */
+enum class LogTopic : int {
+    General = 0,
+    Sample,  // One line per sample / upload interval
+    Anomaly, // Injected and detected anomalies
+    Timing,  // Missed deadlines, pipeline drops
+    Upload,  // Failed uploads
+    Stats,   // Periodic reports
+};
+
+constexpr size_t kLogTopicCount = 6;
+
+// Parse "debug", "info", "warn", "error" or "off"; false if unknown
+bool parseLogLevel(const std::string& name, LogLevel& level);
+
+struct LogOptions {
+    LogLevel level = LogLevel::Info;
+    bool quiet = false;         // Warnings and errors only
+    size_t ring_records = 1024; // Per-thread buffer; messages beyond it are dropped and counted
+    long flush_ms = 50;         // Writer wake-up period
+
+    // Messages per second per topic (indexed by LogTopic); 0 = unlimited.
+    // Anything beyond is suppressed and reported as a count once a second
+    std::array<uint32_t, kLogTopicCount> rate_per_s = {0, 0, 5, 2, 2, 0};
+};
+
+/**
+ * Process-wide asynchronous logger
+ *
+ * A logging thread formats its message with snprintf into a fixed-size
+ * record in its own SPSC ring, which costs no lock and no system call.
+ * The writer thread merges all rings in order, adds level prefixes and
+ * "[timestamp] " headers, and sends each batch to stdout (debug/info)
+ * or stderr (warn/error) with one write() per stream. A message below
+ * the level is rejected by one relaxed load before any formatting, and
+ * one over its topic's rate by two more. Before start() and after stop(),
+ * messages are written synchronously.
+ */
+class AsyncLogger {
+public:
+    static AsyncLogger& global();
+
+    ~AsyncLogger();
+
+    /**
+     * Apply options and start the writer thread (again, after a stop())
+     */
+    void start(const LogOptions& options);
+
+    /**
+     * Apply the level, quiet flag and rate limits of options, running or
+     * not; every field is an atomic, so any thread may call it
+     */
+    void setFilter(const LogOptions& options);
+
+    /**
+     * Write everything buffered and stop the writer thread
+     */
+    void stop();
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= threshold_.load(std::memory_order_relaxed);
+    }
+
+    // printf-style; messages longer than a record are truncated
+    void log(LogLevel level, LogTopic topic, const char* fmt, ...) __attribute__((format(printf, 4, 5)));
+
+    // Same, prefixed with "[<ISO 8601 ts_ms>] " by the writer thread
+    void logAt(int64_t ts_ms, LogLevel level, LogTopic topic, const char* fmt, ...)
+        __attribute__((format(printf, 5, 6)));
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Record {
+        uint64_t seq;
+        int64_t ts_ms; // INT64_MIN = no timestamp header
+        LogLevel level;
+        LogTopic topic;
+        uint16_t length;
+        char text[228];
+    };
+    using Ring = SpscRing<Record>;
+
+    struct TopicLimit {
+        std::atomic<uint32_t> rate{0};
+        std::atomic<int64_t> window_s{0};
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> suppressed{0};
+    };
+
+    AsyncLogger() = default;
+
+    bool admit(LogTopic topic);
+    void submit(int64_t ts_ms, LogLevel level, LogTopic topic, const char* fmt, va_list args);
+    Ring* threadRing();
+    void writerLoop();
+    void flush(std::vector<Record>& batch);
+    static void append(std::string& out, const Record& record, IsoTimestampFormatter& timestamps);
+
+    std::atomic<int> threshold_{static_cast<int>(LogLevel::Info)};
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> next_seq_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::array<TopicLimit, kLogTopicCount> limits_;
+    size_t ring_records_ = 1024;
+    long flush_ms_ = 50;
+
+    std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stop_ = false;
+    std::thread writer_;
+    IsoTimestampFormatter timestamps_; // Writer thread only
+};
+
+#endif // ASYNC_LOGGER_HPP
@@ -0,0 +1,68 @@
+#ifndef BODY_COMPRESSOR_HPP
+#define BODY_COMPRESSOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * Content-Encoding applied to upload bodies
+ */
+enum class Compression {
+    None,
+    Gzip, // Needs zlib (HAVE_ZLIB)
+    Zstd, // Needs libzstd (HAVE_ZSTD); optionally with a shared dictionary
+};
+
+/**
+ * Parse "none", "gzip" or "zstd"
+ * Returns false (leaving compression unchanged) for anything else
+ */
+bool parseCompression(const std::string& name, Compression& compression);
+
+/**
+ * Whether this build can produce the given encoding
+ */
+bool compressionAvailable(Compression compression);
+
+/**
+ * Content-Encoding header value, or nullptr for Compression::None
+ */
+const char* compressionEncoding(Compression compression);
+
+/**
+ * Reusable request body compressor
+ *
+ * Keeps one gzip stream and one zstd context (plus the digested
+ * dictionary) alive across calls, and compresses into a buffer that only
+ * grows, so steady-state uploads do not allocate. Not thread-safe: each
+ * connection owns its own instance.
+ */
+class BodyCompressor {
+public:
+    /**
+     * level 0 picks the library default. Bodies shorter than min_bytes
+     * are left alone. zstd_dictionary holds the raw dictionary bytes
+     * (e.g. from `zstd --train`); empty means none.
+     */
+    BodyCompressor(int level = 0, size_t min_bytes = 1024,
+                   std::string zstd_dictionary = std::string());
+    ~BodyCompressor();
+
+    BodyCompressor(const BodyCompressor&) = delete;
+    BodyCompressor& operator=(const BodyCompressor&) = delete;
+
+    /**
+     * Compress body with the given encoding into out
+     * Returns false (out untouched) if the body is too small, the encoding
+     * is unavailable or compression would not make it smaller.
+     */
+    bool compress(Compression compression, std::string_view body, std::string_view& out);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif // BODY_COMPRESSOR_HPP
@@ -0,0 +1,220 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * What a full queue does with a new item
+ */
+enum class OverflowPolicy {
+    Block,      // Producer waits for space
+    DropOldest, // Evict the oldest queued item
+    DropNewest, // Reject the new item
+    Downsample, // Above the high-water mark admit 1 in N; evict oldest when full
+};
+
+/**
+ * Parse "block", "drop_oldest", "drop_newest" or "downsample"
+ * Returns false (leaving policy unchanged) for anything else
+ */
+inline bool parseOverflowPolicy(const std::string& name, OverflowPolicy& policy) {
+    if (name == "block") policy = OverflowPolicy::Block;
+    else if (name == "drop_oldest") policy = OverflowPolicy::DropOldest;
+    else if (name == "drop_newest") policy = OverflowPolicy::DropNewest;
+    else if (name == "downsample") policy = OverflowPolicy::Downsample;
+    else return false;
+    return true;
+}
+
+/**
+ * Counters reported by BoundedQueue::stats()
+ */
+struct QueueStats {
+    size_t depth = 0;
+    size_t max_depth = 0;
+    size_t capacity = 0;
+    size_t pushed = 0;            // Items accepted
+    size_t dropped = 0;           // Items rejected or evicted
+    size_t high_water_events = 0; // Times the high-water mark was reached
+};
+
+/**
+ * Fixed-capacity multi-producer queue with a selectable overflow policy
+ * Memory use is bounded by capacity items no matter how slowly the
+ * consumer drains it. Counters are kept for pushed/dropped items, and a
+ * callback fires each time the depth rises to the high-water mark.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    using Stats = QueueStats;
+
+    // Called from the producing thread, outside the queue lock
+    using HighWaterCallback = std::function<void(size_t depth)>;
+
+    /**
+     * high_water of 0 means 80% of capacity
+     */
+    BoundedQueue(size_t capacity, OverflowPolicy policy = OverflowPolicy::DropOldest,
+                 size_t high_water = 0, size_t downsample_factor = 4)
+        : capacity_(capacity == 0 ? 1 : capacity),
+          policy_(policy),
+          high_water_(high_water == 0 || high_water > capacity_
+                          ? std::max<size_t>(capacity_ * 8 / 10, 1)
+                          : high_water),
+          downsample_factor_(downsample_factor == 0 ? 1 : downsample_factor) {}
+
+    void setHighWaterCallback(HighWaterCallback callback) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        on_high_water_ = std::move(callback);
+    }
+
+    /**
+     * Enqueue an item according to the overflow policy
+     * Returns false if the item itself was not queued
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool accepted = true;
+
+        if (closed_) {
+            ++stats_.dropped;
+            return false;
+        }
+
+        // Thin the stream first so a rejected item never evicts an old one
+        if (policy_ == OverflowPolicy::Downsample && items_.size() >= high_water_) {
+            if ((downsample_counter_++ % downsample_factor_) != 0) {
+                ++stats_.dropped;
+                return false;
+            }
+        } else if (items_.size() < high_water_) {
+            downsample_counter_ = 0;
+        }
+
+        if (items_.size() >= capacity_) {
+            switch (policy_) {
+            case OverflowPolicy::Block:
+                not_full_.wait(lock, [this] { return items_.size() < capacity_ || closed_; });
+                if (closed_) {
+                    ++stats_.dropped;
+                    return false;
+                }
+                break;
+            case OverflowPolicy::DropNewest:
+                accepted = false;
+                break;
+            case OverflowPolicy::DropOldest:
+            case OverflowPolicy::Downsample:
+                items_.pop_front();
+                ++stats_.dropped;
+                break;
+            }
+        }
+
+        if (!accepted) {
+            ++stats_.dropped;
+            return false;
+        }
+
+        items_.push_back(std::move(item));
+        ++stats_.pushed;
+        stats_.max_depth = std::max(stats_.max_depth, items_.size());
+
+        // Edge-triggered: re-armed once the queue drains below the mark
+        HighWaterCallback callback;
+        size_t depth = items_.size();
+        if (!above_high_water_ && depth >= high_water_) {
+            above_high_water_ = true;
+            ++stats_.high_water_events;
+            callback = on_high_water_;
+        }
+
+        lock.unlock();
+        not_empty_.notify_one();
+        if (callback) callback(depth);
+        return true;
+    }
+
+    /**
+     * Move every queued item into out, waiting until at least one is
+     * available, the deadline passes or the queue is closed.
+     * Returns false once the queue is closed.
+     */
+    bool drain(std::vector<T>& out, std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait_until(lock, deadline, [this] {
+            return !items_.empty() || closed_ || wake_.exchange(false, std::memory_order_acquire);
+        });
+        if (closed_) {
+            return false;
+        }
+
+        for (auto& item : items_) {
+            out.push_back(std::move(item));
+        }
+        items_.clear();
+        above_high_water_ = false;
+        lock.unlock();
+        not_full_.notify_all();
+        return true;
+    }
+
+    /**
+     * Wake a consumer blocked in drain() without queueing anything
+     * Lock-free, so safe to call from latency-sensitive producers; a wake
+     * that races with the consumer going to sleep is only seen at its
+     * next deadline, so consumers relying on this must bound their wait.
+     */
+    void wake() {
+        wake_.store(true, std::memory_order_release);
+        not_empty_.notify_one();
+    }
+
+    /**
+     * Wake all waiters; later pushes are rejected
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s = stats_;
+        s.depth = items_.size();
+        s.capacity = capacity_;
+        return s;
+    }
+
+private:
+    size_t capacity_;
+    OverflowPolicy policy_;
+    size_t high_water_;
+    size_t downsample_factor_;
+    size_t downsample_counter_ = 0;
+    bool above_high_water_ = false;
+    bool closed_ = false;
+    std::atomic<bool> wake_{false};
+    std::deque<T> items_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    HighWaterCallback on_high_water_;
+    Stats stats_;
+};
+
+#endif // BOUNDED_QUEUE_HPP
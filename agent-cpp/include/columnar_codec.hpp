@@ -0,0 +1,219 @@
+#ifndef COLUMNAR_CODEC_HPP
+#define COLUMNAR_CODEC_HPP
+
+#include "metric_point.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Compact binary ingest format ("IOTC", Content-Type kContentType)
+ *
+ *   "IOTC" | version u8 | flags u8 | varint len + deviceId | varint count
+ *   followed by one MSB-first bitstream, zero-padded to a byte:
+ *     timestamps (if kFlagTimestamps): first value as 64 raw bits, then
+ *       zigzag delta-of-delta per point in Gorilla buckets:
+ *       '0' | '10'+7 | '110'+9 | '1110'+12 | '11110'+32 | '11111'+64 bits
+ *     temperature_c, vibration_g, humidity_pct, voltage_v columns, each
+ *       Gorilla XOR coded: first value as 64 raw bits, then per value
+ *       '0' (same as previous) | '10' + meaningful bits in the previous
+ *       window | '11' + 5-bit leading zeros + 6-bit length (0 = 64) + bits
+ *
+ * Points without a timestamp are sent as 0. Values may be rounded to
+ * mantissa_bits significant bits first (52 = lossless); trimming the
+ * noisy low mantissa bits is what lets the XOR coding pay off on real
+ * sensor data. The decoder lives in backend/src/utils/columnar.ts.
+ */
+namespace columnar {
+
+constexpr char kContentType[] = "application/x-iot-columnar";
+constexpr char kMagic[4] = {'I', 'O', 'T', 'C'};
+constexpr uint8_t kVersion = 1;
+constexpr uint8_t kFlagTimestamps = 1;
+
+/**
+ * Round v to the nearest double with at most mantissa_bits fraction bits
+ */
+inline double roundMantissa(double v, unsigned mantissa_bits) {
+    if (mantissa_bits >= 52) return v;
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    if (((bits >> 52) & 0x7ff) == 0x7ff) return v; // inf/nan
+
+    unsigned drop = 52 - mantissa_bits;
+    uint64_t mask = (uint64_t(1) << drop) - 1;
+    uint64_t rounded = (bits + (uint64_t(1) << (drop - 1))) & ~mask;
+    if (((rounded >> 52) & 0x7ff) == 0x7ff) rounded = bits & ~mask; // no overflow to inf
+
+    double out;
+    std::memcpy(&out, &rounded, sizeof(out));
+    return out;
+}
+
+class Encoder {
+public:
+    explicit Encoder(unsigned mantissa_bits = 24)
+        : mantissa_bits_(mantissa_bits > 52 ? 52 : mantissa_bits) {}
+
+    void setMantissaBits(unsigned bits) {
+        mantissa_bits_ = bits > 52 ? 52 : bits;
+    }
+
+    /**
+     * Encode a batch; the view is valid until the next encode()
+     */
+    std::string_view encode(const std::string& device_id, const MetricPoint* points, size_t count) {
+        buf_.clear();
+        acc_ = 0;
+        acc_bits_ = 0;
+
+        bool has_ts = false;
+        for (size_t i = 0; i < count && !has_ts; ++i) {
+            has_ts = points[i].ts_ms != 0;
+        }
+
+        for (char c : kMagic) {
+            buf_.push_back(c);
+        }
+        buf_.push_back(static_cast<char>(kVersion));
+        buf_.push_back(static_cast<char>(has_ts ? kFlagTimestamps : 0));
+        putVarint(device_id.size());
+        buf_.insert(buf_.end(), device_id.begin(), device_id.end());
+        putVarint(count);
+
+        if (count > 0) {
+            if (has_ts) encodeTimestamps(points, count);
+            encodeColumn(points, count, &MetricPoint::temperature_c);
+            encodeColumn(points, count, &MetricPoint::vibration_g);
+            encodeColumn(points, count, &MetricPoint::humidity_pct);
+            encodeColumn(points, count, &MetricPoint::voltage_v);
+        }
+        flushBits();
+        return std::string_view(buf_.data(), buf_.size());
+    }
+
+private:
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            buf_.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        buf_.push_back(static_cast<char>(v));
+    }
+
+    // Append the low `bits` bits of value, most significant first
+    void putBits(uint64_t value, unsigned bits) {
+        while (bits > 0) {
+            unsigned take = bits < 32 ? bits : 32;
+            bits -= take;
+            uint64_t chunk = (value >> bits) & ((uint64_t(1) << take) - 1);
+            acc_ = (acc_ << take) | chunk;
+            acc_bits_ += take;
+            while (acc_bits_ >= 8) {
+                acc_bits_ -= 8;
+                buf_.push_back(static_cast<char>((acc_ >> acc_bits_) & 0xff));
+            }
+        }
+    }
+
+    void flushBits() {
+        if (acc_bits_ > 0) {
+            buf_.push_back(static_cast<char>((acc_ << (8 - acc_bits_)) & 0xff));
+            acc_bits_ = 0;
+        }
+    }
+
+    void encodeTimestamps(const MetricPoint* points, size_t count) {
+        putBits(static_cast<uint64_t>(points[0].ts_ms), 64);
+        int64_t prev = points[0].ts_ms;
+        int64_t prev_delta = 0;
+        for (size_t i = 1; i < count; ++i) {
+            int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(points[i].ts_ms) -
+                                                 static_cast<uint64_t>(prev));
+            int64_t dod = static_cast<int64_t>(static_cast<uint64_t>(delta) -
+                                               static_cast<uint64_t>(prev_delta));
+            uint64_t z = (static_cast<uint64_t>(dod) << 1) ^ static_cast<uint64_t>(dod >> 63);
+            if (z == 0) {
+                putBits(0, 1);
+            } else if (z < (uint64_t(1) << 7)) {
+                putBits(0x2, 2);
+                putBits(z, 7);
+            } else if (z < (uint64_t(1) << 9)) {
+                putBits(0x6, 3);
+                putBits(z, 9);
+            } else if (z < (uint64_t(1) << 12)) {
+                putBits(0xe, 4);
+                putBits(z, 12);
+            } else if (z < (uint64_t(1) << 32)) {
+                putBits(0x1e, 5);
+                putBits(z, 32);
+            } else {
+                putBits(0x1f, 5);
+                putBits(z, 64);
+            }
+            prev = points[i].ts_ms;
+            prev_delta = delta;
+        }
+    }
+
+    static unsigned leadingZeros(uint64_t v) {
+        return v == 0 ? 64 : static_cast<unsigned>(__builtin_clzll(v));
+    }
+
+    static unsigned trailingZeros(uint64_t v) {
+        return v == 0 ? 64 : static_cast<unsigned>(__builtin_ctzll(v));
+    }
+
+    void encodeColumn(const MetricPoint* points, size_t count, double MetricPoint::*field) {
+        auto bitsOf = [this](double v) {
+            v = roundMantissa(v, mantissa_bits_);
+            uint64_t b;
+            std::memcpy(&b, &v, sizeof(b));
+            return b;
+        };
+
+        uint64_t prev = bitsOf(points[0].*field);
+        putBits(prev, 64);
+        unsigned window_lead = 65; // No window yet
+        unsigned window_trail = 0;
+
+        for (size_t i = 1; i < count; ++i) {
+            uint64_t cur = bitsOf(points[i].*field);
+            uint64_t x = cur ^ prev;
+            prev = cur;
+            if (x == 0) {
+                putBits(0, 1);
+                continue;
+            }
+
+            unsigned lead = leadingZeros(x);
+            unsigned trail = trailingZeros(x);
+            if (lead > 31) lead = 31;
+
+            if (window_lead <= 64 && lead >= window_lead && trail >= window_trail) {
+                putBits(0x2, 2);
+                putBits(x >> window_trail, 64 - window_lead - window_trail);
+            } else {
+                unsigned length = 64 - lead - trail;
+                putBits(0x3, 2);
+                putBits(lead, 5);
+                putBits(length & 63, 6);
+                putBits(x >> trail, length);
+                window_lead = lead;
+                window_trail = trail;
+            }
+        }
+    }
+
+    unsigned mantissa_bits_;
+    std::vector<char> buf_;
+    uint64_t acc_ = 0;
+    unsigned acc_bits_ = 0;
+};
+
+} // namespace columnar
+
+#endif // COLUMNAR_CODEC_HPP
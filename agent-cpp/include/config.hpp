@@ -1,8 +1,10 @@
 #ifndef CONFIG_HPP
 #define CONFIG_HPP
 
+#include "metric_registry.hpp"
 #include <string>
 #include <map>
+#include <vector>
 
 struct AgentConfig {
     std::string device_id;
@@ -11,18 +13,94 @@ struct AgentConfig {
     int jitter_ms;
     double anomaly_probability;
     std::map<std::string, bool> metrics_enabled;
+    bool http2; // Negotiate HTTP/2 for uploads when the backend supports it
+    int batch_max_points; // Max points merged into one async upload
+    int batch_linger_ms;  // Max time a point waits for others to batch with
+    int queue_capacity;       // Max async uploads held while the backend lags
+    std::string queue_policy; // block, drop_oldest, drop_newest or downsample
+    std::string wire_format;  // json or columnar (binary, falls back to json)
+    std::string compression;  // none, gzip or zstd upload Content-Encoding
+    int compression_level;    // 0 = library default
+    int compression_min_bytes; // Smaller bodies are sent uncompressed
+    std::string zstd_dictionary; // Path to a dictionary from `zstd --train`
+    std::string spool_dir;     // Durable store-and-forward directory; empty = memory only
+    int spool_max_mb;          // Oldest spooled data dropped beyond this size
+    int spool_max_age_s;       // ... or once it is older than this
+    int max_in_flight;         // Concurrent uploads (at most one per device)
+    int gateway_devices;       // Device pipelines hosted by the gateway
+    int gateway_threads;       // Sampling threads; 0 = one per core
+    int gateway_vibration_pct; // Share of gateway devices that are vibration sensors
+    int sample_rate_hz;        // Vibration sensor acquisition rate
+    int vibration_channels;    // Synchronously sampled vibration channels; > 1 = multi-channel mode
+    int vibration_threads;     // Analysis threads in multi-channel mode; 0 = on the sampling thread
+    int realtime_priority;     // SCHED_FIFO priority of the sampling thread; 0 = off
+    int cpu_affinity;          // Pin the sampling thread to this CPU; -1 = off
+    bool pipeline_threads;     // Analytics on its own thread, off the sampling path
+    int analytics_cpu;         // Pin the analytics stage; -1 = off
+    int transport_cpu;         // Pin the upload worker; -1 = off
+    std::string log_level;     // debug, info, warn, error or off
+    bool log_quiet;            // Warnings and errors only
+    int log_sample_per_s;      // Per-sample/interval lines per second; 0 = unlimited
+    int log_anomaly_per_s;     // Anomaly lines per second; 0 = unlimited
+    int metrics_port;          // Serve GET /metrics on this port; 0 = off
+    std::string metrics_bind;  // Listen address for /metrics
+    int metrics_dump_s;        // Log a metrics summary this often; 0 = off
+    std::string reduction;     // raw (every sample) or aggregate (interval summaries)
+    int reduction_interval_ms; // Summary interval in aggregate mode
+    int anomaly_pre_ms;        // Raw samples sent before a local anomaly
+    int anomaly_post_ms;       // Raw samples sent after a local anomaly
+    double anomaly_trigger_z;  // |z| that opens a raw window; 0 = any local anomaly
+    double shaft_hz;           // Vibration: band powers at 1x/2x/3x of this
+    std::string feature_bands_hz;  // Explicit bands "lo-hi,lo-hi"; overrides shaft_hz
+    std::string envelope_band_hz;  // Envelope demodulation band "lo-hi"; empty = off
+    std::string bearing_defect_hz; // Envelope lines to report, e.g. "107.4,162.2"
+    double fft_crest_limit;    // Frame anomaly above this crest factor; 0 = off
+    double fft_kurtosis_limit; // Frame anomaly above this kurtosis; 0 = off
+    int fft_size;              // Vibration analysis window in samples (hop = half)
+    std::string fft_window;    // rectangular, hann, hamming or blackman_harris
+    std::string fft_mode;      // fft (full spectrum per frame) or targets (sliding DFT only)
+    std::string fft_target_hz; // Bins tracked every sample; empty = shaft harmonics in targets mode
+    bool fft_baseline;          // Learn a per-bin spectrum baseline and flag deviations
+    double fft_baseline_alpha;  // Weight of each new frame in the baseline once warm
+    int fft_baseline_warmup;    // Frames learned before the baseline flags anything
+    double fft_baseline_z;      // Per-bin deviation limit in baseline standard deviations
+    int fft_baseline_min_bins;  // Deviating bins that make a frame anomalous
+    int fft_baseline_relearn;   // Consecutive anomalous frames that restart learning; 0 = never
+    std::string baseline_dir;   // Persist baselines here for fast restarts; empty = off
+    int baseline_save_s;        // Save learned baselines this often (and on gateway shutdown)
+    std::string sensor_source;  // Vibration samples from: simulated or iio
+    int sensor_block_samples;   // Samples per read; 0 = 1 simulated, ~10 ms for iio
+    std::string iio_device;     // iio:deviceN or the device's name attribute
+    std::string iio_channel;    // Scan element to capture, e.g. in_accel_z
+    std::string transport;      // Raw point uploads over http or mqtt
+    std::string mqtt_broker_url; // mqtt://host[:port] for the mqtt transport
+    int mqtt_qos;               // 0 or 1 (broker acknowledges every PUBLISH)
+    int mqtt_max_in_flight;     // Unacknowledged QoS 1 PUBLISHes at a time
+    int mqtt_keepalive_s;       // MQTT keep-alive interval
 
     // Default constructor
     AgentConfig();
 
-    // Load from JSON file
+    // Load from JSON file; warnings go to stderr
     bool loadFromFile(const std::string& filepath);
 
+    // Same, with the reason in error. False (config unchanged) if the file
+    // cannot be read or is not valid JSON; true otherwise, and error then
+    // lists the keys whose values had the wrong type and were skipped
+    bool loadFromFile(const std::string& filepath, std::string& error);
+
     // Load from environment variables
     void loadFromEnv();
 
     // Override with command line arguments
     void parseArgs(int argc, char* argv[]);
+
+    // Registry mask of the metrics enabled in metrics_enabled
+    MetricMask enabledMetrics() const;
+
+    // Config file keys ("interval_ms", "metrics.vibration") whose values
+    // differ from other
+    std::vector<std::string> changedKeys(const AgentConfig& other) const;
 };
 
 #endif // CONFIG_HPP
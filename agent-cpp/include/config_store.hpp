@@ -0,0 +1,97 @@
+#ifndef CONFIG_STORE_HPP
+#define CONFIG_STORE_HPP
+
+#include "async_logger.hpp"
+#include "config.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * The agent's configuration as immutable snapshots, reloadable at runtime
+ *
+ * Each snapshot is built from the config file, then the environment, then
+ * the command line, exactly like the startup config. current() is one
+ * acquire load, so the sampling loop never takes a lock or allocates to
+ * read it; compare version() to notice a reload and re-apply the live
+ * settings. A replaced snapshot is kept until the store is destroyed, so
+ * a reference from current() stays valid (each reload costs one
+ * AgentConfig). With watch(), a background thread reloads on SIGHUP and
+ * when the config file is rewritten (inotify on its directory, so editors
+ * that replace the file are seen too; changes are debounced by 200 ms).
+ */
+class ConfigStore {
+public:
+    struct Options {
+        std::vector<std::string> paths = {"config/agent.json", "../config/agent.json"}; // First readable is used
+        int argc = 0;
+        char** argv = nullptr;
+    };
+
+    // Called on the watcher thread after a reload that changed something
+    using ChangeCallback = std::function<void(const AgentConfig& previous, const AgentConfig& current,
+                                              const std::vector<std::string>& changed_keys)>;
+
+    // Loads the first snapshot; file problems are printed as warnings
+    explicit ConfigStore(const Options& options);
+    ~ConfigStore();
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    const AgentConfig& current() const { return *current_.load(std::memory_order_acquire); }
+
+    // Snapshots published so far; starts at 1
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    // Config file in use; empty if none could be read
+    const std::string& path() const { return path_; }
+
+    /**
+     * Rebuild the snapshot now and publish it if anything changed, then
+     * report it to the watch() callback
+     * False with the reason in error (current snapshot kept) if the file
+     * is unreadable or invalid; on true, error may list skipped keys.
+     */
+    bool reload(std::string& error);
+
+    /**
+     * Start reloading on SIGHUP and on changes to path(), logging problems
+     * through the async logger; one store per process may watch
+     */
+    bool watch(ChangeCallback callback, std::string& error);
+
+private:
+    void run();
+    bool build(AgentConfig& config, std::string& error) const;
+
+    Options options_;
+    std::string path_;
+    std::mutex reload_mutex_; // One reload at a time
+    std::vector<std::unique_ptr<const AgentConfig>> snapshots_; // Guarded by reload_mutex_
+    std::atomic<const AgentConfig*> current_{nullptr};
+    std::atomic<uint64_t> version_{0};
+    ChangeCallback callback_;
+    int signal_fd_ = -1; // Read end of the SIGHUP self-pipe
+    int inotify_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+/**
+ * Logger settings of a config; false if log_level is unknown (info used)
+ */
+bool logOptionsFromConfig(const AgentConfig& config, LogOptions& options);
+
+/**
+ * "applied a, b; restart needed for c" for the keys a reload changed,
+ * given the keys the agent applies while running
+ */
+std::string describeReload(const std::vector<std::string>& changed_keys, const std::vector<std::string>& live_keys);
+
+#endif // CONFIG_STORE_HPP
@@ -0,0 +1,101 @@
+#ifndef DEVICE_SIMULATOR_HPP
+#define DEVICE_SIMULATOR_HPP
+
+#include "metric_point.hpp"
+#include <cmath>
+#include <random>
+
+/**
+ * Anomaly injected into a simulated reading (for logging by the caller)
+ */
+enum class SimulatedAnomaly {
+    None,
+    TemperatureSpike, // +8C
+    VibrationSpike,   // Large amplitude spike / imbalance
+    Resonance,        // 150 Hz bearing resonance (vibration signal only)
+};
+
+/**
+ * Simulated environmental reading: slow temperature cycle plus noise on
+ * all four metrics, with the occasional temperature or vibration spike
+ */
+inline MetricPoint simulateEnvironment(double t, double anomaly_prob, std::mt19937& gen,
+                                       std::normal_distribution<>& normal_dist,
+                                       SimulatedAnomaly* injected = nullptr) {
+    MetricPoint point;
+    point.ts_ms = epochMillisNow();
+
+    // Base values with sinusoidal variation
+    double temp_base = 22.0 + 3.0 * std::sin(t / 60.0); // ~1 minute cycle
+    double vib_base = 0.02;
+    double hum_base = 45.0;
+    double volt_base = 4.9;
+
+    // Add noise
+    double temp_noise = normal_dist(gen) * 0.2;
+    double vib_noise = std::abs(normal_dist(gen) * 0.01);
+    double hum_noise = normal_dist(gen) * 0.5;
+    double volt_noise = normal_dist(gen) * 0.01;
+
+    // Occasionally inject anomalies
+    std::uniform_real_distribution<> anomaly_dist(0.0, 1.0);
+    SimulatedAnomaly anomaly = SimulatedAnomaly::None;
+    if (anomaly_dist(gen) < anomaly_prob) {
+        if (anomaly_dist(gen) < 0.5) {
+            temp_noise += 8.0; // +8C spike
+            anomaly = SimulatedAnomaly::TemperatureSpike;
+        } else {
+            vib_noise += 0.5; // Large vibration spike
+            anomaly = SimulatedAnomaly::VibrationSpike;
+        }
+    }
+    if (injected) *injected = anomaly;
+
+    point.temperature_c = temp_base + temp_noise;
+    point.vibration_g = vib_base + vib_noise;
+    point.humidity_pct = hum_base + hum_noise;
+    point.voltage_v = volt_base + volt_noise;
+    return point;
+}
+
+/**
+ * Simulated vibration magnitude of rotating machinery: a 30 Hz motor with
+ * 2nd/3rd harmonics and noise, with the occasional resonance or spike
+ */
+inline double simulateVibration(double t, double anomaly_prob, std::mt19937& gen,
+                                std::normal_distribution<>& normal_dist,
+                                SimulatedAnomaly* injected = nullptr) {
+    // Base vibration from rotating machinery (e.g., 30 Hz motor)
+    double base_freq = 30.0; // Hz
+    double base_amplitude = 0.02; // g
+
+    // Normal vibration signal
+    double vibration = base_amplitude * std::sin(2.0 * M_PI * base_freq * t);
+
+    // Add harmonics (2nd and 3rd)
+    vibration += 0.005 * std::sin(2.0 * M_PI * base_freq * 2.0 * t);
+    vibration += 0.002 * std::sin(2.0 * M_PI * base_freq * 3.0 * t);
+
+    // Add noise
+    vibration += std::abs(normal_dist(gen) * 0.01);
+
+    // Occasionally inject anomalies
+    std::uniform_real_distribution<> anomaly_dist(0.0, 1.0);
+    SimulatedAnomaly anomaly = SimulatedAnomaly::None;
+    if (anomaly_dist(gen) < anomaly_prob) {
+        if (anomaly_dist(gen) < 0.5) {
+            // High-frequency resonance (bearing failure simulation)
+            vibration += 0.3 * std::sin(2.0 * M_PI * 150.0 * t);
+            anomaly = SimulatedAnomaly::Resonance;
+        } else {
+            // Amplitude spike (imbalance)
+            vibration += 0.5;
+            anomaly = SimulatedAnomaly::VibrationSpike;
+        }
+    }
+    if (injected) *injected = anomaly;
+
+    return std::abs(vibration); // Vibration is always positive magnitude
+}
+
+#endif // DEVICE_SIMULATOR_HPP
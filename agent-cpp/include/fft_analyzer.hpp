@@ -1,197 +1,434 @@
 #ifndef FFT_ANALYZER_HPP
 #define FFT_ANALYZER_HPP
 
+#include "fft_plan.hpp"
+#include "sliding_dft.hpp"
+#include "spectral_baseline.hpp"
+#include "spectral_features.hpp"
+#include "window_function.hpp"
+#include <memory>
 #include <vector>
-#include <complex>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
 
 /**
  * Lightweight FFT-based frequency domain analyzer for vibration data
- * Implements Cooley-Tukey FFT algorithm for anomaly detection
+ * Implements Cooley-Tukey FFT algorithm for anomaly detection.
+ * The transform plan and all spectrum buffers are sized once from the
+ * window, so steady-state analysis does not allocate. Every analyzed
+ * frame also gets a SpectralFeatures vector, and the frame's verdict
+ * compares those features against FeatureLimits and, once
+ * configureBaseline() is called, the spectrum against a learned
+ * SpectralBaseline; either one flags the frame.
+ *
+ * configureSpectrum() picks a taper for the transform and can track a
+ * few target frequencies every sample with a sliding DFT; in
+ * targets_only mode frames skip the FFT entirely and carry time-domain
+ * features only, which is what makes high sample rates affordable.
  */
 class FFTAnalyzer {
 public:
     struct FrequencyDomain {
         std::vector<double> magnitudes;
         std::vector<double> frequencies;
-        double dominant_freq;
-        double total_power;
+        double dominant_freq = 0.0;
+        double total_power = 0.0;
     };
 
-    FFTAnalyzer(size_t window_size = 256, double sample_rate = 1000.0)
-        : window_size_(window_size), sample_rate_(sample_rate) {}
+    // Taper and sliding DFT targets, set through configureSpectrum()
+    struct SpectrumOptions {
+        WindowType window = WindowType::Rectangular;
+        std::vector<double> target_hz; // Tracked every sample by sliding DFT
+        bool targets_only = false;     // No FFT per frame; needs target_hz
+    };
 
     /**
-     * Add a vibration sample and return anomaly flag
-     * Returns true if anomaly detected based on frequency domain analysis
+     * Cached outcome of the latest analysis
+     * Spectrum and summary stats stay valid until new samples arrive,
+     * so reading them back never triggers another FFT.
      */
-    bool addSample(double vibration_value) {
-        samples_.push_back(vibration_value);
-        
-        if (samples_.size() > window_size_) {
-            samples_.erase(samples_.begin());
-        }
+    struct AnalysisResult {
+        bool anomaly = false;     // Verdict of the latest analyzed frame
+        bool fresh = false;       // True if the last process() call analyzed a frame
+        size_t frames = 0;        // Frames analyzed since construction/reset
+        // Magnitude stats over bins 1..n/2-1; the DC bin would dominate them
+        double mean_magnitude = 0.0;
+        double stddev_magnitude = 0.0;
+        double max_magnitude = 0.0;
+        double avg_power = 0.0;
+        FrequencyDomain spectrum;
+        SpectralFeatures features;
+        // Bins off the learned baseline this frame, and whether they were
+        // enough to flag it; 0/false without a baseline or while it warms up
+        size_t deviating_bins = 0;
+        bool baseline_anomaly = false;
+        bool baseline_relearned = false; // This frame reset the baseline (relearn_frames)
+        // Sliding DFT targets (rounded to bins) and their tone amplitudes
+        // at the latest frame; targetAmplitudes() has them per sample
+        std::vector<double> target_hz;
+        std::vector<double> target_amplitude;
+    };
 
-        // Need enough samples for meaningful FFT
-        if (samples_.size() >= window_size_) {
-            return analyzeFrequencyDomain();
+    /**
+     * hop_size is the number of new samples between analyses once the
+     * window is full: 1 analyzes every sample, window_size / 2 gives a
+     * 50% overlap STFT, window_size / 4 a 75% overlap.
+     */
+    FFTAnalyzer(size_t window_size = 256, double sample_rate = 1000.0, size_t hop_size = 1)
+        : window_size_(std::max<size_t>(window_size, 1)),
+          sample_rate_(sample_rate),
+          hop_size_(std::max<size_t>(hop_size, 1)),
+          ring_(2 * window_size_),
+          plan_(window_size_),
+          spectrum_re_(plan_.bins()),
+          spectrum_im_(plan_.bins()),
+          features_(plan_.size(), sample_rate) {
+        // Bins 0..n/2-1; the Nyquist bin is not reported
+        size_t bins = plan_.size() / 2;
+        FrequencyDomain& fd = result_.spectrum;
+        fd.magnitudes.resize(bins);
+        fd.frequencies.resize(bins);
+        for (size_t i = 0; i < bins; ++i) {
+            fd.frequencies[i] = (i * sample_rate_) / plan_.size();
         }
+    }
+
+    /**
+     * Choose the reported bands, envelope demodulation band and defect
+     * lines, and the limits behind the anomaly verdict
+     * Allocates the envelope buffers, so call it during setup.
+     */
+    void configureFeatures(const SpectralFeatureExtractor::Options& options,
+                           const FeatureLimits& limits = FeatureLimits()) {
+        features_ = SpectralFeatureExtractor(plan_.size(), sample_rate_, options);
+        limits_ = limits;
+        spectrum_stale_ = true;
+    }
 
-        return false;
+    const FeatureLimits& featureLimits() const {
+        return limits_;
     }
 
     /**
-     * Perform FFT and analyze frequency domain
+     * Replace only the limits, from the next frame on; does not allocate,
+     * so a config reload can apply it between samples
      */
-    FrequencyDomain analyze() {
-        FrequencyDomain result;
-        
-        if (samples_.size() < 2) {
-            return result;
-        }
+    void setFeatureLimits(const FeatureLimits& limits) {
+        limits_ = limits;
+    }
 
-        // Perform FFT
-        std::vector<std::complex<double>> fft_result = fft(samples_);
-        
-        // Calculate magnitudes and frequencies
-        result.magnitudes.resize(fft_result.size() / 2);
-        result.frequencies.resize(fft_result.size() / 2);
-        
-        double max_magnitude = 0.0;
-        size_t max_index = 0;
-        result.total_power = 0.0;
-
-        for (size_t i = 0; i < result.magnitudes.size(); ++i) {
-            double magnitude = std::abs(fft_result[i]);
-            result.magnitudes[i] = magnitude;
-            result.frequencies[i] = (i * sample_rate_) / samples_.size();
-            result.total_power += magnitude * magnitude;
-
-            if (magnitude > max_magnitude) {
-                max_magnitude = magnitude;
-                max_index = i;
+    /**
+     * Choose the taper and sliding DFT targets; allocates, so call it
+     * during setup. targets_only without targets is ignored.
+     */
+    void configureSpectrum(const SpectrumOptions& options) {
+        taper_ = WindowFunction(options.window, window_size_);
+        windowed_.assign(taper_.rectangular() ? 0 : window_size_, 0.0);
+        sliding_.reset();
+        result_.target_hz.clear();
+        result_.target_amplitude.clear();
+        if (!options.target_hz.empty()) {
+            sliding_ = std::make_unique<SlidingDFT>(window_size_, sample_rate_, options.target_hz, options.window);
+            sliding_->rebase(window(), count_);
+            since_rebase_ = 0;
+            for (size_t i = 0; i < sliding_->targets(); ++i) {
+                result_.target_hz.push_back(sliding_->frequency(i));
             }
+            result_.target_amplitude.assign(sliding_->targets(), 0.0);
         }
+        targets_only_ = options.targets_only && sliding_;
+        spectrum_stale_ = true;
+    }
 
-        result.dominant_freq = result.frequencies[max_index];
-        return result;
+    /**
+     * Learn a per-bin baseline of the spectrum and flag frames that
+     * deviate from it; call after configureSpectrum(), as the taper is
+     * part of the baseline's signature. Allocates.
+     */
+    void configureBaseline(const BaselineOptions& options) {
+        BaselineOptions o = options;
+        // FFT size, sample rate in mHz and window: a saved baseline only
+        // fits the spectrum it was learned on
+        o.signature = (static_cast<uint64_t>(plan_.size()) << 40) ^
+                      (static_cast<uint64_t>(std::llround(sample_rate_ * 1000.0)) << 8) ^
+                      static_cast<uint64_t>(taper_.type());
+        baseline_ = std::make_unique<SpectralBaseline>(1, plan_.size() / 2, o);
     }
 
     /**
-     * Get current samples
+     * The learned baseline (for save/load), or nullptr if not configured
      */
-    const std::vector<double>& getSamples() const {
-        return samples_;
+    SpectralBaseline* baseline() {
+        return baseline_.get();
+    }
+
+    WindowType windowType() const {
+        return taper_.type();
+    }
+
+    bool targetsOnly() const {
+        return targets_only_;
     }
 
     /**
-     * Reset analyzer
+     * Tone amplitude at each sliding DFT target as of the latest sample
      */
-    void reset() {
-        samples_.clear();
+    const std::vector<double>& targetAmplitudes() {
+        static const std::vector<double> none;
+        return sliding_ ? sliding_->amplitudes() : none;
     }
 
-private:
     /**
-     * Iterative Radix-2 Cooley-Tukey FFT implementation
-     * Avoids recursion and minimizes allocations for edge performance.
+     * Add a vibration sample and return the cached analysis result
+     * A new frame is analyzed (result.fresh) once per hop after the
+     * window fills; otherwise the previous frame's result is returned.
      */
-    std::vector<std::complex<double>> fft(const std::vector<double>& input) {
-        size_t n = input.size();
-        
-        // Pad to next power of 2
-        size_t n_padded = 1;
-        while (n_padded < n) {
-            n_padded <<= 1;
+    const AnalysisResult& process(double vibration_value) {
+        // The slot about to be overwritten holds the sample leaving the window
+        if (sliding_) {
+            sliding_->update(vibration_value, count_ == window_size_ ? ring_[head_] : 0.0);
         }
 
-        std::vector<std::complex<double>> x(n_padded);
-        for (size_t i = 0; i < n; ++i) {
-            x[i] = std::complex<double>(input[i], 0.0);
-        }
-        for (size_t i = n; i < n_padded; ++i) {
-            x[i] = std::complex<double>(0.0, 0.0);
+        // Mirrored ring: every sample is stored twice, so the current
+        // window is always the contiguous range [head_, head_ + window_size_)
+        ring_[head_] = vibration_value;
+        ring_[head_ + window_size_] = vibration_value;
+        head_ = (head_ + 1 == window_size_) ? 0 : head_ + 1;
+        spectrum_stale_ = true;
+        result_.fresh = false;
+        if (sliding_ && ++since_rebase_ == window_size_) {
+            // Exact recompute once per window, so rounding never builds up
+            since_rebase_ = 0;
+            sliding_->rebase(window(), std::min(count_ + 1, window_size_));
         }
 
-        // 1. Bit-reversal permutation
-        for (size_t i = 1, j = 0; i < n_padded; i++) {
-            size_t bit = n_padded >> 1;
-            for (; j & bit; bit >>= 1) {
-                j ^= bit;
+        if (count_ < window_size_) {
+            ++count_;
+            if (count_ < window_size_) {
+                return result_;
             }
-            j ^= bit;
+            // First full window is analyzed immediately
+            since_analysis_ = hop_size_;
+        } else {
+            ++since_analysis_;
+        }
 
-            if (i < j) {
-                std::swap(x[i], x[j]);
-            }
+        if (since_analysis_ < hop_size_) {
+            return result_;
         }
 
-        // 2. Iterative butterflies
-        for (size_t len = 2; len <= n_padded; len <<= 1) {
-            double ang = 2.0 * M_PI / len;
-            std::complex<double> wlen(std::cos(ang), -std::sin(ang));
-            for (size_t i = 0; i < n_padded; i += len) {
-                std::complex<double> w(1);
-                for (size_t j = 0; j < len / 2; j++) {
-                    std::complex<double> u = x[i + j];
-                    std::complex<double> v = x[i + j + len / 2] * w;
-                    x[i + j] = u + v;
-                    x[i + j + len / 2] = u - v;
-                    w *= wlen;
-                }
-            }
+        since_analysis_ = 0;
+        result_.fresh = true;
+        ++result_.frames;
+        if (sliding_) {
+            result_.target_amplitude = sliding_->amplitudes();
+        }
+        if (targets_only_) {
+            // No spectrum this frame: time-domain features and verdict only
+            result_.features = SpectralFeatures();
+            SpectralFeatureExtractor::timeDomain(window(), count_, result_.features);
+            result_.deviating_bins = 0;
+            result_.baseline_anomaly = false;
+            result_.baseline_relearned = false;
+            result_.anomaly = isFeatureAnomaly(result_.features, limits_);
+        } else {
+            result_.anomaly = analyzeFrequencyDomain();
         }
+        return result_;
+    }
 
-        return x;
+    /**
+     * Add a vibration sample and return anomaly flag
+     * Returns true if this sample completed a hop and the resulting
+     * frame was flagged by frequency domain analysis
+     */
+    bool addSample(double vibration_value) {
+        const AnalysisResult& r = process(vibration_value);
+        return r.fresh && r.anomaly;
     }
 
     /**
-     * Analyze frequency domain for anomalies
-     * Detects unusual frequency patterns or power spikes
+     * Perform FFT and analyze frequency domain
+     * Recomputes only if samples were added since the last call.
      */
-    bool analyzeFrequencyDomain() {
-        FrequencyDomain fd = analyze();
-        
-        if (fd.magnitudes.empty()) return false;
+    const FrequencyDomain& analyze() {
+        static const FrequencyDomain empty;
+        if (count_ < 2) {
+            return empty;
+        }
+        if (spectrum_stale_) {
+            computeSpectrum();
+        }
+        return result_.spectrum;
+    }
+
+    /**
+     * Latest cached result, without any computation
+     */
+    const AnalysisResult& result() const {
+        return result_;
+    }
+
+    /**
+     * Get current samples, oldest first
+     */
+    std::vector<double> getSamples() const {
+        return std::vector<double>(window(), window() + count_);
+    }
+
+    /**
+     * Number of buffered samples (at most window_size)
+     */
+    size_t sampleCount() const {
+        return count_;
+    }
+
+    bool isWindowFull() const {
+        return count_ == window_size_;
+    }
+
+    /**
+     * True if the last addSample() call ran a frequency domain analysis
+     */
+    bool frameReady() const {
+        return result_.fresh;
+    }
+
+    /**
+     * Verdict of the most recent analyzed frame
+     */
+    bool lastAnomaly() const {
+        return result_.anomaly;
+    }
+
+    size_t hopSize() const {
+        return hop_size_;
+    }
+
+    void setHopSize(size_t hop_size) {
+        hop_size_ = std::max<size_t>(hop_size, 1);
+    }
+
+    /**
+     * Reset analyzer; a learned baseline is kept
+     */
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        since_analysis_ = 0;
+        since_rebase_ = 0;
+        spectrum_stale_ = true;
+        FrequencyDomain spectrum = std::move(result_.spectrum);
+        std::vector<double> target_hz = std::move(result_.target_hz);
+        std::vector<double> target_amplitude = std::move(result_.target_amplitude);
+        result_ = AnalysisResult();
+        result_.spectrum = std::move(spectrum);
+        result_.target_hz = std::move(target_hz);
+        result_.target_amplitude = std::move(target_amplitude);
+        std::fill(result_.target_amplitude.begin(), result_.target_amplitude.end(), 0.0);
+        if (sliding_) {
+            sliding_->rebase(window(), 0);
+        }
+    }
+
+private:
+    /**
+     * FFT the current window and refresh spectrum summary stats
+     */
+    void computeSpectrum() {
+        // Real-input FFT of the window (zero-padded while it is filling);
+        // the taper applies to full windows only, with the mean removed
+        // first, so a tapered spectrum has no DC
+        const double* input = window();
+        const bool tapered = !taper_.rectangular() && count_ == window_size_;
+        if (tapered) {
+            double mean = std::accumulate(input, input + count_, 0.0) / static_cast<double>(count_);
+            taper_.apply(input, windowed_.data(), count_, mean);
+            input = windowed_.data();
+        }
+        plan_.forward(input, count_, spectrum_re_.data(), spectrum_im_.data());
+
+        // Calculate magnitudes and total power in one vectorized sweep
+        FrequencyDomain& fd = result_.spectrum;
+        size_t bins = fd.magnitudes.size();
+        fd.total_power = simd::magnitudes(spectrum_re_.data(), spectrum_im_.data(),
+                                          fd.magnitudes.data(), bins);
+
+        // Stats skip the DC bin: a window's mean (always positive for a
+        // rectified magnitude) would otherwise be the dominant "frequency"
+        auto ac_begin = fd.magnitudes.begin() + (bins > 1 ? 1 : 0);
+        size_t ac_bins = static_cast<size_t>(fd.magnitudes.end() - ac_begin);
+        size_t max_index = static_cast<size_t>(
+            std::max_element(ac_begin, fd.magnitudes.end()) - fd.magnitudes.begin());
+        fd.dominant_freq = fd.frequencies[max_index];
 
         // Calculate mean and stddev of magnitudes
-        double mean_mag = std::accumulate(fd.magnitudes.begin(), fd.magnitudes.end(), 0.0) 
-                         / fd.magnitudes.size();
-        
+        double mean_mag = std::accumulate(ac_begin, fd.magnitudes.end(), 0.0) / ac_bins;
         double variance = 0.0;
-        for (double mag : fd.magnitudes) {
-            double diff = mag - mean_mag;
+        double ac_power = 0.0;
+        for (auto it = ac_begin; it != fd.magnitudes.end(); ++it) {
+            double diff = *it - mean_mag;
             variance += diff * diff;
-        }
-        double stddev_mag = std::sqrt(variance / fd.magnitudes.size());
-
-        // Check for high power spikes (anomalies)
-        double max_magnitude = *std::max_element(fd.magnitudes.begin(), fd.magnitudes.end());
-        
-        // Anomaly if magnitude is > 3 sigma above mean
-        if (stddev_mag > 0.0 && max_magnitude > mean_mag + 4.0 * stddev_mag) {
-            return true;
+            ac_power += *it * *it;
         }
 
-        // Check for unusual dominant frequency (outside normal range 0-50 Hz)
-        if (fd.dominant_freq > 60.0) {
-            return true;
-        }
+        result_.mean_magnitude = mean_mag;
+        result_.stddev_magnitude = std::sqrt(variance / ac_bins);
+        result_.max_magnitude = fd.magnitudes[max_index];
+        result_.avg_power = ac_power / ac_bins;
+
+        features_.compute(window(), count_, spectrum_re_.data(), spectrum_im_.data(),
+                          fd.magnitudes.data(), bins, result_.features, tapered ? &taper_ : nullptr);
+        spectrum_stale_ = false;
+    }
 
-        // Check for excessive total power
-        double avg_power = fd.total_power / fd.magnitudes.size();
-        if (avg_power > 250.0) { // Adjusted threshold
-            return true;
+    /**
+     * Analyze the frame's features and spectrum for anomalies
+     * Impulsive content (bearing defects, knocks) raises crest factor and
+     * kurtosis; a steady tone or harmonic does not, but a new one (a
+     * resonance) or a changed one moves bins off the learned baseline.
+     */
+    bool analyzeFrequencyDomain() {
+        if (spectrum_stale_) {
+            computeSpectrum();
+        }
+        if (baseline_) {
+            uint64_t relearns = baseline_->relearns(0);
+            result_.deviating_bins = baseline_->update(0, result_.spectrum.magnitudes.data());
+            result_.baseline_anomaly = baseline_->anomalous(result_.deviating_bins);
+            result_.baseline_relearned = baseline_->relearns(0) != relearns;
         }
+        return isFeatureAnomaly(result_.features, limits_) || result_.baseline_anomaly;
+    }
 
-        return false;
+    /**
+     * Oldest-first view of the buffered samples
+     */
+    const double* window() const {
+        return count_ < window_size_ ? ring_.data() : ring_.data() + head_;
     }
 
     size_t window_size_;
     double sample_rate_;
-    std::vector<double> samples_;
+    size_t hop_size_;
+    std::vector<double> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t since_analysis_ = 0;
+    bool spectrum_stale_ = true;
+    RealFFTPlan plan_;
+    simd::aligned_vector<double> spectrum_re_;
+    simd::aligned_vector<double> spectrum_im_;
+    SpectralFeatureExtractor features_;
+    FeatureLimits limits_;
+    WindowFunction taper_;
+    simd::aligned_vector<double> windowed_;
+    std::unique_ptr<SlidingDFT> sliding_;
+    std::unique_ptr<SpectralBaseline> baseline_;
+    size_t since_rebase_ = 0;
+    bool targets_only_ = false;
+    AnalysisResult result_;
 };
 
 #endif // FFT_ANALYZER_HPP
@@ -0,0 +1,285 @@
+#ifndef FFT_PLAN_HPP
+#define FFT_PLAN_HPP
+
+#include "simd.hpp"
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * Smallest power of two >= n
+ */
+inline size_t nextPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/**
+ * Precomputed complex FFT of a fixed power-of-two size
+ *
+ * Data is kept in split layout (separate real and imaginary arrays) so
+ * butterflies map directly onto SIMD lanes. Pairs of radix-2 stages are
+ * fused into radix-4 passes, halving the number of sweeps over the data;
+ * an odd leading stage is done as a twiddle-free radix-2 pass.
+ * Bit-reversal and per-pass twiddle tables are built once, so transforms
+ * run without allocating and without the drift of a w *= wlen recurrence.
+ * Real is double or float (float32 mode doubles the SIMD lane count).
+ */
+template <typename Real>
+class BasicFFTPlan {
+public:
+    explicit BasicFFTPlan(size_t n = 1)
+        : n_(nextPowerOfTwo(std::max<size_t>(n, 1))),
+          bitrev_(n_) {
+        size_t bits = 0;
+        while ((size_t(1) << bits) < n_) {
+            ++bits;
+        }
+        for (size_t i = 0; i < n_; ++i) {
+            size_t r = 0;
+            for (size_t b = 0; b < bits; ++b) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            bitrev_[i] = static_cast<uint32_t>(r);
+        }
+
+        // Radix-4 passes start from blocks of size 1, or 2 after an odd stage
+        first_quarter_ = (bits % 2 == 1) ? 2 : 1;
+        for (size_t h = first_quarter_; 4 * h <= n_; h *= 4) {
+            // Each twiddle is evaluated directly: exp(-2*pi*i*j/len)
+            for (size_t j = 0; j < h; ++j) {
+                double a2 = -2.0 * M_PI * static_cast<double>(j) / static_cast<double>(2 * h);
+                double a4 = -2.0 * M_PI * static_cast<double>(j) / static_cast<double>(4 * h);
+                tw2_re_.push_back(static_cast<Real>(std::cos(a2)));
+                tw2_im_.push_back(static_cast<Real>(std::sin(a2)));
+                tw4_re_.push_back(static_cast<Real>(std::cos(a4)));
+                tw4_im_.push_back(static_cast<Real>(std::sin(a4)));
+            }
+        }
+    }
+
+    size_t size() const {
+        return n_;
+    }
+
+    /**
+     * Bit-reversed index of i
+     */
+    size_t reversed(size_t i) const {
+        return bitrev_[i];
+    }
+
+    /**
+     * In-place forward transform of re/im[0..size())
+     */
+    void forward(Real* re, Real* im) const {
+        for (size_t i = 0; i < n_; ++i) {
+            size_t j = bitrev_[i];
+            if (i < j) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+        butterflies(re, im);
+    }
+
+    /**
+     * Butterfly passes only; data must already be in bit-reversed order
+     */
+    void butterflies(Real* re, Real* im) const {
+        if (first_quarter_ == 2) {
+            for (size_t i = 0; i < n_; i += 2) {
+                Real ur = re[i], ui = im[i];
+                Real vr = re[i + 1], vi = im[i + 1];
+                re[i] = ur + vr;
+                im[i] = ui + vi;
+                re[i + 1] = ur - vr;
+                im[i + 1] = ui - vi;
+            }
+        }
+
+        size_t tw = 0;
+        for (size_t h = first_quarter_; 4 * h <= n_; h *= 4) {
+            for (size_t i = 0; i < n_; i += 4 * h) {
+                radix4(re + i, im + i, h, tw);
+            }
+            tw += h;
+        }
+    }
+
+private:
+    /**
+     * One fused radix-2^2 butterfly group: four sub-transforms of size h
+     * at x, x+h, x+2h, x+3h become one transform of size 4h.
+     * Equivalent to the radix-2 stages of length 2h and 4h in sequence.
+     */
+    void radix4(Real* re, Real* im, size_t h, size_t tw) const {
+        using V = simd::Vec<Real>;
+        const Real* w2r = tw2_re_.data() + tw;
+        const Real* w2i = tw2_im_.data() + tw;
+        const Real* w4r = tw4_re_.data() + tw;
+        const Real* w4i = tw4_im_.data() + tw;
+        Real* r0 = re;
+        Real* r1 = re + h;
+        Real* r2 = re + 2 * h;
+        Real* r3 = re + 3 * h;
+        Real* i0 = im;
+        Real* i1 = im + h;
+        Real* i2 = im + 2 * h;
+        Real* i3 = im + 3 * h;
+
+        size_t j = 0;
+        for (; j + V::lanes <= h; j += V::lanes) {
+            V ar = V::load(w2r + j), ai = V::load(w2i + j);
+            V br = V::load(w4r + j), bi = V::load(w4i + j);
+
+            // Stage 2h: (a0, a1) and (a2, a3) with W_2h^j
+            V x0r = V::load(r0 + j), x0i = V::load(i0 + j);
+            V x1r = V::load(r1 + j), x1i = V::load(i1 + j);
+            V x2r = V::load(r2 + j), x2i = V::load(i2 + j);
+            V x3r = V::load(r3 + j), x3i = V::load(i3 + j);
+
+            V t1r = x1r * ar - x1i * ai, t1i = x1r * ai + x1i * ar;
+            V t3r = x3r * ar - x3i * ai, t3i = x3r * ai + x3i * ar;
+            V b0r = x0r + t1r, b0i = x0i + t1i;
+            V b1r = x0r - t1r, b1i = x0i - t1i;
+            V b2r = x2r + t3r, b2i = x2i + t3i;
+            V b3r = x2r - t3r, b3i = x2i - t3i;
+
+            // Stage 4h: W_4h^j on b2, W_4h^(j+h) = -i * W_4h^j on b3
+            V u2r = b2r * br - b2i * bi, u2i = b2r * bi + b2i * br;
+            V u3r = b3r * br - b3i * bi, u3i = b3r * bi + b3i * br;
+
+            (b0r + u2r).store(r0 + j);
+            (b0i + u2i).store(i0 + j);
+            (b0r - u2r).store(r2 + j);
+            (b0i - u2i).store(i2 + j);
+            (b1r + u3i).store(r1 + j);
+            (b1i - u3r).store(i1 + j);
+            (b1r - u3i).store(r3 + j);
+            (b1i + u3r).store(i3 + j);
+        }
+
+        for (; j < h; ++j) {
+            Real ar = w2r[j], ai = w2i[j];
+            Real br = w4r[j], bi = w4i[j];
+
+            Real t1r = r1[j] * ar - i1[j] * ai, t1i = r1[j] * ai + i1[j] * ar;
+            Real t3r = r3[j] * ar - i3[j] * ai, t3i = r3[j] * ai + i3[j] * ar;
+            Real b0r = r0[j] + t1r, b0i = i0[j] + t1i;
+            Real b1r = r0[j] - t1r, b1i = i0[j] - t1i;
+            Real b2r = r2[j] + t3r, b2i = i2[j] + t3i;
+            Real b3r = r2[j] - t3r, b3i = i2[j] - t3i;
+
+            Real u2r = b2r * br - b2i * bi, u2i = b2r * bi + b2i * br;
+            Real u3r = b3r * br - b3i * bi, u3i = b3r * bi + b3i * br;
+
+            r0[j] = b0r + u2r;
+            i0[j] = b0i + u2i;
+            r2[j] = b0r - u2r;
+            i2[j] = b0i - u2i;
+            r1[j] = b1r + u3i;
+            i1[j] = b1i - u3r;
+            r3[j] = b1r - u3i;
+            i3[j] = b1i + u3r;
+        }
+    }
+
+    size_t n_;
+    size_t first_quarter_ = 1;
+    std::vector<uint32_t> bitrev_;
+    simd::aligned_vector<Real> tw2_re_;
+    simd::aligned_vector<Real> tw2_im_;
+    simd::aligned_vector<Real> tw4_re_;
+    simd::aligned_vector<Real> tw4_im_;
+};
+
+/**
+ * Forward FFT of real input of a fixed power-of-two size n
+ * Packs even/odd samples into an n/2-point complex transform and
+ * untangles the result, producing bins 0..n/2 (n/2 + 1 values).
+ * Work buffers are owned by the plan, so repeated calls do not allocate.
+ */
+template <typename Real>
+class BasicRealFFTPlan {
+public:
+    explicit BasicRealFFTPlan(size_t n = 2)
+        : n_(std::max<size_t>(nextPowerOfTwo(n), 2)),
+          half_(n_ / 2),
+          tw_re_(n_ / 2 + 1),
+          tw_im_(n_ / 2 + 1),
+          work_re_(n_ / 2),
+          work_im_(n_ / 2) {
+        for (size_t k = 0; k <= n_ / 2; ++k) {
+            double ang = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(n_);
+            tw_re_[k] = static_cast<Real>(std::cos(ang));
+            tw_im_[k] = static_cast<Real>(std::sin(ang));
+        }
+    }
+
+    size_t size() const {
+        return n_;
+    }
+
+    /**
+     * Number of output bins written by forward()
+     */
+    size_t bins() const {
+        return n_ / 2 + 1;
+    }
+
+    /**
+     * Transform input[0..count), zero-padded to size(), into
+     * out_re/out_im[0..bins())
+     */
+    template <typename In>
+    void forward(const In* input, size_t count, Real* out_re, Real* out_im) {
+        count = std::min(count, n_);
+        size_t m = half_.size();
+
+        // Pack x[2k] + i*x[2k+1], written straight to bit-reversed slots
+        for (size_t k = 0; k < m; ++k) {
+            size_t slot = half_.reversed(k);
+            work_re_[slot] = (2 * k < count) ? static_cast<Real>(input[2 * k]) : Real(0);
+            work_im_[slot] = (2 * k + 1 < count) ? static_cast<Real>(input[2 * k + 1]) : Real(0);
+        }
+        half_.butterflies(work_re_.data(), work_im_.data());
+
+        // X[k] = E[k] + W^k * O[k], with E/O recovered from Z[k], Z[m-k]
+        for (size_t k = 0; k <= m; ++k) {
+            size_t a = (k == m) ? 0 : k;
+            size_t b = (k == 0) ? 0 : m - k;
+            Real zr = work_re_[a], zi = work_im_[a];
+            Real cr = work_re_[b], ci = -work_im_[b];
+
+            Real er = Real(0.5) * (zr + cr);
+            Real ei = Real(0.5) * (zi + ci);
+            // odd = -i/2 * (z - c)
+            Real orr = Real(0.5) * (zi - ci);
+            Real oi = Real(-0.5) * (zr - cr);
+
+            out_re[k] = er + tw_re_[k] * orr - tw_im_[k] * oi;
+            out_im[k] = ei + tw_re_[k] * oi + tw_im_[k] * orr;
+        }
+    }
+
+private:
+    size_t n_;
+    BasicFFTPlan<Real> half_;
+    simd::aligned_vector<Real> tw_re_;
+    simd::aligned_vector<Real> tw_im_;
+    simd::aligned_vector<Real> work_re_;
+    simd::aligned_vector<Real> work_im_;
+};
+
+using FFTPlan = BasicFFTPlan<double>;
+using RealFFTPlan = BasicRealFFTPlan<double>;
+using FFTPlanF = BasicFFTPlan<float>;
+using RealFFTPlanF = BasicRealFFTPlan<float>;
+
+#endif // FFT_PLAN_HPP
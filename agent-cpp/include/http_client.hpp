@@ -1,67 +1,163 @@
 #ifndef HTTP_CLIENT_HPP
 #define HTTP_CLIENT_HPP
 
+#include "body_compressor.hpp"
+#include "bounded_queue.hpp"
+#include "interval_reducer.hpp"
+#include "metric_point.hpp"
+#include "retry_scheduler.hpp"
+#include "spool.hpp"
+#include "transport.hpp"
+#include <array>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
-struct MetricPoint {
-  double temperature_c;
-  double vibration_g;
-  double humidity_pct;
-  double voltage_v;
-  std::string ts; // ISO 8601 timestamp
+struct HttpClientOptions : TransportOptions {
+  long timeout_ms = 10000;        // Whole-request timeout
+  size_t max_in_flight = 8;       // Concurrent async uploads (1 per device)
+  long connect_timeout_ms = 5000; // TCP/TLS connect timeout
+  long dns_cache_timeout_s = 300; // How long resolved addresses are reused
+  long keepalive_idle_s = 30;     // TCP keep-alive probe interval
+  bool http2 = false;             // Negotiate HTTP/2 (over TLS) and multiplex
+  int worker_cpu = -1;            // Pin the upload worker thread; -1 = no pinning
+
+  // Columnar batches fall back to JSON for the client's lifetime if the
+  // backend answers 415 (or a 400 saying the content type is unsupported).
+  // Any other 400 resends that batch as JSON and pauses columnar for
+  // columnar_retry_s, since older backends answer 400 to any body they
+  // cannot parse
+  WireFormat wire_format = WireFormat::Json;
+  unsigned columnar_mantissa_bits = 24; // 52 = lossless
+  long columnar_retry_s = 60;           // Clamped to at least 1
+
+  // Content-Encoding for bodies of at least compression_min_bytes. An
+  // encoding this build lacks, or one the backend answers 415 to, steps
+  // down zstd -> gzip -> none for the client's lifetime
+  Compression compression = Compression::None;
+  int compression_level = 0; // 0 = library default
+  size_t compression_min_bytes = 1024;
+  std::string zstd_dictionary_path; // Shared dictionary (zstd --train)
+
+  // Async batching: queued points for the same device are merged into one
+  // request once any limit is reached or the oldest point has waited
+  // max_linger_ms (0 sends whatever is queued right away)
+  size_t max_batch_points = 500;
+  size_t max_batch_bytes = 256 * 1024;
+  long max_linger_ms = 0;
+
+  // Async retries never block a caller: a batch that fails with a 5xx,
+  // 408, 429 or transport error goes back into staging, merged with newer
+  // points, and is retried after an exponential backoff with jitter (see
+  // retry_scheduler.hpp for the circuit breaker). Other 4xx responses drop
+  // the batch. At most retry_buffer_points per device are held meanwhile;
+  // the oldest are dropped beyond that.
+  RetryOptions retry;
+  size_t retry_buffer_points = 50000;
 };
 
-class HttpClient {
+class HttpClient : public Transport {
 public:
-  HttpClient(const std::string &base_url);
-  ~HttpClient();
+  HttpClient(const std::string &base_url,
+             const HttpClientOptions &options = HttpClientOptions());
+  ~HttpClient() override;
+
+  HttpClient(const HttpClient &) = delete;
+  HttpClient &operator=(const HttpClient &) = delete;
 
-  // POST metrics to /api/ingest (blocking)
+  // POST metrics to /api/ingest (blocking, single attempt)
   bool postMetrics(const std::string &device_id,
                    const std::vector<MetricPoint> &metrics);
 
-  // POST metrics asynchronously (non-blocking)
-  void postMetricsAsync(const std::string &device_id,
-                        const std::vector<MetricPoint> &metrics);
+  const char *name() const override { return "http"; }
 
-  // Get last error message
-  std::string getLastError() const;
+  // POST interval summaries to /api/ingest/summary (blocking, single
+  // attempt, always JSON). A Reject with http_status 404 or 405 means the
+  // backend predates summaries.
+  UploadResult postSummaries(const std::string &device_id,
+                             const std::vector<IntervalSummary> &summaries);
 
   // Set API Key for ingest
-  void setApiKey(const std::string &key) { api_key_ = key; }
+  void setApiKey(const std::string &key);
   // Get API Key
-  const std::string &getApiKey() const { return api_key_; }
+  std::string getApiKey() const;
 
 private:
+  // Long-lived easy handle with its persistent request headers
+  struct Connection;
+
   std::string base_url_;
+  std::string ingest_url_;
+  std::string summary_url_;
+  HttpClientOptions options_;
+  mutable std::mutex settings_mutex_;
   std::string api_key_;
-  mutable std::mutex error_mutex_;
-  std::string last_error_;
+  std::atomic<unsigned> headers_version_;
+  std::atomic<bool> columnar_rejected_;
+  // steady_clock ticks until which requests are sent as JSON
+  std::atomic<int64_t> columnar_paused_until_;
+  std::atomic<Compression> compression_;
+  std::string zstd_dictionary_;
 
-  // Background worker for async requests
-  struct RequestTask {
-    std::string device_id;
+  // Shared DNS/TLS-session/connection cache for all handles
+  void *share_;
+  std::array<std::mutex, 8> share_locks_;
+
+  // Blocking callers share one warm connection
+  std::unique_ptr<Connection> blocking_conn_;
+  std::mutex blocking_mutex_;
+  std::unique_ptr<Connection> summary_conn_; // Points at summary_url_
+  std::mutex summary_mutex_;
+
+  // Worker event loop: up to max_in_flight connections driven by one
+  // curl multi handle; idle ones stay warm for the next request
+  void *multi_;
+  std::vector<std::unique_ptr<Connection>> worker_conns_;
+  std::vector<Connection *> idle_conns_;
+  size_t in_flight_ = 0;
+
+  // Worker-side staging of merged points per device
+  struct PendingBatch {
     std::vector<MetricPoint> metrics;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point first_enqueued;
+    bool in_flight = false; // At most one request per device, in order
   };
 
-  std::queue<RequestTask> task_queue_;
-  std::mutex queue_mutex_;
-  std::condition_variable cv_;
+  std::unordered_map<std::string, PendingBatch> pending_;
+
+  // Worker-only backoff/breaker state shared by batches and spool replay
+  RetryScheduler retry_;
+
   std::thread worker_thread_;
   std::atomic<bool> stop_worker_;
 
   void workerLoop();
-  void setLastError(const std::string &error);
+  void wakeWorker() override;
+  void stagePoint(const std::string &device_id, const MetricPoint &point);
+  void submitDueBatches();
+  void replaySpools();
+  std::chrono::steady_clock::time_point nextWakeup() const;
+  Connection *acquireConnection();
+  void startTransfer(Connection &conn);
+  void processCompletions();
+  void completeTransfer(Connection &conn, SendOutcome outcome);
+  static size_t estimateJsonBytes(const MetricPoint &point);
 
-  // Helper to format JSON
-  std::string formatMetricsJson(const std::string &device_id,
-                                const std::vector<MetricPoint> &metrics);
+  std::unique_ptr<Connection> openConnection();
+  void refreshHeaders(Connection &conn);
+  void attachBody(Connection &conn, std::string_view body);
+  void prepareRequest(Connection &conn, const std::string &device_id,
+                      const std::vector<MetricPoint> &metrics);
+  SendOutcome finishRequest(Connection &conn, int curl_code, bool &resend);
+  SendOutcome send(Connection &conn, const std::string &device_id,
+                   const std::vector<MetricPoint> &metrics);
 };
 
 #endif // HTTP_CLIENT_HPP
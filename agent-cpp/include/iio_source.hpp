@@ -0,0 +1,82 @@
+#ifndef IIO_SOURCE_HPP
+#define IIO_SOURCE_HPP
+
+#include "sensor_source.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * One channel of a Linux IIO device in buffered (triggered or FIFO) mode
+ *
+ * The constructor enables only the requested scan element, sets the
+ * sampling frequency and the buffer watermark to one block, and enables
+ * the buffer. read() polls /dev/iio:deviceN and takes every complete
+ * frame the kernel holds, up to 4 blocks, in one read(); the raw frames
+ * are decoded in place into a preallocated buffer, scaled to g for
+ * accelerometer channels (channel units times _scale otherwise). A
+ * device that needs a trigger must have current_trigger set beforehand.
+ * Sample timestamps are reconstructed from the read time and the rate.
+ */
+class IioSource : public SensorSource {
+public:
+    struct Options {
+        std::string device = "iio:device0"; // Or the device's name attribute
+        std::string channel = "in_accel_z";
+        double sample_rate_hz = 1000.0;     // 0 keeps the device's rate
+        size_t block = 0;                    // 0 = about 10 ms of samples
+        int realtime_priority = 0;
+        int cpu = -1;
+        std::string sysfs_dir = "/sys/bus/iio/devices";
+        std::string dev_dir = "/dev";
+    };
+
+    explicit IioSource(const Options& options);
+    ~IioSource() override;
+
+    IioSource(const IioSource&) = delete;
+    IioSource& operator=(const IioSource&) = delete;
+
+    // False if the device could not be set up; see error()
+    bool ok() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    const char* name() const override { return "iio"; }
+    double sampleRate() const override { return rate_hz_; }
+    size_t blockSize() const override { return block_; }
+    bool configureThread(std::string& error) const override;
+    bool read(SampleBlock& block, std::string& error) override;
+
+    // Device directory in use, e.g. /sys/bus/iio/devices/iio:device0
+    const std::string& devicePath() const { return device_path_; }
+
+private:
+    // Storage of one scan element, from its _type attribute ("le:s12/16>>4")
+    struct ScanType {
+        bool big_endian = false;
+        bool is_signed = true;
+        unsigned bits = 16;
+        unsigned storage_bytes = 2;
+        unsigned shift = 0;
+    };
+
+    bool setup();
+    bool parseScanType(const std::string& text);
+    double decode(const unsigned char* raw) const;
+
+    Options options_;
+    std::string error_;
+    std::string device_path_;
+    int fd_ = -1;
+    bool buffer_enabled_ = false;
+    ScanType type_;
+    double scale_ = 1.0;
+    double offset_ = 0.0;
+    double rate_hz_ = 0.0;
+    size_t block_ = 0;
+    uint64_t next_index_ = 0;
+    std::vector<unsigned char> raw_;
+    std::vector<double> values_;
+};
+
+#endif // IIO_SOURCE_HPP
@@ -0,0 +1,320 @@
+#ifndef INTERVAL_REDUCER_HPP
+#define INTERVAL_REDUCER_HPP
+
+#include "metric_point.hpp"
+#include "metric_registry.hpp"
+#include "spectral_features.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Upload reduction: "raw" sends every sample, "aggregate" sends one
+ * IntervalSummary per interval plus raw samples around local anomalies
+ */
+enum class ReductionMode {
+    Raw,
+    Aggregate,
+};
+
+// Parse "raw" or "aggregate"; false (mode unchanged) for anything else
+inline bool parseReductionMode(const std::string& name, ReductionMode& mode) {
+    if (name == "raw") {
+        mode = ReductionMode::Raw;
+    } else if (name == "aggregate") {
+        mode = ReductionMode::Aggregate;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+constexpr size_t kSpectralBands = 8;
+
+struct MetricAggregate {
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0; // Population
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+/**
+ * One reduced upload interval [start_ms, end_ms)
+ * Trivially copyable, so it can travel through pipeline stage rings.
+ */
+struct IntervalSummary {
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    uint32_t count = 0;      // Samples in the interval
+    uint32_t anomalies = 0;  // Samples flagged by local analytics
+    uint32_t raw_points = 0; // Samples sent at full resolution (anomaly windows)
+    MetricMask metrics = 0;  // Which entries of aggregates are filled in
+    std::array<MetricAggregate, kMetricCount> aggregates{};
+
+    // Mean power per equal-width band from 0 Hz to Nyquist over the
+    // interval's FFT frames, DC bin excluded; spectral_frames = 0 if none
+    uint32_t spectral_frames = 0;
+    double band_width_hz = 0.0;
+    std::array<double, kSpectralBands> band_energy{};
+
+    // Frame features over the interval; feature_frames = 0 if none. rms,
+    // centroid, band powers and defect amplitudes are means; peak, crest
+    // factor, kurtosis and the envelope peak are the worst frame's, and
+    // dominant_hz is that of the loudest frame
+    uint32_t feature_frames = 0;
+    SpectralFeatures features{};
+};
+
+/**
+ * Reduces a sample stream to per-interval summaries
+ *
+ * Intervals are aligned to multiples of interval_ms since the epoch, so
+ * summaries from different devices line up. Samples are kept for the
+ * open interval only (for exact percentiles) in buffers sized once from
+ * expected_samples. Around every locally flagged sample, the last
+ * pre_samples and the next post_samples go to the raw callback at full
+ * resolution; a new anomaly inside the post window extends it. Not
+ * thread-safe; one reducer per device and analytics stage.
+ */
+class IntervalReducer {
+public:
+    struct Options {
+        int64_t interval_ms = 10000;
+        size_t pre_samples = 0;
+        size_t post_samples = 0;
+        size_t expected_samples = 0; // Samples per interval, for preallocation
+        MetricMask metrics = kAllMetrics;
+    };
+
+    explicit IntervalReducer(const Options& options)
+        : options_(options), pre_(options.pre_samples) {
+        options_.interval_ms = std::max<int64_t>(options_.interval_ms, 1);
+        options_.metrics &= kAllMetrics;
+        for (auto& values : values_) {
+            values.reserve(options_.expected_samples);
+        }
+    }
+
+    /**
+     * True if ts_ms falls past the open interval, which must then be
+     * close()d before the sample is added
+     */
+    bool due(int64_t ts_ms) const {
+        return summary_.count > 0 && ts_ms >= summary_.end_ms;
+    }
+
+    /**
+     * Add one sample; emit_raw(const MetricPoint&) is called for every
+     * point that should go upstream at full resolution, oldest first
+     */
+    template <typename EmitRaw>
+    void add(const MetricPoint& point, bool anomaly, EmitRaw&& emit_raw) {
+        if (summary_.count == 0) {
+            summary_.start_ms = alignDown(point.ts_ms);
+            summary_.end_ms = summary_.start_ms + options_.interval_ms;
+        }
+        ++summary_.count;
+        for (MetricId id : kAllMetricIds) {
+            if (options_.metrics & metricBit(id)) {
+                values_[metricIndex(id)].push_back(metricValue(point, id));
+            }
+        }
+
+        if (anomaly) {
+            ++summary_.anomalies;
+            // Flush the lead-in, oldest first
+            for (size_t i = 0; i < pre_count_; ++i) {
+                emitRaw(pre_[(pre_head_ + pre_.size() - pre_count_ + i) % pre_.size()], emit_raw);
+            }
+            pre_count_ = 0;
+            emitRaw(point, emit_raw);
+            post_left_ = options_.post_samples;
+        } else if (post_left_ > 0) {
+            --post_left_;
+            emitRaw(point, emit_raw);
+        } else if (!pre_.empty()) {
+            pre_[pre_head_] = point;
+            pre_head_ = (pre_head_ + 1) % pre_.size();
+            pre_count_ = std::min(pre_count_ + 1, pre_.size());
+        }
+    }
+
+    /**
+     * Fold one FFT frame (bin magnitudes from 0 Hz, bin_hz apart) into
+     * the interval's band energies
+     */
+    void addSpectrum(const double* magnitudes, size_t bins, double bin_hz) {
+        if (bins < kSpectralBands + 1) return;
+        for (size_t b = 0; b < kSpectralBands; ++b) {
+            size_t first = std::max<size_t>(b * bins / kSpectralBands, 1);
+            size_t last = (b + 1) * bins / kSpectralBands;
+            double energy = 0.0;
+            for (size_t k = first; k < last; ++k) {
+                energy += magnitudes[k] * magnitudes[k];
+            }
+            band_sum_[b] += energy;
+        }
+        ++summary_.spectral_frames;
+        summary_.band_width_hz = bin_hz * static_cast<double>(bins) / kSpectralBands;
+    }
+
+    /**
+     * Fold one frame's features into the interval
+     */
+    void addFeatures(const SpectralFeatures& f) {
+        SpectralFeatures& worst = summary_.features;
+        if (summary_.feature_frames == 0 || f.rms > loudest_rms_) {
+            loudest_rms_ = f.rms;
+            worst.dominant_hz = f.dominant_hz;
+        }
+        if (summary_.feature_frames == 0) {
+            worst.peak = f.peak;
+            worst.crest_factor = f.crest_factor;
+            worst.kurtosis = f.kurtosis;
+            worst.envelope_peak = f.envelope_peak;
+            worst.envelope_peak_hz = f.envelope_peak_hz;
+        } else {
+            worst.peak = std::max(worst.peak, f.peak);
+            worst.crest_factor = std::max(worst.crest_factor, f.crest_factor);
+            worst.kurtosis = std::max(worst.kurtosis, f.kurtosis);
+            if (f.envelope_peak > worst.envelope_peak) {
+                worst.envelope_peak = f.envelope_peak;
+                worst.envelope_peak_hz = f.envelope_peak_hz;
+            }
+        }
+        worst.band_count = f.band_count;
+        worst.defect_count = f.defect_count;
+
+        feature_sum_.rms += f.rms;
+        feature_sum_.centroid_hz += f.centroid_hz;
+        for (size_t b = 0; b < f.band_count; ++b) {
+            feature_sum_.band_power[b] += f.band_power[b];
+        }
+        for (size_t d = 0; d < f.defect_count; ++d) {
+            feature_sum_.defect_amplitude[d] += f.defect_amplitude[d];
+        }
+        ++summary_.feature_frames;
+    }
+
+    /**
+     * Finish the open interval and start the next one
+     * The summary stays valid until the next add().
+     */
+    const IntervalSummary& close() {
+        closed_ = summary_;
+        closed_.metrics = summary_.count > 0 ? options_.metrics : 0;
+        for (MetricId id : kAllMetricIds) {
+            size_t i = metricIndex(id);
+            if (closed_.metrics & metricBit(id)) {
+                closed_.aggregates[i] = aggregate(values_[i]);
+            }
+            values_[i].clear();
+        }
+        if (closed_.spectral_frames > 0) {
+            for (size_t b = 0; b < kSpectralBands; ++b) {
+                closed_.band_energy[b] = band_sum_[b] / closed_.spectral_frames;
+            }
+        }
+        band_sum_.fill(0.0);
+        if (closed_.feature_frames > 0) {
+            SpectralFeatures& f = closed_.features;
+            double frames = static_cast<double>(closed_.feature_frames);
+            f.rms = feature_sum_.rms / frames;
+            f.centroid_hz = feature_sum_.centroid_hz / frames;
+            for (size_t b = 0; b < f.band_count; ++b) {
+                f.band_power[b] = feature_sum_.band_power[b] / frames;
+            }
+            for (size_t d = 0; d < f.defect_count; ++d) {
+                f.defect_amplitude[d] = feature_sum_.defect_amplitude[d] / frames;
+            }
+        }
+        feature_sum_ = SpectralFeatures();
+        summary_ = IntervalSummary();
+        return closed_;
+    }
+
+    const Options& options() const { return options_; }
+
+private:
+    static double metricValue(const MetricPoint& point, MetricId id) {
+        switch (id) {
+        case MetricId::Temperature: return point.temperature_c;
+        case MetricId::Vibration: return point.vibration_g;
+        case MetricId::Humidity: return point.humidity_pct;
+        case MetricId::Voltage: return point.voltage_v;
+        }
+        return 0.0;
+    }
+
+    int64_t alignDown(int64_t ts_ms) const {
+        int64_t r = ts_ms % options_.interval_ms;
+        return ts_ms - (r < 0 ? r + options_.interval_ms : r);
+    }
+
+    template <typename EmitRaw>
+    void emitRaw(const MetricPoint& point, EmitRaw& emit_raw) {
+        ++summary_.raw_points;
+        emit_raw(point);
+    }
+
+    // Zero-based nearest-rank index of quantile q among n values
+    static size_t rankIndex(size_t n, double q) {
+        size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(n)));
+        return std::clamp<size_t>(rank, 1, n) - 1;
+    }
+
+    static MetricAggregate aggregate(std::vector<double>& values) {
+        MetricAggregate a;
+        if (values.empty()) return a;
+        double sum = 0.0;
+        a.min = a.max = values[0];
+        for (double v : values) {
+            sum += v;
+            a.min = std::min(a.min, v);
+            a.max = std::max(a.max, v);
+        }
+        a.mean = sum / static_cast<double>(values.size());
+        double sq = 0.0;
+        for (double v : values) {
+            sq += (v - a.mean) * (v - a.mean);
+        }
+        a.stddev = std::sqrt(sq / static_cast<double>(values.size()));
+
+        // Each nth_element leaves everything above its rank to the right,
+        // so the higher quantiles only search what is left
+        size_t n = values.size();
+        size_t k50 = rankIndex(n, 0.50);
+        size_t k95 = rankIndex(n, 0.95);
+        size_t k99 = rankIndex(n, 0.99);
+        std::nth_element(values.begin(), values.begin() + k50, values.end());
+        a.p50 = values[k50];
+        std::nth_element(values.begin() + k50, values.begin() + k95, values.end());
+        a.p95 = values[k95];
+        std::nth_element(values.begin() + k95, values.begin() + k99, values.end());
+        a.p99 = values[k99];
+        return a;
+    }
+
+    Options options_;
+    IntervalSummary summary_;
+    IntervalSummary closed_;
+    std::array<std::vector<double>, kMetricCount> values_;
+    std::array<double, kSpectralBands> band_sum_{};
+    SpectralFeatures feature_sum_;
+    double loudest_rms_ = 0.0;
+
+    // Lead-in ring of the last pre_samples points not yet sent raw
+    std::vector<MetricPoint> pre_;
+    size_t pre_head_ = 0;
+    size_t pre_count_ = 0;
+    size_t post_left_ = 0;
+};
+
+#endif // INTERVAL_REDUCER_HPP
@@ -0,0 +1,36 @@
+#ifndef JSON_READER_HPP
+#define JSON_READER_HPP
+
+#include <functional>
+#include <string>
+
+/**
+ * One scalar reported by parseJson()
+ * text is the unescaped string, the number exactly as written, or
+ * "true", "false" or "null".
+ */
+struct JsonScalar {
+    enum class Type {
+        String,
+        Number,
+        Bool,
+        Null,
+    };
+    Type type = Type::Null;
+    std::string text;
+};
+
+using JsonScalarHandler = std::function<void(const std::string& path, const JsonScalar& value)>;
+
+/**
+ * Strict single-pass (SAX-style) JSON reader
+ *
+ * Every scalar is reported in document order with its dotted path from
+ * the root: "interval_ms", "metrics.vibration", "bands.0". No document
+ * tree is built. Objects and arrays nest at most 64 deep. On malformed
+ * input, returns false with "line L, column C: reason" in error; scalars
+ * before the error have already been reported.
+ */
+bool parseJson(const std::string& text, const JsonScalarHandler& on_value, std::string& error);
+
+#endif // JSON_READER_HPP
@@ -1,17 +1,23 @@
 #ifndef LOCAL_ANALYTICS_HPP
 #define LOCAL_ANALYTICS_HPP
 
+#include "metric_registry.hpp"
+#include "rolling_window.hpp"
+#include <array>
+#include <string_view>
 #include <vector>
-#include <deque>
-#include <map>
-#include <string>
 #include <cmath>
 #include <algorithm>
-#include <numeric>
 
 /**
  * Local analytics module for edge-side anomaly detection
- * Implements running mean and z-score calculation for lightweight anomaly detection
+ * Implements running mean and z-score calculation for lightweight anomaly detection.
+ * Statistics are maintained incrementally, so an update costs the same
+ * regardless of window size.
+ *
+ * Per-metric state is indexed by MetricId: windows for all registered
+ * metrics share one allocation (a ring plane followed by a sorted plane),
+ * and the running moments and stats sit in fixed arrays next to it.
  */
 class LocalAnalytics {
 public:
@@ -19,29 +25,35 @@ public:
         double mean;
         double stddev;
         size_t count;
+        double min = 0.0;
+        double max = 0.0;
+        double median = 0.0;
+        double mad = 0.0; // Median absolute deviation
     };
 
-    LocalAnalytics(size_t window_size = 200, double z_threshold = 3.0)
-        : window_size_(window_size), z_threshold_(z_threshold) {}
+    LocalAnalytics(size_t window_size = 200, double z_threshold = 3.0,
+                   MetricMask enabled = kAllMetrics)
+        : window_size_(std::max<size_t>(window_size, 1)),
+          z_threshold_(z_threshold),
+          enabled_(enabled & kAllMetrics),
+          samples_(2 * kMetricCount * window_size_) {}
 
     /**
      * Update statistics for a metric value
      * Returns true if anomaly detected (z-score > threshold)
+     * NaN and infinite readings are counted and dropped; once in the
+     * sorted window they would never be found again to evict.
      */
-    bool updateMetric(const std::string& metric_name, double value) {
-        auto& window = windows_[metric_name];
-        auto& stats = statistics_[metric_name];
-
-        // Add new value to window
-        window.push_back(value);
-        if (window.size() > window_size_) {
-            window.pop_front();
+    bool updateMetric(MetricId id, double value) {
+        size_t i = metricIndex(id);
+        if (!std::isfinite(value)) {
+            ++non_finite_[i];
+            return false;
         }
+        rolling::push(moments_[i], ring(i), sorted(i), window_size_, value);
+        refreshStats(i);
 
-        // Recalculate statistics
-        updateStats(metric_name, window, stats);
-
-        // Check for anomaly
+        const Stats& stats = stats_[i];
         if (stats.count >= 10) { // Need at least 10 samples for meaningful z-score
             double z_score = std::abs((value - stats.mean) / stats.stddev);
             return z_score > z_threshold_;
@@ -51,26 +63,33 @@ public:
     }
 
     /**
-     * Get current statistics for a metric
+     * Update every enabled metric in one pass
+     * Returns a mask of the metrics flagged as anomalous
      */
-    Stats getStats(const std::string& metric_name) const {
-        auto it = statistics_.find(metric_name);
-        if (it != statistics_.end()) {
-            return it->second;
+    MetricMask updateAll(const MetricValues& values) {
+        MetricMask anomalies = 0;
+        for (MetricId id : kAllMetricIds) {
+            if ((enabled_ & metricBit(id)) && updateMetric(id, values[metricIndex(id)])) {
+                anomalies |= metricBit(id);
+            }
         }
-        return {0.0, 0.0, 0};
+        return anomalies;
+    }
+
+    /**
+     * Get current statistics for a metric
+     */
+    const Stats& getStats(MetricId id) const {
+        return stats_[metricIndex(id)];
     }
 
     /**
      * Get z-score for a value without updating statistics
      */
-    double getZScore(const std::string& metric_name, double value) const {
-        auto it = statistics_.find(metric_name);
-        if (it != statistics_.end() && it->second.count >= 10) {
-            const auto& stats = it->second;
-            if (stats.stddev > 0.0) {
-                return std::abs((value - stats.mean) / stats.stddev);
-            }
+    double getZScore(MetricId id, double value) const {
+        const Stats& stats = stats_[metricIndex(id)];
+        if (stats.count >= 10 && stats.stddev > 0.0) {
+            return std::abs((value - stats.mean) / stats.stddev);
         }
         return 0.0;
     }
@@ -78,52 +97,87 @@ public:
     /**
      * Reset statistics for a metric
      */
-    void reset(const std::string& metric_name) {
-        windows_.erase(metric_name);
-        statistics_.erase(metric_name);
+    void reset(MetricId id) {
+        size_t i = metricIndex(id);
+        moments_[i] = rolling::Moments();
+        stats_[i] = Stats{0.0, 0.0, 0};
     }
 
     /**
      * Reset all statistics
      */
     void resetAll() {
-        windows_.clear();
-        statistics_.clear();
+        for (MetricId id : kAllMetricIds) {
+            reset(id);
+        }
     }
 
-private:
-    void updateStats(const std::string& metric_name, 
-                    const std::deque<double>& window,
-                    Stats& stats) {
-        if (window.empty()) {
-            stats = {0.0, 0.0, 0};
-            return;
+    MetricMask enabledMetrics() const { return enabled_; }
+
+    /**
+     * Non-finite readings dropped for a metric
+     */
+    size_t nonFiniteCount(MetricId id) const { return non_finite_[metricIndex(id)]; }
+
+    // Name-based compatibility wrappers; unregistered names are ignored
+
+    bool updateMetric(std::string_view metric_name, double value) {
+        MetricId id;
+        return metricFromName(metric_name, id) && updateMetric(id, value);
+    }
+
+    Stats getStats(std::string_view metric_name) const {
+        MetricId id;
+        if (metricFromName(metric_name, id)) {
+            return getStats(id);
         }
+        return {0.0, 0.0, 0};
+    }
 
-        stats.count = window.size();
+    double getZScore(std::string_view metric_name, double value) const {
+        MetricId id;
+        return metricFromName(metric_name, id) ? getZScore(id, value) : 0.0;
+    }
 
-        // Calculate mean
-        double sum = std::accumulate(window.begin(), window.end(), 0.0);
-        stats.mean = sum / stats.count;
+    void reset(std::string_view metric_name) {
+        MetricId id;
+        if (metricFromName(metric_name, id)) {
+            reset(id);
+        }
+    }
 
-        // Calculate standard deviation
-        if (stats.count > 1) {
-            double variance = 0.0;
-            for (double val : window) {
-                double diff = val - stats.mean;
-                variance += diff * diff;
-            }
-            stats.stddev = std::sqrt(variance / (stats.count - 1));
-        } else {
-            stats.stddev = 0.0;
+private:
+    double* ring(size_t i) { return samples_.data() + i * window_size_; }
+    double* sorted(size_t i) { return samples_.data() + (kMetricCount + i) * window_size_; }
+    const double* sorted(size_t i) const {
+        return samples_.data() + (kMetricCount + i) * window_size_;
+    }
+
+    void refreshStats(size_t i) {
+        const rolling::Moments& m = moments_[i];
+        Stats& stats = stats_[i];
+        if (m.count == 0) {
+            stats = {0.0, 0.0, 0};
+            return;
         }
+
+        const double* s = sorted(i);
+        stats.count = m.count;
+        stats.mean = m.mean;
+        stats.stddev = rolling::stddev(m);
+        stats.min = s[0];
+        stats.max = s[m.count - 1];
+        stats.median = rolling::median(s, m.count);
+        stats.mad = rolling::mad(s, m.count, stats.median);
     }
 
     size_t window_size_;
     double z_threshold_;
-    std::map<std::string, std::deque<double>> windows_;
-    std::map<std::string, Stats> statistics_;
+    MetricMask enabled_;
+    std::vector<double> samples_;
+    std::array<rolling::Moments, kMetricCount> moments_{};
+    std::array<Stats, kMetricCount> stats_{};
+    std::array<size_t, kMetricCount> non_finite_{};
 };
 
 #endif // LOCAL_ANALYTICS_HPP
-
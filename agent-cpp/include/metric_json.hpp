@@ -0,0 +1,252 @@
+#ifndef METRIC_JSON_HPP
+#define METRIC_JSON_HPP
+
+#include "interval_reducer.hpp"
+#include "metric_point.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Compact JSON serializer for ingest payloads
+ *
+ *   {"deviceId":"...","metrics":[{"ts":"...","temperature_c":21.50,...}]}
+ *
+ * Writes straight into a buffer that is reused across calls (it only
+ * grows, so steady-state batches do not allocate). Numbers go through
+ * std::to_chars with two fixed decimals, matching the previous
+ * iostream output; timestamps use a cached IsoTimestampFormatter.
+ */
+class MetricsJsonWriter {
+public:
+    // Typical size of one serialized point, for batch size estimates
+    static constexpr size_t kTypicalPointBytes = 112;
+
+    /**
+     * Serialize points; the view is valid until the next write()
+     */
+    std::string_view write(const std::string& device_id, const MetricPoint* points, size_t count) {
+        len_ = 0;
+        append("{\"deviceId\":\"");
+        appendEscaped(device_id);
+        append("\",\"metrics\":[");
+
+        for (size_t i = 0; i < count; ++i) {
+            const MetricPoint& m = points[i];
+            ensure(kMaxPointBytes);
+            if (i > 0) buf_[len_++] = ',';
+            append("{");
+            if (m.ts_ms != 0) {
+                append("\"ts\":\"");
+                len_ = timestamps_.write(m.ts_ms, buf_.data() + len_) - buf_.data();
+                append("\",");
+            }
+            append("\"temperature_c\":");
+            appendNumber(m.temperature_c);
+            append(",\"vibration_g\":");
+            appendNumber(m.vibration_g);
+            append(",\"humidity_pct\":");
+            appendNumber(m.humidity_pct);
+            append(",\"voltage_v\":");
+            appendNumber(m.voltage_v);
+            append("}");
+        }
+
+        append("]}");
+        return std::string_view(buf_.data(), len_);
+    }
+
+    /**
+     * Serialize interval summaries for /api/ingest/summary:
+     *
+     *   {"deviceId":"...","summaries":[{"start":"...","end":"...","count":N,
+     *    "anomalies":N,"rawPoints":N,"metrics":{"vibration_g":{"min":...,
+     *    "max":...,"mean":...,"stddev":...,"p50":...,"p95":...,"p99":...}},
+     *    "spectrum":{"frames":N,"bandWidthHz":...,"bandEnergy":[...]},
+     *    "features":{"frames":N,"rms":...,"peak":...,"crestFactor":...,
+     *    "kurtosis":...,"dominantHz":...,"centroidHz":...,"bandPower":[...],
+     *    "envelope":{"peakHz":...,"peak":...,"defectAmplitude":[...]}}}]}
+     *
+     * Statistics use the shortest round-trip form rather than two fixed
+     * decimals, since a summary stands in for many raw values. The
+     * spectrum and features objects are omitted for intervals without FFT
+     * frames, and envelope when no demodulation band is configured.
+     */
+    std::string_view writeSummaries(const std::string& device_id, const IntervalSummary* summaries, size_t count) {
+        static constexpr const char* kFields[kMetricCount] = {"temperature_c", "vibration_g", "humidity_pct",
+                                                               "voltage_v"};
+        len_ = 0;
+        append("{\"deviceId\":\"");
+        appendEscaped(device_id);
+        append("\",\"summaries\":[");
+
+        for (size_t i = 0; i < count; ++i) {
+            const IntervalSummary& s = summaries[i];
+            if (i > 0) append(",");
+            append("{\"start\":\"");
+            ensure(IsoTimestampFormatter::kLength);
+            len_ = timestamps_.write(s.start_ms, buf_.data() + len_) - buf_.data();
+            append("\",\"end\":\"");
+            ensure(IsoTimestampFormatter::kLength);
+            len_ = timestamps_.write(s.end_ms, buf_.data() + len_) - buf_.data();
+            append("\",\"count\":");
+            appendInteger(s.count);
+            append(",\"anomalies\":");
+            appendInteger(s.anomalies);
+            append(",\"rawPoints\":");
+            appendInteger(s.raw_points);
+            append(",\"metrics\":{");
+            bool first = true;
+            for (MetricId id : kAllMetricIds) {
+                if (!(s.metrics & metricBit(id))) continue;
+                const MetricAggregate& a = s.aggregates[metricIndex(id)];
+                if (!first) append(",");
+                first = false;
+                append("\"");
+                append(kFields[metricIndex(id)]);
+                append("\":{\"min\":");
+                appendShortest(a.min);
+                append(",\"max\":");
+                appendShortest(a.max);
+                append(",\"mean\":");
+                appendShortest(a.mean);
+                append(",\"stddev\":");
+                appendShortest(a.stddev);
+                append(",\"p50\":");
+                appendShortest(a.p50);
+                append(",\"p95\":");
+                appendShortest(a.p95);
+                append(",\"p99\":");
+                appendShortest(a.p99);
+                append("}");
+            }
+            append("}");
+            if (s.spectral_frames > 0) {
+                append(",\"spectrum\":{\"frames\":");
+                appendInteger(s.spectral_frames);
+                append(",\"bandWidthHz\":");
+                appendShortest(s.band_width_hz);
+                append(",\"bandEnergy\":[");
+                for (size_t b = 0; b < kSpectralBands; ++b) {
+                    if (b > 0) append(",");
+                    appendShortest(s.band_energy[b]);
+                }
+                append("]}");
+            }
+            if (s.feature_frames > 0) {
+                appendFeatures(s.feature_frames, s.features);
+            }
+            append("}");
+        }
+
+        append("]}");
+        return std::string_view(buf_.data(), len_);
+    }
+
+private:
+    void appendFeatures(uint32_t frames, const SpectralFeatures& f) {
+        append(",\"features\":{\"frames\":");
+        appendInteger(frames);
+        append(",\"rms\":");
+        appendShortest(f.rms);
+        append(",\"peak\":");
+        appendShortest(f.peak);
+        append(",\"crestFactor\":");
+        appendShortest(f.crest_factor);
+        append(",\"kurtosis\":");
+        appendShortest(f.kurtosis);
+        append(",\"dominantHz\":");
+        appendShortest(f.dominant_hz);
+        append(",\"centroidHz\":");
+        appendShortest(f.centroid_hz);
+        append(",\"bandPower\":[");
+        for (size_t b = 0; b < f.band_count; ++b) {
+            if (b > 0) append(",");
+            appendShortest(f.band_power[b]);
+        }
+        append("]");
+        if (f.envelope_peak_hz > 0.0) {
+            append(",\"envelope\":{\"peakHz\":");
+            appendShortest(f.envelope_peak_hz);
+            append(",\"peak\":");
+            appendShortest(f.envelope_peak);
+            append(",\"defectAmplitude\":[");
+            for (size_t d = 0; d < f.defect_count; ++d) {
+                if (d > 0) append(",");
+                appendShortest(f.defect_amplitude[d]);
+            }
+            append("]}");
+        }
+        append("}");
+    }
+
+    // Room for four worst-case fixed-point doubles plus keys and timestamp
+    static constexpr size_t kMaxNumberBytes = 320;
+    static constexpr size_t kMaxPointBytes = 4 * kMaxNumberBytes + 128;
+
+    void ensure(size_t extra) {
+        if (len_ + extra > buf_.size()) {
+            buf_.resize(std::max(buf_.size() * 2, len_ + extra));
+        }
+    }
+
+    void append(const char* text) {
+        size_t n = std::strlen(text);
+        ensure(n);
+        std::memcpy(buf_.data() + len_, text, n);
+        len_ += n;
+    }
+
+    void appendNumber(double value) {
+        ensure(kMaxNumberBytes);
+        char* first = buf_.data() + len_;
+        auto res = std::to_chars(first, buf_.data() + buf_.size(), value,
+                                 std::chars_format::fixed, 2);
+        len_ = res.ptr - buf_.data();
+    }
+
+    void appendShortest(double value) {
+        ensure(kMaxNumberBytes);
+        if (!std::isfinite(value)) value = 0.0; // Not representable in JSON
+        char* first = buf_.data() + len_;
+        auto res = std::to_chars(first, buf_.data() + buf_.size(), value);
+        len_ = res.ptr - buf_.data();
+    }
+
+    void appendInteger(uint64_t value) {
+        ensure(24);
+        char* first = buf_.data() + len_;
+        auto res = std::to_chars(first, buf_.data() + buf_.size(), value);
+        len_ = res.ptr - buf_.data();
+    }
+
+    void appendEscaped(const std::string& text) {
+        ensure(text.size() * 6);
+        static const char kHex[] = "0123456789abcdef";
+        for (char c : text) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                buf_[len_++] = '\\';
+                buf_[len_++] = c;
+            } else if (u < 0x20) {
+                std::memcpy(buf_.data() + len_, "\\u00", 4);
+                buf_[len_ + 4] = kHex[u >> 4];
+                buf_[len_ + 5] = kHex[u & 0xf];
+                len_ += 6;
+            } else {
+                buf_[len_++] = c;
+            }
+        }
+    }
+
+    std::vector<char> buf_ = std::vector<char>(4096);
+    size_t len_ = 0;
+    IsoTimestampFormatter timestamps_;
+};
+
+#endif // METRIC_JSON_HPP
@@ -0,0 +1,120 @@
+#ifndef METRIC_POINT_HPP
+#define METRIC_POINT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * One sample of every metric
+ * Trivially copyable: the timestamp is kept as an integer and only
+ * rendered as ISO 8601 when a batch is serialized.
+ */
+struct MetricPoint {
+    double temperature_c;
+    double vibration_g;
+    double humidity_pct;
+    double voltage_v;
+    int64_t ts_ms = 0; // Unix epoch milliseconds (0 = no timestamp)
+};
+
+/**
+ * Current wall-clock time in Unix epoch milliseconds
+ */
+inline int64_t epochMillisNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Formats epoch milliseconds as "YYYY-MM-DDTHH:MM:SS.mmmZ" (UTC)
+ * The "YYYY-MM-DDTHH:MM:SS." prefix is cached and only rebuilt when the
+ * second changes, so consecutive samples cost a few byte copies. The
+ * calendar conversion is done arithmetically (no gmtime, no locale).
+ */
+class IsoTimestampFormatter {
+public:
+    static constexpr size_t kLength = 24;
+
+    /**
+     * Write exactly kLength characters (no terminator) to out
+     * Returns out + kLength
+     */
+    char* write(int64_t epoch_ms, char* out) {
+        int64_t second = epoch_ms / 1000;
+        int64_t ms = epoch_ms % 1000;
+        if (ms < 0) {
+            ms += 1000;
+            --second;
+        }
+        if (second != cached_second_) {
+            buildPrefix(second);
+        }
+
+        std::memcpy(out, prefix_, kPrefixLength);
+        out[20] = static_cast<char>('0' + ms / 100);
+        out[21] = static_cast<char>('0' + ms / 10 % 10);
+        out[22] = static_cast<char>('0' + ms % 10);
+        out[23] = 'Z';
+        return out + kLength;
+    }
+
+    /**
+     * NUL-terminated timestamp, valid until the next call
+     */
+    const char* format(int64_t epoch_ms) {
+        *write(epoch_ms, text_) = '\0';
+        return text_;
+    }
+
+private:
+    static constexpr size_t kPrefixLength = 20;
+
+    static void put2(char* out, unsigned v) {
+        out[0] = static_cast<char>('0' + v / 10 % 10);
+        out[1] = static_cast<char>('0' + v % 10);
+    }
+
+    void buildPrefix(int64_t second) {
+        int64_t days = second / 86400;
+        int64_t rem = second % 86400;
+        if (rem < 0) {
+            rem += 86400;
+            --days;
+        }
+
+        // Days since 1970-01-01 to a proleptic Gregorian date
+        days += 719468;
+        int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        unsigned doe = static_cast<unsigned>(days - era * 146097);
+        unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        unsigned mp = (5 * doy + 2) / 153;
+        unsigned day = doy - (153 * mp + 2) / 5 + 1;
+        unsigned month = mp < 10 ? mp + 3 : mp - 9;
+        int64_t year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2 ? 1 : 0);
+        unsigned y = static_cast<unsigned>(year < 0 ? 0 : year % 10000);
+
+        put2(prefix_, y / 100);
+        put2(prefix_ + 2, y % 100);
+        prefix_[4] = '-';
+        put2(prefix_ + 5, month);
+        prefix_[7] = '-';
+        put2(prefix_ + 8, day);
+        prefix_[10] = 'T';
+        put2(prefix_ + 11, static_cast<unsigned>(rem / 3600));
+        prefix_[13] = ':';
+        put2(prefix_ + 14, static_cast<unsigned>(rem / 60 % 60));
+        prefix_[16] = ':';
+        put2(prefix_ + 17, static_cast<unsigned>(rem % 60));
+        prefix_[19] = '.';
+        cached_second_ = second;
+    }
+
+    int64_t cached_second_ = INT64_MIN;
+    char prefix_[kPrefixLength] = {};
+    char text_[kLength + 1] = {};
+};
+
+#endif // METRIC_POINT_HPP
@@ -0,0 +1,71 @@
+#ifndef METRIC_REGISTRY_HPP
+#define METRIC_REGISTRY_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Compile-time registry of the metrics carried by a MetricPoint
+ * Metric IDs index per-metric state directly, so hot paths never
+ * hash or compare metric names.
+ */
+enum class MetricId : uint8_t {
+    Temperature = 0,
+    Vibration,
+    Humidity,
+    Voltage,
+};
+
+constexpr size_t kMetricCount = 4;
+
+constexpr std::array<std::string_view, kMetricCount> kMetricNames = {
+    "temperature",
+    "vibration",
+    "humidity",
+    "voltage",
+};
+
+constexpr std::array<MetricId, kMetricCount> kAllMetricIds = {
+    MetricId::Temperature,
+    MetricId::Vibration,
+    MetricId::Humidity,
+    MetricId::Voltage,
+};
+
+// Bit set of metric IDs
+using MetricMask = uint32_t;
+
+constexpr size_t metricIndex(MetricId id) {
+    return static_cast<size_t>(id);
+}
+
+constexpr MetricMask metricBit(MetricId id) {
+    return MetricMask(1) << metricIndex(id);
+}
+
+constexpr MetricMask kAllMetrics = (MetricMask(1) << kMetricCount) - 1;
+
+constexpr std::string_view metricName(MetricId id) {
+    return kMetricNames[metricIndex(id)];
+}
+
+/**
+ * Resolve a metric name to its ID
+ * Returns false if the name is not registered
+ */
+constexpr bool metricFromName(std::string_view name, MetricId& id) {
+    for (size_t i = 0; i < kMetricCount; ++i) {
+        if (kMetricNames[i] == name) {
+            id = kAllMetricIds[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// One value per registered metric, indexed by metricIndex()
+using MetricValues = std::array<double, kMetricCount>;
+
+#endif // METRIC_REGISTRY_HPP
@@ -0,0 +1,46 @@
+#ifndef METRICS_EXPORTER_HPP
+#define METRICS_EXPORTER_HPP
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+/**
+ * Serves AgentMetrics and/or logs a periodic summary
+ *
+ * With a port, a background thread answers `GET /metrics` in the
+ * Prometheus text format (one request at a time, which is all a scraper
+ * needs). With a dump interval, the same thread logs
+ * AgentMetrics::summaryLines() through the async logger. Neither touches
+ * the hot paths beyond reading their counters.
+ */
+class MetricsExporter {
+public:
+    struct Options {
+        int port = 0;                      // 0 = no HTTP endpoint
+        std::string bind_address = "127.0.0.1";
+        int dump_interval_s = 0;           // 0 = no periodic summary
+    };
+
+    explicit MetricsExporter(const Options& options);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // False if the endpoint was requested but could not listen; see error()
+    bool ok() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+
+private:
+    void run();
+    void serveOne();
+
+    Options options_;
+    int listen_fd_ = -1;
+    std::string error_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+#endif // METRICS_EXPORTER_HPP
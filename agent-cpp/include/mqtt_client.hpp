@@ -0,0 +1,165 @@
+#ifndef MQTT_CLIENT_HPP
+#define MQTT_CLIENT_HPP
+
+#include "bounded_queue.hpp"
+#include "columnar_codec.hpp"
+#include "config.hpp"
+#include "http_client.hpp"
+#include "metric_json.hpp"
+#include "metric_point.hpp"
+#include "spool.hpp"
+#include "transport.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct mosquitto;
+
+// True if this build links libmosquitto (HAVE_MOSQUITTO)
+bool mqttAvailable();
+
+struct MqttClientOptions : TransportOptions {
+  std::string client_id; // Empty = generated by the broker library
+  int keepalive_s = 30;
+
+  // QoS 1 messages stay in flight until the broker's PUBACK; at most
+  // max_in_flight of them are outstanding, and staged points wait for a
+  // free slot. QoS 0 messages count as sent once libmosquitto queues them.
+  int qos = 1;
+  size_t max_in_flight = 16;
+
+  // Background reconnect: the network thread retries after reconnect_min_s,
+  // doubling up to reconnect_max_s, without ever blocking a producer
+  unsigned reconnect_min_s = 1;
+  unsigned reconnect_max_s = 30;
+
+  int worker_cpu = -1; // Pin the publish worker thread; -1 = no pinning
+
+  // Payload encoding: the /api/ingest JSON body, or the columnar batch
+  // (both carry the device id; the bridge tells them apart by the magic)
+  WireFormat wire_format = WireFormat::Json;
+  unsigned columnar_mantissa_bits = 24;
+
+  // Batching: staged points for the same device are packed into one
+  // PUBLISH once any limit is reached or the oldest point has waited
+  // max_linger_ms (0 publishes whatever is staged right away)
+  size_t max_batch_points = 500;
+  size_t max_batch_bytes = 256 * 1024;
+  long max_linger_ms = 0;
+
+  // Points staged per device while the broker is unreachable or the
+  // window is full; the oldest are dropped beyond this
+  size_t retry_buffer_points = 50000;
+
+  // Spooled points (TransportOptions::spool_dir) are only consumed once
+  // their PUBLISH is acknowledged
+};
+
+// Publishes batches of points to sensors/<device_id>/metrics on an MQTT
+// broker, for the backend's MQTT bridge.
+//
+// libmosquitto's threaded loop owns the socket: it connects, reconnects
+// with backoff and resends unacknowledged QoS 1 messages after a
+// reconnect. A separate worker thread drains the producer rings, packs
+// each device's points into as few PUBLISHes as the batch limits allow
+// and keeps up to max_in_flight of them outstanding, so neither sampling
+// nor batching ever waits on the network.
+class MqttClient : public Transport {
+public:
+  // broker_url: mqtt://host[:port] or host[:port] (port 1883 by default)
+  MqttClient(const std::string &broker_url,
+             const MqttClientOptions &options = MqttClientOptions());
+  ~MqttClient() override;
+
+  MqttClient(const MqttClient &) = delete;
+  MqttClient &operator=(const MqttClient &) = delete;
+
+  // False if the client could not be created (bad URL, or no libmosquitto
+  // in this build); see error(). Connection failures are not errors: the
+  // client keeps reconnecting in the background.
+  bool ok() const { return error_.empty(); }
+  const std::string &error() const { return error_; }
+
+  // Broker connection is up
+  bool connected() const { return connected_.load(std::memory_order_relaxed); }
+
+  // Topic the points of device_id are published to
+  static std::string topicFor(const std::string &device_id);
+
+  const char *name() const override { return "mqtt"; }
+
+private:
+  // One PUBLISH awaiting its PUBACK
+  struct Message {
+    std::string device_id;
+    size_t points = 0;
+    MetricProducer::Channel *spool_channel = nullptr; // Set for spool replay
+    std::chrono::steady_clock::time_point started;
+    SendOutcome outcome = SendOutcome::Sent;
+    std::string error;
+  };
+
+  // Worker-side staging of points per device
+  struct PendingBatch {
+    std::vector<MetricPoint> metrics;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point first_enqueued;
+  };
+
+  std::string host_;
+  int port_ = 1883;
+  MqttClientOptions options_;
+  std::string error_; // Construction only
+  void *mosq_ = nullptr;
+  std::atomic<bool> connected_{false};
+
+  // Messages by mid, and the ones the network thread has finished; the
+  // worker settles finished ones so callbacks and spool acknowledgements
+  // stay on its thread
+  mutable std::mutex messages_mutex_;
+  std::unordered_map<int, Message> in_flight_;
+  std::vector<Message> finished_;
+
+  std::unordered_map<std::string, PendingBatch> pending_; // Worker-only
+
+  // Payload buffers, reused across batches (worker-only)
+  MetricsJsonWriter writer_;
+  columnar::Encoder encoder_;
+  std::vector<MetricPoint> replay_;
+
+  std::thread worker_thread_;
+  std::atomic<bool> stop_worker_{false};
+
+  static void onConnect(struct mosquitto *, void *self, int rc);
+  static void onDisconnect(struct mosquitto *, void *self, int rc);
+  static void onPublish(struct mosquitto *, void *self, int mid);
+
+  void workerLoop();
+  void wakeWorker() override;
+  void stagePoint(const std::string &device_id, const MetricPoint &point);
+  void publishDueBatches();
+  void replaySpools();
+  size_t inFlight() const;
+  std::chrono::steady_clock::time_point nextWakeup() const;
+  bool publish(const std::string &device_id, const MetricPoint *points,
+               size_t count, MetricProducer::Channel *spool_channel,
+               SendOutcome &failure);
+  void settleFinished();
+};
+
+// Raw point transport for config.transport: an MqttClient for "mqtt",
+// with the batching, queue, spool and worker settings of http_options,
+// or nullptr to keep uploading through the HttpClient. error explains a
+// fallback to HTTP (unknown transport, no libmosquitto, bad broker URL).
+std::unique_ptr<MqttClient>
+makeMqttTransport(const AgentConfig &config,
+                  const HttpClientOptions &http_options, std::string &error);
+
+#endif // MQTT_CLIENT_HPP
@@ -0,0 +1,238 @@
+#ifndef MULTICHANNEL_ANALYZER_HPP
+#define MULTICHANNEL_ANALYZER_HPP
+
+#include "fft_plan.hpp"
+#include "simd.hpp"
+#include "spectral_baseline.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * Batched spectral analyzer for N synchronously sampled channels
+ * (e.g. triaxial accelerometers on several machines)
+ *
+ * Interleaved frames are split into channel-major mirrored rings held in
+ * one aligned allocation. Every hop, all channels are transformed in one
+ * batch, spread over an optional thread pool; each pool slot owns its own
+ * FFT plan so workers never share scratch memory. Every channel gets the
+ * same spectrum summary as FFTAnalyzer (DC bin excluded). There are no
+ * time-domain features, so the verdict comes from a per-channel learned
+ * SpectralBaseline alone, and nothing is flagged while it warms up.
+ * Real selects double or float32 storage and transforms.
+ */
+template <typename Real>
+class BasicMultiChannelAnalyzer {
+public:
+    struct ChannelResult {
+        bool anomaly = false;
+        double dominant_freq = 0.0;
+        double total_power = 0.0;
+        double mean_magnitude = 0.0;
+        double stddev_magnitude = 0.0;
+        double max_magnitude = 0.0;
+        double avg_power = 0.0;
+        size_t deviating_bins = 0;        // Bins off the channel's baseline
+        const Real* magnitudes = nullptr; // bins() values, valid until the next frame
+    };
+
+    // Invoked after each analyzed frame with one result per channel
+    using FrameCallback = std::function<void(const std::vector<ChannelResult>&)>;
+
+    BasicMultiChannelAnalyzer(size_t channels, size_t window_size = 256,
+                              double sample_rate = 1000.0, size_t hop_size = 0,
+                              size_t threads = 0)
+        : channels_(std::max<size_t>(channels, 1)),
+          window_size_(std::max<size_t>(window_size, 1)),
+          hop_size_(hop_size == 0 ? std::max<size_t>(window_size_ / 2, 1) : hop_size),
+          sample_rate_(sample_rate),
+          ring_stride_(padded(2 * window_size_)),
+          rings_(channels_ * ring_stride_),
+          pool_(threads),
+          results_(channels_),
+          baseline_(channels_, std::max<size_t>(nextPowerOfTwo(window_size_), 2) / 2, withSignature(BaselineOptions())) {
+        size_t slots = pool_.concurrency();
+        plans_.reserve(slots);
+        for (size_t i = 0; i < slots; ++i) {
+            plans_.emplace_back(window_size_);
+        }
+        fft_size_ = plans_.front().size();
+        bins_ = fft_size_ / 2;
+        spectrum_stride_ = padded(bins_ + 1);
+        spectrum_re_.resize(slots * spectrum_stride_);
+        spectrum_im_.resize(slots * spectrum_stride_);
+        magnitude_stride_ = padded(bins_);
+        magnitudes_.resize(channels_ * magnitude_stride_);
+        for (size_t c = 0; c < channels_; ++c) {
+            results_[c].magnitudes = magnitudes_.data() + c * magnitude_stride_;
+        }
+    }
+
+    size_t channels() const { return channels_; }
+    size_t bins() const { return bins_; }
+    size_t hopSize() const { return hop_size_; }
+
+    /**
+     * Frequency of bin i in Hz
+     */
+    double binFrequency(size_t i) const {
+        return (i * sample_rate_) / fft_size_;
+    }
+
+    /**
+     * Replace the baseline (and everything learned) with one using these
+     * options; allocates, so call it during setup
+     */
+    void configureBaseline(const BaselineOptions& options) {
+        baseline_ = BasicSpectralBaseline<Real>(channels_, bins_, withSignature(options));
+    }
+
+    // For save/load; update()s come from analysis only
+    BasicSpectralBaseline<Real>& baseline() {
+        return baseline_;
+    }
+
+    void setFrameCallback(FrameCallback callback) {
+        on_frame_ = std::move(callback);
+    }
+
+    /**
+     * Append frames laid out as [frame][channel]
+     * Returns the number of frames analyzed during this call; results()
+     * holds the latest one and the frame callback sees each of them.
+     */
+    template <typename In>
+    size_t pushFrames(const In* interleaved, size_t frames) {
+        size_t analyzed = 0;
+        for (size_t f = 0; f < frames; ++f) {
+            const In* frame = interleaved + f * channels_;
+            Real* ring = rings_.data();
+            for (size_t c = 0; c < channels_; ++c, ring += ring_stride_) {
+                Real v = static_cast<Real>(frame[c]);
+                ring[head_] = v;
+                ring[head_ + window_size_] = v;
+            }
+            head_ = (head_ + 1 == window_size_) ? 0 : head_ + 1;
+
+            if (count_ < window_size_) {
+                if (++count_ < window_size_) continue;
+                since_analysis_ = hop_size_;
+            } else {
+                ++since_analysis_;
+            }
+            if (since_analysis_ < hop_size_) continue;
+
+            since_analysis_ = 0;
+            analyzeAll();
+            ++analyzed;
+            if (on_frame_) on_frame_(results_);
+        }
+        return analyzed;
+    }
+
+    const std::vector<ChannelResult>& results() const {
+        return results_;
+    }
+
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        since_analysis_ = 0;
+        for (auto& r : results_) {
+            const Real* mags = r.magnitudes;
+            r = ChannelResult();
+            r.magnitudes = mags;
+        }
+    }
+
+private:
+    // FFT size and sample rate in mHz; rings are never tapered
+    BaselineOptions withSignature(BaselineOptions options) const {
+        options.signature = (static_cast<uint64_t>(std::max<size_t>(nextPowerOfTwo(window_size_), 2)) << 40) ^
+                            (static_cast<uint64_t>(std::llround(sample_rate_ * 1000.0)) << 8);
+        return options;
+    }
+
+    static size_t padded(size_t n) {
+        size_t per_line = simd::kAlignment / sizeof(Real);
+        return (n + per_line - 1) / per_line * per_line;
+    }
+
+    void analyzeAll() {
+        const size_t start = (count_ < window_size_) ? 0 : head_;
+        pool_.parallelFor(channels_, 1, [this, start](size_t slot, size_t begin, size_t end) {
+            Real* re = spectrum_re_.data() + slot * spectrum_stride_;
+            Real* im = spectrum_im_.data() + slot * spectrum_stride_;
+            for (size_t c = begin; c < end; ++c) {
+                const Real* window = rings_.data() + c * ring_stride_ + start;
+                analyzeChannel(plans_[slot], window, re, im, c);
+            }
+        });
+    }
+
+    void analyzeChannel(BasicRealFFTPlan<Real>& plan, const Real* window,
+                        Real* re, Real* im, size_t channel) {
+        plan.forward(window, window_size_, re, im);
+
+        ChannelResult& r = results_[channel];
+        Real* mags = magnitudes_.data() + channel * magnitude_stride_;
+        r.total_power = simd::magnitudes(re, im, mags, bins_);
+
+        // Stats over bins 1..bins-1, as in FFTAnalyzer
+        const size_t first = bins_ > 1 ? 1 : 0;
+        const size_t ac_bins = bins_ - first;
+        size_t max_index = first;
+        double sum = 0.0;
+        double ac_power = 0.0;
+        for (size_t i = first; i < bins_; ++i) {
+            sum += mags[i];
+            ac_power += static_cast<double>(mags[i]) * mags[i];
+            if (mags[i] > mags[max_index]) max_index = i;
+        }
+        double mean = sum / ac_bins;
+        double variance = 0.0;
+        for (size_t i = first; i < bins_; ++i) {
+            double diff = mags[i] - mean;
+            variance += diff * diff;
+        }
+
+        r.mean_magnitude = mean;
+        r.stddev_magnitude = std::sqrt(variance / ac_bins);
+        r.max_magnitude = mags[max_index];
+        r.dominant_freq = binFrequency(max_index);
+        r.avg_power = ac_power / ac_bins;
+        r.deviating_bins = baseline_.update(channel, mags);
+        r.anomaly = baseline_.anomalous(r.deviating_bins);
+    }
+
+    size_t channels_;
+    size_t window_size_;
+    size_t hop_size_;
+    double sample_rate_;
+    size_t ring_stride_;
+    simd::aligned_vector<Real> rings_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t since_analysis_ = 0;
+
+    ThreadPool pool_;
+    std::vector<BasicRealFFTPlan<Real>> plans_;
+    size_t fft_size_ = 0;
+    size_t bins_ = 0;
+    size_t spectrum_stride_ = 0;
+    simd::aligned_vector<Real> spectrum_re_;
+    simd::aligned_vector<Real> spectrum_im_;
+    size_t magnitude_stride_ = 0;
+    simd::aligned_vector<Real> magnitudes_;
+    std::vector<ChannelResult> results_;
+    BasicSpectralBaseline<Real> baseline_; // Channel c written by whichever slot analyzes it
+    FrameCallback on_frame_;
+};
+
+using MultiChannelAnalyzer = BasicMultiChannelAnalyzer<double>;
+using MultiChannelAnalyzerF = BasicMultiChannelAnalyzer<float>;
+
+#endif // MULTICHANNEL_ANALYZER_HPP
@@ -0,0 +1,148 @@
+#ifndef PIPELINE_STAGE_HPP
+#define PIPELINE_STAGE_HPP
+
+#include "async_logger.hpp"
+#include "spsc_ring.hpp"
+#include "thread_affinity.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * One stage of a staged pipeline: a handler fed through a bounded SPSC ring
+ *
+ * The upstream stage calls push(), which never blocks or allocates: an
+ * item that does not fit is dropped and counted, so a slow stage stalls
+ * only itself and the ones after it, never acquisition. The stage's own
+ * thread (optionally pinned to a core) hands items to the handler in
+ * batches, oldest first. It spins briefly when idle and then sleeps
+ * until the producer wakes it. With threaded = false, push() runs the
+ * handler inline, and the stage is just a function call.
+ * Exactly one thread may push.
+ */
+template <typename In>
+class PipelineStage {
+public:
+    struct Options {
+        std::string name = "stage";
+        bool threaded = true;
+        size_t capacity = 4096; // Items buffered for a slow handler
+        size_t batch = 64;      // Max items per handler call
+        int cpu = -1;           // Pin the stage thread; -1 = no pinning
+    };
+
+    // handler(items, count); only ever called from one thread at a time
+    using Handler = std::function<void(const In* items, size_t count)>;
+
+    PipelineStage(const Options& options, Handler handler)
+        : options_(options), handler_(std::move(handler)), ring_(options.capacity) {
+        options_.batch = std::max<size_t>(options_.batch, 1);
+        if (options_.threaded) {
+            thread_ = std::thread(&PipelineStage::run, this);
+        }
+    }
+
+    /**
+     * Stops after handling everything already pushed
+     */
+    ~PipelineStage() {
+        if (!thread_.joinable()) return;
+        stop_.store(true, std::memory_order_seq_cst);
+        wake();
+        thread_.join();
+    }
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator=(const PipelineStage&) = delete;
+
+    /**
+     * Producer side: hand one item to the stage
+     * Returns false (and counts a drop) if the stage is too far behind
+     */
+    bool push(const In& item) {
+        if (!options_.threaded) {
+            handler_(&item, 1);
+            return true;
+        }
+        if (!ring_.tryPush(item)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Only pay for the lock when the consumer actually went to sleep; the
+        // fence pairs with the one in run() so the ring write and the flag
+        // check are not reordered
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            wake();
+        }
+        return true;
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    size_t depth() const { return ring_.sizeApprox(); }
+
+    const std::string& name() const { return options_.name; }
+
+private:
+    void wake() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+
+    void run() {
+        std::string error;
+        if (!pinCurrentThread(options_.cpu, error)) {
+            AsyncLogger::global().log(LogLevel::Warn, LogTopic::General, "%s stage %srunning unpinned",
+                                      options_.name.c_str(), error.c_str());
+        }
+
+        std::vector<In> batch(options_.batch);
+        unsigned idle_spins = 0;
+        while (true) {
+            size_t n = ring_.pop(batch.data(), batch.size());
+            if (n > 0) {
+                handler_(batch.data(), n);
+                idle_spins = 0;
+                continue;
+            }
+            if (stop_.load(std::memory_order_seq_cst)) break;
+
+            // A short spin catches items that arrive at kHz rates without
+            // a sleep/wake round trip; beyond that, sleep
+            if (++idle_spins < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // Re-check after announcing the sleep, or a push in between is missed;
+            // the timeout is only a safety net
+            if (ring_.sizeApprox() == 0 && !stop_.load(std::memory_order_seq_cst)) {
+                cv_.wait_for(lock, std::chrono::milliseconds(50));
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    Options options_;
+    Handler handler_;
+    SpscRing<In> ring_;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stop_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+};
+
+#endif // PIPELINE_STAGE_HPP
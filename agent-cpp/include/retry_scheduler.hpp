@@ -0,0 +1,137 @@
+#ifndef RETRY_SCHEDULER_HPP
+#define RETRY_SCHEDULER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/**
+ * How a failed upload should be handled
+ */
+enum class SendOutcome {
+    Sent,   // Accepted by the backend
+    Retry,  // Transient: transport error, timeout, 408, 429 or 5xx
+    Reject, // Permanent: any other 4xx; resending cannot succeed
+};
+
+/**
+ * Classify an HTTP status (0 when no response was received)
+ */
+inline SendOutcome classifyHttpStatus(long status) {
+    if (status >= 200 && status < 300) return SendOutcome::Sent;
+    if (status == 0 || status == 408 || status == 429 || status >= 500) return SendOutcome::Retry;
+    return SendOutcome::Reject;
+}
+
+struct RetryOptions {
+    long initial_backoff_ms = 500;
+    long max_backoff_ms = 30000;
+    double multiplier = 2.0;
+    double jitter = 0.5; // Fraction of each delay that is randomized
+
+    // Consecutive failures that open the circuit, and how long it stays open
+    unsigned breaker_threshold = 5;
+    long breaker_open_ms = 30000;
+};
+
+/**
+ * Timer-driven retry state for one backend: exponential backoff with
+ * jitter plus a circuit breaker
+ *
+ * Nothing here sleeps. The caller asks canSend() before each attempt,
+ * calls onSend() when it starts one, reports the outcome with the round
+ * onSend() returned, and uses nextAttempt() as a wakeup deadline.
+ *
+ * Requests sent concurrently form one attempt round: once a failure of
+ * the round is reported, the other failures of that round are ignored, so
+ * max_in_flight requests dying in the same outage count as one failure.
+ * After a failure only one probe is let through per deadline, and no
+ * other request is allowed until its outcome is reported. After
+ * breaker_threshold consecutive failed rounds the circuit opens and no
+ * request is allowed for breaker_open_ms; then a single probe is let
+ * through (half-open), which either closes the circuit or reopens it.
+ * Not thread-safe: owned by the upload worker.
+ */
+class RetryScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State { Closed, Open, HalfOpen };
+
+    explicit RetryScheduler(const RetryOptions& options = RetryOptions())
+        : options_(options), rng_(std::random_device{}()) {}
+
+    bool canSend(Clock::time_point now) const {
+        if (failures_ == 0) return true;
+        return !probe_in_flight_ && now >= next_attempt_;
+    }
+
+    /**
+     * Record the start of an attempt allowed by canSend(); returns the
+     * round to report its outcome with
+     */
+    uint64_t onSend() {
+        if (failures_ > 0) probe_in_flight_ = true;
+        return round_;
+    }
+
+    /**
+     * Earliest time the next attempt is allowed (time_point::max() while
+     * a probe is in flight: only its outcome can allow another)
+     */
+    Clock::time_point nextAttempt() const {
+        return probe_in_flight_ ? Clock::time_point::max() : next_attempt_;
+    }
+
+    State state(Clock::time_point now) const {
+        if (failures_ < options_.breaker_threshold) return State::Closed;
+        return probe_in_flight_ || now >= next_attempt_ ? State::HalfOpen : State::Open;
+    }
+
+    unsigned consecutiveFailures() const { return failures_; }
+
+    /**
+     * Any response from any round proves the backend is reachable
+     */
+    void onSuccess() {
+        failures_ = 0;
+        delay_ms_ = 0;
+        probe_in_flight_ = false;
+        next_attempt_ = Clock::time_point();
+    }
+
+    void onFailure(Clock::time_point now, uint64_t round) {
+        if (round != round_) return; // Its round already counted as failed
+        ++round_;
+        ++failures_;
+        probe_in_flight_ = false;
+        if (failures_ >= options_.breaker_threshold) {
+            // Open (or reopen after a failed probe)
+            next_attempt_ = now + std::chrono::milliseconds(options_.breaker_open_ms);
+            return;
+        }
+
+        delay_ms_ = delay_ms_ == 0
+            ? static_cast<double>(options_.initial_backoff_ms)
+            : std::min(delay_ms_ * options_.multiplier, static_cast<double>(options_.max_backoff_ms));
+
+        // Keep (1 - jitter) of the delay fixed and randomize the rest so
+        // agents that failed together do not retry together
+        double jitter = std::clamp(options_.jitter, 0.0, 1.0);
+        std::uniform_real_distribution<double> spread(0.0, delay_ms_ * jitter);
+        double wait_ms = delay_ms_ * (1.0 - jitter) + spread(rng_);
+        next_attempt_ = now + std::chrono::milliseconds(static_cast<int64_t>(wait_ms));
+    }
+
+private:
+    RetryOptions options_;
+    std::minstd_rand rng_;
+    unsigned failures_ = 0;
+    uint64_t round_ = 0;
+    bool probe_in_flight_ = false;
+    double delay_ms_ = 0;
+    Clock::time_point next_attempt_{};
+};
+
+#endif // RETRY_SCHEDULER_HPP
@@ -0,0 +1,201 @@
+#ifndef ROLLING_WINDOW_HPP
+#define ROLLING_WINDOW_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * Sliding-window statistics helpers.
+ * Kept as free functions so they can run on any contiguous storage.
+ */
+namespace rolling {
+
+/**
+ * Insert x into sorted[0..n), keeping ascending order.
+ * sorted must have room for n + 1 elements.
+ */
+inline void sortedInsert(double* sorted, size_t n, double x) {
+    double* pos = std::upper_bound(sorted, sorted + n, x);
+    std::memmove(pos + 1, pos, static_cast<size_t>(sorted + n - pos) * sizeof(double));
+    *pos = x;
+}
+
+/**
+ * Remove one occurrence of x from sorted[0..n).
+ */
+inline void sortedErase(double* sorted, size_t n, double x) {
+    double* pos = std::lower_bound(sorted, sorted + n, x);
+    if (pos == sorted + n) {
+        // NaN or a value that was never inserted; drop the last slot
+        pos = sorted + n - 1;
+    }
+    std::memmove(pos, pos + 1, static_cast<size_t>(sorted + n - pos - 1) * sizeof(double));
+}
+
+/**
+ * Median as the element at index n/2, matching the backend
+ * median-deviation engine (upper median for even n).
+ */
+inline double median(const double* sorted, size_t n) {
+    return n == 0 ? 0.0 : sorted[n / 2];
+}
+
+/**
+ * k-th smallest (0-based) of |sorted[i] - center| in O(log n).
+ * Deviations left of center and right of center are two ascending
+ * sequences, so this is a k-th-of-two-sorted-arrays selection.
+ */
+inline double kthAbsDeviation(const double* sorted, size_t n, double center, size_t k) {
+    size_t split = static_cast<size_t>(std::lower_bound(sorted, sorted + n, center) - sorted);
+    size_t left_n = split;
+    size_t right_n = n - split;
+    auto left = [&](size_t j) { return center - sorted[split - 1 - j]; };
+    auto right = [&](size_t j) { return sorted[split + j] - center; };
+
+    // Take i elements from the left sequence and (k + 1 - i) from the right
+    size_t lo = (k + 1 > right_n) ? k + 1 - right_n : 0;
+    size_t hi = std::min(k + 1, left_n);
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        // Too few taken from the left if left[i] < right[k - i]
+        if (left(i) < right(k - i)) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+
+    size_t i = lo;
+    if (i == 0) return right(k);
+    if (i == k + 1) return left(k);
+    return std::max(left(i - 1), right(k - i));
+}
+
+/**
+ * Median absolute deviation, same indexing as median().
+ */
+inline double mad(const double* sorted, size_t n, double center) {
+    return n == 0 ? 0.0 : kthAbsDeviation(sorted, n, center, n / 2);
+}
+
+/**
+ * Running moments and ring position for one window.
+ * The sample storage itself is owned by the caller.
+ */
+struct Moments {
+    double mean = 0.0;
+    double m2 = 0.0;
+    size_t count = 0;
+    size_t head = 0;
+    size_t replacements = 0;
+};
+
+/**
+ * Recompute the moments exactly from the ring contents
+ */
+inline void resync(Moments& m, const double* ring) {
+    double sum = 0.0;
+    for (size_t i = 0; i < m.count; ++i) sum += ring[i];
+    m.mean = sum / m.count;
+
+    double m2 = 0.0;
+    for (size_t i = 0; i < m.count; ++i) {
+        double diff = ring[i] - m.mean;
+        m2 += diff * diff;
+    }
+    m.m2 = m2;
+    m.replacements = 0;
+}
+
+/**
+ * Add a value to a window of the given capacity, evicting the oldest
+ * one once it is full. ring and sorted each hold capacity doubles.
+ */
+inline void push(Moments& m, double* ring, double* sorted, size_t capacity, double value) {
+    if (m.count < capacity) {
+        ring[m.head] = value;
+        sortedInsert(sorted, m.count, value);
+        ++m.count;
+
+        double delta = value - m.mean;
+        m.mean += delta / m.count;
+        m.m2 += delta * (value - m.mean);
+    } else {
+        double evicted = ring[m.head];
+        ring[m.head] = value;
+        sortedErase(sorted, m.count, evicted);
+        sortedInsert(sorted, m.count - 1, value);
+
+        double old_mean = m.mean;
+        m.mean += (value - evicted) / m.count;
+        m.m2 += (value - evicted) * (value - m.mean + evicted - old_mean);
+
+        // Re-anchor the running moments once per window length so
+        // rounding error from add/remove pairs cannot accumulate
+        if (++m.replacements >= capacity) {
+            resync(m, ring);
+        }
+    }
+
+    m.head = (m.head + 1 == capacity) ? 0 : m.head + 1;
+    if (m.m2 < 0.0) m.m2 = 0.0;
+}
+
+/**
+ * Sample standard deviation (n - 1 denominator)
+ */
+inline double stddev(const Moments& m) {
+    return m.count > 1 ? std::sqrt(m.m2 / (m.count - 1)) : 0.0;
+}
+
+} // namespace rolling
+
+/**
+ * Fixed-capacity sliding window with O(1) moment updates
+ *
+ * Mean/variance are maintained with Welford add/replace steps on a ring
+ * buffer, so the cost per sample does not depend on the window size.
+ * A sorted copy of the window gives min/max/median in O(1) and MAD in
+ * O(log n); keeping it sorted costs one memmove of at most n doubles.
+ */
+class RollingWindow {
+public:
+    explicit RollingWindow(size_t capacity = 200)
+        : capacity_(std::max<size_t>(capacity, 1)),
+          ring_(capacity_),
+          sorted_(capacity_) {}
+
+    /**
+     * Add a value, evicting the oldest one once the window is full.
+     * Non-finite values are ignored, as in LocalAnalytics.
+     */
+    void push(double value) {
+        if (!std::isfinite(value)) return;
+        rolling::push(moments_, ring_.data(), sorted_.data(), capacity_, value);
+    }
+
+    size_t size() const { return moments_.count; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return moments_.count == 0; }
+
+    double mean() const { return moments_.mean; }
+    double stddev() const { return rolling::stddev(moments_); }
+
+    double min() const { return empty() ? 0.0 : sorted_[0]; }
+    double max() const { return empty() ? 0.0 : sorted_[moments_.count - 1]; }
+    double median() const { return rolling::median(sorted_.data(), moments_.count); }
+    double mad() const { return rolling::mad(sorted_.data(), moments_.count, median()); }
+
+    void clear() { moments_ = rolling::Moments(); }
+
+private:
+    size_t capacity_;
+    std::vector<double> ring_;
+    std::vector<double> sorted_;
+    rolling::Moments moments_;
+};
+
+#endif // ROLLING_WINDOW_HPP
@@ -0,0 +1,163 @@
+#ifndef SAMPLING_SCHEDULER_HPP
+#define SAMPLING_SCHEDULER_HPP
+
+#include "thread_affinity.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <random>
+#include <string>
+#include <sys/prctl.h>
+
+/**
+ * Periodic sampling clock on absolute CLOCK_MONOTONIC deadlines
+ *
+ * Deadline k is start + k * period, no matter how long each sample took
+ * to process, so the average rate never drifts. wait() sleeps with
+ * clock_nanosleep(TIMER_ABSTIME) and reports how late it woke. A sample
+ * that wakes a full period or more late skips the periods it missed and
+ * counts them instead of bursting to catch up, so index * period stays
+ * the true sample time. Optional jitter offsets each deadline without
+ * accumulating (for spreading simulated traffic; leave 0 for real
+ * sensors). setPeriod() changes the rate from the next deadline on.
+ */
+class SamplingScheduler {
+public:
+    struct Options {
+        int64_t period_ns = 1000000000;
+        int64_t jitter_ns = 0;      // Each deadline uniformly in +/- jitter_ns
+        int realtime_priority = 0;  // SCHED_FIFO priority (1-99); 0 keeps the default policy
+        int cpu = -1;               // Pin the sampling thread to this CPU; -1 = no pinning
+    };
+
+    struct Tick {
+        uint64_t index = 0;     // Sample number; index * period is the ideal time
+        int64_t deadline_ns = 0; // CLOCK_MONOTONIC
+        int64_t late_ns = 0;     // Wake-up lateness
+        uint64_t missed = 0;     // Periods skipped right before this tick
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t missed = 0;
+        int64_t max_late_ns = 0;
+        double mean_late_ns = 0.0;
+    };
+
+    explicit SamplingScheduler(const Options& options)
+        : options_(options), rng_(std::random_device{}()) {
+        options_.period_ns = std::max<int64_t>(options_.period_ns, 1000);
+        options_.jitter_ns = std::clamp<int64_t>(options_.jitter_ns, 0, options_.period_ns / 2);
+        start_ns_ = monotonicNanos();
+    }
+
+    /**
+     * Apply realtime priority, CPU pinning and fine timer slack to the
+     * calling thread. Returns false with a reason if any part failed
+     * (typically missing CAP_SYS_NICE); sampling still works without it.
+     */
+    bool configureThread(std::string& error) const {
+        if (options_.period_ns <= 10000000) {
+            // The default 50us slack is a large share of a kHz-rate period
+            prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+        }
+        bool ok = pinCurrentThread(options_.cpu, error);
+        return setRealtimePriority(options_.realtime_priority, error) && ok;
+    }
+
+    /**
+     * Sleep until the next deadline and return it
+     * The first call returns immediately with index 0.
+     */
+    Tick wait() {
+        Tick tick;
+        int64_t deadline = start_ns_ + idealNs(next_index_) + offset();
+        sleepUntil(deadline);
+        int64_t now = monotonicNanos();
+
+        // Woke a whole period late: skip ahead instead of bursting
+        if (now - deadline >= options_.period_ns) {
+            uint64_t behind = static_cast<uint64_t>((now - deadline) / options_.period_ns);
+            next_index_ += behind;
+            deadline += static_cast<int64_t>(behind) * options_.period_ns;
+            tick.missed = behind;
+            stats_.missed += behind;
+        }
+
+        tick.index = next_index_++;
+        tick.deadline_ns = deadline;
+        tick.late_ns = std::max<int64_t>(now - deadline, 0);
+
+        ++stats_.ticks;
+        stats_.max_late_ns = std::max(stats_.max_late_ns, tick.late_ns);
+        stats_.mean_late_ns += (tick.late_ns - stats_.mean_late_ns) / static_cast<double>(stats_.ticks);
+        return tick;
+    }
+
+    /**
+     * Ideal time of a tick in seconds since the scheduler started
+     */
+    double secondsAt(const Tick& tick) const {
+        return static_cast<double>(idealNs(tick.index)) * 1e-9;
+    }
+
+    /**
+     * New period and jitter, counted from the last tick's deadline, so
+     * neither the next deadline nor secondsAt() jumps; call from the
+     * thread that calls wait()
+     */
+    void setPeriod(int64_t period_ns, int64_t jitter_ns) {
+        if (next_index_ > 0) {
+            base_ns_ = idealNs(next_index_ - 1);
+            base_index_ = next_index_ - 1;
+        }
+        options_.period_ns = std::max<int64_t>(period_ns, 1000);
+        options_.jitter_ns = std::clamp<int64_t>(jitter_ns, 0, options_.period_ns / 2);
+    }
+
+    int64_t periodNs() const { return options_.period_ns; }
+    int64_t jitterNs() const { return options_.jitter_ns; }
+
+    double rateHz() const { return 1e9 / static_cast<double>(options_.period_ns); }
+
+    const Stats& stats() const { return stats_; }
+
+    static int64_t monotonicNanos() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+private:
+    // Ideal deadline of a tick relative to start_ns_, without jitter
+    int64_t idealNs(uint64_t index) const {
+        return base_ns_ + static_cast<int64_t>(index - base_index_) * options_.period_ns;
+    }
+
+    int64_t offset() {
+        if (options_.jitter_ns == 0) return 0;
+        std::uniform_int_distribution<int64_t> dist(-options_.jitter_ns, options_.jitter_ns);
+        return dist(rng_);
+    }
+
+    static void sleepUntil(int64_t deadline_ns) {
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(deadline_ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(deadline_ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+    }
+
+    Options options_;
+    std::mt19937 rng_;
+    int64_t start_ns_;
+    uint64_t next_index_ = 0;
+    uint64_t base_index_ = 0; // Tick the current period is counted from
+    int64_t base_ns_ = 0;     // ... and its ideal deadline
+    Stats stats_;
+};
+
+#endif // SAMPLING_SCHEDULER_HPP
@@ -0,0 +1,128 @@
+#ifndef SENSOR_SOURCE_HPP
+#define SENSOR_SOURCE_HPP
+
+#include "agent_metrics.hpp"
+#include "device_simulator.hpp"
+#include "metric_point.hpp"
+#include "sampling_scheduler.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Consecutive samples of one channel, oldest first
+ * values (and injected) point into the source's own buffers and stay
+ * valid until its next read().
+ */
+struct SampleBlock {
+    const double* values = nullptr;
+    const SimulatedAnomaly* injected = nullptr; // Per sample; nullptr from real sensors
+    size_t count = 0;
+    uint64_t first_index = 0; // Sample number of values[0]; index / rate is its ideal time
+    int64_t last_ts_ms = 0;   // Acquisition time of the last sample
+    int64_t late_ns = 0;      // How late the read woke after the block was due, if known
+    uint64_t missed = 0;      // Samples lost right before this block
+
+    // Acquisition time of sample i, spread back from the last one
+    int64_t timestampMs(size_t i, double rate_hz) const {
+        return last_ts_ms - static_cast<int64_t>(static_cast<double>(count - 1 - i) * 1000.0 / rate_hz);
+    }
+};
+
+/**
+ * Where the acquisition loop gets its samples from
+ *
+ * read() blocks until the next block and returns it without copying; a
+ * source sizes its buffers up front, so reading never allocates. Call
+ * configureThread() and read() from the acquisition thread.
+ */
+class SensorSource {
+public:
+    virtual ~SensorSource() = default;
+
+    virtual const char* name() const = 0;
+
+    // Actual rate, which a device may have rounded from the one requested
+    virtual double sampleRate() const = 0;
+
+    // Samples per read() when the loop keeps up
+    virtual size_t blockSize() const = 0;
+
+    // Realtime priority, CPU pinning and timer slack for the calling thread
+    virtual bool configureThread(std::string& error) const = 0;
+
+    // False with the reason in error if the sensor stopped delivering
+    virtual bool read(SampleBlock& block, std::string& error) = 0;
+};
+
+/**
+ * simulateVibration() paced by a SamplingScheduler
+ * With block > 1 the scheduler ticks once per block and the whole block
+ * is generated at its last sample's deadline, like a sensor FIFO.
+ */
+class SimulatedVibrationSource : public SensorSource {
+public:
+    struct Options {
+        double sample_rate_hz = 1000.0;
+        size_t block = 1;
+        double anomaly_probability = 0.0; // Per sample
+        int realtime_priority = 0;
+        int cpu = -1;
+    };
+
+    explicit SimulatedVibrationSource(const Options& options)
+        : options_(options),
+          scheduler_(schedulerOptions(options)),
+          gen_(std::random_device{}()),
+          normal_dist_(0.0, 1.0),
+          values_(std::max<size_t>(options.block, 1)),
+          injected_(values_.size()) {
+        options_.block = values_.size();
+    }
+
+    const char* name() const override { return "simulated"; }
+    double sampleRate() const override { return options_.sample_rate_hz; }
+    size_t blockSize() const override { return options_.block; }
+    bool configureThread(std::string& error) const override { return scheduler_.configureThread(error); }
+
+    bool read(SampleBlock& block, std::string&) override {
+        SamplingScheduler::Tick tick = scheduler_.wait();
+        block.first_index = tick.index * options_.block;
+        block.missed = tick.missed * options_.block;
+        block.late_ns = tick.late_ns;
+        {
+            StageTimer timer(AgentMetrics::global().stage(Stage::Generate));
+            for (size_t i = 0; i < options_.block; ++i) {
+                double t = static_cast<double>(block.first_index + i) / options_.sample_rate_hz;
+                values_[i] = simulateVibration(t, options_.anomaly_probability, gen_, normal_dist_, &injected_[i]);
+            }
+        }
+        block.values = values_.data();
+        block.injected = injected_.data();
+        block.count = options_.block;
+        block.last_ts_ms = epochMillisNow();
+        return true;
+    }
+
+private:
+    static SamplingScheduler::Options schedulerOptions(const Options& options) {
+        SamplingScheduler::Options sampling;
+        double block = static_cast<double>(std::max<size_t>(options.block, 1));
+        sampling.period_ns = static_cast<int64_t>(1e9 * block / std::max(options.sample_rate_hz, 1e-3));
+        sampling.realtime_priority = options.realtime_priority;
+        sampling.cpu = options.cpu;
+        return sampling;
+    }
+
+    Options options_;
+    SamplingScheduler scheduler_;
+    std::mt19937 gen_;
+    std::normal_distribution<> normal_dist_;
+    std::vector<double> values_;
+    std::vector<SimulatedAnomaly> injected_;
+};
+
+#endif // SENSOR_SOURCE_HPP
@@ -0,0 +1,272 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/**
+ * Minimal portable SIMD layer for the spectral kernels
+ *
+ * The instruction set is chosen at compile time: AVX2 when the compiler
+ * targets it (-mavx2, see AGENT_ENABLE_AVX2 in CMakeLists.txt), NEON on
+ * AArch64, and a one-lane scalar fallback otherwise or when
+ * AGENT_NO_SIMD is defined. Kernels are written once against Vec<Real>.
+ */
+#if !defined(AGENT_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define AGENT_SIMD_AVX2 1
+#elif !defined(AGENT_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AGENT_SIMD_NEON 1
+#endif
+
+namespace simd {
+
+// Cache-line alignment for SIMD work buffers
+constexpr size_t kAlignment = 64;
+
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + kAlignment - 1) / kAlignment * kAlignment;
+        void* p = std::aligned_alloc(kAlignment, bytes == 0 ? kAlignment : bytes);
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) {
+        std::free(p);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using aligned_vector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * Scalar fallback: one lane
+ */
+template <typename Real>
+struct Vec {
+    static constexpr size_t lanes = 1;
+    Real v;
+
+    static Vec load(const Real* p) { return {*p}; }
+    static Vec broadcast(Real x) { return {x}; }
+    void store(Real* p) const { *p = v; }
+
+    friend Vec operator+(Vec a, Vec b) { return {a.v + b.v}; }
+    friend Vec operator-(Vec a, Vec b) { return {a.v - b.v}; }
+    friend Vec operator*(Vec a, Vec b) { return {a.v * b.v}; }
+    friend Vec sqrt(Vec a) { return {std::sqrt(a.v)}; }
+    friend size_t countGreater(Vec a, Vec b) { return a.v > b.v ? 1 : 0; } // Lanes with a > b
+    Real sum() const { return v; }
+};
+
+#if defined(AGENT_SIMD_AVX2)
+
+template <>
+struct Vec<double> {
+    static constexpr size_t lanes = 4;
+    __m256d v;
+
+    static Vec load(const double* p) { return {_mm256_loadu_pd(p)}; }
+    static Vec broadcast(double x) { return {_mm256_set1_pd(x)}; }
+    void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+    friend Vec operator+(Vec a, Vec b) { return {_mm256_add_pd(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {_mm256_sub_pd(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm256_mul_pd(a.v, b.v)}; }
+    friend Vec sqrt(Vec a) { return {_mm256_sqrt_pd(a.v)}; }
+    friend size_t countGreater(Vec a, Vec b) {
+        return static_cast<size_t>(__builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ))));
+    }
+    double sum() const {
+        __m128d lo = _mm256_castpd256_pd128(v);
+        __m128d hi = _mm256_extractf128_pd(v, 1);
+        lo = _mm_add_pd(lo, hi);
+        return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    }
+};
+
+template <>
+struct Vec<float> {
+    static constexpr size_t lanes = 8;
+    __m256 v;
+
+    static Vec load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    static Vec broadcast(float x) { return {_mm256_set1_ps(x)}; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Vec operator+(Vec a, Vec b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend Vec sqrt(Vec a) { return {_mm256_sqrt_ps(a.v)}; }
+    friend size_t countGreater(Vec a, Vec b) {
+        return static_cast<size_t>(__builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ))));
+    }
+    float sum() const {
+        __m128 lo = _mm256_castps256_ps128(v);
+        __m128 hi = _mm256_extractf128_ps(v, 1);
+        lo = _mm_add_ps(lo, hi);
+        lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+        return _mm_cvtss_f32(_mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+    }
+};
+
+#elif defined(AGENT_SIMD_NEON)
+
+template <>
+struct Vec<double> {
+    static constexpr size_t lanes = 2;
+    float64x2_t v;
+
+    static Vec load(const double* p) { return {vld1q_f64(p)}; }
+    static Vec broadcast(double x) { return {vdupq_n_f64(x)}; }
+    void store(double* p) const { vst1q_f64(p, v); }
+
+    friend Vec operator+(Vec a, Vec b) { return {vaddq_f64(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {vsubq_f64(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {vmulq_f64(a.v, b.v)}; }
+    friend Vec sqrt(Vec a) { return {vsqrtq_f64(a.v)}; }
+    friend size_t countGreater(Vec a, Vec b) {
+        return static_cast<size_t>(vaddvq_u64(vshrq_n_u64(vcgtq_f64(a.v, b.v), 63)));
+    }
+    double sum() const { return vaddvq_f64(v); }
+};
+
+template <>
+struct Vec<float> {
+    static constexpr size_t lanes = 4;
+    float32x4_t v;
+
+    static Vec load(const float* p) { return {vld1q_f32(p)}; }
+    static Vec broadcast(float x) { return {vdupq_n_f32(x)}; }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    friend Vec operator+(Vec a, Vec b) { return {vaddq_f32(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {vsubq_f32(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {vmulq_f32(a.v, b.v)}; }
+    friend Vec sqrt(Vec a) { return {vsqrtq_f32(a.v)}; }
+    friend size_t countGreater(Vec a, Vec b) {
+        return static_cast<size_t>(vaddvq_u32(vshrq_n_u32(vcgtq_f32(a.v, b.v), 31)));
+    }
+    float sum() const { return vaddvq_f32(v); }
+};
+
+#endif
+
+/**
+ * Name of the instruction set the kernels were compiled for
+ */
+inline const char* isaName() {
+#if defined(AGENT_SIMD_AVX2)
+    return "avx2";
+#elif defined(AGENT_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * out[i] = |re[i] + i*im[i]|; returns the sum of squared magnitudes
+ */
+template <typename Real>
+inline double magnitudes(const Real* re, const Real* im, Real* out, size_t n) {
+    using V = Vec<Real>;
+    V power = V::broadcast(Real(0));
+    size_t i = 0;
+    for (; i + V::lanes <= n; i += V::lanes) {
+        V r = V::load(re + i);
+        V m = V::load(im + i);
+        V sq = r * r + m * m;
+        power = power + sq;
+        sqrt(sq).store(out + i);
+    }
+    double total = power.sum();
+    for (; i < n; ++i) {
+        Real sq = re[i] * re[i] + im[i] * im[i];
+        total += sq;
+        out[i] = std::sqrt(sq);
+    }
+    return total;
+}
+
+/**
+ * out[i] = (a[i] - offset) * b[i]
+ */
+template <typename Real>
+inline void multiplyOffset(const Real* a, Real offset, const Real* b, Real* out, size_t n) {
+    using V = Vec<Real>;
+    V off = V::broadcast(offset);
+    size_t i = 0;
+    for (; i + V::lanes <= n; i += V::lanes) {
+        ((V::load(a + i) - off) * V::load(b + i)).store(out + i);
+    }
+    for (; i < n; ++i) {
+        out[i] = (a[i] - offset) * b[i];
+    }
+}
+
+/**
+ * Number of i with (x[i] - mean[i])^2 > z2 * var[i] + r2 * mean[i]^2
+ */
+template <typename Real>
+inline size_t countDeviations(const Real* x, const Real* mean, const Real* var, size_t n, Real z2, Real r2) {
+    using V = Vec<Real>;
+    V vz2 = V::broadcast(z2);
+    V vr2 = V::broadcast(r2);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + V::lanes <= n; i += V::lanes) {
+        V m = V::load(mean + i);
+        V d = V::load(x + i) - m;
+        count += countGreater(d * d, vz2 * V::load(var + i) + vr2 * m * m);
+    }
+    for (; i < n; ++i) {
+        Real d = x[i] - mean[i];
+        if (d * d > z2 * var[i] + r2 * mean[i] * mean[i]) ++count;
+    }
+    return count;
+}
+
+/**
+ * Exponentially weighted mean and variance of each lane:
+ * d = x - mean, mean += alpha * d, var = (1 - alpha) * (var + alpha * d^2)
+ */
+template <typename Real>
+inline void ewUpdate(const Real* x, Real* mean, Real* var, size_t n, Real alpha) {
+    using V = Vec<Real>;
+    V a = V::broadcast(alpha);
+    V keep = V::broadcast(Real(1) - alpha);
+    size_t i = 0;
+    for (; i + V::lanes <= n; i += V::lanes) {
+        V m = V::load(mean + i);
+        V d = V::load(x + i) - m;
+        (m + a * d).store(mean + i);
+        (keep * (V::load(var + i) + a * d * d)).store(var + i);
+    }
+    for (; i < n; ++i) {
+        Real d = x[i] - mean[i];
+        mean[i] += alpha * d;
+        var[i] = (Real(1) - alpha) * (var[i] + alpha * d * d);
+    }
+}
+
+} // namespace simd
+
+#endif // SIMD_HPP
@@ -0,0 +1,158 @@
+#ifndef SLIDING_DFT_HPP
+#define SLIDING_DFT_HPP
+
+#include "window_function.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Sliding DFT over a few target bins of an n-sample window
+ *
+ * Each needed bin k is one complex resonator updated per sample as
+ * X_k <- (X_k + x_new - x_old) * e^{i*2*pi*k/n}, so tracking K targets
+ * costs O(K) per sample instead of an n-point FFT. The window is applied
+ * in the frequency domain: a cosine-sum taper with T terms needs the
+ * 2T-1 bins around each target (Hann and Hamming 3, Blackman-Harris 7),
+ * shared between neighbouring targets. Every n updates the resonators
+ * are recomputed exactly from the window, so rounding never accumulates.
+ * Targets are rounded to the nearest bin; one within T-1 bins of DC
+ * also sees the signal's mean through the taper. Buffers are sized at
+ * construction.
+ */
+class SlidingDFT {
+public:
+    SlidingDFT(size_t window_size, double sample_rate, const std::vector<double>& target_hz,
+               WindowType window = WindowType::Rectangular)
+        : n_(std::max<size_t>(window_size, 2)),
+          bin_hz_(sample_rate / static_cast<double>(n_)),
+          terms_(cosineTerms(window)),
+          cos_(n_),
+          sin_(n_) {
+        for (size_t m = 0; m < n_; ++m) {
+            double angle = 2.0 * M_PI * static_cast<double>(m) / static_cast<double>(n_);
+            cos_[m] = std::cos(angle);
+            sin_[m] = std::sin(angle);
+        }
+
+        const long span = static_cast<long>(terms_.terms) - 1;
+        for (double hz : target_hz) {
+            long k = std::lround(hz / bin_hz_);
+            k = std::clamp<long>(k, 1, static_cast<long>(n_ / 2) - 1);
+            Target target;
+            target.bin = static_cast<size_t>(k);
+            for (long j = -span; j <= span; ++j) {
+                size_t bin = static_cast<size_t>(((k + j) % static_cast<long>(n_) + static_cast<long>(n_)) %
+                                                 static_cast<long>(n_));
+                target.taps[static_cast<size_t>(j + span)] = resonatorFor(bin);
+            }
+            targets_.push_back(target);
+        }
+        re_.assign(bins_.size(), 0.0);
+        im_.assign(bins_.size(), 0.0);
+        amplitudes_.assign(targets_.size(), 0.0);
+    }
+
+    size_t targets() const { return targets_.size(); }
+    size_t resonators() const { return bins_.size(); }
+
+    /**
+     * Frequency of target i after rounding to a bin
+     */
+    double frequency(size_t i) const { return static_cast<double>(targets_[i].bin) * bin_hz_; }
+
+    /**
+     * Slide the window by one sample: newest enters, oldest (the sample
+     * n updates back, or 0 while the window fills) leaves
+     */
+    void update(double newest, double oldest) {
+        double delta = newest - oldest;
+        for (size_t r = 0; r < bins_.size(); ++r) {
+            double c = cos_[bins_[r]];
+            double s = sin_[bins_[r]];
+            double xr = re_[r] + delta;
+            double xi = im_[r];
+            re_[r] = xr * c - xi * s;
+            im_[r] = xr * s + xi * c;
+        }
+        stale_ = true;
+    }
+
+    /**
+     * Recompute every resonator exactly from the window, oldest first
+     * (count <= window size samples, zero-padded at the front)
+     */
+    void rebase(const double* window, size_t count) {
+        count = std::min(count, n_);
+        size_t offset = n_ - count;
+        for (size_t r = 0; r < bins_.size(); ++r) {
+            size_t k = bins_[r];
+            double xr = 0.0;
+            double xi = 0.0;
+            size_t phase = (k * offset) % n_;
+            for (size_t m = 0; m < count; ++m) {
+                xr += window[m] * cos_[phase];
+                xi -= window[m] * sin_[phase];
+                phase += k;
+                if (phase >= n_) phase -= n_;
+            }
+            re_[r] = xr;
+            im_[r] = xi;
+        }
+        stale_ = true;
+    }
+
+    /**
+     * Windowed tone amplitude at each target, in signal units
+     */
+    const std::vector<double>& amplitudes() {
+        if (!stale_) return amplitudes_;
+        const long span = static_cast<long>(terms_.terms) - 1;
+        const double scale = 2.0 / (static_cast<double>(n_) * terms_.a[0]);
+        for (size_t i = 0; i < targets_.size(); ++i) {
+            const Target& t = targets_[i];
+            double xr = 0.0;
+            double xi = 0.0;
+            for (long j = -span; j <= span; ++j) {
+                size_t order = static_cast<size_t>(j < 0 ? -j : j);
+                double a = order == 0 ? terms_.a[0] : 0.5 * terms_.a[order];
+                double weight = (order % 2 == 0) ? a : -a;
+                size_t r = t.taps[static_cast<size_t>(j + span)];
+                xr += weight * re_[r];
+                xi += weight * im_[r];
+            }
+            amplitudes_[i] = std::sqrt(xr * xr + xi * xi) * scale;
+        }
+        stale_ = false;
+        return amplitudes_;
+    }
+
+private:
+    struct Target {
+        size_t bin = 0;
+        size_t taps[7] = {}; // Resonators for bins bin-span..bin+span
+    };
+
+    size_t resonatorFor(size_t bin) {
+        auto it = std::find(bins_.begin(), bins_.end(), bin);
+        if (it != bins_.end()) return static_cast<size_t>(it - bins_.begin());
+        bins_.push_back(bin);
+        return bins_.size() - 1;
+    }
+
+    size_t n_;
+    double bin_hz_;
+    CosineTerms terms_;
+    std::vector<double> cos_;
+    std::vector<double> sin_;
+    std::vector<Target> targets_;
+    std::vector<size_t> bins_; // Bin index of each resonator
+    std::vector<double> re_;
+    std::vector<double> im_;
+    std::vector<double> amplitudes_;
+    bool stale_ = true;
+};
+
+#endif // SLIDING_DFT_HPP
@@ -0,0 +1,237 @@
+#ifndef SPECTRAL_BASELINE_HPP
+#define SPECTRAL_BASELINE_HPP
+
+#include "simd.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct BaselineOptions {
+    double alpha = 0.01;        // Weight of each new frame once warm (~100-frame memory)
+    size_t warmup_frames = 200; // Frames learned before the first verdict
+    double z_limit = 6.0;       // A bin deviates beyond this many standard deviations...
+    double min_change = 0.5;    // ...and this fraction of its mean magnitude
+    size_t min_bins = 2;        // Deviating bins that make an anomalous frame
+    size_t relearn_frames = 0;  // Consecutive anomalous frames that restart learning; 0 = never
+    uint64_t signature = 0;     // Spectrum layout (size, rate, window); saved state must match
+};
+
+/**
+ * Learned per-bin magnitude baseline for N spectra of the same layout
+ *
+ * Every channel keeps an exponentially weighted mean and variance of
+ * each bin's magnitude, DC excluded. A frame is scored against its
+ * channel's baseline before it is learned: bins off by more than z_limit
+ * standard deviations and min_change of their mean deviate, and
+ * min_bins of them make the frame anomalous. Anomalous frames are not
+ * learned, so a fault never becomes the norm; a lasting change (new
+ * speed, load or mounting) keeps flagging until relearn_frames
+ * consecutive anomalous frames reset the channel, which then warms up
+ * on the new operating point. The frame weight starts at
+ * 1/frames, an exact running mean and variance, and settles at alpha;
+ * nothing is scored during the warmup. State is one aligned allocation
+ * sized at construction, and update() is two SIMD passes over the bins
+ * without allocating. Channels are independent, so different threads
+ * may update different channels. save() and load() persist the state
+ * for a fast restart.
+ */
+template <typename Real>
+class BasicSpectralBaseline {
+public:
+    BasicSpectralBaseline(size_t channels, size_t bins, const BaselineOptions& options = BaselineOptions())
+        : options_(options),
+          channels_(std::max<size_t>(channels, 1)),
+          bins_(std::max<size_t>(bins, 2)),
+          stride_(padded(bins_ - 1)),
+          frames_(channels_, 0),
+          streak_(channels_, 0),
+          relearns_(channels_, 0),
+          state_(2 * channels_ * stride_, Real(0)) {
+        options_.warmup_frames = std::max<size_t>(options_.warmup_frames, 1);
+        options_.min_bins = std::max<size_t>(options_.min_bins, 1);
+    }
+
+    const BaselineOptions& options() const { return options_; }
+    size_t channels() const { return channels_; }
+    size_t bins() const { return bins_; }
+
+    // Frames learned by the channel since construction, reset() or load()
+    uint64_t frames(size_t channel) const { return frames_[channel]; }
+    bool warm(size_t channel) const { return frames_[channel] >= options_.warmup_frames; }
+
+    // Times the channel restarted learning after relearn_frames anomalous frames
+    uint64_t relearns(size_t channel) const { return relearns_[channel]; }
+
+    // Learned mean and variance of bins 1..bins-1 (bin i + 1 at index i)
+    const Real* mean(size_t channel) const { return state_.data() + 2 * channel * stride_; }
+    const Real* variance(size_t channel) const { return mean(channel) + stride_; }
+
+    /**
+     * Score a frame of bins() magnitudes from 0 Hz, then learn it unless
+     * it was anomalous; returns the number of deviating bins (0 while
+     * warming up). The relearn_frames-th anomalous frame in a row is
+     * still reported, then the channel is reset.
+     */
+    size_t update(size_t channel, const Real* magnitudes) {
+        const Real* x = magnitudes + 1;
+        const size_t n = bins_ - 1;
+        Real* mean = state_.data() + 2 * channel * stride_;
+        Real* var = mean + stride_;
+        uint64_t& frames = frames_[channel];
+
+        size_t deviating = 0;
+        if (frames >= options_.warmup_frames) {
+            Real z2 = static_cast<Real>(options_.z_limit * options_.z_limit);
+            Real r2 = static_cast<Real>(options_.min_change * options_.min_change);
+            deviating = simd::countDeviations(x, mean, var, n, z2, r2);
+            if (deviating >= options_.min_bins) {
+                if (options_.relearn_frames > 0 && ++streak_[channel] >= options_.relearn_frames) {
+                    reset(channel);
+                    ++relearns_[channel];
+                }
+                return deviating;
+            }
+        }
+        streak_[channel] = 0;
+        double alpha = std::max(options_.alpha, 1.0 / static_cast<double>(frames + 1));
+        simd::ewUpdate(x, mean, var, n, static_cast<Real>(alpha));
+        ++frames;
+        return deviating;
+    }
+
+    bool anomalous(size_t deviating) const { return deviating >= options_.min_bins; }
+
+    /**
+     * Forget everything the channel has learned
+     */
+    void reset(size_t channel) {
+        frames_[channel] = 0;
+        streak_[channel] = 0;
+        std::fill_n(state_.begin() + static_cast<std::ptrdiff_t>(2 * channel * stride_), 2 * stride_, Real(0));
+    }
+
+    /**
+     * Write the state to path through a temporary file and a rename, so
+     * an interrupted save leaves the previous file intact
+     */
+    bool save(const std::string& path, std::string& error) const {
+        FileHeader header = makeHeader();
+        header.checksum = checksum(frames_, state_);
+        std::string tmp = path + ".tmp";
+        std::FILE* file = std::fopen(tmp.c_str(), "wb");
+        if (!file) {
+            error = "Cannot write baseline " + tmp + ": " + std::strerror(errno);
+            return false;
+        }
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(frames_.data(), sizeof(uint64_t), frames_.size(), file) == frames_.size() &&
+                  std::fwrite(state_.data(), sizeof(Real), state_.size(), file) == state_.size();
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            error = "Cannot write baseline " + path + ": " + std::strerror(errno);
+            std::remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Restore state written by save() for the same channels, bins, Real
+     * and signature; on any mismatch or corruption nothing changes.
+     * Returns false with an empty error if the file does not exist.
+     */
+    bool load(const std::string& path, std::string& error) {
+        error.clear();
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            if (errno != ENOENT) error = "Cannot read baseline " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        FileHeader header;
+        FileHeader expected = makeHeader();
+        std::vector<uint64_t> frames(frames_.size());
+        simd::aligned_vector<Real> state(state_.size());
+        bool read = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                    std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0;
+        if (read && (header.signature != expected.signature || header.channels != expected.channels ||
+                     header.bins != expected.bins || header.real_bytes != expected.real_bytes)) {
+            std::fclose(file);
+            error = "Baseline " + path + " was learned for a different spectrum, ignoring it";
+            return false;
+        }
+        read = read && std::fread(frames.data(), sizeof(uint64_t), frames.size(), file) == frames.size() &&
+               std::fread(state.data(), sizeof(Real), state.size(), file) == state.size() &&
+               std::fgetc(file) == EOF;
+        std::fclose(file);
+        if (!read || header.checksum != checksum(frames, state)) {
+            error = "Baseline " + path + " is corrupt, ignoring it";
+            return false;
+        }
+        frames_.swap(frames);
+        state_.swap(state);
+        std::fill(streak_.begin(), streak_.end(), 0);
+        return true;
+    }
+
+private:
+    struct FileHeader {
+        char magic[8];
+        uint64_t signature;
+        uint32_t channels;
+        uint32_t bins;
+        uint32_t real_bytes;
+        uint32_t checksum; // FNV-1a over the frame counts and state
+    };
+    static_assert(sizeof(FileHeader) == 32, "baseline header must stay 32 bytes");
+
+    static size_t padded(size_t n) {
+        size_t per_line = simd::kAlignment / sizeof(Real);
+        return (n + per_line - 1) / per_line * per_line;
+    }
+
+    FileHeader makeHeader() const {
+        FileHeader header{};
+        std::memcpy(header.magic, "IOTBSL01", sizeof(header.magic));
+        header.signature = options_.signature;
+        header.channels = static_cast<uint32_t>(channels_);
+        header.bins = static_cast<uint32_t>(bins_);
+        header.real_bytes = static_cast<uint32_t>(sizeof(Real));
+        return header;
+    }
+
+    static uint32_t checksum(const std::vector<uint64_t>& frames, const simd::aligned_vector<Real>& state) {
+        uint32_t h = 2166136261u;
+        auto mix = [&h](const void* data, size_t bytes) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < bytes; ++i) {
+                h = (h ^ p[i]) * 16777619u;
+            }
+        };
+        mix(frames.data(), frames.size() * sizeof(uint64_t));
+        mix(state.data(), state.size() * sizeof(Real));
+        return h;
+    }
+
+    BaselineOptions options_;
+    size_t channels_;
+    size_t bins_;
+    size_t stride_; // Padded bins per mean/variance row
+    std::vector<uint64_t> frames_;
+    std::vector<uint64_t> streak_;   // Consecutive anomalous frames (not saved)
+    std::vector<uint64_t> relearns_; // Not saved either
+    simd::aligned_vector<Real> state_; // Per channel: mean row, then variance row
+};
+
+using SpectralBaseline = BasicSpectralBaseline<double>;
+
+// File an agent keeps a device's baseline in under baseline_dir
+inline std::string baselinePath(const std::string& dir, const std::string& device_id) {
+    return dir + "/" + device_id + ".baseline";
+}
+
+#endif // SPECTRAL_BASELINE_HPP
@@ -0,0 +1,334 @@
+#ifndef SPECTRAL_FEATURES_HPP
+#define SPECTRAL_FEATURES_HPP
+
+#include "fft_plan.hpp"
+#include "simd.hpp"
+#include "window_function.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * Frequency range [low_hz, high_hz) for band powers and envelope
+ * demodulation
+ */
+struct FeatureBand {
+    double low_hz = 0.0;
+    double high_hz = 0.0;
+
+    bool empty() const { return !(high_hz > low_hz); }
+};
+
+constexpr size_t kMaxFeatureBands = 8;
+constexpr size_t kMaxDefectLines = 4;
+
+/**
+ * Parse "low-high" ranges separated by commas, e.g. "25-35,55-65"
+ * Returns false (bands unchanged) on malformed input; "" gives no bands.
+ */
+inline bool parseFeatureBands(const std::string& text, std::vector<FeatureBand>& bands) {
+    std::vector<FeatureBand> parsed;
+    const char* p = text.c_str();
+    while (*p) {
+        char* end = nullptr;
+        FeatureBand band;
+        band.low_hz = std::strtod(p, &end);
+        if (end == p || *end != '-') return false;
+        p = end + 1;
+        band.high_hz = std::strtod(p, &end);
+        if (end == p || band.empty()) return false;
+        parsed.push_back(band);
+        p = end;
+        while (*p == ' ') ++p;
+        if (*p == ',') ++p;
+        else if (*p) return false;
+        while (*p == ' ') ++p;
+    }
+    bands = std::move(parsed);
+    return true;
+}
+
+/**
+ * Parse comma-separated frequencies, e.g. "107.4,162.2"
+ * Returns false (values unchanged) on malformed input.
+ */
+inline bool parseFrequencyList(const std::string& text, std::vector<double>& values) {
+    std::vector<double> parsed;
+    const char* p = text.c_str();
+    while (*p) {
+        char* end = nullptr;
+        double v = std::strtod(p, &end);
+        if (end == p || !(v > 0.0)) return false;
+        parsed.push_back(v);
+        p = end;
+        while (*p == ' ') ++p;
+        if (*p == ',') ++p;
+        else if (*p) return false;
+        while (*p == ' ') ++p;
+    }
+    values = std::move(parsed);
+    return true;
+}
+
+/**
+ * Compact feature vector of one analyzed frame
+ * Time-domain features use the window with its mean removed, so a DC
+ * offset does not hide impulses. Powers are in signal units squared:
+ * the AC powers of all bins add up to rms^2. Trivially copyable.
+ */
+struct SpectralFeatures {
+    double rms = 0.0;
+    double peak = 0.0;         // Largest |x - mean|
+    double crest_factor = 0.0; // peak / rms; ~1.4 for a sine, high for impulses
+    double kurtosis = 0.0;     // 3 for Gaussian noise, ~1.5 for a sine, high for impulses
+    double dominant_hz = 0.0;  // Strongest bin, DC excluded
+    double centroid_hz = 0.0;  // Power-weighted mean frequency, DC excluded
+
+    uint32_t band_count = 0;
+    std::array<double, kMaxFeatureBands> band_power{};
+
+    // Envelope spectrum of the demodulation band (zero if not configured):
+    // the strongest line and the amplitude at each configured defect frequency
+    double envelope_peak_hz = 0.0;
+    double envelope_peak = 0.0;
+    uint32_t defect_count = 0;
+    std::array<double, kMaxDefectLines> defect_amplitude{};
+};
+
+/**
+ * Per-frame anomaly limits on the features; 0 disables a check
+ * With the mean removed, a healthy rotating machine stays near the
+ * sine/noise values above; a single impulse in the window exceeds both.
+ */
+struct FeatureLimits {
+    double crest_factor = 6.0;
+    double kurtosis = 8.0;
+};
+
+inline bool isFeatureAnomaly(const SpectralFeatures& f, const FeatureLimits& limits) {
+    return (limits.crest_factor > 0.0 && f.crest_factor > limits.crest_factor) ||
+           (limits.kurtosis > 0.0 && f.kurtosis > limits.kurtosis);
+}
+
+/**
+ * One-pass feature stage over an analyzed frame
+ *
+ * Reuses the frame's spectrum, so time-domain statistics, centroid and
+ * band powers cost one sweep each over the window and the bins. The
+ * envelope spectrum (bearing defects) band-passes the spectrum, takes
+ * the analytic signal's magnitude with one inverse complex FFT and
+ * transforms that again; it only runs when a demodulation band is set.
+ * All buffers are sized at construction.
+ */
+class SpectralFeatureExtractor {
+public:
+    struct Options {
+        std::vector<FeatureBand> bands;  // Band powers to report (first kMaxFeatureBands)
+        FeatureBand envelope;            // Demodulation band; empty = no envelope spectrum
+        std::vector<double> defect_hz;   // Envelope lines to report (first kMaxDefectLines)
+    };
+
+    /**
+     * Bands around the first harmonics of a shaft frequency, each
+     * +-25% of the shaft frequency wide (1x/2x/3x by default)
+     */
+    static std::vector<FeatureBand> harmonicBands(double shaft_hz, size_t harmonics = 3) {
+        std::vector<FeatureBand> bands;
+        if (!(shaft_hz > 0.0)) return bands;
+        for (size_t h = 1; h <= std::min(harmonics, kMaxFeatureBands); ++h) {
+            double center = shaft_hz * static_cast<double>(h);
+            bands.push_back(FeatureBand{center - 0.25 * shaft_hz, center + 0.25 * shaft_hz});
+        }
+        return bands;
+    }
+
+    SpectralFeatureExtractor(size_t fft_size, double sample_rate, const Options& options = Options())
+        : n_(nextPowerOfTwo(std::max<size_t>(fft_size, 2))),
+          bin_hz_(sample_rate / static_cast<double>(n_)),
+          options_(options) {
+        band_count_ = std::min(options_.bands.size(), kMaxFeatureBands);
+        for (size_t b = 0; b < band_count_; ++b) {
+            band_bins_[b] = binRange(options_.bands[b]);
+        }
+        defect_count_ = std::min(options_.defect_hz.size(), kMaxDefectLines);
+        envelope_bins_ = binRange(options_.envelope);
+        if (envelope_bins_.second > envelope_bins_.first) {
+            hilbert_ = FFTPlan(n_);
+            envelope_fft_ = RealFFTPlan(n_);
+            analytic_re_.resize(n_);
+            analytic_im_.resize(n_);
+            envelope_.resize(n_);
+            envelope_re_.resize(n_ / 2 + 1);
+            envelope_im_.resize(n_ / 2 + 1);
+            envelope_mag_.resize(n_ / 2 + 1);
+        }
+    }
+
+    size_t fftSize() const { return n_; }
+    bool envelopeEnabled() const { return !envelope_.empty(); }
+    const Options& options() const { return options_; }
+
+    /**
+     * Features of one frame: window holds count time samples (oldest
+     * first); re/im/magnitudes hold bins values of its transform from
+     * 0 Hz, bin_hz() apart. If the transform was of the window times
+     * taper, band powers are corrected for the taper's power, and the
+     * envelope stage transforms the untapered window itself (the taper
+     * would otherwise show up as an envelope line).
+     */
+    void compute(const double* window, size_t count, const double* re, const double* im,
+                 const double* magnitudes, size_t bins, SpectralFeatures& out,
+                 const WindowFunction* taper = nullptr) {
+        out = SpectralFeatures();
+        if (count < 2 || bins < 2) return;
+        timeDomain(window, count, out);
+        const bool tapered = taper && !taper->rectangular();
+
+        // 2|X_k|^2 / n^2 is the power of bin k, so AC powers add up to rms^2
+        const double scale = 2.0 / (static_cast<double>(n_) * static_cast<double>(n_) *
+                                    (tapered ? taper->meanSquare() : 1.0));
+        size_t dominant = 1;
+        double power = 0.0;
+        double weighted = 0.0;
+        for (size_t k = 1; k < bins; ++k) {
+            double p = magnitudes[k] * magnitudes[k];
+            power += p;
+            weighted += p * static_cast<double>(k);
+            if (magnitudes[k] > magnitudes[dominant]) dominant = k;
+        }
+        out.dominant_hz = static_cast<double>(dominant) * bin_hz_;
+        out.centroid_hz = power > 0.0 ? weighted / power * bin_hz_ : 0.0;
+
+        out.band_count = static_cast<uint32_t>(band_count_);
+        for (size_t b = 0; b < band_count_; ++b) {
+            size_t last = std::min(band_bins_[b].second, bins);
+            double sum = 0.0;
+            for (size_t k = band_bins_[b].first; k < last; ++k) {
+                sum += magnitudes[k] * magnitudes[k];
+            }
+            out.band_power[b] = sum * scale;
+        }
+
+        if (envelopeEnabled() && bins >= n_ / 2) {
+            if (tapered) {
+                envelope_fft_.forward(window, count, envelope_re_.data(), envelope_im_.data());
+                re = envelope_re_.data();
+                im = envelope_im_.data();
+            }
+            envelopeSpectrum(re, im, out);
+        }
+    }
+
+    /**
+     * RMS, peak, crest factor and kurtosis only, for frames without a
+     * spectrum
+     */
+    static void timeDomain(const double* x, size_t n, SpectralFeatures& out) {
+        if (n < 2) return;
+        double mean = 0.0;
+        double lo = x[0];
+        double hi = x[0];
+        for (size_t i = 0; i < n; ++i) {
+            mean += x[i];
+            lo = std::min(lo, x[i]);
+            hi = std::max(hi, x[i]);
+        }
+        mean /= static_cast<double>(n);
+        double m2 = 0.0;
+        double m4 = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            double d = x[i] - mean;
+            double d2 = d * d;
+            m2 += d2;
+            m4 += d2 * d2;
+        }
+        m2 /= static_cast<double>(n);
+        m4 /= static_cast<double>(n);
+        out.rms = std::sqrt(m2);
+        out.peak = std::max(hi - mean, mean - lo);
+        out.crest_factor = out.rms > 0.0 ? out.peak / out.rms : 0.0;
+        out.kurtosis = m2 > 0.0 ? m4 / (m2 * m2) : 0.0;
+    }
+
+private:
+    // Bins [first, last) covering a band, DC excluded
+    std::pair<size_t, size_t> binRange(const FeatureBand& band) const {
+        if (band.empty()) return {0, 0};
+        size_t first = static_cast<size_t>(std::max(1.0, std::ceil(band.low_hz / bin_hz_)));
+        size_t last = static_cast<size_t>(std::max(0.0, std::ceil(band.high_hz / bin_hz_)));
+        last = std::min(last, n_ / 2);
+        return {first, std::max(first, last)};
+    }
+
+    void envelopeSpectrum(const double* re, const double* im, SpectralFeatures& out) {
+        // Analytic signal of the band: positive frequencies doubled, the
+        // rest zeroed. Inverse FFT as conj(FFT(conj(A))) / n; the outer
+        // conjugate does not change the magnitude
+        std::fill(analytic_re_.begin(), analytic_re_.end(), 0.0);
+        std::fill(analytic_im_.begin(), analytic_im_.end(), 0.0);
+        for (size_t k = envelope_bins_.first; k < envelope_bins_.second; ++k) {
+            analytic_re_[k] = 2.0 * re[k];
+            analytic_im_[k] = -2.0 * im[k];
+        }
+        hilbert_.forward(analytic_re_.data(), analytic_im_.data());
+        simd::magnitudes(analytic_re_.data(), analytic_im_.data(), envelope_.data(), n_);
+
+        double mean = 0.0;
+        for (double& e : envelope_) {
+            e /= static_cast<double>(n_);
+            mean += e;
+        }
+        mean /= static_cast<double>(n_);
+        for (double& e : envelope_) {
+            e -= mean;
+        }
+
+        envelope_fft_.forward(envelope_.data(), n_, envelope_re_.data(), envelope_im_.data());
+        size_t bins = n_ / 2;
+        simd::magnitudes(envelope_re_.data(), envelope_im_.data(), envelope_mag_.data(), bins);
+
+        // Line amplitudes: 2|E_k| / n
+        const double amplitude = 2.0 / static_cast<double>(n_);
+        size_t peak = 1;
+        for (size_t k = 2; k < bins; ++k) {
+            if (envelope_mag_[k] > envelope_mag_[peak]) peak = k;
+        }
+        out.envelope_peak_hz = static_cast<double>(peak) * bin_hz_;
+        out.envelope_peak = envelope_mag_[peak] * amplitude;
+
+        // Nearest bin and its neighbours, so a line between bins still counts
+        out.defect_count = static_cast<uint32_t>(defect_count_);
+        for (size_t d = 0; d < defect_count_; ++d) {
+            size_t k = static_cast<size_t>(std::lround(options_.defect_hz[d] / bin_hz_));
+            double best = 0.0;
+            for (size_t j = std::max<size_t>(k, 2) - 1; j <= k + 1 && j < bins; ++j) {
+                best = std::max(best, envelope_mag_[j]);
+            }
+            out.defect_amplitude[d] = best * amplitude;
+        }
+    }
+
+    size_t n_;
+    double bin_hz_;
+    Options options_;
+    size_t band_count_ = 0;
+    std::array<std::pair<size_t, size_t>, kMaxFeatureBands> band_bins_{};
+    size_t defect_count_ = 0;
+    std::pair<size_t, size_t> envelope_bins_{0, 0};
+
+    FFTPlan hilbert_;
+    RealFFTPlan envelope_fft_;
+    simd::aligned_vector<double> analytic_re_;
+    simd::aligned_vector<double> analytic_im_;
+    simd::aligned_vector<double> envelope_;
+    simd::aligned_vector<double> envelope_re_;
+    simd::aligned_vector<double> envelope_im_;
+    simd::aligned_vector<double> envelope_mag_;
+};
+
+#endif // SPECTRAL_FEATURES_HPP
@@ -0,0 +1,105 @@
+#ifndef SPOOL_HPP
+#define SPOOL_HPP
+
+#include "metric_point.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Durable store-and-forward queue of MetricPoints on local disk
+ *
+ * Points are appended to fixed-size segment files (seg-<seq>.spool) that
+ * are preallocated and memory-mapped, so an append is a memcpy into the
+ * page cache; syscalls only happen when a segment fills up and the next
+ * one is created. Each record carries a checksum and a commit marker, and
+ * each segment header records how many of its points were acknowledged,
+ * so after a crash or restart delivery resumes where it stopped.
+ *
+ * One thread appends and one other thread reads (peek/consume/retention).
+ * Data survives process crashes; segments are msync'ed when sealed, so a
+ * power loss can only lose the segment being written.
+ */
+class Spool {
+public:
+    struct Options {
+        std::string dir;
+        size_t segment_bytes = 4 * 1024 * 1024;
+        uint64_t max_bytes = 256ull * 1024 * 1024; // Oldest segments dropped beyond this
+        int64_t max_age_ms = 24ll * 3600 * 1000;    // Segments older than this are dropped
+    };
+
+    struct Stats {
+        size_t segments = 0;
+        uint64_t bytes = 0;
+        uint64_t pending = 0;  // Points not yet acknowledged
+        uint64_t appended = 0; // Since open
+        uint64_t dropped = 0;  // Lost to retention or a full disk since open
+    };
+
+    explicit Spool(const Options& options);
+    ~Spool();
+
+    Spool(const Spool&) = delete;
+    Spool& operator=(const Spool&) = delete;
+
+    /**
+     * False if the directory could not be opened; see error()
+     */
+    bool ok() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    // Writer side --------------------------------------------------------
+
+    /**
+     * Append one point; returns false (and counts a drop) only if a new
+     * segment could not be created
+     */
+    bool append(const MetricPoint& point);
+
+    // Reader side --------------------------------------------------------
+
+    /**
+     * Copy up to max of the oldest unacknowledged points into out
+     * (replacing its contents) without consuming them
+     */
+    size_t peek(std::vector<MetricPoint>& out, size_t max);
+
+    /**
+     * Acknowledge the first n points returned by the last peek()
+     */
+    void consume(size_t n);
+
+    /**
+     * Drop segments beyond max_bytes / max_age_ms (oldest first)
+     */
+    void enforceRetention(int64_t now_ms);
+
+    Stats stats() const;
+
+private:
+    struct Segment;
+
+    std::unique_ptr<Segment> openSegment(const std::string& path, uint64_t seq, bool create);
+    bool rollover();
+    void dropFront();
+
+    Options options_;
+    size_t capacity_; // Records per segment
+    std::string error_;
+
+    mutable std::mutex segments_mutex_; // Guards the list, not record data
+    std::deque<std::unique_ptr<Segment>> segments_;
+    Segment* tail_ = nullptr; // Writer's segment
+    uint64_t next_seq_ = 0;
+
+    std::atomic<uint64_t> appended_{0}; // Written by the producer only
+    std::atomic<uint64_t> dropped_{0};  // Producer (failed appends) and worker (retention)
+};
+
+#endif // SPOOL_HPP
@@ -0,0 +1,97 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Wait-free single-producer/single-consumer ring of trivially copyable items
+ *
+ * Slots are preallocated (capacity rounded up to a power of two), so
+ * neither side ever allocates or takes a lock. The producer and consumer
+ * indices live on separate cache lines, and each side keeps a cached copy
+ * of the other's index so the shared line is only re-read when the ring
+ * looks full (producer) or empty (consumer).
+ * Exactly one thread may push and exactly one other thread may pop.
+ */
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscRing items are copied slot-wise and must be trivially copyable");
+
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t n = 1;
+        while (n < std::max<size_t>(capacity, 1)) {
+            n <<= 1;
+        }
+        mask_ = n - 1;
+        slots_.resize(n);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+
+    /**
+     * Producer side: copy item into the ring
+     * Returns false without waiting if the ring is full
+     */
+    bool tryPush(const T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ > mask_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ > mask_) {
+                return false;
+            }
+        }
+        slots_[head & mask_] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer side: move up to max items into out
+     * Returns the number of items popped (0 if the ring is empty)
+     */
+    size_t pop(T* out, size_t max) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (cached_head_ - tail < max) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(cached_head_ - tail, max);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = slots_[(tail + i) & mask_];
+        }
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Items currently queued; exact only when called from either side
+     * while the other is idle
+     */
+    size_t sizeApprox() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Producer-owned line
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // Consumer-owned line
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+
+    alignas(64) size_t mask_ = 0;
+    std::vector<T> slots_;
+};
+
+#endif // SPSC_RING_HPP
@@ -0,0 +1,120 @@
+#ifndef SUMMARY_UPLOADER_HPP
+#define SUMMARY_UPLOADER_HPP
+
+#include "async_logger.hpp"
+#include "http_client.hpp"
+#include "interval_reducer.hpp"
+#include "pipeline_stage.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Transport stage for interval summaries (aggregate reduction mode)
+ *
+ * Summaries arrive a few times a minute, so they travel on their own
+ * pipeline stage and are posted synchronously from its thread; a slow
+ * backend only delays the next summary, never analytics. A failed post
+ * keeps up to backlog summaries and sends them with the next one. A
+ * backend without /api/ingest/summary (404/405) gets each summary's
+ * per-metric means as an ordinary point instead, so charts keep working.
+ */
+class SummaryUploader {
+public:
+    struct Options {
+        std::string device_id;
+        size_t backlog = 64; // Summaries held while the backend is unreachable
+        int cpu = -1;        // Pin the stage thread; -1 = no pinning
+    };
+
+    SummaryUploader(HttpClient& client, const Options& options)
+        : client_(client),
+          options_(options),
+          stage_(stageOptions(options),
+                 [this](const IntervalSummary* items, size_t count) { upload(items, count); }) {}
+
+    /**
+     * Queue a closed interval; false if the stage had no room
+     */
+    bool push(const IntervalSummary& summary) { return stage_.push(summary); }
+
+    // Summaries lost to a full stage, a full backlog or a rejected post
+    uint64_t dropped() const { return stage_.dropped() + lost_.load(std::memory_order_relaxed); }
+
+private:
+    static PipelineStage<IntervalSummary>::Options stageOptions(const Options& options) {
+        PipelineStage<IntervalSummary>::Options stage;
+        stage.name = "summary upload";
+        stage.threaded = true; // Posts block, so never inline
+        stage.capacity = 64;
+        stage.batch = 16;
+        stage.cpu = options.cpu;
+        return stage;
+    }
+
+    static MetricPoint meanPoint(const IntervalSummary& summary) {
+        MetricPoint point{};
+        point.ts_ms = summary.start_ms;
+        point.temperature_c = summary.aggregates[metricIndex(MetricId::Temperature)].mean;
+        point.vibration_g = summary.aggregates[metricIndex(MetricId::Vibration)].mean;
+        point.humidity_pct = summary.aggregates[metricIndex(MetricId::Humidity)].mean;
+        point.voltage_v = summary.aggregates[metricIndex(MetricId::Voltage)].mean;
+        return point;
+    }
+
+    void upload(const IntervalSummary* items, size_t count) {
+        pending_.insert(pending_.end(), items, items + count);
+        if (pending_.size() > options_.backlog) {
+            size_t excess = pending_.size() - options_.backlog;
+            pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(excess));
+            lost_.fetch_add(excess, std::memory_order_relaxed);
+        }
+
+        AsyncLogger& logger = AsyncLogger::global();
+        if (!legacy_) {
+            UploadResult result = client_.postSummaries(options_.device_id, pending_);
+            if (result.outcome == SendOutcome::Sent) {
+                pending_.clear();
+                return;
+            }
+            if (result.outcome == SendOutcome::Retry) {
+                logger.log(LogLevel::Warn, LogTopic::Upload, "Summary upload failed, %zu kept for retry: %s",
+                           pending_.size(), result.error.c_str());
+                return;
+            }
+            if (result.http_status != 404 && result.http_status != 405) {
+                logger.log(LogLevel::Error, LogTopic::Upload, "Summary upload rejected, %zu dropped: %s",
+                           pending_.size(), result.error.c_str());
+                lost_.fetch_add(pending_.size(), std::memory_order_relaxed);
+                pending_.clear();
+                return;
+            }
+            legacy_ = true;
+            logger.log(LogLevel::Warn, LogTopic::General,
+                       "Backend has no summary endpoint, uploading interval means as points");
+        }
+
+        std::vector<MetricPoint> means;
+        means.reserve(pending_.size());
+        for (const IntervalSummary& summary : pending_) {
+            means.push_back(meanPoint(summary));
+        }
+        if (client_.postMetrics(options_.device_id, means)) {
+            pending_.clear();
+        } else {
+            logger.log(LogLevel::Warn, LogTopic::Upload, "Interval mean upload failed, %zu kept for retry: %s",
+                       pending_.size(), client_.getLastError().c_str());
+        }
+    }
+
+    HttpClient& client_;
+    Options options_;
+    std::vector<IntervalSummary> pending_; // Stage thread only
+    bool legacy_ = false;                  // Stage thread only
+    std::atomic<uint64_t> lost_{0};
+    PipelineStage<IntervalSummary> stage_; // Last: its thread uses everything above
+};
+
+#endif // SUMMARY_UPLOADER_HPP
@@ -0,0 +1,45 @@
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+
+/**
+ * Pin the calling thread to one CPU; cpu < 0 leaves it unpinned
+ * Returns false with the reason appended to error if the kernel refused.
+ */
+inline bool pinCurrentThread(int cpu, std::string& error) {
+    if (cpu < 0) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        error += "pinning to CPU " + std::to_string(cpu) + " failed: " + std::strerror(rc) + "; ";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Run the calling thread under SCHED_FIFO at priority (1-99); 0 keeps the
+ * default policy
+ * Returns false with the reason appended to error if the kernel refused
+ * (typically missing CAP_SYS_NICE).
+ */
+inline bool setRealtimePriority(int priority, std::string& error) {
+    if (priority <= 0) return true;
+    sched_param param{};
+    param.sched_priority = std::clamp(priority, 1, 99);
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+        error += "SCHED_FIFO failed: " + std::string(std::strerror(rc)) + "; ";
+        return false;
+    }
+    return true;
+}
+
+#endif // THREAD_AFFINITY_HPP
@@ -0,0 +1,142 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Fixed-size pool for data-parallel loops
+ *
+ * parallelFor() splits [0, n) into chunks that the workers and the
+ * calling thread claim from a shared counter, and returns once every
+ * chunk is done. With zero threads everything runs inline on the caller.
+ * Each invocation gets a stable worker slot in [0, concurrency()), so
+ * callers can keep per-slot scratch buffers without locking.
+ * The first exception fn throws is rethrown on the caller once every
+ * thread has stopped; chunks not yet claimed are skipped.
+ */
+class ThreadPool {
+public:
+    // fn(slot, begin, end)
+    using RangeFn = std::function<void(size_t, size_t, size_t)>;
+
+    explicit ThreadPool(size_t threads = 0) {
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Number of distinct slots passed to RangeFn (workers + caller)
+     */
+    size_t concurrency() const {
+        return workers_.size() + 1;
+    }
+
+    /**
+     * Run fn over [0, n) in chunks of at most grain items; blocks until done
+     */
+    void parallelFor(size_t n, size_t grain, const RangeFn& fn) {
+        if (n == 0) return;
+        grain = grain == 0 ? 1 : grain;
+
+        if (workers_.empty() || n <= grain) {
+            fn(workers_.size(), 0, n);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_ = &fn;
+        job_size_ = n;
+        job_grain_ = grain;
+        next_.store(0, std::memory_order_relaxed);
+        busy_ = workers_.size();
+        ++generation_;
+        lock.unlock();
+        cv_.notify_all();
+
+        runChunks(workers_.size());
+
+        lock.lock();
+        done_cv_.wait(lock, [this] { return busy_ == 0; });
+        job_ = nullptr;
+        std::exception_ptr error = std::exchange(error_, nullptr);
+        lock.unlock();
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    // Called without mutex_ held; never throws, so busy_ always drops
+    void runChunks(size_t slot) {
+        try {
+            for (;;) {
+                size_t begin = next_.fetch_add(job_grain_, std::memory_order_relaxed);
+                if (begin >= job_size_) break;
+                size_t end = begin + job_grain_ < job_size_ ? begin + job_grain_ : job_size_;
+                (*job_)(slot, begin, end);
+            }
+        } catch (...) {
+            // Other threads run out of chunks; the caller gets the first error
+            next_.store(job_size_, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+    }
+
+    void workerLoop(size_t slot) {
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+
+            lock.unlock();
+            runChunks(slot);
+            lock.lock();
+
+            if (--busy_ == 0) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    const RangeFn* job_ = nullptr;
+    size_t job_size_ = 0;
+    size_t job_grain_ = 1;
+    std::atomic<size_t> next_{0};
+    size_t busy_ = 0;
+    std::exception_ptr error_; // First exception of the current job
+    size_t generation_ = 0;
+    bool stop_ = false;
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,92 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hashed timer wheel for large numbers of periodic timers
+ *
+ * Time is split into ticks of tick_ms; a timer lands in slot
+ * (due tick % slots) and stays there across rotations until its tick
+ * comes up. schedule() and firing are O(1) per timer regardless of how
+ * many are pending, which is what makes thousands of per-device
+ * intervals cheap compared to a heap or one sleeping thread each.
+ * Timers fire at tick granularity, never early. Not thread-safe.
+ */
+template <typename T>
+class TimerWheel {
+public:
+    TimerWheel(size_t slots, int64_t tick_ms, int64_t now_ms)
+        : tick_ms_(std::max<int64_t>(tick_ms, 1)),
+          slots_(std::max<size_t>(slots, 1)),
+          next_tick_(now_ms / tick_ms_) {}
+
+    /**
+     * Fire item at due_ms; times already passed fire on the next advance()
+     */
+    void schedule(int64_t due_ms, const T& item) {
+        // Round up so a timer never fires before its due time
+        int64_t tick = std::max((due_ms + tick_ms_ - 1) / tick_ms_, next_tick_);
+        slots_[static_cast<size_t>(tick) % slots_.size()].push_back({tick, item});
+        ++size_;
+    }
+
+    /**
+     * Call fn(item) for every timer due at or before now_ms and remove it
+     * fn may schedule() new timers; ones due right away fire on the next
+     * advance(), not this one.
+     */
+    template <typename Fn>
+    void advance(int64_t now_ms, Fn&& fn) {
+        int64_t now_tick = now_ms / tick_ms_;
+        if (now_tick < next_tick_) return;
+
+        // After a long stall every slot is visited once, not every tick
+        int64_t ticks = std::min<int64_t>(now_tick - next_tick_ + 1,
+                                          static_cast<int64_t>(slots_.size()));
+        int64_t first = next_tick_;
+        next_tick_ = now_tick + 1;
+        for (int64_t t = first; t < first + ticks; ++t) {
+            std::vector<Entry>& slot = slots_[static_cast<size_t>(t) % slots_.size()];
+            fired_.clear();
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].tick <= now_tick) {
+                    fired_.push_back(slot[i].item);
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                } else {
+                    ++i; // A later rotation
+                }
+            }
+            size_ -= fired_.size();
+            for (const T& item : fired_) {
+                fn(item);
+            }
+        }
+    }
+
+    /**
+     * Start of the next unprocessed tick, i.e. when advance() next has work
+     * to look at
+     */
+    int64_t nextTickMs() const { return next_tick_ * tick_ms_; }
+
+    size_t size() const { return size_; }
+
+private:
+    struct Entry {
+        int64_t tick;
+        T item;
+    };
+
+    int64_t tick_ms_;
+    std::vector<std::vector<Entry>> slots_;
+    std::vector<T> fired_;
+    int64_t next_tick_;
+    size_t size_ = 0;
+};
+
+#endif // TIMER_WHEEL_HPP
@@ -0,0 +1,240 @@
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include "bounded_queue.hpp"
+#include "metric_point.hpp"
+#include "retry_scheduler.hpp"
+#include "spool.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Transport;
+
+// Upload body encoding (the /api/ingest body, or an MQTT payload)
+enum class WireFormat {
+  Json,     // application/json, two decimals per value
+  Columnar, // application/x-iot-columnar (see columnar_codec.hpp)
+};
+
+// Parse "json" or "columnar"; returns false and leaves format unchanged
+// for anything else
+bool parseWireFormat(const std::string &name, WireFormat &format);
+
+// Lock-free send path for one sampling thread and one device.
+// push() copies the point into a preallocated ring and never blocks or
+// allocates; the transport's worker is only woken once per
+// producer_wake_batch points and otherwise polls every producer_poll_ms.
+// With a spool directory configured, points go to the device's disk spool
+// instead of the ring.
+class MetricProducer {
+public:
+  // Ring (or spool) of one producer, owned by its transport
+  struct Channel {
+    Channel(const std::string &id, size_t capacity, size_t wake)
+        : device_id(id), ring(capacity), wake_batch(wake) {}
+
+    std::string device_id;
+    SpscRing<MetricPoint> ring;
+    size_t wake_batch;
+    // Written only by the producer; relaxed loads elsewhere are for stats
+    std::atomic<size_t> pushed{0};
+    std::atomic<size_t> dropped{0};
+    size_t unsignaled = 0; // Producer-only
+
+    // Set when points are spooled to disk instead of the ring
+    std::unique_ptr<Spool> spool;
+    bool in_flight = false; // Worker-only: a replay request is running
+  };
+
+  // Returns false (and counts a drop) if the ring is full, or if the
+  // spool could not create a new segment
+  bool push(const MetricPoint &point);
+
+  // Points dropped because the ring or the spool was full
+  size_t dropped() const;
+
+private:
+  friend class Transport;
+
+  MetricProducer(Transport *transport, Channel *channel)
+      : transport_(transport), channel_(channel) {}
+
+  Transport *transport_;
+  Channel *channel_;
+};
+
+// Spool directory for device_id under spool_dir; anything outside
+// [A-Za-z0-9_-] becomes '_' so ids cannot escape it
+std::string deviceSpoolDir(const std::string &spool_dir,
+                           const std::string &device_id);
+
+// Queue, producer and spool settings every transport shares;
+// HttpClientOptions and MqttClientOptions extend them
+struct TransportOptions {
+  // Async queue bound: at most queue_capacity pending postMetricsAsync()
+  // calls are held; overflow_policy decides what happens beyond that
+  size_t queue_capacity = 10000;
+  OverflowPolicy overflow_policy = OverflowPolicy::DropOldest;
+  size_t queue_high_water = 0;  // 0 = 80% of capacity
+  size_t downsample_factor = 4; // Keep 1 in N above high water (Downsample)
+
+  // MetricProducer rings: points buffered per producer, points between
+  // worker wakeups, and the worker's polling period while producers exist
+  size_t producer_ring_capacity = 4096;
+  size_t producer_wake_batch = 32;
+  long producer_poll_ms = 20;
+
+  // Store-and-forward: when spool_dir is set, every producer appends to
+  // memory-mapped segments under spool_dir/<device_id> and the worker
+  // replays them, acknowledging only what the backend accepted. Points
+  // survive restarts and outages up to spool_max_bytes / spool_max_age_ms.
+  std::string spool_dir;
+  size_t spool_segment_bytes = 4 * 1024 * 1024;
+  uint64_t spool_max_bytes = 256ull * 1024 * 1024;
+  int64_t spool_max_age_ms = 24ll * 3600 * 1000;
+};
+
+// Outcome of one finished async upload request (or MQTT publish)
+struct UploadResult {
+  std::string device_id;
+  size_t points = 0;
+  SendOutcome outcome = SendOutcome::Sent; // Retry: points kept for later
+  long http_status = 0;                    // 0 if no response arrived
+  std::string error;                       // Empty when sent
+  std::chrono::milliseconds latency{0};
+  bool replayed = false; // Read back from the disk spool
+};
+
+// Called on the worker thread for every finished async request; must not
+// block, since it delays every other upload in flight
+using UploadCallback = std::function<void(const UploadResult &result)>;
+
+// Where sampled points are uploaded: HttpClient posts them to
+// /api/ingest, MqttClient publishes them to sensors/<device_id>/metrics.
+// Either way the sampling threads only touch MetricProducer rings, and a
+// background worker batches, sends and retries.
+//
+// The producer registry, the async queue and their stats live here; a
+// client only implements its worker's send and acknowledgement path.
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  Transport(const Transport &) = delete;
+  Transport &operator=(const Transport &) = delete;
+
+  // "http" or "mqtt", for logs
+  virtual const char *name() const = 0;
+
+  // Upload metrics asynchronously (non-blocking unless the queue is full
+  // and the overflow policy is Block). Returns false if dropped.
+  bool postMetricsAsync(const std::string &device_id,
+                        const std::vector<MetricPoint> &metrics);
+
+  // Register a lock-free producer for device_id. The handle stays valid
+  // for the transport's lifetime and must only be pushed from one thread.
+  MetricProducer createProducer(const std::string &device_id);
+
+  // Depth and pushed/dropped counters of the async queue (dropped and
+  // pushed also include producer rings)
+  QueueStats getQueueStats() const;
+
+  // Totals over all producer spools (all zero without spool_dir)
+  Spool::Stats getSpoolStats() const;
+
+  // Called (from the producing thread) when the queue reaches high water
+  void setHighWaterCallback(std::function<void(size_t depth)> callback);
+
+  // Register the completion callback for async uploads (replaces any
+  // previous one)
+  void setCompletionCallback(UploadCallback callback);
+
+  // Last error from any request
+  std::string getLastError() const;
+
+protected:
+  friend class MetricProducer;
+
+  // One postMetricsAsync() call waiting for the worker
+  struct RequestTask {
+    std::string device_id;
+    std::vector<MetricPoint> metrics;
+  };
+
+  explicit Transport(const TransportOptions &options);
+
+  // Wake the worker from any thread (a batch of producer points is ready)
+  virtual void wakeWorker() = 0;
+
+  void setLastError(const std::string &error);
+
+  // Copy of the completion callback, to call without holding its lock
+  UploadCallback completionCallback() const;
+
+  bool hasProducers() const { return has_producers_; }
+
+  // Points rejected for good or over a client's staging limit; they count
+  // as dropped in getQueueStats()
+  void countDropped(size_t points) {
+    staging_dropped_.fetch_add(points, std::memory_order_relaxed);
+  }
+
+  // Worker-only: pops every ring-backed producer into scratch-sized
+  // chunks and hands each point to stage(device_id, point)
+  template <typename StageFn>
+  void drainProducers(std::vector<MetricPoint> &scratch, StageFn &&stage);
+
+  // Worker-only: producers that spool to disk, refreshed on every call.
+  // Channels live as long as the transport, so uploads from them don't
+  // hold the producer lock.
+  const std::vector<MetricProducer::Channel *> &spoolChannels();
+
+  BoundedQueue<RequestTask> task_queue_;
+
+private:
+  MetricProducer producerFor(MetricProducer::Channel *channel) {
+    return MetricProducer(this, channel);
+  }
+
+  TransportOptions transport_options_;
+  mutable std::mutex error_mutex_;
+  std::string last_error_;
+  mutable std::mutex callback_mutex_;
+  UploadCallback on_complete_;
+
+  // Producer rings are owned here; the worker polls all of them
+  std::vector<std::unique_ptr<MetricProducer::Channel>> producers_;
+  mutable std::mutex producers_mutex_;
+  std::atomic<bool> has_producers_{false};
+  std::vector<MetricProducer::Channel *> spool_channels_; // Worker-only
+  std::atomic<size_t> staging_dropped_{0};
+};
+
+template <typename StageFn>
+void Transport::drainProducers(std::vector<MetricPoint> &scratch,
+                               StageFn &&stage) {
+  if (!has_producers_)
+    return;
+
+  std::lock_guard<std::mutex> lock(producers_mutex_);
+  for (auto &channel : producers_) {
+    if (channel->spool)
+      continue; // Replayed straight from disk
+    size_t n;
+    while ((n = channel->ring.pop(scratch.data(), scratch.size())) > 0) {
+      for (size_t i = 0; i < n; ++i) {
+        stage(channel->device_id, scratch[i]);
+      }
+    }
+  }
+}
+
+#endif // TRANSPORT_HPP
@@ -0,0 +1,121 @@
+#ifndef WINDOW_FUNCTION_HPP
+#define WINDOW_FUNCTION_HPP
+
+#include "simd.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+/**
+ * Tapers applied before a transform to limit spectral leakage
+ * All are cosine sums w[m] = sum_j (-1)^j a_j cos(2*pi*j*m/n), periodic
+ * (DFT-even), so the same coefficients also window a sliding DFT as a
+ * short convolution over neighbouring bins.
+ */
+enum class WindowType {
+    Rectangular,
+    Hann,
+    Hamming,
+    BlackmanHarris, // 4-term, -92 dB sidelobes
+};
+
+// Parse "rectangular", "hann", "hamming" or "blackman_harris"; false
+// (type unchanged) for anything else
+inline bool parseWindowType(const std::string& name, WindowType& type) {
+    if (name == "rectangular" || name == "none") {
+        type = WindowType::Rectangular;
+    } else if (name == "hann") {
+        type = WindowType::Hann;
+    } else if (name == "hamming") {
+        type = WindowType::Hamming;
+    } else if (name == "blackman_harris") {
+        type = WindowType::BlackmanHarris;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* windowTypeName(WindowType type) {
+    switch (type) {
+    case WindowType::Rectangular: return "rectangular";
+    case WindowType::Hann: return "hann";
+    case WindowType::Hamming: return "hamming";
+    case WindowType::BlackmanHarris: return "blackman_harris";
+    }
+    return "rectangular";
+}
+
+/**
+ * Cosine-sum coefficients a_0..a_{terms-1}
+ * a_0 is the coherent gain (mean of the window).
+ */
+struct CosineTerms {
+    std::array<double, 4> a{};
+    size_t terms = 1;
+};
+
+inline CosineTerms cosineTerms(WindowType type) {
+    switch (type) {
+    case WindowType::Rectangular: return {{1.0, 0.0, 0.0, 0.0}, 1};
+    case WindowType::Hann: return {{0.5, 0.5, 0.0, 0.0}, 2};
+    case WindowType::Hamming: return {{0.54, 0.46, 0.0, 0.0}, 2};
+    case WindowType::BlackmanHarris: return {{0.35875, 0.48829, 0.14128, 0.01168}, 4};
+    }
+    return {{1.0, 0.0, 0.0, 0.0}, 1};
+}
+
+/**
+ * Precomputed taper of n points
+ * mean() corrects tone amplitudes and meanSquare() noise and band powers
+ * for the window's gain.
+ */
+class WindowFunction {
+public:
+    explicit WindowFunction(WindowType type = WindowType::Rectangular, size_t n = 0)
+        : type_(type), coefficients_(n) {
+        CosineTerms c = cosineTerms(type);
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        for (size_t m = 0; m < n; ++m) {
+            double w = 0.0;
+            for (size_t j = 0; j < c.terms; ++j) {
+                double sign = (j % 2 == 0) ? 1.0 : -1.0;
+                w += sign * c.a[j] * std::cos(2.0 * M_PI * static_cast<double>(j * m) / static_cast<double>(n));
+            }
+            coefficients_[m] = w;
+            sum += w;
+            sum_sq += w * w;
+        }
+        if (n > 0) {
+            mean_ = sum / static_cast<double>(n);
+            mean_square_ = sum_sq / static_cast<double>(n);
+        }
+    }
+
+    WindowType type() const { return type_; }
+    size_t size() const { return coefficients_.size(); }
+    bool rectangular() const { return type_ == WindowType::Rectangular; }
+    double mean() const { return mean_; }
+    double meanSquare() const { return mean_square_; }
+    const double* data() const { return coefficients_.data(); }
+
+    /**
+     * out[m] = (in[m] - offset) * w[m] for the first count <= size()
+     * samples; pass the window mean as offset so a DC level does not leak
+     * into the lowest bins through the taper's main lobe
+     */
+    void apply(const double* in, double* out, size_t count, double offset = 0.0) const {
+        simd::multiplyOffset(in, offset, coefficients_.data(), out, std::min(count, coefficients_.size()));
+    }
+
+private:
+    WindowType type_;
+    simd::aligned_vector<double> coefficients_;
+    double mean_ = 1.0;
+    double mean_square_ = 1.0;
+};
+
+#endif // WINDOW_FUNCTION_HPP
@@ -0,0 +1,179 @@
+#include "agent_metrics.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+    constexpr const char* kStageNames[kStageCount] = {
+        "generate", "analytics", "fft", "serialize", "enqueue", "http_round_trip", "mqtt_round_trip",
+    };
+
+    // Prometheus bucket bounds: powers of two from 256 ns to ~34 s
+    constexpr unsigned kFirstBoundExponent = 8;
+    constexpr unsigned kLastBoundExponent = 35;
+
+    void appendf(std::string& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    void appendf(std::string& out, const char* fmt, ...) {
+        char buffer[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = std::vsnprintf(buffer, sizeof(buffer), fmt, args);
+        va_end(args);
+        if (n > 0) out.append(buffer, std::min<size_t>(static_cast<size_t>(n), sizeof(buffer) - 1));
+    }
+
+    void appendCounter(std::string& out, const char* name, const char* help, uint64_t value) {
+        appendf(out, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n", name, help, name, name, value);
+    }
+
+    // Short human-readable duration
+    std::string formatNs(uint64_t ns) {
+        char buffer[32];
+        if (ns < 10000) {
+            std::snprintf(buffer, sizeof(buffer), "%" PRIu64 "ns", ns);
+        } else if (ns < 10000000) {
+            std::snprintf(buffer, sizeof(buffer), "%.1fus", static_cast<double>(ns) / 1e3);
+        } else if (ns < 10000000000ull) {
+            std::snprintf(buffer, sizeof(buffer), "%.1fms", static_cast<double>(ns) / 1e6);
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "%.1fs", static_cast<double>(ns) / 1e9);
+        }
+        return buffer;
+    }
+}
+
+const char* stageName(Stage stage) {
+    return kStageNames[static_cast<size_t>(stage)];
+}
+
+uint64_t LatencyHistogram::bucketUpperNs(size_t bucket) {
+    if (bucket < kLinear) return bucket;
+    if (bucket >= kBuckets - 1) return UINT64_MAX;
+    size_t rel = bucket - kLinear;
+    unsigned exponent = static_cast<unsigned>(rel >> kSubBits) + kSubBits + 1;
+    uint64_t sub = rel & ((size_t(1) << kSubBits) - 1);
+    unsigned shift = exponent - kSubBits;
+    uint64_t lower = ((uint64_t(1) << kSubBits) + sub) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snap;
+    for (const Shard& shard : shards_) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            snap.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snap.sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+    for (uint64_t c : snap.counts) snap.count += c;
+    return snap;
+}
+
+uint64_t LatencyHistogram::Snapshot::quantileNs(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) return bucketUpperNs(i);
+    }
+    return bucketUpperNs(kBuckets - 1);
+}
+
+uint64_t LatencyHistogram::Snapshot::countAtOrBelow(uint64_t bound_ns) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets && bucketUpperNs(i) <= bound_ns; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+AgentMetrics& AgentMetrics::global() {
+    static AgentMetrics metrics;
+    return metrics;
+}
+
+void AgentMetrics::addGauge(const void* owner, const std::string& name, const std::string& help,
+                            std::function<double()> read) {
+    std::lock_guard<std::mutex> lock(gauges_mutex_);
+    gauges_.push_back({owner, name, help, std::move(read)});
+}
+
+void AgentMetrics::removeGauges(const void* owner) {
+    std::lock_guard<std::mutex> lock(gauges_mutex_);
+    gauges_.erase(std::remove_if(gauges_.begin(), gauges_.end(),
+                                 [owner](const Gauge& gauge) { return gauge.owner == owner; }),
+                  gauges_.end());
+}
+
+std::string AgentMetrics::renderPrometheus() const {
+    std::string out;
+    out.reserve(16 * 1024);
+
+    out += "# HELP agent_stage_duration_seconds Time spent per pipeline stage invocation\n"
+           "# TYPE agent_stage_duration_seconds histogram\n";
+    for (size_t s = 0; s < kStageCount; ++s) {
+        LatencyHistogram::Snapshot snap = stages_[s].snapshot();
+        if (snap.count == 0) continue;
+        // Power-of-two bounds line up with sub-bucket edges, so every
+        // cumulative count is exact
+        for (unsigned e = kFirstBoundExponent; e <= kLastBoundExponent; ++e) {
+            uint64_t bound = (uint64_t(1) << e) - 1;
+            appendf(out, "agent_stage_duration_seconds_bucket{stage=\"%s\",le=\"%.9g\"} %" PRIu64 "\n",
+                    kStageNames[s], static_cast<double>(bound + 1) / 1e9, snap.countAtOrBelow(bound));
+        }
+        appendf(out, "agent_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+                kStageNames[s], snap.count);
+        appendf(out, "agent_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n", kStageNames[s],
+                static_cast<double>(snap.sum_ns) / 1e9);
+        appendf(out, "agent_stage_duration_seconds_count{stage=\"%s\"} %" PRIu64 "\n", kStageNames[s],
+                snap.count);
+    }
+
+    out += "# HELP agent_upload_requests_total Finished upload requests by outcome\n"
+           "# TYPE agent_upload_requests_total counter\n";
+    appendf(out, "agent_upload_requests_total{outcome=\"sent\"} %" PRIu64 "\n", uploads_sent.value());
+    appendf(out, "agent_upload_requests_total{outcome=\"retry\"} %" PRIu64 "\n", uploads_retried.value());
+    appendf(out, "agent_upload_requests_total{outcome=\"reject\"} %" PRIu64 "\n", uploads_rejected.value());
+    out += "# HELP agent_upload_errors_total Failed upload attempts by kind\n"
+           "# TYPE agent_upload_errors_total counter\n";
+    appendf(out, "agent_upload_errors_total{kind=\"transport\"} %" PRIu64 "\n", transport_errors.value());
+    appendf(out, "agent_upload_errors_total{kind=\"http\"} %" PRIu64 "\n", http_errors.value());
+    appendCounter(out, "agent_upload_points_total", "Points in finished upload requests", upload_points.value());
+    appendCounter(out, "agent_upload_bytes_total", "Upload request body bytes after compression",
+                  upload_bytes.value());
+    appendCounter(out, "agent_samples_total", "Acquired samples", samples.value());
+    appendCounter(out, "agent_samples_missed_total", "Sampling deadlines skipped", samples_missed.value());
+    appendCounter(out, "agent_pipeline_dropped_total", "Samples dropped between pipeline stages",
+                  pipeline_dropped.value());
+
+    std::lock_guard<std::mutex> lock(gauges_mutex_);
+    for (const Gauge& gauge : gauges_) {
+        appendf(out, "# HELP %s %s\n# TYPE %s gauge\n%s %.17g\n", gauge.name.c_str(), gauge.help.c_str(),
+                gauge.name.c_str(), gauge.name.c_str(), gauge.read());
+    }
+    return out;
+}
+
+std::vector<std::string> AgentMetrics::summaryLines() const {
+    std::vector<std::string> lines;
+    for (size_t s = 0; s < kStageCount; ++s) {
+        LatencyHistogram::Snapshot snap = stages_[s].snapshot();
+        if (snap.count == 0) continue;
+        std::string line;
+        appendf(line, "[metrics] %-15s n=%" PRIu64 " mean=%s p50=%s p99=%s max=%s", kStageNames[s], snap.count,
+                formatNs(snap.sum_ns / snap.count).c_str(), formatNs(snap.quantileNs(0.5)).c_str(),
+                formatNs(snap.quantileNs(0.99)).c_str(), formatNs(snap.maxNs()).c_str());
+        lines.push_back(line);
+    }
+    std::string line;
+    appendf(line,
+            "[metrics] uploads sent=%" PRIu64 " retry=%" PRIu64 " reject=%" PRIu64 " points=%" PRIu64
+            " bytes=%" PRIu64 " samples=%" PRIu64 " missed=%" PRIu64 " dropped=%" PRIu64,
+            uploads_sent.value(), uploads_retried.value(), uploads_rejected.value(), upload_points.value(),
+            upload_bytes.value(), samples.value(), samples_missed.value(), pipeline_dropped.value());
+    lines.push_back(line);
+    return lines;
+}
@@ -0,0 +1,255 @@
+#include "async_logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+
+namespace {
+    constexpr const char* kTopicNames[kLogTopicCount] = {
+        "general", "sample", "anomaly", "timing", "upload", "stats",
+    };
+
+    const char* levelPrefix(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "Debug: ";
+            case LogLevel::Warn: return "Warning: ";
+            case LogLevel::Error: return "Error: ";
+            default: return "";
+        }
+    }
+
+    // Coarse clock: a vDSO read without a hardware timer access
+    int64_t coarseSeconds() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<int64_t>(ts.tv_sec);
+    }
+
+    void writeAll(int fd, const std::string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return; // Nowhere left to report it
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+}
+
+bool parseLogLevel(const std::string& name, LogLevel& level) {
+    if (name == "debug") {
+        level = LogLevel::Debug;
+    } else if (name == "info") {
+        level = LogLevel::Info;
+    } else if (name == "warn" || name == "warning") {
+        level = LogLevel::Warn;
+    } else if (name == "error") {
+        level = LogLevel::Error;
+    } else if (name == "off") {
+        level = LogLevel::Off;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+AsyncLogger& AsyncLogger::global() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+}
+
+void AsyncLogger::start(const LogOptions& options) {
+    stop();
+    setFilter(options);
+    ring_records_ = std::max<size_t>(options.ring_records, 16);
+    flush_ms_ = std::max(options.flush_ms, 1L);
+
+    stop_ = false;
+    running_.store(true, std::memory_order_release);
+    writer_ = std::thread(&AsyncLogger::writerLoop, this);
+}
+
+void AsyncLogger::setFilter(const LogOptions& options) {
+    LogLevel level = options.quiet ? std::max(options.level, LogLevel::Warn) : options.level;
+    threshold_.store(static_cast<int>(level), std::memory_order_relaxed);
+    for (size_t i = 0; i < kLogTopicCount; ++i) {
+        limits_[i].rate.store(options.rate_per_s[i], std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogger::stop() {
+    if (!writer_.joinable()) return;
+    running_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_one();
+    writer_.join();
+}
+
+void AsyncLogger::log(LogLevel level, LogTopic topic, const char* fmt, ...) {
+    if (!enabled(level) || !admit(topic)) return;
+    va_list args;
+    va_start(args, fmt);
+    submit(INT64_MIN, level, topic, fmt, args);
+    va_end(args);
+}
+
+void AsyncLogger::logAt(int64_t ts_ms, LogLevel level, LogTopic topic, const char* fmt, ...) {
+    if (!enabled(level) || !admit(topic)) return;
+    va_list args;
+    va_start(args, fmt);
+    submit(ts_ms, level, topic, fmt, args);
+    va_end(args);
+}
+
+bool AsyncLogger::admit(LogTopic topic) {
+    TopicLimit& limit = limits_[static_cast<size_t>(topic)];
+    uint32_t rate = limit.rate.load(std::memory_order_relaxed);
+    if (rate == 0) return true;
+
+    // One-second windows; a racing reset may let a message or two through
+    int64_t now = coarseSeconds();
+    if (limit.window_s.load(std::memory_order_relaxed) != now) {
+        limit.window_s.store(now, std::memory_order_relaxed);
+        limit.count.store(0, std::memory_order_relaxed);
+    }
+    if (limit.count.fetch_add(1, std::memory_order_relaxed) < rate) return true;
+    limit.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void AsyncLogger::submit(int64_t ts_ms, LogLevel level, LogTopic topic, const char* fmt, va_list args) {
+    Record record;
+    record.seq = next_seq_.fetch_add(1, std::memory_order_relaxed);
+    record.ts_ms = ts_ms;
+    record.level = level;
+    record.topic = topic;
+    int n = std::vsnprintf(record.text, sizeof(record.text), fmt, args);
+    record.length = static_cast<uint16_t>(std::clamp<int>(n, 0, sizeof(record.text) - 1));
+
+    if (!running_.load(std::memory_order_acquire)) {
+        // No writer thread: write through
+        std::string line;
+        IsoTimestampFormatter timestamps;
+        append(line, record, timestamps);
+        writeAll(level >= LogLevel::Warn ? STDERR_FILENO : STDOUT_FILENO, line);
+        return;
+    }
+    if (!threadRing()->tryPush(record)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+AsyncLogger::Ring* AsyncLogger::threadRing() {
+    // Rings are never freed before the logger, so the pointer stays valid
+    thread_local Ring* ring = nullptr;
+    if (!ring) {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(std::make_unique<Ring>(ring_records_));
+        ring = rings_.back().get();
+    }
+    return ring;
+}
+
+void AsyncLogger::writerLoop() {
+    std::vector<Record> batch;
+    std::vector<Record> scratch(256);
+    std::array<uint64_t, kLogTopicCount> reported{};
+    uint64_t dropped_reported = 0;
+    int64_t report_s = coarseSeconds();
+
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(flush_ms_), [this] { return stop_; });
+            stopping = stop_;
+        }
+
+        // Everything currently buffered, in logging order across threads
+        std::vector<Ring*> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (const auto& ring : rings_) rings.push_back(ring.get());
+        }
+        batch.clear();
+        for (Ring* ring : rings) {
+            size_t n;
+            while ((n = ring->pop(scratch.data(), scratch.size())) > 0) {
+                batch.insert(batch.end(), scratch.begin(), scratch.begin() + static_cast<std::ptrdiff_t>(n));
+            }
+        }
+        std::sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) { return a.seq < b.seq; });
+
+        // Once a second, say what the limits held back
+        int64_t now = coarseSeconds();
+        if (now != report_s || stopping) {
+            report_s = now;
+            for (size_t i = 0; i < kLogTopicCount; ++i) {
+                uint64_t suppressed = limits_[i].suppressed.load(std::memory_order_relaxed);
+                if (suppressed == reported[i]) continue;
+                Record note{};
+                note.seq = UINT64_MAX;
+                note.ts_ms = INT64_MIN;
+                note.level = LogLevel::Warn;
+                note.topic = LogTopic::General;
+                int n = std::snprintf(note.text, sizeof(note.text), "%llu %s messages suppressed by rate limit",
+                                      static_cast<unsigned long long>(suppressed - reported[i]), kTopicNames[i]);
+                note.length = static_cast<uint16_t>(std::clamp<int>(n, 0, sizeof(note.text) - 1));
+                batch.push_back(note);
+                reported[i] = suppressed;
+            }
+            uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+            if (dropped != dropped_reported) {
+                Record note{};
+                note.seq = UINT64_MAX;
+                note.ts_ms = INT64_MIN;
+                note.level = LogLevel::Warn;
+                note.topic = LogTopic::General;
+                int n = std::snprintf(note.text, sizeof(note.text), "%llu log messages dropped (buffer full)",
+                                      static_cast<unsigned long long>(dropped - dropped_reported));
+                note.length = static_cast<uint16_t>(std::clamp<int>(n, 0, sizeof(note.text) - 1));
+                batch.push_back(note);
+                dropped_reported = dropped;
+            }
+        }
+
+        flush(batch);
+        if (stopping) break;
+    }
+}
+
+void AsyncLogger::flush(std::vector<Record>& batch) {
+    if (batch.empty()) return;
+    std::string out;
+    std::string err;
+    for (const Record& record : batch) {
+        append(record.level >= LogLevel::Warn ? err : out, record, timestamps_);
+    }
+    if (!out.empty()) writeAll(STDOUT_FILENO, out);
+    if (!err.empty()) writeAll(STDERR_FILENO, err);
+}
+
+void AsyncLogger::append(std::string& out, const Record& record, IsoTimestampFormatter& timestamps) {
+    if (record.ts_ms != INT64_MIN) {
+        char ts[IsoTimestampFormatter::kLength];
+        timestamps.write(record.ts_ms, ts);
+        out += '[';
+        out.append(ts, sizeof(ts));
+        out += "] ";
+    }
+    out += levelPrefix(record.level);
+    out.append(record.text, record.length);
+    out += '\n';
+}
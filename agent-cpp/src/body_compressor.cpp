@@ -0,0 +1,157 @@
+#include "body_compressor.hpp"
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+bool parseCompression(const std::string& name, Compression& compression) {
+    if (name == "none") compression = Compression::None;
+    else if (name == "gzip") compression = Compression::Gzip;
+    else if (name == "zstd") compression = Compression::Zstd;
+    else return false;
+    return true;
+}
+
+bool compressionAvailable(Compression compression) {
+    switch (compression) {
+    case Compression::None:
+        return true;
+    case Compression::Gzip:
+#ifdef HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+const char* compressionEncoding(Compression compression) {
+    switch (compression) {
+    case Compression::Gzip: return "gzip";
+    case Compression::Zstd: return "zstd";
+    case Compression::None: break;
+    }
+    return nullptr;
+}
+
+struct BodyCompressor::Impl {
+    int level;
+    size_t min_bytes;
+    std::string dictionary;
+    std::vector<char> out;
+
+#ifdef HAVE_ZLIB
+    z_stream gzip{};
+    bool gzip_ready = false;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx* zstd = nullptr;
+    ZSTD_CDict* zstd_dict = nullptr;
+#endif
+
+    ~Impl() {
+#ifdef HAVE_ZLIB
+        if (gzip_ready) deflateEnd(&gzip);
+#endif
+#ifdef HAVE_ZSTD
+        if (zstd_dict) ZSTD_freeCDict(zstd_dict);
+        if (zstd) ZSTD_freeCCtx(zstd);
+#endif
+    }
+
+    bool gzipCompress(std::string_view body, size_t& written) {
+#ifdef HAVE_ZLIB
+        if (!gzip_ready) {
+            // windowBits 15 + 16 selects the gzip wrapper
+            int lvl = level == 0 ? Z_DEFAULT_COMPRESSION : level;
+            if (deflateInit2(&gzip, lvl, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            gzip_ready = true;
+        } else if (deflateReset(&gzip) != Z_OK) {
+            return false;
+        }
+
+        size_t bound = deflateBound(&gzip, static_cast<uLong>(body.size()));
+        if (out.size() < bound) out.resize(bound);
+        gzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        gzip.avail_in = static_cast<uInt>(body.size());
+        gzip.next_out = reinterpret_cast<Bytef*>(out.data());
+        gzip.avail_out = static_cast<uInt>(out.size());
+        if (deflate(&gzip, Z_FINISH) != Z_STREAM_END) {
+            return false;
+        }
+        written = out.size() - gzip.avail_out;
+        return true;
+#else
+        (void)body;
+        (void)written;
+        return false;
+#endif
+    }
+
+    bool zstdCompress(std::string_view body, size_t& written) {
+#ifdef HAVE_ZSTD
+        int lvl = level == 0 ? ZSTD_CLEVEL_DEFAULT : level;
+        if (!zstd) {
+            zstd = ZSTD_createCCtx();
+            if (!zstd) return false;
+            if (!dictionary.empty()) {
+                // Digest the dictionary once; every body reuses it
+                zstd_dict = ZSTD_createCDict(dictionary.data(), dictionary.size(), lvl);
+            }
+        }
+
+        size_t bound = ZSTD_compressBound(body.size());
+        if (out.size() < bound) out.resize(bound);
+        size_t n = zstd_dict
+            ? ZSTD_compress_usingCDict(zstd, out.data(), out.size(), body.data(), body.size(), zstd_dict)
+            : ZSTD_compressCCtx(zstd, out.data(), out.size(), body.data(), body.size(), lvl);
+        if (ZSTD_isError(n)) {
+            return false;
+        }
+        written = n;
+        return true;
+#else
+        (void)body;
+        (void)written;
+        return false;
+#endif
+    }
+};
+
+BodyCompressor::BodyCompressor(int level, size_t min_bytes, std::string zstd_dictionary)
+    : impl_(new Impl) {
+    impl_->level = level;
+    impl_->min_bytes = min_bytes;
+    impl_->dictionary = std::move(zstd_dictionary);
+}
+
+BodyCompressor::~BodyCompressor() = default;
+
+bool BodyCompressor::compress(Compression compression, std::string_view body, std::string_view& out) {
+    if (compression == Compression::None || body.size() < impl_->min_bytes) {
+        return false;
+    }
+
+    size_t written = 0;
+    bool ok = compression == Compression::Gzip ? impl_->gzipCompress(body, written)
+                                               : impl_->zstdCompress(body, written);
+    if (!ok || written >= body.size()) {
+        return false;
+    }
+    out = std::string_view(impl_->out.data(), written);
+    return true;
+}
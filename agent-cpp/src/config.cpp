@@ -1,49 +1,160 @@
 #include "config.hpp"
+#include "json_reader.hpp"
 #include <fstream>
 #include <iostream>
+#include <cerrno>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
 #include <algorithm>
+#include <variant>
 
-// Simple JSON parser (minimal implementation)
 namespace {
-    std::string trim(const std::string& str) {
-        size_t first = str.find_first_not_of(" \t\n\r");
-        if (first == std::string::npos) return "";
-        size_t last = str.find_last_not_of(" \t\n\r");
-        return str.substr(first, (last - first + 1));
-    }
-
-    std::string getJsonValue(const std::string& json, const std::string& key) {
-        std::string searchKey = "\"" + key + "\"";
-        size_t pos = json.find(searchKey);
-        if (pos == std::string::npos) return "";
-
-        pos = json.find(":", pos);
-        if (pos == std::string::npos) return "";
-
-        size_t start = json.find_first_not_of(" \t:", pos);
-        if (start == std::string::npos) return "";
-
-        size_t end = start;
-        if (json[start] == '"') {
-            start++;
-            end = json.find("\"", start);
-            if (end == std::string::npos) return "";
-            return json.substr(start, end - start);
+    // Scalars of a config file by dotted path ("metrics.vibration")
+    using JsonFields = std::map<std::string, JsonScalar>;
+
+    const JsonScalar* find(const JsonFields& fields, const char* key) {
+        auto it = fields.find(key);
+        if (it == fields.end() || it->second.type == JsonScalar::Type::Null) return nullptr;
+        return &it->second;
+    }
+
+    void problem(std::string& problems, const char* key, const char* expected) {
+        if (!problems.empty()) problems += "; ";
+        problems += std::string("'") + key + "' must be " + expected;
+    }
+
+    // Each read() leaves the field unchanged if the key is absent or null,
+    // or notes the key in problems if its value has the wrong type.
+    // Numbers and booleans may also be given as strings.
+    void read(const JsonFields& fields, const char* key, std::string& field, std::string& problems) {
+        const JsonScalar* v = find(fields, key);
+        if (!v) return;
+        if (v->type == JsonScalar::Type::String || v->type == JsonScalar::Type::Number) {
+            field = v->text;
+        } else {
+            problem(problems, key, "a string");
+        }
+    }
+
+    void read(const JsonFields& fields, const char* key, double& field, std::string& problems) {
+        const JsonScalar* v = find(fields, key);
+        if (!v) return;
+        char* end = nullptr;
+        double parsed = std::strtod(v->text.c_str(), &end);
+        if (v->type != JsonScalar::Type::Bool && !v->text.empty() && *end == '\0' && std::isfinite(parsed)) {
+            field = parsed;
         } else {
-            while (end < json.length() && json[end] != ',' && json[end] != '}' && json[end] != '\n') {
-                end++;
-            }
-            return trim(json.substr(start, end - start));
+            problem(problems, key, "a number");
         }
     }
 
-    bool getJsonBool(const std::string& json, const std::string& key) {
-        std::string value = getJsonValue(json, key);
-        return value == "true" || value == "1";
+    void read(const JsonFields& fields, const char* key, int& field, std::string& problems) {
+        const JsonScalar* v = find(fields, key);
+        if (!v) return;
+        char* end = nullptr;
+        errno = 0;
+        long parsed = std::strtol(v->text.c_str(), &end, 10);
+        if (v->type != JsonScalar::Type::Bool && !v->text.empty() && *end == '\0' && errno == 0 &&
+            parsed >= INT_MIN && parsed <= INT_MAX) {
+            field = static_cast<int>(parsed);
+        } else {
+            problem(problems, key, "an integer");
+        }
     }
+
+    void read(const JsonFields& fields, const char* key, bool& field, std::string& problems) {
+        const JsonScalar* v = find(fields, key);
+        if (!v) return;
+        if (v->text == "true" || v->text == "1") {
+            field = true;
+        } else if (v->text == "false" || v->text == "0") {
+            field = false;
+        } else {
+            problem(problems, key, "true or false");
+        }
+    }
+
+    // Every top-level config file key and the field it sets
+    struct Field {
+        const char* key;
+        std::variant<std::string AgentConfig::*, int AgentConfig::*, double AgentConfig::*, bool AgentConfig::*>
+            member;
+    };
+
+    const Field kFields[] = {
+        {"device_id", &AgentConfig::device_id},
+        {"api_base_url", &AgentConfig::api_base_url},
+        {"interval_ms", &AgentConfig::interval_ms},
+        {"jitter_ms", &AgentConfig::jitter_ms},
+        {"anomaly_probability", &AgentConfig::anomaly_probability},
+        {"http2", &AgentConfig::http2},
+        {"batch_max_points", &AgentConfig::batch_max_points},
+        {"batch_linger_ms", &AgentConfig::batch_linger_ms},
+        {"queue_capacity", &AgentConfig::queue_capacity},
+        {"queue_policy", &AgentConfig::queue_policy},
+        {"wire_format", &AgentConfig::wire_format},
+        {"compression", &AgentConfig::compression},
+        {"compression_level", &AgentConfig::compression_level},
+        {"compression_min_bytes", &AgentConfig::compression_min_bytes},
+        {"zstd_dictionary", &AgentConfig::zstd_dictionary},
+        {"spool_dir", &AgentConfig::spool_dir},
+        {"spool_max_mb", &AgentConfig::spool_max_mb},
+        {"spool_max_age_s", &AgentConfig::spool_max_age_s},
+        {"max_in_flight", &AgentConfig::max_in_flight},
+        {"gateway_devices", &AgentConfig::gateway_devices},
+        {"gateway_threads", &AgentConfig::gateway_threads},
+        {"gateway_vibration_pct", &AgentConfig::gateway_vibration_pct},
+        {"sample_rate_hz", &AgentConfig::sample_rate_hz},
+        {"vibration_channels", &AgentConfig::vibration_channels},
+        {"vibration_threads", &AgentConfig::vibration_threads},
+        {"realtime_priority", &AgentConfig::realtime_priority},
+        {"cpu_affinity", &AgentConfig::cpu_affinity},
+        {"pipeline_threads", &AgentConfig::pipeline_threads},
+        {"analytics_cpu", &AgentConfig::analytics_cpu},
+        {"transport_cpu", &AgentConfig::transport_cpu},
+        {"log_level", &AgentConfig::log_level},
+        {"log_quiet", &AgentConfig::log_quiet},
+        {"log_sample_per_s", &AgentConfig::log_sample_per_s},
+        {"log_anomaly_per_s", &AgentConfig::log_anomaly_per_s},
+        {"metrics_port", &AgentConfig::metrics_port},
+        {"metrics_bind", &AgentConfig::metrics_bind},
+        {"metrics_dump_s", &AgentConfig::metrics_dump_s},
+        {"reduction", &AgentConfig::reduction},
+        {"reduction_interval_ms", &AgentConfig::reduction_interval_ms},
+        {"anomaly_pre_ms", &AgentConfig::anomaly_pre_ms},
+        {"anomaly_post_ms", &AgentConfig::anomaly_post_ms},
+        {"anomaly_trigger_z", &AgentConfig::anomaly_trigger_z},
+        {"shaft_hz", &AgentConfig::shaft_hz},
+        {"feature_bands_hz", &AgentConfig::feature_bands_hz},
+        {"envelope_band_hz", &AgentConfig::envelope_band_hz},
+        {"bearing_defect_hz", &AgentConfig::bearing_defect_hz},
+        {"fft_crest_limit", &AgentConfig::fft_crest_limit},
+        {"fft_kurtosis_limit", &AgentConfig::fft_kurtosis_limit},
+        {"fft_size", &AgentConfig::fft_size},
+        {"fft_window", &AgentConfig::fft_window},
+        {"fft_mode", &AgentConfig::fft_mode},
+        {"fft_target_hz", &AgentConfig::fft_target_hz},
+        {"fft_baseline", &AgentConfig::fft_baseline},
+        {"fft_baseline_alpha", &AgentConfig::fft_baseline_alpha},
+        {"fft_baseline_warmup", &AgentConfig::fft_baseline_warmup},
+        {"fft_baseline_z", &AgentConfig::fft_baseline_z},
+        {"fft_baseline_min_bins", &AgentConfig::fft_baseline_min_bins},
+        {"fft_baseline_relearn", &AgentConfig::fft_baseline_relearn},
+        {"baseline_dir", &AgentConfig::baseline_dir},
+        {"baseline_save_s", &AgentConfig::baseline_save_s},
+        {"sensor_source", &AgentConfig::sensor_source},
+        {"sensor_block_samples", &AgentConfig::sensor_block_samples},
+        {"iio_device", &AgentConfig::iio_device},
+        {"iio_channel", &AgentConfig::iio_channel},
+        {"transport", &AgentConfig::transport},
+        {"mqtt_broker_url", &AgentConfig::mqtt_broker_url},
+        {"mqtt_qos", &AgentConfig::mqtt_qos},
+        {"mqtt_max_in_flight", &AgentConfig::mqtt_max_in_flight},
+        {"mqtt_keepalive_s", &AgentConfig::mqtt_keepalive_s},
+    };
 }
 
 AgentConfig::AgentConfig()
@@ -52,6 +163,63 @@ AgentConfig::AgentConfig()
     , interval_ms(1000)
     , jitter_ms(100)
     , anomaly_probability(0.05)
+    , http2(false)
+    , batch_max_points(500)
+    , batch_linger_ms(0)
+    , queue_capacity(10000)
+    , queue_policy("drop_oldest")
+    , wire_format("json")
+    , compression("none")
+    , compression_level(0)
+    , compression_min_bytes(1024)
+    , spool_max_mb(256)
+    , spool_max_age_s(86400)
+    , max_in_flight(8)
+    , gateway_devices(100)
+    , gateway_threads(0)
+    , gateway_vibration_pct(20)
+    , sample_rate_hz(1000)
+    , vibration_channels(1)
+    , vibration_threads(0)
+    , realtime_priority(0)
+    , cpu_affinity(-1)
+    , pipeline_threads(true)
+    , analytics_cpu(-1)
+    , transport_cpu(-1)
+    , log_level("info")
+    , log_quiet(false)
+    , log_sample_per_s(0)
+    , log_anomaly_per_s(5)
+    , metrics_port(0)
+    , metrics_bind("127.0.0.1")
+    , metrics_dump_s(0)
+    , reduction("raw")
+    , reduction_interval_ms(10000)
+    , anomaly_pre_ms(5000)
+    , anomaly_post_ms(5000)
+    , anomaly_trigger_z(6.0)
+    , shaft_hz(30.0)
+    , fft_crest_limit(6.0)
+    , fft_kurtosis_limit(8.0)
+    , fft_size(256)
+    , fft_window("hann")
+    , fft_mode("fft")
+    , fft_baseline(true)
+    , fft_baseline_alpha(0.01)
+    , fft_baseline_warmup(200)
+    , fft_baseline_z(6.0)
+    , fft_baseline_min_bins(2)
+    , fft_baseline_relearn(500)
+    , baseline_save_s(300)
+    , sensor_source("simulated")
+    , sensor_block_samples(0)
+    , iio_device("iio:device0")
+    , iio_channel("in_accel_z")
+    , transport("http")
+    , mqtt_broker_url("mqtt://localhost:1883")
+    , mqtt_qos(1)
+    , mqtt_max_in_flight(16)
+    , mqtt_keepalive_s(30)
 {
     metrics_enabled["temperature"] = true;
     metrics_enabled["vibration"] = true;
@@ -60,42 +228,50 @@ AgentConfig::AgentConfig()
 }
 
 bool AgentConfig::loadFromFile(const std::string& filepath) {
+    std::string error;
+    bool ok = loadFromFile(filepath, error);
+    if (!error.empty()) {
+        std::cerr << "Warning: " << error << std::endl;
+    }
+    return ok;
+}
+
+bool AgentConfig::loadFromFile(const std::string& filepath, std::string& error) {
+    error.clear();
     std::ifstream file(filepath);
     if (!file.is_open()) {
-        std::cerr << "Warning: Could not open config file: " << filepath << std::endl;
+        error = "Could not open config file: " + filepath;
         return false;
     }
 
     std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     file.close();
 
-    // Parse JSON (simple implementation)
-    std::string value;
-
-    value = getJsonValue(json, "device_id");
-    if (!value.empty()) device_id = value;
-
-    value = getJsonValue(json, "api_base_url");
-    if (!value.empty()) api_base_url = value;
-
-    value = getJsonValue(json, "interval_ms");
-    if (!value.empty()) interval_ms = std::stoi(value);
-
-    value = getJsonValue(json, "jitter_ms");
-    if (!value.empty()) jitter_ms = std::stoi(value);
+    // Parse the whole document before touching any field, so a broken
+    // file leaves the config as it was
+    JsonFields fields;
+    std::string parse_error;
+    bool parsed = parseJson(
+        json, [&fields](const std::string& path, const JsonScalar& value) { fields[path] = value; }, parse_error);
+    if (!parsed) {
+        error = filepath + ": " + parse_error;
+        return false;
+    }
 
-    value = getJsonValue(json, "anomaly_probability");
-    if (!value.empty()) anomaly_probability = std::stod(value);
+    std::string problems;
+    for (const Field& field : kFields) {
+        std::visit([&](auto member) { read(fields, field.key, this->*member, problems); }, field.member);
+    }
 
-    // Parse metrics object
-    size_t metricsPos = json.find("\"metrics\"");
-    if (metricsPos != std::string::npos) {
-        metrics_enabled["temperature"] = getJsonBool(json, "temperature");
-        metrics_enabled["vibration"] = getJsonBool(json, "vibration");
-        metrics_enabled["humidity"] = getJsonBool(json, "humidity");
-        metrics_enabled["voltage"] = getJsonBool(json, "voltage");
+    // Metrics listed in the "metrics" object; unlisted ones keep their setting
+    for (auto& entry : metrics_enabled) {
+        std::string key = "metrics." + entry.first;
+        read(fields, key.c_str(), entry.second, problems);
     }
 
+    if (!problems.empty()) {
+        error = filepath + ": " + problems + " (skipped)";
+    }
     return true;
 }
 
@@ -113,19 +289,132 @@ void AgentConfig::loadFromEnv() {
 
     env = std::getenv("AGENT_ANOMALY_PROBABILITY");
     if (env) anomaly_probability = std::stod(env);
+
+    env = std::getenv("AGENT_BATCH_LINGER_MS");
+    if (env) batch_linger_ms = std::stoi(env);
+
+    env = std::getenv("AGENT_QUEUE_POLICY");
+    if (env) queue_policy = env;
+
+    env = std::getenv("AGENT_WIRE_FORMAT");
+    if (env) wire_format = env;
+
+    env = std::getenv("AGENT_COMPRESSION");
+    if (env) compression = env;
+
+    env = std::getenv("AGENT_SPOOL_DIR");
+    if (env) spool_dir = env;
+
+    env = std::getenv("AGENT_MAX_IN_FLIGHT");
+    if (env) max_in_flight = std::stoi(env);
+
+    env = std::getenv("AGENT_GATEWAY_DEVICES");
+    if (env) gateway_devices = std::stoi(env);
+
+    env = std::getenv("AGENT_SAMPLE_RATE_HZ");
+    if (env) sample_rate_hz = std::stoi(env);
+
+    env = std::getenv("AGENT_VIBRATION_CHANNELS");
+    if (env) vibration_channels = std::stoi(env);
+
+    env = std::getenv("AGENT_VIBRATION_THREADS");
+    if (env) vibration_threads = std::stoi(env);
+
+    env = std::getenv("AGENT_REALTIME_PRIORITY");
+    if (env) realtime_priority = std::stoi(env);
+
+    env = std::getenv("AGENT_CPU_AFFINITY");
+    if (env) cpu_affinity = std::stoi(env);
+
+    env = std::getenv("AGENT_PIPELINE_THREADS");
+    if (env) pipeline_threads = (std::strcmp(env, "true") == 0 || std::strcmp(env, "1") == 0);
+
+    env = std::getenv("AGENT_ANALYTICS_CPU");
+    if (env) analytics_cpu = std::stoi(env);
+
+    env = std::getenv("AGENT_TRANSPORT_CPU");
+    if (env) transport_cpu = std::stoi(env);
+
+    env = std::getenv("AGENT_LOG_LEVEL");
+    if (env) log_level = env;
+
+    env = std::getenv("AGENT_LOG_QUIET");
+    if (env) log_quiet = (std::strcmp(env, "true") == 0 || std::strcmp(env, "1") == 0);
+
+    env = std::getenv("AGENT_METRICS_PORT");
+    if (env) metrics_port = std::stoi(env);
+
+    env = std::getenv("AGENT_METRICS_DUMP_S");
+    if (env) metrics_dump_s = std::stoi(env);
+
+    env = std::getenv("AGENT_REDUCTION");
+    if (env) reduction = env;
+
+    env = std::getenv("AGENT_REDUCTION_INTERVAL_MS");
+    if (env) reduction_interval_ms = std::stoi(env);
+
+    env = std::getenv("AGENT_SHAFT_HZ");
+    if (env) shaft_hz = std::stod(env);
+
+    env = std::getenv("AGENT_ENVELOPE_BAND_HZ");
+    if (env) envelope_band_hz = env;
+
+    env = std::getenv("AGENT_BEARING_DEFECT_HZ");
+    if (env) bearing_defect_hz = env;
+
+    env = std::getenv("AGENT_FFT_WINDOW");
+    if (env) fft_window = env;
+
+    env = std::getenv("AGENT_FFT_MODE");
+    if (env) fft_mode = env;
+
+    env = std::getenv("AGENT_FFT_TARGET_HZ");
+    if (env) fft_target_hz = env;
+
+    env = std::getenv("AGENT_FFT_BASELINE");
+    if (env) fft_baseline = (std::strcmp(env, "true") == 0 || std::strcmp(env, "1") == 0);
+
+    env = std::getenv("AGENT_BASELINE_DIR");
+    if (env) baseline_dir = env;
+
+    env = std::getenv("AGENT_SENSOR_SOURCE");
+    if (env) sensor_source = env;
+
+    env = std::getenv("AGENT_IIO_DEVICE");
+    if (env) iio_device = env;
+
+    env = std::getenv("AGENT_IIO_CHANNEL");
+    if (env) iio_channel = env;
+
+    env = std::getenv("AGENT_TRANSPORT");
+    if (env) transport = env;
+
+    env = std::getenv("AGENT_MQTT_BROKER_URL");
+    if (env) mqtt_broker_url = env;
+
+    env = std::getenv("AGENT_HTTP2");
+    if (env) http2 = (std::strcmp(env, "true") == 0 || std::strcmp(env, "1") == 0);
 }
 
 void AgentConfig::parseArgs(int argc, char* argv[]) {
+    // The value of --name=value, if arg is that option
+    auto option = [](const std::string& arg, const char* prefix, std::string& value) {
+        size_t length = std::strlen(prefix);
+        if (arg.compare(0, length, prefix) != 0) return false;
+        value = arg.substr(length);
+        return true;
+    };
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
-        if (arg.find("--device_id=") == 0) {
-            device_id = arg.substr(13);
-        } else if (arg.find("--api_base_url=") == 0) {
-            api_base_url = arg.substr(16);
-        } else if (arg.find("--interval_ms=") == 0) {
-            interval_ms = std::stoi(arg.substr(15));
-        } else if (arg.find("--anomaly_probability=") == 0) {
-            anomaly_probability = std::stod(arg.substr(22));
+        std::string value;
+        if (option(arg, "--device_id=", value)) {
+            device_id = value;
+        } else if (option(arg, "--api_base_url=", value)) {
+            api_base_url = value;
+        } else if (option(arg, "--interval_ms=", value)) {
+            interval_ms = std::stoi(value);
+        } else if (option(arg, "--anomaly_probability=", value)) {
+            anomaly_probability = std::stod(value);
         } else if (arg == "--help" || arg == "-h") {
             std::cout << "Usage: " << argv[0] << " [options]\n"
                       << "Options:\n"
@@ -139,3 +428,27 @@ void AgentConfig::parseArgs(int argc, char* argv[]) {
     }
 }
 
+
+std::vector<std::string> AgentConfig::changedKeys(const AgentConfig& other) const {
+    std::vector<std::string> keys;
+    for (const Field& field : kFields) {
+        bool same = std::visit([&](auto member) { return this->*member == other.*member; }, field.member);
+        if (!same) keys.push_back(field.key);
+    }
+    for (const auto& entry : metrics_enabled) {
+        auto it = other.metrics_enabled.find(entry.first);
+        if (it == other.metrics_enabled.end() || it->second != entry.second) keys.push_back("metrics." + entry.first);
+    }
+    return keys;
+}
+
+MetricMask AgentConfig::enabledMetrics() const {
+    MetricMask mask = 0;
+    for (const auto& entry : metrics_enabled) {
+        MetricId id;
+        if (entry.second && metricFromName(entry.first, id)) {
+            mask |= metricBit(id);
+        }
+    }
+    return mask;
+}
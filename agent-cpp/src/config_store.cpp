@@ -0,0 +1,211 @@
+#include "config_store.hpp"
+#include "agent_metrics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    // Write end of the self-pipe the SIGHUP handler wakes the watcher with
+    volatile std::sig_atomic_t hangup_fd = -1;
+    struct sigaction previous_hangup;
+
+    void onHangup(int) {
+        int saved = errno;
+        char byte = 1;
+        ssize_t written = ::write(hangup_fd, &byte, 1);
+        (void)written;
+        errno = saved;
+    }
+
+    constexpr auto kDebounce = std::chrono::milliseconds(200);
+}
+
+ConfigStore::ConfigStore(const Options& options) : options_(options) {
+    for (const std::string& candidate : options_.paths) {
+        if (std::ifstream(candidate).is_open()) {
+            path_ = candidate;
+            break;
+        }
+    }
+    if (path_.empty() && !options_.paths.empty()) {
+        std::cerr << "Warning: Could not open config file: " << options_.paths.front() << std::endl;
+    }
+
+    // A broken file still leaves the defaults, environment and arguments
+    auto config = std::make_unique<AgentConfig>();
+    std::string error;
+    build(*config, error);
+    if (!error.empty()) {
+        std::cerr << "Warning: " << error << std::endl;
+    }
+    current_.store(config.get(), std::memory_order_release);
+    snapshots_.push_back(std::move(config));
+    version_.store(1, std::memory_order_release);
+    AgentMetrics::global().addGauge(this, "agent_config_version", "Config snapshots published since start",
+                                    [this] { return static_cast<double>(version()); });
+}
+
+ConfigStore::~ConfigStore() {
+    stop_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable()) thread_.join();
+    if (signal_fd_ >= 0) {
+        ::sigaction(SIGHUP, &previous_hangup, nullptr);
+        ::close(hangup_fd);
+        hangup_fd = -1;
+        ::close(signal_fd_);
+    }
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+    AgentMetrics::global().removeGauges(this);
+}
+
+bool ConfigStore::build(AgentConfig& config, std::string& error) const {
+    error.clear();
+    bool ok = path_.empty() || config.loadFromFile(path_, error);
+    try {
+        config.loadFromEnv();
+        config.parseArgs(options_.argc, options_.argv);
+    } catch (const std::exception& e) {
+        if (!error.empty()) error += "; ";
+        error += std::string("invalid environment or argument value: ") + e.what();
+        ok = false;
+    }
+    return ok;
+}
+
+bool ConfigStore::reload(std::string& error) {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    auto config = std::make_unique<AgentConfig>();
+    if (!build(*config, error)) return false;
+
+    const AgentConfig& previous = *snapshots_.back();
+    std::vector<std::string> changed = config->changedKeys(previous);
+    if (changed.empty()) return true;
+
+    const AgentConfig& next = *config;
+    snapshots_.push_back(std::move(config));
+    current_.store(&next, std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_release);
+    if (callback_) callback_(previous, next, changed);
+    return true;
+}
+
+bool ConfigStore::watch(ChangeCallback callback, std::string& error) {
+    if (thread_.joinable()) {
+        error = "config is already watched";
+        return false;
+    }
+    if (hangup_fd >= 0) {
+        error = "another config store handles SIGHUP";
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        callback_ = std::move(callback);
+    }
+
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        error = std::string("config reload pipe: ") + std::strerror(errno);
+        return false;
+    }
+    signal_fd_ = fds[0];
+    hangup_fd = fds[1];
+    struct sigaction action {};
+    action.sa_handler = onHangup;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGHUP, &action, &previous_hangup);
+
+    // Watch the directory, not the file: editors and config management
+    // usually write a new file and rename it over the old one
+    if (!path_.empty()) {
+        std::filesystem::path dir = std::filesystem::path(path_).parent_path();
+        inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0 ||
+            ::inotify_add_watch(inotify_fd_, dir.empty() ? "." : dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            error = "cannot watch " + path_ + " (" + std::strerror(errno) + "), reloading on SIGHUP only";
+            if (inotify_fd_ >= 0) ::close(inotify_fd_);
+            inotify_fd_ = -1;
+        }
+    }
+    thread_ = std::thread(&ConfigStore::run, this);
+    return error.empty();
+}
+
+void ConfigStore::run() {
+    using Clock = std::chrono::steady_clock;
+    const std::string name = std::filesystem::path(path_).filename().string();
+    bool pending = false;
+    Clock::time_point due;
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        // Short poll timeout so shutdown never waits long
+        pollfd fds[2] = {{signal_fd_, POLLIN, 0}, {inotify_fd_, POLLIN, 0}};
+        int ready = ::poll(fds, inotify_fd_ >= 0 ? 2 : 1, 200);
+        bool now = false;
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            char bytes[64];
+            while (::read(signal_fd_, bytes, sizeof(bytes)) > 0) {
+            }
+            now = true;
+        }
+        if (ready > 0 && inotify_fd_ >= 0 && (fds[1].revents & POLLIN)) {
+            alignas(inotify_event) char buffer[4096];
+            ssize_t n;
+            while ((n = ::read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+                for (ssize_t at = 0; at < n;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + at);
+                    if (event->len > 0 && name == event->name) {
+                        // Wait for the writes to settle before reading
+                        pending = true;
+                        due = Clock::now() + kDebounce;
+                    }
+                    at += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+            }
+        }
+        if (pending && Clock::now() >= due) now = true;
+        if (!now) continue;
+
+        pending = false;
+        std::string error;
+        bool ok = reload(error);
+        if (!error.empty()) {
+            AsyncLogger::global().log(LogLevel::Warn, LogTopic::General, "Config reload: %s%s", error.c_str(),
+                                      ok ? "" : ", keeping the running config");
+        }
+    }
+}
+
+bool logOptionsFromConfig(const AgentConfig& config, LogOptions& options) {
+    bool known = parseLogLevel(config.log_level, options.level);
+    options.quiet = config.log_quiet;
+    options.rate_per_s[static_cast<size_t>(LogTopic::Sample)] =
+        static_cast<uint32_t>(std::max(0, config.log_sample_per_s));
+    options.rate_per_s[static_cast<size_t>(LogTopic::Anomaly)] =
+        static_cast<uint32_t>(std::max(0, config.log_anomaly_per_s));
+    return known;
+}
+
+std::string describeReload(const std::vector<std::string>& changed_keys, const std::vector<std::string>& live_keys) {
+    std::string applied;
+    std::string restart;
+    for (const std::string& key : changed_keys) {
+        bool live = std::find(live_keys.begin(), live_keys.end(), key) != live_keys.end();
+        std::string& list = live ? applied : restart;
+        list += list.empty() ? key : ", " + key;
+    }
+    std::string out = applied.empty() ? "" : "applied " + applied;
+    if (!restart.empty()) out += (out.empty() ? "" : "; ") + ("restart needed for " + restart);
+    return out;
+}
@@ -0,0 +1,450 @@
+#include "agent_metrics.hpp"
+#include "async_logger.hpp"
+#include "config.hpp"
+#include "config_store.hpp"
+#include "device_simulator.hpp"
+#include "fft_analyzer.hpp"
+#include "http_client.hpp"
+#include "mqtt_client.hpp"
+#include "local_analytics.hpp"
+#include "metrics_exporter.hpp"
+#include "spectral_baseline.hpp"
+#include "thread_pool.hpp"
+#include "timer_wheel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+    volatile std::sig_atomic_t stop_requested = 0;
+
+    void onSignal(int) { stop_requested = 1; }
+
+    int64_t steadyMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /**
+     * Per-device settings; derived from the gateway config for now
+     */
+    struct DeviceConfig {
+        std::string device_id;
+        bool vibration = false; // FFT vibration sensor instead of environment sensor
+        int interval_ms = 1000;
+        int jitter_ms = 100;
+        double anomaly_probability = 0.05;
+        bool fft_baseline = false; // Learned spectrum baseline on the vibration FFT
+        BaselineOptions baseline;
+    };
+
+    /**
+     * One hosted device: its own analytics state, RNG and upload producer
+     *
+     * step() is run by one pool thread at a time; parallelFor() returning
+     * orders consecutive steps, which is what the SPSC producer requires.
+     */
+    class DevicePipeline {
+    public:
+        DevicePipeline(const DeviceConfig& config, uint32_t seed, MetricProducer producer,
+                       MetricMask metrics, int64_t start_ms, int64_t first_due_ms)
+            : config_(config),
+              analytics_(200, 3.0, config.vibration ? metricBit(MetricId::Vibration) : metrics),
+              gen_(seed),
+              normal_dist_(0.0, 1.0),
+              jitter_dist_(-config.jitter_ms, config.jitter_ms),
+              producer_(producer),
+              start_ms_(start_ms),
+              due_ms_(first_due_ms) {
+            if (config_.vibration) {
+                fft_ = std::make_unique<FFTAnalyzer>(256, 1000.0, 128);
+                if (config_.fft_baseline) fft_->configureBaseline(config_.baseline);
+            }
+        }
+
+        int64_t firstDueMs() const { return due_ms_; }
+        const std::string& deviceId() const { return config_.device_id; }
+
+        // Only while no step() runs; nullptr without a vibration baseline
+        SpectralBaseline* baseline() { return fft_ ? fft_->baseline() : nullptr; }
+
+        // True once after the baseline restarted learning (only while no step() runs)
+        bool takeRelearned() { return std::exchange(relearned_, false); }
+
+        /**
+         * Apply reloaded sampling settings from the next step() on; only
+         * while no step() runs
+         */
+        void retune(int interval_ms, int jitter_ms, double anomaly_probability) {
+            config_.interval_ms = interval_ms;
+            config_.jitter_ms = jitter_ms;
+            config_.anomaly_probability = anomaly_probability;
+            jitter_dist_.param(std::uniform_int_distribution<>::param_type(-jitter_ms, jitter_ms));
+        }
+
+        /**
+         * Take one sample, update analytics and queue it for upload
+         * Returns when the next sample is due.
+         */
+        int64_t step(int64_t now_ms) {
+            AgentMetrics& metrics = AgentMetrics::global();
+            double t = (due_ms_ - start_ms_) / 1000.0;
+            MetricPoint point;
+            bool anomaly;
+            if (config_.vibration) {
+                uint64_t start_ns = monotonicNowNs();
+                double vibration = simulateVibration(t, config_.anomaly_probability, gen_, normal_dist_);
+                uint64_t generated_ns = monotonicNowNs();
+                metrics.stage(Stage::Generate).record(generated_ns - start_ns);
+                const auto& fft = fft_->process(vibration);
+                uint64_t fft_ns = monotonicNowNs();
+                if (fft.fresh) metrics.stage(Stage::Fft).record(fft_ns - generated_ns);
+                bool fft_anomaly = fft.fresh && fft.anomaly;
+                if (fft.fresh && fft.baseline_relearned) {
+                    relearned_ = true;
+                    AsyncLogger::global().log(LogLevel::Warn, LogTopic::General,
+                                              "%s: spectrum off its baseline for %zu frames in a row, re-learning it",
+                                              config_.device_id.c_str(), config_.baseline.relearn_frames);
+                }
+                anomaly = analytics_.updateMetric(MetricId::Vibration, vibration) || fft_anomaly;
+                metrics.stage(Stage::Analytics).record(monotonicNowNs() - fft_ns);
+
+                point.ts_ms = epochMillisNow();
+                point.temperature_c = 0.0;
+                point.vibration_g = vibration;
+                point.humidity_pct = 0.0;
+                point.voltage_v = 0.0;
+            } else {
+                {
+                    StageTimer timer(metrics.stage(Stage::Generate));
+                    point = simulateEnvironment(t, config_.anomaly_probability, gen_, normal_dist_);
+                }
+                MetricValues values{};
+                values[metricIndex(MetricId::Temperature)] = point.temperature_c;
+                values[metricIndex(MetricId::Vibration)] = point.vibration_g;
+                values[metricIndex(MetricId::Humidity)] = point.humidity_pct;
+                values[metricIndex(MetricId::Voltage)] = point.voltage_v;
+                StageTimer timer(metrics.stage(Stage::Analytics));
+                anomaly = analytics_.updateAll(values) != 0;
+            }
+
+            ++samples_;
+            metrics.samples.add();
+            if (anomaly) ++anomalies_;
+            producer_.push(point);
+
+            // Advance from the previous deadline, not from now, so tick
+            // granularity and pool latency never stretch the interval;
+            // a device a whole interval behind skips ahead instead
+            due_ms_ += config_.interval_ms;
+            if (due_ms_ <= now_ms - config_.interval_ms) due_ms_ = now_ms;
+            return due_ms_ + jitter_dist_(gen_);
+        }
+
+        uint64_t samples() const { return samples_; }
+        uint64_t anomalies() const { return anomalies_; }
+
+    private:
+        DeviceConfig config_;
+        LocalAnalytics analytics_;
+        std::unique_ptr<FFTAnalyzer> fft_;
+        std::mt19937 gen_;
+        std::normal_distribution<> normal_dist_;
+        std::uniform_int_distribution<> jitter_dist_;
+        MetricProducer producer_;
+        int64_t start_ms_;
+        int64_t due_ms_; // Unjittered deadline of the current sample
+        uint64_t samples_ = 0;
+        uint64_t anomalies_ = 0;
+        bool relearned_ = false; // Baseline reset since the last save
+    };
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "IoT Gateway - Starting..." << std::endl;
+
+    // Load configuration; the store reloads it on SIGHUP or when the file
+    // changes, config stays the startup snapshot
+    ConfigStore::Options store_options;
+    store_options.argc = argc;
+    store_options.argv = argv;
+    ConfigStore store(store_options);
+    const AgentConfig& config = store.current();
+
+    const size_t device_count = static_cast<size_t>(std::max(1, config.gateway_devices));
+    size_t threads = config.gateway_threads > 0
+        ? static_cast<size_t>(config.gateway_threads)
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Configuration:" << std::endl;
+    std::cout << "  Device prefix: " << config.device_id << std::endl;
+    std::cout << "  Devices: " << device_count << " (" << config.gateway_vibration_pct
+              << "% vibration)" << std::endl;
+    std::cout << "  API URL: " << config.api_base_url << std::endl;
+    std::cout << "  Interval: " << config.interval_ms << " ms" << std::endl;
+    std::cout << "  Sampling threads: " << threads << std::endl;
+
+    // One upload engine for every device
+    HttpClientOptions http_options;
+    http_options.http2 = config.http2;
+    http_options.max_in_flight = static_cast<size_t>(std::max(1, config.max_in_flight));
+    http_options.worker_cpu = config.transport_cpu;
+    http_options.max_batch_points = static_cast<size_t>(std::max(1, config.batch_max_points));
+    http_options.max_linger_ms = config.batch_linger_ms;
+    http_options.queue_capacity = static_cast<size_t>(std::max(1, config.queue_capacity));
+    parseOverflowPolicy(config.queue_policy, http_options.overflow_policy);
+    parseWireFormat(config.wire_format, http_options.wire_format);
+    parseCompression(config.compression, http_options.compression);
+    http_options.compression_level = config.compression_level;
+    http_options.compression_min_bytes = static_cast<size_t>(std::max(0, config.compression_min_bytes));
+    http_options.zstd_dictionary_path = config.zstd_dictionary;
+    http_options.spool_dir = config.spool_dir;
+    http_options.spool_max_bytes = static_cast<uint64_t>(std::max(1, config.spool_max_mb)) * 1024 * 1024;
+    http_options.spool_max_age_ms = static_cast<int64_t>(config.spool_max_age_s) * 1000;
+    // Each device pushes a few points between worker polls; small rings
+    // and spool segments keep thousands of devices affordable
+    http_options.producer_ring_capacity = 256;
+    http_options.spool_segment_bytes = 256 * 1024;
+    HttpClient client(config.api_base_url, http_options);
+
+    // Or one MQTT connection, each device publishing to its own topic
+    std::string transport_error;
+    std::unique_ptr<MqttClient> mqtt = makeMqttTransport(config, http_options, transport_error);
+    if (!transport_error.empty()) {
+        std::cerr << "Warning: " << transport_error << ", uploading over HTTP" << std::endl;
+    }
+    Transport& transport = mqtt ? static_cast<Transport&>(*mqtt) : client;
+    if (mqtt) {
+        std::cout << "  Transport: mqtt " << config.mqtt_broker_url << " (QoS " << (config.mqtt_qos > 0 ? 1 : 0)
+                  << ", " << std::max(1, config.mqtt_max_in_flight) << " in flight)" << std::endl;
+    }
+
+    std::atomic<uint64_t> sent_points{0};
+    std::atomic<uint64_t> failed_requests{0};
+    transport.setCompletionCallback([&](const UploadResult& result) {
+        if (result.outcome == SendOutcome::Sent) {
+            sent_points.fetch_add(result.points, std::memory_order_relaxed);
+        } else {
+            failed_requests.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // Build the device pipelines
+    std::random_device rd;
+    uint32_t base_seed = rd();
+    int64_t start_ms = steadyMillis();
+    // Stagger first samples across one interval so uploads don't arrive in bursts
+    std::vector<std::unique_ptr<DevicePipeline>> devices;
+    devices.reserve(device_count);
+    for (size_t i = 0; i < device_count; ++i) {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "-%05zu", i);
+
+        DeviceConfig device;
+        device.device_id = config.device_id + suffix;
+        device.vibration = static_cast<int>(i % 100) < config.gateway_vibration_pct;
+        device.interval_ms = config.interval_ms;
+        device.jitter_ms = config.jitter_ms;
+        device.anomaly_probability = config.anomaly_probability;
+        device.fft_baseline = config.fft_baseline;
+        device.baseline.alpha = config.fft_baseline_alpha;
+        device.baseline.warmup_frames = static_cast<size_t>(std::max(1, config.fft_baseline_warmup));
+        device.baseline.z_limit = config.fft_baseline_z;
+        device.baseline.min_bins = static_cast<size_t>(std::max(1, config.fft_baseline_min_bins));
+        device.baseline.relearn_frames = static_cast<size_t>(std::max(0, config.fft_baseline_relearn));
+
+        devices.push_back(std::make_unique<DevicePipeline>(
+            device, base_seed + static_cast<uint32_t>(i), transport.createProducer(device.device_id),
+            config.enabledMetrics(), start_ms,
+            start_ms + static_cast<int64_t>(i) * config.interval_ms / static_cast<int64_t>(device_count)));
+    }
+    if (!config.spool_dir.empty() && !transport.getLastError().empty()) {
+        std::cerr << "Warning: " << transport.getLastError() << ", buffering in memory only" << std::endl;
+    }
+
+    // Vibration baselines persist per device, so a restart skips the warmup
+    if (!config.baseline_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(config.baseline_dir, ec);
+        size_t restored = 0;
+        size_t baselines = 0;
+        for (const auto& device : devices) {
+            SpectralBaseline* baseline = device->baseline();
+            if (!baseline) continue;
+            ++baselines;
+            std::string error;
+            if (baseline->load(baselinePath(config.baseline_dir, device->deviceId()), error)) {
+                ++restored;
+            } else if (!error.empty()) {
+                std::cerr << "Warning: " << error << std::endl;
+            }
+        }
+        std::cout << "  Baselines: restored " << restored << " of " << baselines << " from " << config.baseline_dir
+                  << std::endl;
+    }
+    // Saving copies the baselines between pool rounds, when devices are not
+    // stepping, and writes the files on a thread of its own, so thousands
+    // of writes and renames never stall the timer loop. A baseline that
+    // restarted learning is saved while still cold, so a restart does not
+    // bring back the one it gave up on.
+    struct BaselineSnapshot {
+        std::string path;
+        SpectralBaseline baseline;
+    };
+    auto snapshotBaselines = [&]() {
+        std::vector<BaselineSnapshot> snapshots;
+        for (const auto& device : devices) {
+            SpectralBaseline* baseline = device->baseline();
+            bool relearned = device->takeRelearned();
+            if (!baseline || !(baseline->warm(0) || relearned)) continue;
+            snapshots.push_back({baselinePath(config.baseline_dir, device->deviceId()), *baseline});
+        }
+        return snapshots;
+    };
+    auto writeBaselines = [](const std::vector<BaselineSnapshot>& snapshots) {
+        size_t failed = 0;
+        std::string error;
+        for (const auto& snapshot : snapshots) {
+            std::string device_error;
+            if (!snapshot.baseline.save(snapshot.path, device_error)) {
+                if (failed++ == 0) error = device_error;
+            }
+        }
+        if (failed > 0) {
+            AsyncLogger::global().log(LogLevel::Warn, LogTopic::General, "%zu baselines not saved: %s", failed,
+                                      error.c_str());
+        }
+    };
+    std::thread baseline_writer;
+    std::atomic<bool> baseline_writing{false};
+    const int64_t baseline_save_ms = static_cast<int64_t>(std::max(1, config.baseline_save_s)) * 1000;
+    int64_t baseline_saved_ms = start_ms;
+
+    TimerWheel<uint32_t> wheel(4096, 10, start_ms);
+    for (size_t i = 0; i < device_count; ++i) {
+        wheel.schedule(devices[i]->firstDueMs(), static_cast<uint32_t>(i));
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    // The calling thread takes part in parallelFor, so the pool gets one less
+    ThreadPool pool(threads - 1);
+    std::vector<uint32_t> due;
+    std::vector<int64_t> next_due(device_count);
+    int64_t reported_ms = start_ms;
+    uint64_t reported_samples = 0;
+
+    // Everything the loop prints goes through the asynchronous logger
+    AsyncLogger& logger = AsyncLogger::global();
+    LogOptions log_options;
+    if (!logOptionsFromConfig(config, log_options)) {
+        std::cerr << "Warning: Unknown log level '" << config.log_level << "', using info" << std::endl;
+    }
+    logger.start(log_options);
+
+    // Reloads publish a new snapshot; the loop retunes the devices between
+    // rounds, the logger filter is applied here
+    const std::vector<std::string> live_keys = {"interval_ms", "jitter_ms",        "anomaly_probability",
+                                                "log_level",   "log_quiet",        "log_sample_per_s",
+                                                "log_anomaly_per_s"};
+    std::string watch_error;
+    bool watching = store.watch(
+        [&logger, &live_keys](const AgentConfig&, const AgentConfig& current, const std::vector<std::string>& changed) {
+            logger.log(LogLevel::Info, LogTopic::General, "Config reloaded: %s",
+                       describeReload(changed, live_keys).c_str());
+            LogOptions options;
+            logOptionsFromConfig(current, options);
+            logger.setFilter(options);
+        },
+        watch_error);
+    if (!watching) {
+        logger.log(LogLevel::Warn, LogTopic::General, "%s", watch_error.c_str());
+    }
+    uint64_t config_version = store.version();
+
+    MetricsExporter::Options exporter_options;
+    exporter_options.port = config.metrics_port;
+    exporter_options.bind_address = config.metrics_bind;
+    exporter_options.dump_interval_s = config.metrics_dump_s;
+    MetricsExporter exporter(exporter_options);
+    if (!exporter.ok()) {
+        logger.log(LogLevel::Warn, LogTopic::General, "%s", exporter.error().c_str());
+    }
+
+    logger.log(LogLevel::Info, LogTopic::General, "Starting gateway loop...");
+    while (!stop_requested) {
+        int64_t next = wheel.nextTickMs();
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::milliseconds(next)));
+
+        int64_t now = steadyMillis();
+        due.clear();
+        wheel.advance(now, [&](uint32_t id) { due.push_back(id); });
+
+        // Run every due device on the pool, then rearm its timer
+        pool.parallelFor(due.size(), 64, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                next_due[due[i]] = devices[due[i]]->step(now);
+            }
+        });
+        for (uint32_t id : due) {
+            wheel.schedule(next_due[id], id);
+        }
+        uint64_t version = store.version();
+        if (version != config_version) {
+            config_version = version;
+            const AgentConfig& live = store.current();
+            for (const auto& device : devices) {
+                device->retune(live.interval_ms, live.jitter_ms, live.anomaly_probability);
+            }
+        }
+        // The next round starts once the previous one is written
+        if (!config.baseline_dir.empty() && now - baseline_saved_ms >= baseline_save_ms &&
+            !baseline_writing.load(std::memory_order_acquire)) {
+            if (baseline_writer.joinable()) baseline_writer.join();
+            baseline_writing.store(true, std::memory_order_relaxed);
+            baseline_writer = std::thread([&writeBaselines, &baseline_writing, snapshots = snapshotBaselines()]() {
+                writeBaselines(snapshots);
+                baseline_writing.store(false, std::memory_order_release);
+            });
+            baseline_saved_ms = now;
+        }
+
+        if (now - reported_ms >= 10000) {
+            uint64_t samples = 0;
+            uint64_t anomalies = 0;
+            for (const auto& device : devices) {
+                samples += device->samples();
+                anomalies += device->anomalies();
+            }
+            QueueStats queue = transport.getQueueStats();
+            logger.log(LogLevel::Info, LogTopic::Stats,
+                       "[gateway] %llu samples/s, anomalies=%llu, sent=%llu, failed_requests=%llu, queued=%zu, "
+                       "dropped=%zu",
+                       static_cast<unsigned long long>((samples - reported_samples) * 1000 /
+                                                       static_cast<uint64_t>(now - reported_ms)),
+                       static_cast<unsigned long long>(anomalies),
+                       static_cast<unsigned long long>(sent_points.load(std::memory_order_relaxed)),
+                       static_cast<unsigned long long>(failed_requests.load(std::memory_order_relaxed)),
+                       queue.depth, queue.dropped);
+            reported_samples = samples;
+            reported_ms = now;
+        }
+    }
+
+    logger.log(LogLevel::Info, LogTopic::General, "Gateway stopping");
+    if (baseline_writer.joinable()) baseline_writer.join();
+    if (!config.baseline_dir.empty()) writeBaselines(snapshotBaselines());
+    logger.stop();
+    return 0;
+}
@@ -1,8 +1,17 @@
 #include "http_client.hpp"
+#include "agent_metrics.hpp"
+#include "body_compressor.hpp"
+#include "columnar_codec.hpp"
+#include "metric_json.hpp"
+#include "thread_affinity.hpp"
 #include <curl/curl.h>
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iterator>
 #include <iostream>
-#include <sstream>
 
 namespace {
 // Callback for writing response data
@@ -12,143 +21,716 @@ size_t WriteCallback(void *contents, size_t size, size_t nmemb,
   data->append((char *)contents, total_size);
   return total_size;
 }
+
+// Share-handle locking; userptr is the client's lock array
+void LockShare(CURL *, curl_lock_data data, curl_lock_access, void *userptr) {
+  auto *locks = static_cast<std::array<std::mutex, 8> *>(userptr);
+  (*locks)[static_cast<size_t>(data) % locks->size()].lock();
+}
+
+void UnlockShare(CURL *, curl_lock_data data, void *userptr) {
+  auto *locks = static_cast<std::array<std::mutex, 8> *>(userptr);
+  (*locks)[static_cast<size_t>(data) % locks->size()].unlock();
+}
+
+// Best encoding this build supports, stepping down zstd -> gzip -> none
+Compression usableCompression(Compression requested) {
+  if (requested == Compression::Zstd && !compressionAvailable(requested))
+    requested = Compression::Gzip;
+  if (requested == Compression::Gzip && !compressionAvailable(requested))
+    requested = Compression::None;
+  return requested;
+}
+
+// Error body of a 400 that rejects the Content-Type rather than the points
+bool unsupportedContentType(const std::string &body) {
+  std::string lower(body);
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return lower.find("unsupported") != std::string::npos &&
+         (lower.find("content type") != std::string::npos ||
+          lower.find("content-type") != std::string::npos ||
+          lower.find("media type") != std::string::npos);
+}
 } // namespace
 
-HttpClient::HttpClient(const std::string &base_url)
-    : base_url_(base_url), stop_worker_(false) {
+struct HttpClient::Connection {
+  Connection(int level, size_t min_bytes, const std::string &dictionary)
+      : compressor(level, min_bytes, dictionary) {}
+
+  CURL *easy = nullptr;
+  // One header list per (wire format, content encoding) pair
+  std::array<struct curl_slist *, 6> headers{};
+  unsigned headers_version = 0;
+  std::string response;
+
+  // Request bodies; must outlive curl_easy_perform
+  MetricsJsonWriter writer;
+  columnar::Encoder encoder;
+  BodyCompressor compressor;
+
+  // The request being sent (worker connections only)
+  std::string device_id;
+  std::vector<MetricPoint> metrics;
+  bool columnar = false;
+  bool json_only = false; // Columnar was answered 400/415; resend as JSON
+  Compression encoding = Compression::None;
+  MetricProducer::Channel *spool_channel = nullptr; // Set for spool replay
+  std::chrono::steady_clock::time_point first_enqueued;
+  std::chrono::steady_clock::time_point started;
+  uint64_t retry_round = 0; // RetryScheduler round it was sent in
+  long http_status = 0;
+  std::string error;
+
+  static size_t headerIndex(bool columnar, Compression compression) {
+    return (columnar ? 3 : 0) + static_cast<size_t>(compression);
+  }
+
+  ~Connection() {
+    for (auto *list : headers) {
+      if (list)
+        curl_slist_free_all(list);
+    }
+    if (easy)
+      curl_easy_cleanup(easy);
+  }
+};
+
+
+HttpClient::HttpClient(const std::string &base_url,
+                       const HttpClientOptions &options)
+    : Transport(options), base_url_(base_url), ingest_url_(base_url + "/api/ingest"),
+      summary_url_(base_url + "/api/ingest/summary"),
+      options_(options), headers_version_(1), columnar_rejected_(false),
+      columnar_paused_until_(0),
+      compression_(usableCompression(options.compression)), share_(nullptr),
+      multi_(nullptr), retry_(options.retry), stop_worker_(false) {
   curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  if (!options_.zstd_dictionary_path.empty()) {
+    std::ifstream file(options_.zstd_dictionary_path, std::ios::binary);
+    if (file) {
+      zstd_dictionary_.assign(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+    } else {
+      setLastError("Could not read zstd dictionary: " +
+                   options_.zstd_dictionary_path);
+    }
+  }
+
+  CURLSH *share = curl_share_init();
+  if (share) {
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, LockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, &share_locks_);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    share_ = share;
+  }
+
+  CURLM *multi = curl_multi_init();
+  if (multi && options_.http2) {
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  }
+  multi_ = multi;
+
   worker_thread_ = std::thread(&HttpClient::workerLoop, this);
+
+  AgentMetrics &metrics = AgentMetrics::global();
+  metrics.addGauge(this, "agent_upload_queue_depth",
+                   "Points and requests waiting for upload", [this] {
+                     return static_cast<double>(getQueueStats().depth);
+                   });
+  metrics.addGauge(this, "agent_spool_pending_points",
+                   "Spooled points not yet acknowledged by the backend",
+                   [this] {
+                     return static_cast<double>(getSpoolStats().pending);
+                   });
 }
 
 HttpClient::~HttpClient() {
+  AgentMetrics::global().removeGauges(this);
   stop_worker_ = true;
-  cv_.notify_all();
+  task_queue_.close();
+  wakeWorker();
   if (worker_thread_.joinable()) {
     worker_thread_.join();
   }
+
+  // Easy handles must go before the multi and share handles they use
+  idle_conns_.clear();
+  worker_conns_.clear();
+  blocking_conn_.reset();
+  summary_conn_.reset();
+  if (multi_) {
+    curl_multi_cleanup(static_cast<CURLM *>(multi_));
+  }
+  if (share_) {
+    curl_share_cleanup(static_cast<CURLSH *>(share_));
+  }
   curl_global_cleanup();
 }
 
-std::string HttpClient::getLastError() const {
-  std::lock_guard<std::mutex> lock(error_mutex_);
-  return last_error_;
+void HttpClient::setApiKey(const std::string &key) {
+  {
+    std::lock_guard<std::mutex> lock(settings_mutex_);
+    api_key_ = key;
+  }
+  // Connections rebuild their header list before the next request
+  headers_version_.fetch_add(1);
+}
+
+std::string HttpClient::getApiKey() const {
+  std::lock_guard<std::mutex> lock(settings_mutex_);
+  return api_key_;
+}
+
+std::unique_ptr<HttpClient::Connection> HttpClient::openConnection() {
+  auto conn = std::make_unique<Connection>(
+      options_.compression_level, options_.compression_min_bytes,
+      zstd_dictionary_);
+  conn->easy = curl_easy_init();
+  if (!conn->easy) {
+    return nullptr;
+  }
+
+  // Options that stay fixed for the lifetime of the handle
+  CURL *curl = conn->easy;
+  curl_easy_setopt(curl, CURLOPT_URL, ingest_url_.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &conn->response);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, options_.timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, options_.connect_timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L); // Required for threaded use
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, options_.keepalive_idle_s);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, options_.keepalive_idle_s);
+  curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, options_.dns_cache_timeout_s);
+  if (share_) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, static_cast<CURLSH *>(share_));
+  }
+  if (options_.http2) {
+    // Falls back to HTTP/1.1 if the server does not negotiate h2 via ALPN
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  }
+
+  conn->encoder.setMantissaBits(options_.columnar_mantissa_bits);
+  refreshHeaders(*conn);
+  return conn;
 }
 
-void HttpClient::setLastError(const std::string &error) {
-  std::lock_guard<std::mutex> lock(error_mutex_);
-  last_error_ = error;
+void HttpClient::refreshHeaders(Connection &conn) {
+  unsigned version = headers_version_.load();
+  if (conn.headers[0] && conn.headers_version == version) {
+    return;
+  }
+
+  std::string api_key = getApiKey();
+  for (bool columnar : {false, true}) {
+    for (Compression encoding :
+         {Compression::None, Compression::Gzip, Compression::Zstd}) {
+      struct curl_slist *headers = nullptr;
+      headers = curl_slist_append(
+          headers, columnar ? "Content-Type: application/x-iot-columnar"
+                            : "Content-Type: application/json");
+      if (const char *name = compressionEncoding(encoding)) {
+        headers = curl_slist_append(
+            headers, (std::string("Content-Encoding: ") + name).c_str());
+      }
+      if (!api_key.empty()) {
+        std::string auth_header = "X-API-Key: " + api_key;
+        headers = curl_slist_append(headers, auth_header.c_str());
+      }
+
+      struct curl_slist *&slot =
+          conn.headers[Connection::headerIndex(columnar, encoding)];
+      if (slot)
+        curl_slist_free_all(slot);
+      slot = headers;
+    }
+  }
+  conn.headers_version = version;
 }
 
-void HttpClient::postMetricsAsync(const std::string &device_id,
-                                  const std::vector<MetricPoint> &metrics) {
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    task_queue_.push({device_id, metrics});
+void HttpClient::wakeWorker() {
+  // Interrupts curl_multi_poll from any thread
+  if (multi_) {
+    curl_multi_wakeup(static_cast<CURLM *>(multi_));
   }
-  cv_.notify_one();
+}
+
+size_t HttpClient::estimateJsonBytes(const MetricPoint &) {
+  return MetricsJsonWriter::kTypicalPointBytes;
 }
 
 void HttpClient::workerLoop() {
+  CURLM *multi = static_cast<CURLM *>(multi_);
+  if (!multi) {
+    setLastError("Failed to initialize CURL multi handle");
+    return;
+  }
+  std::string pin_error;
+  if (!pinCurrentThread(options_.worker_cpu, pin_error)) {
+    setLastError("Upload worker " + pin_error + "running unpinned");
+  }
+
+  std::vector<RequestTask> drained;
+  std::vector<MetricPoint> scratch(256);
   while (!stop_worker_) {
-    RequestTask task;
-    {
-      std::unique_lock<std::mutex> lock(queue_mutex_);
-      cv_.wait(lock, [this] { return !task_queue_.empty() || stop_worker_; });
+    // Collect new data without waiting; the wait happens in curl below
+    drained.clear();
+    if (!task_queue_.drain(drained, std::chrono::steady_clock::time_point()) ||
+        stop_worker_)
+      break;
+
+    // Coalesce everything drained per device
+    for (auto &task : drained) {
+      for (auto &point : task.metrics) {
+        stagePoint(task.device_id, point);
+      }
+    }
+    drainProducers(scratch,
+                   [this](const std::string &device_id,
+                          const MetricPoint &point) {
+                     stagePoint(device_id, point);
+                   });
+
+    // Start every due request the in-flight limit allows, then advance
+    // all transfers and settle the finished ones
+    submitDueBatches();
+    replaySpools();
+    int running = 0;
+    curl_multi_perform(multi, &running);
+    processCompletions();
+
+    // Sleep until socket activity, a wakeup from a producer, or the next
+    // deadline (linger, retry or producer poll); curl shortens the wait
+    // itself when a transfer needs attention sooner
+    auto wait = nextWakeup() - std::chrono::steady_clock::now();
+    long wait_ms = static_cast<long>(std::max<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()));
+    curl_multi_poll(multi, nullptr, 0, static_cast<int>(wait_ms), nullptr);
+  }
+
+  // Abandon whatever is still in flight
+  for (auto &conn : worker_conns_) {
+    curl_multi_remove_handle(multi, conn->easy);
+  }
+}
+
+std::chrono::steady_clock::time_point HttpClient::nextWakeup() const {
+  using Clock = std::chrono::steady_clock;
+  const auto linger = std::chrono::milliseconds(options_.max_linger_ms);
+  const auto poll = std::chrono::milliseconds(
+      std::max<long>(options_.producer_poll_ms, 1));
+
+  // Producer rings only signal in batches, so they are polled as well
+  auto now = Clock::now();
+  auto wake = now + (hasProducers() ? poll : std::chrono::hours(1));
+  if (in_flight_ >= std::max<size_t>(options_.max_in_flight, 1)) {
+    return wake; // A completion frees a slot and wakes curl_multi_poll
+  }
 
-      if (stop_worker_ && task_queue_.empty())
-        break;
+  bool backing_off = !retry_.canSend(now);
+  for (const auto &entry : pending_) {
+    const PendingBatch &batch = entry.second;
+    if (batch.in_flight || batch.metrics.empty())
+      continue;
+    wake = std::min(wake, backing_off ? retry_.nextAttempt()
+                                      : batch.first_enqueued + linger);
+  }
+  return wake;
+}
+
+void HttpClient::stagePoint(const std::string &device_id,
+                            const MetricPoint &point) {
+  PendingBatch &batch = pending_[device_id];
+  if (batch.metrics.empty()) {
+    batch.first_enqueued = std::chrono::steady_clock::now();
+  }
+  batch.bytes += estimateJsonBytes(point);
+  batch.metrics.push_back(point);
+}
+
+void HttpClient::submitDueBatches() {
+  using Clock = std::chrono::steady_clock;
+  const auto linger = std::chrono::milliseconds(options_.max_linger_ms);
+  const size_t max_points = std::max<size_t>(options_.max_batch_points, 1);
+  const size_t limit = std::max<size_t>(options_.retry_buffer_points, 1);
+
+  // Send every batch that is full or has lingered long enough; batches
+  // that failed stay staged and absorb newer points until the retry
+  auto now = Clock::now();
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    PendingBatch &batch = it->second;
+    if (batch.metrics.size() > limit) {
+      size_t excess = batch.metrics.size() - limit;
+      batch.metrics.erase(batch.metrics.begin(),
+                          batch.metrics.begin() + excess);
+      batch.bytes = batch.metrics.size() * MetricsJsonWriter::kTypicalPointBytes;
+      countDropped(excess);
+    }
+    if (batch.metrics.empty() && !batch.in_flight) {
+      it = pending_.erase(it);
+      continue;
+    }
+
+    bool due = !batch.in_flight && !batch.metrics.empty() &&
+               (batch.metrics.size() >= max_points ||
+                batch.bytes >= options_.max_batch_bytes ||
+                now - batch.first_enqueued >= linger);
+    if (due && retry_.canSend(now)) {
+      Connection *conn = acquireConnection();
+      if (!conn)
+        return; // In-flight limit reached
+
+      // Take the oldest points that fit both the point and byte limits;
+      // the rest stays staged and goes out once this request finishes
+      size_t count = 0;
+      size_t bytes = 0;
+      while (count < batch.metrics.size()) {
+        size_t next = estimateJsonBytes(batch.metrics[count]);
+        if (count > 0 && (count >= max_points ||
+                          bytes + next > options_.max_batch_bytes))
+          break;
+        bytes += next;
+        ++count;
+      }
+      conn->device_id = it->first;
+      conn->metrics.assign(batch.metrics.begin(),
+                           batch.metrics.begin() + count);
+      conn->spool_channel = nullptr;
+      conn->first_enqueued = batch.first_enqueued;
+      batch.metrics.erase(batch.metrics.begin(),
+                          batch.metrics.begin() + count);
+      batch.bytes -= std::min(batch.bytes, bytes);
+      batch.in_flight = true;
+      startTransfer(*conn);
+    }
+    ++it;
+  }
+}
+
+void HttpClient::replaySpools() {
+  // Replay in full-size requests; a short batch waits for the linger
+  // period unless its oldest point is already that old (e.g. after restart)
+  const size_t max_points = std::max<size_t>(
+      1, std::min(options_.max_batch_points,
+                  options_.max_batch_bytes / MetricsJsonWriter::kTypicalPointBytes));
+
+  for (auto *channel : spoolChannels()) {
+    if (channel->in_flight)
+      continue; // One request per spool; its points are still unconsumed
+    Spool *spool = channel->spool.get();
+    spool->enforceRetention(epochMillisNow());
+    if (stop_worker_ || !retry_.canSend(std::chrono::steady_clock::now()))
+      return;
 
-      task = std::move(task_queue_.front());
-      task_queue_.pop();
+    Connection *conn = acquireConnection();
+    if (!conn)
+      return; // In-flight limit reached
+    size_t n = spool->peek(conn->metrics, max_points);
+    bool due = n > 0 && (n >= max_points ||
+                         epochMillisNow() - conn->metrics.front().ts_ms >=
+                             options_.max_linger_ms);
+    if (!due) {
+      idle_conns_.push_back(conn);
+      continue;
     }
 
-    // Perform the actual POST (blocking call within worker thread)
-    postMetrics(task.device_id, task.metrics);
+    conn->device_id = channel->device_id;
+    conn->spool_channel = channel;
+    conn->first_enqueued = std::chrono::steady_clock::now();
+    channel->in_flight = true;
+    startTransfer(*conn);
   }
 }
 
-std::string
-HttpClient::formatMetricsJson(const std::string &device_id,
-                              const std::vector<MetricPoint> &metrics) {
-  std::ostringstream json;
-  json << std::fixed << std::setprecision(2);
+HttpClient::Connection *HttpClient::acquireConnection() {
+  if (!idle_conns_.empty()) {
+    Connection *conn = idle_conns_.back();
+    idle_conns_.pop_back();
+    return conn;
+  }
+  if (worker_conns_.size() >= std::max<size_t>(options_.max_in_flight, 1)) {
+    return nullptr;
+  }
+
+  auto conn = openConnection();
+  if (!conn) {
+    setLastError("Failed to initialize CURL");
+    return nullptr;
+  }
+  curl_easy_setopt(conn->easy, CURLOPT_PRIVATE, conn.get());
+  worker_conns_.push_back(std::move(conn));
+  return worker_conns_.back().get();
+}
+
+void HttpClient::startTransfer(Connection &conn) {
+  conn.started = std::chrono::steady_clock::now();
+  conn.retry_round = retry_.onSend();
+  conn.json_only = false;
+  prepareRequest(conn, conn.device_id, conn.metrics);
+  curl_multi_add_handle(static_cast<CURLM *>(multi_), conn.easy);
+  ++in_flight_;
+}
 
-  json << "{\n";
-  json << "  \"deviceId\": \"" << device_id << "\",\n";
-  json << "  \"metrics\": [\n";
+void HttpClient::processCompletions() {
+  CURLM *multi = static_cast<CURLM *>(multi_);
+  CURLMsg *msg;
+  int queued = 0;
+  while ((msg = curl_multi_info_read(multi, &queued)) != nullptr) {
+    if (msg->msg != CURLMSG_DONE)
+      continue;
 
-  for (size_t i = 0; i < metrics.size(); i++) {
-    const auto &m = metrics[i];
-    json << "    {\n";
-    if (!m.ts.empty()) {
-      json << "      \"ts\": \"" << m.ts << "\",\n";
+    CURL *easy = msg->easy_handle;
+    CURLcode res = msg->data.result; // msg is invalid after remove_handle
+    char *priv = nullptr;
+    curl_easy_getinfo(easy, CURLINFO_PRIVATE, &priv);
+    Connection &conn = *reinterpret_cast<Connection *>(priv);
+    curl_multi_remove_handle(multi, easy);
+
+    bool resend = false;
+    SendOutcome outcome = finishRequest(conn, res, resend);
+    if (resend) {
+      // Format or encoding fallback: the same points go straight back out
+      prepareRequest(conn, conn.device_id, conn.metrics);
+      curl_multi_add_handle(multi, easy);
+      continue;
     }
-    json << "      \"temperature_c\": " << m.temperature_c << ",\n";
-    json << "      \"vibration_g\": " << m.vibration_g << ",\n";
-    json << "      \"humidity_pct\": " << m.humidity_pct << ",\n";
-    json << "      \"voltage_v\": " << m.voltage_v << "\n";
-    json << "    }";
-    if (i < metrics.size() - 1)
-      json << ",";
-    json << "\n";
+
+    --in_flight_;
+    completeTransfer(conn, outcome);
+    idle_conns_.push_back(&conn);
+  }
+}
+
+void HttpClient::completeTransfer(Connection &conn, SendOutcome outcome) {
+  auto now = std::chrono::steady_clock::now();
+  AgentMetrics &metrics = AgentMetrics::global();
+  metrics.stage(Stage::HttpRoundTrip)
+      .record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                               conn.started)
+              .count()));
+  metrics.upload_points.add(conn.metrics.size());
+  switch (outcome) {
+  case SendOutcome::Sent:
+    metrics.uploads_sent.add();
+    break;
+  case SendOutcome::Retry:
+    metrics.uploads_retried.add();
+    break;
+  case SendOutcome::Reject:
+    metrics.uploads_rejected.add();
+    break;
+  }
+  if (outcome == SendOutcome::Retry) {
+    retry_.onFailure(now, conn.retry_round);
+  } else {
+    // A rejection still proves the backend is reachable
+    retry_.onSuccess();
+  }
+  if (outcome == SendOutcome::Reject) {
+    countDropped(conn.metrics.size());
   }
 
-  json << "  ]\n";
-  json << "}";
+  if (MetricProducer::Channel *channel = conn.spool_channel) {
+    // Retried points are simply still unconsumed on disk
+    if (outcome != SendOutcome::Retry) {
+      channel->spool->consume(conn.metrics.size());
+    }
+    channel->in_flight = false;
+  } else {
+    PendingBatch &batch = pending_[conn.device_id];
+    if (outcome == SendOutcome::Retry) {
+      // Put the points back in front of anything staged meanwhile
+      batch.metrics.insert(batch.metrics.begin(), conn.metrics.begin(),
+                           conn.metrics.end());
+      batch.bytes += conn.metrics.size() * MetricsJsonWriter::kTypicalPointBytes;
+      batch.first_enqueued = conn.first_enqueued;
+    }
+    batch.in_flight = false;
+  }
 
-  return json.str();
+  UploadCallback callback = completionCallback();
+  if (callback) {
+    UploadResult result;
+    result.device_id = conn.device_id;
+    result.points = conn.metrics.size();
+    result.outcome = outcome;
+    result.http_status = conn.http_status;
+    result.error = conn.error;
+    result.latency =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - conn.started);
+    result.replayed = conn.spool_channel != nullptr;
+    callback(result);
+  }
 }
 
 bool HttpClient::postMetrics(const std::string &device_id,
                              const std::vector<MetricPoint> &metrics) {
-  if (metrics.empty()) {
-    setLastError("No metrics to send");
-    return false;
+  std::lock_guard<std::mutex> lock(blocking_mutex_);
+  if (!blocking_conn_) {
+    blocking_conn_ = openConnection();
   }
-
-  CURL *curl = curl_easy_init();
-  if (!curl) {
+  if (!blocking_conn_) {
     setLastError("Failed to initialize CURL");
     return false;
   }
+  return send(*blocking_conn_, device_id, metrics) == SendOutcome::Sent;
+}
 
-  std::string json_data = formatMetricsJson(device_id, metrics);
-  std::string response_data;
-
-  std::string url = base_url_ + "/api/ingest";
+UploadResult
+HttpClient::postSummaries(const std::string &device_id,
+                          const std::vector<IntervalSummary> &summaries) {
+  UploadResult result;
+  result.device_id = device_id;
+  result.points = summaries.size();
+  if (summaries.empty()) {
+    result.outcome = SendOutcome::Reject;
+    result.error = "No summaries to send";
+    return result;
+  }
 
-  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_data.c_str());
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L); // 10s timeout
+  std::lock_guard<std::mutex> lock(summary_mutex_);
+  if (!summary_conn_) {
+    summary_conn_ = openConnection();
+    if (summary_conn_)
+      curl_easy_setopt(summary_conn_->easy, CURLOPT_URL, summary_url_.c_str());
+  }
+  if (!summary_conn_) {
+    result.outcome = SendOutcome::Retry;
+    result.error = "Failed to initialize CURL";
+    setLastError(result.error);
+    return result;
+  }
 
-  struct curl_slist *headers = nullptr;
-  headers = curl_slist_append(headers, "Content-Type: application/json");
-  if (!api_key_.empty()) {
-    std::string auth_header = "X-API-Key: " + api_key_;
-    headers = curl_slist_append(headers, auth_header.c_str());
+  // Only the compression fallback can ask for a resend here
+  Connection &conn = *summary_conn_;
+  auto start = std::chrono::steady_clock::now();
+  for (;;) {
+    conn.columnar = false;
+    attachBody(conn, conn.writer.writeSummaries(device_id, summaries.data(),
+                                                summaries.size()));
+    CURLcode res = curl_easy_perform(conn.easy);
+    bool resend = false;
+    result.outcome = finishRequest(conn, res, resend);
+    if (!resend)
+      break;
   }
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  result.http_status = conn.http_status;
+  result.error = conn.error;
+  result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  return result;
+}
+
+void HttpClient::prepareRequest(Connection &conn, const std::string &device_id,
+                                const std::vector<MetricPoint> &metrics) {
+  StageTimer timer(AgentMetrics::global().stage(Stage::Serialize));
+  conn.columnar =
+      options_.wire_format == WireFormat::Columnar && !conn.json_only &&
+      !columnar_rejected_ &&
+      std::chrono::steady_clock::now().time_since_epoch().count() >=
+          columnar_paused_until_.load(std::memory_order_relaxed);
+  std::string_view body =
+      conn.columnar
+          ? conn.encoder.encode(device_id, metrics.data(), metrics.size())
+          : conn.writer.write(device_id, metrics.data(), metrics.size());
+  attachBody(conn, body);
+}
 
-  CURLcode res = curl_easy_perform(curl);
+// Compress body into the connection and point its handle at the result
+void HttpClient::attachBody(Connection &conn, std::string_view body) {
+  conn.encoding = compression_;
+  if (!conn.compressor.compress(conn.encoding, body, body)) {
+    conn.encoding = Compression::None;
+  }
+  conn.response.clear();
+  conn.http_status = 0;
+  conn.error.clear();
+  refreshHeaders(conn);
 
-  long response_code = 0;
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+  CURL *curl = conn.easy;
+  curl_easy_setopt(
+      curl, CURLOPT_HTTPHEADER,
+      conn.headers[Connection::headerIndex(conn.columnar, conn.encoding)]);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                   static_cast<curl_off_t>(body.size()));
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data());
+  AgentMetrics::global().upload_bytes.add(body.size());
+}
 
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
+SendOutcome HttpClient::finishRequest(Connection &conn, int curl_code,
+                                      bool &resend) {
+  resend = false;
+  CURLcode res = static_cast<CURLcode>(curl_code);
+  curl_easy_getinfo(conn.easy, CURLINFO_RESPONSE_CODE, &conn.http_status);
+  long response_code = conn.http_status;
 
   if (res != CURLE_OK) {
-    setLastError("CURL error: " + std::string(curl_easy_strerror(res)));
-    return false;
+    // Timeouts, refused connections, DNS failures: all worth retrying
+    conn.error = "CURL error: " + std::string(curl_easy_strerror(res));
+    setLastError(conn.error);
+    AgentMetrics::global().transport_errors.add();
+    return SendOutcome::Retry;
   }
 
-  if (response_code < 200 || response_code >= 300) {
-    setLastError("HTTP error: " + std::to_string(response_code) + " - " +
-                 response_data);
-    return false;
+  if (conn.encoding != Compression::None && response_code == 415) {
+    // Backend cannot decode this Content-Encoding; step down and resend
+    compression_ = usableCompression(conn.encoding == Compression::Zstd
+                                         ? Compression::Gzip
+                                         : Compression::None);
+    resend = true;
+    return SendOutcome::Retry;
+  }
+
+  if (conn.columnar && (response_code == 415 || response_code == 400)) {
+    if (response_code == 415 || unsupportedContentType(conn.response)) {
+      // Backend does not understand the binary format; resend as JSON
+      columnar_rejected_ = true;
+    } else {
+      // Maybe only this batch, maybe an older backend that cannot say
+      // which: resend as JSON and try columnar again later
+      auto until =
+          std::chrono::steady_clock::now() +
+          std::chrono::seconds(std::max<long>(options_.columnar_retry_s, 1));
+      columnar_paused_until_.store(until.time_since_epoch().count(),
+                                   std::memory_order_relaxed);
+    }
+    conn.json_only = true;
+    resend = true;
+    return SendOutcome::Retry;
+  }
+
+  SendOutcome outcome = classifyHttpStatus(response_code);
+  if (outcome != SendOutcome::Sent) {
+    conn.error = "HTTP error: " + std::to_string(response_code) + " - " +
+                 conn.response;
+    setLastError(conn.error);
+    AgentMetrics::global().http_errors.add();
+  }
+  return outcome;
+}
+
+SendOutcome HttpClient::send(Connection &conn, const std::string &device_id,
+                             const std::vector<MetricPoint> &metrics) {
+  if (metrics.empty()) {
+    setLastError("No metrics to send");
+    return SendOutcome::Reject;
   }
 
-  return true;
+  // Fallbacks only ever step down, so this resends at most three times
+  conn.json_only = false;
+  for (;;) {
+    prepareRequest(conn, device_id, metrics);
+    CURLcode res = curl_easy_perform(conn.easy);
+    bool resend = false;
+    SendOutcome outcome = finishRequest(conn, res, resend);
+    if (!resend)
+      return outcome;
+  }
 }
@@ -0,0 +1,271 @@
+#include "iio_source.hpp"
+#include "agent_metrics.hpp"
+#include "thread_affinity.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+    constexpr double kStandardGravity = 9.80665; // m/s^2 per g
+    constexpr size_t kBlocksPerRead = 4;
+
+    bool readAttribute(const std::string& path, std::string& value) {
+        std::ifstream file(path);
+        if (!file.is_open() || !std::getline(file, value)) return false;
+        while (!value.empty() && (value.back() == '\n' || value.back() == ' ')) value.pop_back();
+        return true;
+    }
+
+    bool readNumber(const std::string& path, double& value) {
+        std::string text;
+        if (!readAttribute(path, text)) return false;
+        char* end = nullptr;
+        double parsed = std::strtod(text.c_str(), &end);
+        if (end == text.c_str()) return false;
+        value = parsed;
+        return true;
+    }
+
+    // sysfs reports the reason for a rejected value only through errno
+    bool writeAttribute(const std::string& path, const std::string& value, std::string& error) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        bool ok = fd >= 0 && ::write(fd, value.data(), value.size()) == static_cast<ssize_t>(value.size());
+        if (!ok) error = path + ": " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return ok;
+    }
+
+    // "in_accel_z" -> "in_accel", whose _scale and _offset the axes share
+    std::string channelType(const std::string& channel) {
+        size_t last = channel.rfind('_');
+        return last == std::string::npos || last == 0 ? channel : channel.substr(0, last);
+    }
+}
+
+IioSource::IioSource(const Options& options) : options_(options) {
+    if (!setup()) {
+        if (buffer_enabled_) {
+            std::string ignored;
+            writeAttribute(device_path_ + "/buffer/enable", "0", ignored);
+            buffer_enabled_ = false;
+        }
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+IioSource::~IioSource() {
+    if (buffer_enabled_) {
+        std::string ignored;
+        writeAttribute(device_path_ + "/buffer/enable", "0", ignored);
+    }
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool IioSource::setup() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    // Find the device by directory or by name
+    std::string device_name;
+    if (options_.device.compare(0, 10, "iio:device") == 0) {
+        device_name = options_.device;
+    } else {
+        for (const auto& entry : fs::directory_iterator(options_.sysfs_dir, ec)) {
+            std::string name;
+            std::string dir = entry.path().filename().string();
+            if (dir.compare(0, 10, "iio:device") == 0 && readAttribute(entry.path().string() + "/name", name) &&
+                name == options_.device) {
+                device_name = dir;
+                break;
+            }
+        }
+    }
+    device_path_ = options_.sysfs_dir + "/" + device_name;
+    if (device_name.empty() || !fs::is_directory(device_path_, ec)) {
+        error_ = "IIO device '" + options_.device + "' not found under " + options_.sysfs_dir;
+        return false;
+    }
+
+    // Scan elements can only change while the buffer is off; capture the
+    // requested channel alone, so a frame is one sample
+    std::string ignored;
+    writeAttribute(device_path_ + "/buffer/enable", "0", ignored);
+    const std::string scan_dir = device_path_ + "/scan_elements";
+    const std::string wanted = options_.channel + "_en";
+    bool found = false;
+    for (const auto& entry : fs::directory_iterator(scan_dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() < 3 || name.compare(name.size() - 3, 3, "_en") != 0) continue;
+        if (name == wanted) {
+            found = true;
+            continue;
+        }
+        std::string enabled;
+        if (readAttribute(entry.path().string(), enabled) && enabled != "0" &&
+            !writeAttribute(entry.path().string(), "0", error_)) {
+            return false;
+        }
+    }
+    if (!found) {
+        error_ = "IIO device " + device_name + " has no buffered channel " + options_.channel;
+        return false;
+    }
+    if (!writeAttribute(scan_dir + "/" + wanted, "1", error_)) return false;
+
+    std::string type;
+    if (!readAttribute(scan_dir + "/" + options_.channel + "_type", type) || !parseScanType(type)) {
+        error_ = "IIO channel " + options_.channel + " has an unsupported scan type '" + type + "'";
+        return false;
+    }
+
+    // Channel value = (raw + offset) * scale, per axis or shared by the type
+    const std::string prefix = device_path_ + "/" + options_.channel;
+    const std::string shared = device_path_ + "/" + channelType(options_.channel);
+    if (!readNumber(prefix + "_scale", scale_)) readNumber(shared + "_scale", scale_);
+    if (!readNumber(prefix + "_offset", offset_)) readNumber(shared + "_offset", offset_);
+    if (options_.channel.compare(0, 8, "in_accel") == 0) scale_ /= kStandardGravity;
+
+    // Request the rate, then use whatever the device settled on
+    const std::string rate_paths[] = {device_path_ + "/sampling_frequency", shared + "_sampling_frequency"};
+    if (options_.sample_rate_hz > 0.0) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.6f", options_.sample_rate_hz);
+        for (const std::string& path : rate_paths) {
+            if (writeAttribute(path, text, ignored)) break;
+        }
+    }
+    for (const std::string& path : rate_paths) {
+        if (readNumber(path, rate_hz_) && rate_hz_ > 0.0) break;
+        rate_hz_ = 0.0;
+    }
+    if (rate_hz_ <= 0.0) rate_hz_ = options_.sample_rate_hz;
+    if (rate_hz_ <= 0.0) {
+        error_ = "IIO device " + device_name + " reports no sampling frequency; set sample_rate_hz";
+        return false;
+    }
+
+    // Wake once per block; the kernel buffer holds a few more
+    block_ = options_.block > 0 ? options_.block
+                                : std::max<size_t>(1, static_cast<size_t>(std::lround(rate_hz_ / 100.0)));
+    if (!writeAttribute(device_path_ + "/buffer/length", std::to_string(block_ * 4 * kBlocksPerRead), error_)) {
+        return false;
+    }
+    // Older kernels have no watermark and wake per sample
+    writeAttribute(device_path_ + "/buffer/watermark", std::to_string(block_), ignored);
+
+    raw_.resize(block_ * kBlocksPerRead * type_.storage_bytes);
+    values_.resize(block_ * kBlocksPerRead);
+
+    const std::string dev_path = options_.dev_dir + "/" + device_name;
+    fd_ = ::open(dev_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        error_ = dev_path + ": " + std::strerror(errno);
+        return false;
+    }
+    if (!writeAttribute(device_path_ + "/buffer/enable", "1", error_)) return false;
+    buffer_enabled_ = true;
+    return true;
+}
+
+bool IioSource::parseScanType(const std::string& text) {
+    // [be|le]:[s|u]bits/storagebits[Xrepeat][>>shift]
+    char endian[3] = {};
+    char sign = 0;
+    unsigned bits = 0;
+    unsigned storage = 0;
+    int used = 0;
+    if (std::sscanf(text.c_str(), "%2[bl]e:%c%u/%u%n", endian, &sign, &bits, &storage, &used) != 4) return false;
+    if ((sign != 's' && sign != 'u') || bits == 0 || bits > storage ||
+        (storage != 8 && storage != 16 && storage != 32 && storage != 64)) {
+        return false;
+    }
+    const char* rest = text.c_str() + used;
+    if (*rest == 'X') return false; // Repeated elements (several values per scan) are not supported
+    unsigned shift = 0;
+    if (*rest != '\0' && std::sscanf(rest, ">>%u", &shift) != 1) return false;
+    if (shift + bits > storage) return false;
+    type_.big_endian = endian[0] == 'b';
+    type_.is_signed = sign == 's';
+    type_.bits = bits;
+    type_.storage_bytes = storage / 8;
+    type_.shift = shift;
+    return true;
+}
+
+double IioSource::decode(const unsigned char* raw) const {
+    uint64_t word = 0;
+    for (unsigned i = 0; i < type_.storage_bytes; ++i) {
+        unsigned byte = type_.big_endian ? i : type_.storage_bytes - 1 - i;
+        word = (word << 8) | raw[byte];
+    }
+    word >>= type_.shift;
+    if (type_.bits < 64) word &= (uint64_t(1) << type_.bits) - 1;
+    double value;
+    if (type_.is_signed && type_.bits < 64 && (word >> (type_.bits - 1)) & 1) {
+        value = static_cast<double>(static_cast<int64_t>(word | ~((uint64_t(1) << type_.bits) - 1)));
+    } else if (type_.is_signed) {
+        value = static_cast<double>(static_cast<int64_t>(word));
+    } else {
+        value = static_cast<double>(word);
+    }
+    return (value + offset_) * scale_;
+}
+
+bool IioSource::configureThread(std::string& error) const {
+    bool ok = pinCurrentThread(options_.cpu, error);
+    return setRealtimePriority(options_.realtime_priority, error) && ok;
+}
+
+bool IioSource::read(SampleBlock& block, std::string& error) {
+    if (fd_ < 0) {
+        error = error_.empty() ? "IIO device is not open" : error_;
+        return false;
+    }
+    while (true) {
+        pollfd pfd{fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 1000);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            error = device_path_ + ": " + (ready < 0 ? std::strerror(errno) : "device error");
+            return false;
+        }
+        if (ready == 0) {
+            error = device_path_ + ": no samples for 1 s (is a trigger set?)";
+            return false;
+        }
+
+        // Everything buffered, up to kBlocksPerRead blocks, in one syscall
+        ssize_t n = ::read(fd_, raw_.data(), raw_.size());
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n < 0) {
+            error = device_path_ + ": " + std::strerror(errno);
+            return false;
+        }
+        size_t count = static_cast<size_t>(n) / type_.storage_bytes;
+        if (count == 0) continue;
+
+        uint64_t start_ns = monotonicNowNs();
+        for (size_t i = 0; i < count; ++i) {
+            values_[i] = decode(raw_.data() + i * type_.storage_bytes);
+        }
+        AgentMetrics::global().stage(Stage::Generate).record(monotonicNowNs() - start_ns);
+
+        block.values = values_.data();
+        block.injected = nullptr;
+        block.count = count;
+        block.first_index = next_index_;
+        block.last_ts_ms = epochMillisNow();
+        block.late_ns = 0;
+        block.missed = 0;
+        next_index_ += count;
+        return true;
+    }
+}
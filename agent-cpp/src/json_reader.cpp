@@ -0,0 +1,271 @@
+#include "json_reader.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    constexpr int kMaxDepth = 64;
+
+    class Reader {
+    public:
+        Reader(const std::string& text, const JsonScalarHandler& on_value)
+            : text_(text), on_value_(on_value) {}
+
+        bool parse(std::string& error) {
+            skipSpace();
+            bool ok = value(0);
+            if (ok) {
+                skipSpace();
+                if (pos_ < text_.size()) ok = fail("unexpected data after the document");
+            }
+            if (!ok) error = error_;
+            return ok;
+        }
+
+    private:
+        bool fail(const char* reason) {
+            if (!error_.empty()) return false;
+            size_t line = 1;
+            size_t column = 1;
+            for (size_t i = 0; i < pos_ && i < text_.size(); ++i) {
+                if (text_[i] == '\n') {
+                    ++line;
+                    column = 1;
+                } else {
+                    ++column;
+                }
+            }
+            char where[48];
+            std::snprintf(where, sizeof(where), "line %zu, column %zu: ", line, column);
+            error_ = std::string(where) + reason;
+            return false;
+        }
+
+        void skipSpace() {
+            while (pos_ < text_.size() &&
+                   (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+                ++pos_;
+            }
+        }
+
+        bool literal(const char* word) {
+            size_t n = std::strlen(word);
+            if (text_.compare(pos_, n, word) != 0) return fail("invalid literal");
+            pos_ += n;
+            return true;
+        }
+
+        bool value(int depth) {
+            if (pos_ >= text_.size()) return fail("unexpected end of input");
+            char c = text_[pos_];
+            if (c == '{' || c == '[') {
+                if (depth >= kMaxDepth) return fail("nested too deeply");
+                return c == '{' ? object(depth + 1) : array(depth + 1);
+            }
+            JsonScalar scalar;
+            if (c == '"') {
+                scalar.type = JsonScalar::Type::String;
+                if (!string(scalar.text)) return false;
+            } else if (c == 't' || c == 'f') {
+                scalar.type = JsonScalar::Type::Bool;
+                scalar.text = c == 't' ? "true" : "false";
+                if (!literal(scalar.text.c_str())) return false;
+            } else if (c == 'n') {
+                scalar.type = JsonScalar::Type::Null;
+                scalar.text = "null";
+                if (!literal("null")) return false;
+            } else if (c == '-' || (c >= '0' && c <= '9')) {
+                scalar.type = JsonScalar::Type::Number;
+                if (!number(scalar.text)) return false;
+            } else {
+                return fail("expected a value");
+            }
+            on_value_(path_, scalar);
+            return true;
+        }
+
+        // Appends ".key" (or "key" at the root) for the member being read
+        void member(size_t parent_length, const std::string& key) {
+            path_.resize(parent_length);
+            if (parent_length > 0) path_ += '.';
+            path_ += key;
+        }
+
+        bool object(int depth) {
+            ++pos_; // '{'
+            size_t parent_length = path_.size();
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                ++pos_;
+                return true;
+            }
+            std::string key;
+            while (true) {
+                skipSpace();
+                if (pos_ >= text_.size() || text_[pos_] != '"') return fail("expected a member name");
+                if (!string(key)) return false;
+                skipSpace();
+                if (pos_ >= text_.size() || text_[pos_] != ':') return fail("expected ':'");
+                ++pos_;
+                skipSpace();
+                member(parent_length, key);
+                if (!value(depth)) return false;
+                skipSpace();
+                if (pos_ < text_.size() && text_[pos_] == ',') {
+                    ++pos_;
+                    continue;
+                }
+                if (pos_ < text_.size() && text_[pos_] == '}') {
+                    ++pos_;
+                    path_.resize(parent_length);
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+
+        bool array(int depth) {
+            ++pos_; // '['
+            size_t parent_length = path_.size();
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ']') {
+                ++pos_;
+                return true;
+            }
+            for (size_t index = 0;; ++index) {
+                skipSpace();
+                member(parent_length, std::to_string(index));
+                if (!value(depth)) return false;
+                skipSpace();
+                if (pos_ < text_.size() && text_[pos_] == ',') {
+                    ++pos_;
+                    continue;
+                }
+                if (pos_ < text_.size() && text_[pos_] == ']') {
+                    ++pos_;
+                    path_.resize(parent_length);
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        bool number(std::string& out) {
+            size_t start = pos_;
+            auto digits = [this]() {
+                size_t first = pos_;
+                while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') ++pos_;
+                return pos_ > first;
+            };
+            if (text_[pos_] == '-') ++pos_;
+            if (pos_ < text_.size() && text_[pos_] == '0') {
+                ++pos_;
+            } else if (!digits()) {
+                return fail("invalid number");
+            }
+            if (pos_ < text_.size() && text_[pos_] == '.') {
+                ++pos_;
+                if (!digits()) return fail("invalid number");
+            }
+            if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+                ++pos_;
+                if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) ++pos_;
+                if (!digits()) return fail("invalid number");
+            }
+            out.assign(text_, start, pos_ - start);
+            return true;
+        }
+
+        bool hex4(unsigned& out) {
+            if (pos_ + 4 > text_.size()) return fail("invalid \\u escape");
+            out = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = text_[pos_++];
+                out <<= 4;
+                if (c >= '0' && c <= '9') {
+                    out |= static_cast<unsigned>(c - '0');
+                } else if (c >= 'a' && c <= 'f') {
+                    out |= static_cast<unsigned>(c - 'a' + 10);
+                } else if (c >= 'A' && c <= 'F') {
+                    out |= static_cast<unsigned>(c - 'A' + 10);
+                } else {
+                    return fail("invalid \\u escape");
+                }
+            }
+            return true;
+        }
+
+        static void appendUtf8(std::string& out, unsigned cp) {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xc0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xe0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            } else {
+                out += static_cast<char>(0xf0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+        }
+
+        bool string(std::string& out) {
+            ++pos_; // Opening quote
+            out.clear();
+            while (true) {
+                if (pos_ >= text_.size()) return fail("unterminated string");
+                char c = text_[pos_++];
+                if (c == '"') return true;
+                if (static_cast<unsigned char>(c) < 0x20) return fail("control character in string");
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos_ >= text_.size()) return fail("unterminated string");
+                char e = text_[pos_++];
+                switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned cp = 0;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xd800 && cp < 0xdc00) {
+                        // High surrogate: a low one must follow
+                        unsigned low = 0;
+                        if (text_.compare(pos_, 2, "\\u") != 0) return fail("unpaired surrogate");
+                        pos_ += 2;
+                        if (!hex4(low)) return false;
+                        if (low < 0xdc00 || low >= 0xe000) return fail("unpaired surrogate");
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    } else if (cp >= 0xdc00 && cp < 0xe000) {
+                        return fail("unpaired surrogate");
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+                }
+            }
+        }
+
+        const std::string& text_;
+        const JsonScalarHandler& on_value_;
+        size_t pos_ = 0;
+        std::string path_;
+        std::string error_;
+    };
+}
+
+bool parseJson(const std::string& text, const JsonScalarHandler& on_value, std::string& error) {
+    return Reader(text, on_value).parse(error);
+}
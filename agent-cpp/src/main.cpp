@@ -1,89 +1,36 @@
+#include "agent_metrics.hpp"
+#include "async_logger.hpp"
 #include "config.hpp"
+#include "config_store.hpp"
+#include "device_simulator.hpp"
 #include "http_client.hpp"
+#include "interval_reducer.hpp"
 #include "local_analytics.hpp"
-#include <chrono>
+#include "metrics_exporter.hpp"
+#include "mqtt_client.hpp"
+#include "pipeline_stage.hpp"
+#include "sampling_scheduler.hpp"
+#include "summary_uploader.hpp"
 #include <cmath>
-#include <ctime>
-#include <iomanip>
+#include <cstdio>
 #include <iostream>
+#include <memory>
 #include <random>
-#include <sstream>
-#include <thread>
-
-// Get current timestamp in ISO 8601 format
-std::string getCurrentTimestamp() {
-  auto now = std::chrono::system_clock::now();
-  auto time_t = std::chrono::system_clock::to_time_t(now);
-  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now.time_since_epoch()) %
-            1000;
-
-  std::ostringstream oss;
-  oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%S");
-  oss << "." << std::setfill('0') << std::setw(3) << ms.count() << "Z";
-  return oss.str();
-}
-
-// Generate simulated metrics
-MetricPoint generateMetrics(double t, double anomaly_prob, std::mt19937 &gen,
-                            std::normal_distribution<> &normal_dist) {
-  MetricPoint point;
-  point.ts = getCurrentTimestamp();
-
-  // Base values with sinusoidal variation
-  double temp_base = 22.0 + 3.0 * std::sin(t / 60.0); // ~1 minute cycle
-  double vib_base = 0.02;
-  double hum_base = 45.0;
-  double volt_base = 4.9;
-
-  // Add noise
-  double temp_noise = normal_dist(gen) * 0.2;
-  double vib_noise = std::abs(normal_dist(gen) * 0.01);
-  double hum_noise = normal_dist(gen) * 0.5;
-  double volt_noise = normal_dist(gen) * 0.01;
-
-  // Occasionally inject anomalies
-  std::uniform_real_distribution<> anomaly_dist(0.0, 1.0);
-  bool inject_anomaly = anomaly_dist(gen) < anomaly_prob;
-
-  if (inject_anomaly) {
-    // Temperature spike
-    if (anomaly_dist(gen) < 0.5) {
-      temp_noise += 8.0; // +8C spike
-      std::cout << "[ANOMALY] Temperature spike detected!" << std::endl;
-    } else {
-      // Vibration spike
-      vib_noise += 0.5; // Large vibration spike
-      std::cout << "[ANOMALY] Vibration spike detected!" << std::endl;
-    }
-  }
-
-  point.temperature_c = temp_base + temp_noise;
-  point.vibration_g = vib_base + vib_noise;
-  point.humidity_pct = hum_base + hum_noise;
-  point.voltage_v = volt_base + volt_noise;
-
-  return point;
-}
+#include <vector>
 
 int main(int argc, char *argv[]) {
   std::cout << "IoT Edge Agent - Starting..." << std::endl;
 
-  // Load configuration
-  AgentConfig config;
-
-  // Try to load from file first (relative to executable or current directory)
-  std::string config_path = "config/agent.json";
-  // Also try parent directory if running from build/
-  if (!config.loadFromFile(config_path)) {
-    config.loadFromFile("../config/agent.json");
-  }
-
-  // Override with environment variables
-  config.loadFromEnv();
-
-  // Override with command line arguments
-  config.parseArgs(argc, argv);
+  // Load configuration: config/agent.json (or ../config/agent.json when
+  // running from build/), then environment variables, then command line
+  // arguments. The store reloads it on SIGHUP or when the file changes;
+  // config stays the startup snapshot, live settings come from
+  // store.current()
+  ConfigStore::Options store_options;
+  store_options.argc = argc;
+  store_options.argv = argv;
+  ConfigStore store(store_options);
+  const AgentConfig &config = store.current();
 
   std::cout << "Configuration:" << std::endl;
   std::cout << "  Device ID: " << config.device_id << std::endl;
@@ -92,104 +39,331 @@ int main(int argc, char *argv[]) {
   std::cout << "  Anomaly Probability: " << config.anomaly_probability
             << std::endl;
 
-  // Initialize HTTP client
-  HttpClient client(config.api_base_url);
+  // Initialize HTTP client (one persistent connection per sender)
+  HttpClientOptions http_options;
+  http_options.http2 = config.http2;
+  http_options.max_in_flight = static_cast<size_t>(std::max(1, config.max_in_flight));
+  http_options.worker_cpu = config.transport_cpu;
+  http_options.max_batch_points = static_cast<size_t>(std::max(1, config.batch_max_points));
+  http_options.max_linger_ms = config.batch_linger_ms;
+  http_options.queue_capacity = static_cast<size_t>(std::max(1, config.queue_capacity));
+  if (!parseOverflowPolicy(config.queue_policy, http_options.overflow_policy)) {
+    std::cerr << "Warning: Unknown queue policy '" << config.queue_policy
+              << "', using drop_oldest" << std::endl;
+  }
+  if (!parseWireFormat(config.wire_format, http_options.wire_format)) {
+    std::cerr << "Warning: Unknown wire format '" << config.wire_format
+              << "', using json" << std::endl;
+  }
+  if (!parseCompression(config.compression, http_options.compression)) {
+    std::cerr << "Warning: Unknown compression '" << config.compression
+              << "', uploading uncompressed" << std::endl;
+  } else if (!compressionAvailable(http_options.compression)) {
+    std::cerr << "Warning: " << config.compression
+              << " not available in this build, using the next best encoding"
+              << std::endl;
+  }
+  http_options.compression_level = config.compression_level;
+  http_options.compression_min_bytes =
+      static_cast<size_t>(std::max(0, config.compression_min_bytes));
+  http_options.zstd_dictionary_path = config.zstd_dictionary;
+  http_options.spool_dir = config.spool_dir;
+  http_options.spool_max_bytes =
+      static_cast<uint64_t>(std::max(1, config.spool_max_mb)) * 1024 * 1024;
+  http_options.spool_max_age_ms =
+      static_cast<int64_t>(config.spool_max_age_s) * 1000;
+  HttpClient client(config.api_base_url, http_options);
+
+  // Raw points can go over MQTT instead; summaries always use HTTP
+  std::string transport_error;
+  std::unique_ptr<MqttClient> mqtt =
+      makeMqttTransport(config, http_options, transport_error);
+  if (!transport_error.empty()) {
+    std::cerr << "Warning: " << transport_error << ", uploading over HTTP"
+              << std::endl;
+  }
+  Transport &transport = mqtt ? static_cast<Transport &>(*mqtt) : client;
+  if (mqtt) {
+    std::cout << "  Transport: mqtt " << config.mqtt_broker_url << " (QoS "
+              << (config.mqtt_qos > 0 ? 1 : 0) << ", "
+              << std::max(1, config.mqtt_max_in_flight) << " in flight)"
+              << std::endl;
+  }
+
+  AsyncLogger &logger = AsyncLogger::global();
+  AgentMetrics &metrics = AgentMetrics::global();
+  transport.setHighWaterCallback([&logger](size_t depth) {
+    logger.log(LogLevel::Warn, LogTopic::Upload,
+               "Upload queue backlog at %zu entries, backend is falling behind",
+               depth);
+  });
+  const char *transport_label = mqtt ? "MQTT" : "HTTP";
+  transport.setCompletionCallback([&logger, transport_label](
+                                      const UploadResult &result) {
+    if (result.outcome == SendOutcome::Sent)
+      return;
+    logger.log(LogLevel::Error, LogTopic::Upload,
+               "Background %s Error: %s (%zu points %s)", transport_label,
+               result.error.c_str(), result.points,
+               result.outcome == SendOutcome::Retry ? "kept for retry"
+                                                    : "dropped");
+  });
+
+  // The sampling loop hands points to the uploader through a lock-free ring,
+  // or through the disk spool when one is configured
+  MetricProducer producer = transport.createProducer(config.device_id);
+  if (!config.spool_dir.empty()) {
+    if (transport.getLastError().empty()) {
+      std::cout << "  Spool: " << config.spool_dir << " ("
+                << transport.getSpoolStats().pending << " points to replay)"
+                << std::endl;
+    } else {
+      std::cerr << "Warning: " << transport.getLastError()
+                << ", buffering in memory only" << std::endl;
+    }
+  }
 
   // Initialize local analytics for edge-side anomaly detection
-  LocalAnalytics local_analytics(200, 3.0);
+  LocalAnalytics local_analytics(200, 3.0, config.enabledMetrics());
   std::cout << "  Local Analytics: Enabled (window=200, z-threshold=3.0)"
             << std::endl;
 
+  // Aggregate mode: one summary per reduction interval, raw points only
+  // around strong local anomalies
+  ReductionMode reduction = ReductionMode::Raw;
+  if (!parseReductionMode(config.reduction, reduction)) {
+    std::cerr << "Warning: Unknown reduction '" << config.reduction
+              << "', uploading raw samples" << std::endl;
+  }
+  std::unique_ptr<IntervalReducer> reducer;
+  std::unique_ptr<SummaryUploader> summaries;
+  if (reduction == ReductionMode::Aggregate) {
+    const int64_t interval = std::max(1, config.interval_ms);
+    IntervalReducer::Options reducer_options;
+    reducer_options.interval_ms = std::max(1, config.reduction_interval_ms);
+    reducer_options.pre_samples =
+        static_cast<size_t>(std::max(0, config.anomaly_pre_ms) / interval);
+    reducer_options.post_samples =
+        static_cast<size_t>(std::max(0, config.anomaly_post_ms) / interval);
+    reducer_options.expected_samples =
+        static_cast<size_t>(reducer_options.interval_ms / interval + 1);
+    reducer_options.metrics = config.enabledMetrics();
+    reducer = std::make_unique<IntervalReducer>(reducer_options);
+
+    SummaryUploader::Options uploader_options;
+    uploader_options.device_id = config.device_id;
+    uploader_options.cpu = config.transport_cpu;
+    summaries = std::make_unique<SummaryUploader>(client, uploader_options);
+    std::cout << "  Reduction: aggregate every "
+              << reducer_options.interval_ms << " ms, raw "
+              << reducer_options.pre_samples << "+"
+              << reducer_options.post_samples
+              << " samples around anomalies (|z| >= "
+              << config.anomaly_trigger_z << ")" << std::endl;
+  }
+
   // Random number generator
   std::random_device rd;
   std::mt19937 gen(rd());
   std::normal_distribution<> normal_dist(0.0, 1.0);
-  std::uniform_int_distribution<> jitter_dist(-config.jitter_ms,
-                                              config.jitter_ms);
 
-  // Time tracking
-  auto start_time = std::chrono::steady_clock::now();
-  double t = 0.0;
+  // Analytics stage: z-scores, console report and hand-off to the upload
+  // worker, which encodes and sends. With pipeline_threads it runs on its
+  // own thread so console I/O never delays acquisition
+  struct Acquired {
+    MetricPoint point;
+    SimulatedAnomaly injected;
+    uint64_t missed;  // Samples skipped since the previous one
+    uint64_t dropped; // Samples the analytics stage had no room for, so far
+  };
+  uint64_t missed_total = 0;
+  uint64_t dropped_reported = 0;
+  auto analyze = [&](const Acquired &sample) {
+    if (sample.missed > 0) {
+      missed_total += sample.missed;
+      logger.log(LogLevel::Warn, LogTopic::Timing,
+                 "Sampling fell behind, skipped %llu samples (%llu total)",
+                 static_cast<unsigned long long>(sample.missed),
+                 static_cast<unsigned long long>(missed_total));
+    }
+    if (sample.dropped > dropped_reported) {
+      logger.log(LogLevel::Warn, LogTopic::Timing,
+                 "Analytics fell behind, dropped %llu samples",
+                 static_cast<unsigned long long>(sample.dropped -
+                                                 dropped_reported));
+      dropped_reported = sample.dropped;
+    }
 
-  // Retry configuration
-  const int max_retries = 3;
-  const int retry_delay_ms = 1000;
+    const MetricPoint &point = sample.point;
+    if (sample.injected == SimulatedAnomaly::TemperatureSpike) {
+      logger.log(LogLevel::Info, LogTopic::Anomaly,
+                 "[ANOMALY] Temperature spike detected!");
+    } else if (sample.injected == SimulatedAnomaly::VibrationSpike) {
+      logger.log(LogLevel::Info, LogTopic::Anomaly,
+                 "[ANOMALY] Vibration spike detected!");
+    }
 
-  std::cout << "Starting metric collection loop..." << std::endl;
+    // Update local analytics for every enabled metric in one pass
+    MetricValues values{};
+    values[metricIndex(MetricId::Temperature)] = point.temperature_c;
+    values[metricIndex(MetricId::Vibration)] = point.vibration_g;
+    values[metricIndex(MetricId::Humidity)] = point.humidity_pct;
+    values[metricIndex(MetricId::Voltage)] = point.voltage_v;
+    MetricMask anomalies;
+    {
+      StageTimer timer(metrics.stage(Stage::Analytics));
+      anomalies = local_analytics.updateAll(values);
+    }
 
-  while (true) {
-    try {
-      // Generate metrics
-      MetricPoint point =
-          generateMetrics(t, config.anomaly_probability, gen, normal_dist);
-
-      // Update local analytics for each metric
-      bool temp_anomaly =
-          local_analytics.updateMetric("temperature", point.temperature_c);
-      bool vib_anomaly =
-          local_analytics.updateMetric("vibration", point.vibration_g);
-      bool hum_anomaly =
-          local_analytics.updateMetric("humidity", point.humidity_pct);
-      bool volt_anomaly =
-          local_analytics.updateMetric("voltage", point.voltage_v);
-
-      // Get z-scores
+    // Print metrics with local analytics; the logger adds the timestamp
+    if (logger.enabled(LogLevel::Info)) {
       double temp_z =
-          local_analytics.getZScore("temperature", point.temperature_c);
-      double vib_z = local_analytics.getZScore("vibration", point.vibration_g);
-
-      // Print metrics with local analytics
-      std::cout << "[" << point.ts << "] "
-                << "Temp: " << std::fixed << std::setprecision(2)
-                << point.temperature_c << "°C"
-                << " (z=" << std::setprecision(2) << temp_z << "), "
-                << "Vib: " << point.vibration_g << "g"
-                << " (z=" << std::setprecision(2) << vib_z << "), "
-                << "Hum: " << point.humidity_pct << "%, "
-                << "Volt: " << point.voltage_v << "V";
+          local_analytics.getZScore(MetricId::Temperature, point.temperature_c);
+      double vib_z =
+          local_analytics.getZScore(MetricId::Vibration, point.vibration_g);
 
       // Show local anomaly detection
-      if (temp_anomaly || vib_anomaly || hum_anomaly || volt_anomaly) {
-        std::cout << " [LOCAL ANOMALY";
-        if (temp_anomaly)
-          std::cout << " TEMP";
-        if (vib_anomaly)
-          std::cout << " VIB";
-        if (hum_anomaly)
-          std::cout << " HUM";
-        if (volt_anomaly)
-          std::cout << " VOLT";
-        std::cout << "]";
+      char flags[48] = "";
+      if (anomalies != 0) {
+        std::snprintf(
+            flags, sizeof(flags), " [LOCAL ANOMALY%s%s%s%s]",
+            anomalies & metricBit(MetricId::Temperature) ? " TEMP" : "",
+            anomalies & metricBit(MetricId::Vibration) ? " VIB" : "",
+            anomalies & metricBit(MetricId::Humidity) ? " HUM" : "",
+            anomalies & metricBit(MetricId::Voltage) ? " VOLT" : "");
       }
-      std::cout << std::endl;
+      logger.logAt(point.ts_ms, LogLevel::Info, LogTopic::Sample,
+                   "Temp: %.2f°C (z=%.2f), Vib: %.2fg (z=%.2f), Hum: %.2f%%, "
+                   "Volt: %.2fV%s",
+                   point.temperature_c, temp_z, point.vibration_g, vib_z,
+                   point.humidity_pct, point.voltage_v, flags);
+    }
 
-      // Send metrics asynchronously (non-blocking)
-      std::vector<MetricPoint> metrics = {point};
-      client.postMetricsAsync(config.device_id, metrics);
+    // Send metrics asynchronously (never blocks the analytics stage)
+    if (!reducer) {
+      producer.push(point);
+      return;
+    }
+    if (reducer->due(point.ts_ms) && !summaries->push(reducer->close())) {
+      logger.log(LogLevel::Warn, LogTopic::Upload,
+                 "Summary upload fell behind, dropped an interval");
+    }
+    bool trigger = false;
+    const double trigger_z = store.current().anomaly_trigger_z;
+    for (MetricId id : kAllMetricIds) {
+      trigger = trigger ||
+                ((anomalies & metricBit(id)) &&
+                 local_analytics.getZScore(id, values[metricIndex(id)]) >=
+                     trigger_z);
+    }
+    reducer->add(point, trigger,
+                 [&producer](const MetricPoint &raw) { producer.push(raw); });
+  };
+  PipelineStage<Acquired>::Options stage_options;
+  stage_options.name = "analytics";
+  stage_options.threaded = config.pipeline_threads;
+  stage_options.cpu = config.analytics_cpu;
+  PipelineStage<Acquired> analytics(
+      stage_options, [&](const Acquired *samples, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+          try {
+            analyze(samples[i]);
+          } catch (const std::exception &e) {
+            logger.log(LogLevel::Error, LogTopic::General, "Exception: %s",
+                       e.what());
+          }
+        }
+      });
+
+  // Acquisition stage: sample on absolute deadlines so processing time
+  // never stretches the interval; jitter shifts each deadline without
+  // accumulating
+  SamplingScheduler::Options sampling;
+  sampling.period_ns =
+      static_cast<int64_t>(std::max(1, config.interval_ms)) * 1000000;
+  sampling.jitter_ns =
+      static_cast<int64_t>(std::max(0, config.jitter_ms)) * 1000000;
+  sampling.realtime_priority = config.realtime_priority;
+  sampling.cpu = config.cpu_affinity;
+  SamplingScheduler scheduler(sampling);
+  std::string sampling_error;
+  if (!scheduler.configureThread(sampling_error)) {
+    std::cerr << "Warning: " << sampling_error
+              << "sampling with default scheduling" << std::endl;
+  }
 
-      // Periodically check for background errors
-      std::string last_http_error = client.getLastError();
-      if (!last_http_error.empty()) {
-        std::cerr << "Background HTTP Error: " << last_http_error << std::endl;
-      }
+  // Everything the loop prints goes through the asynchronous logger
+  LogOptions log_options;
+  if (!logOptionsFromConfig(config, log_options)) {
+    std::cerr << "Warning: Unknown log level '" << config.log_level
+              << "', using info" << std::endl;
+  }
+  logger.start(log_options);
+
+  // Reloads publish a new snapshot; the loops below pick up its live
+  // settings, the logger filter is applied here
+  const std::vector<std::string> live_keys = {
+      "interval_ms", "jitter_ms", "anomaly_probability", "anomaly_trigger_z",
+      "log_level",   "log_quiet", "log_sample_per_s",    "log_anomaly_per_s"};
+  std::string watch_error;
+  bool watching = store.watch(
+      [&logger, &live_keys](const AgentConfig &, const AgentConfig &current,
+                            const std::vector<std::string> &changed) {
+        logger.log(LogLevel::Info, LogTopic::General, "Config reloaded: %s",
+                   describeReload(changed, live_keys).c_str());
+        LogOptions options;
+        logOptionsFromConfig(current, options);
+        logger.setFilter(options);
+      },
+      watch_error);
+  if (!watching) {
+    logger.log(LogLevel::Warn, LogTopic::General, "%s", watch_error.c_str());
+  }
 
-      // Calculate sleep time with jitter
-      int sleep_ms = config.interval_ms + jitter_dist(gen);
-      sleep_ms = std::max(100, sleep_ms); // Minimum 100ms
+  MetricsExporter::Options exporter_options;
+  exporter_options.port = config.metrics_port;
+  exporter_options.bind_address = config.metrics_bind;
+  exporter_options.dump_interval_s = config.metrics_dump_s;
+  MetricsExporter exporter(exporter_options);
+  if (!exporter.ok()) {
+    logger.log(LogLevel::Warn, LogTopic::General, "%s",
+               exporter.error().c_str());
+  }
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+  logger.log(LogLevel::Info, LogTopic::General,
+             "Starting metric collection loop...");
 
-      // Update time
-      auto current_time = std::chrono::steady_clock::now();
-      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         current_time - start_time)
-                         .count();
-      t = elapsed / 1000.0; // Convert to seconds
+  uint64_t dropped = 0;
+  uint64_t config_version = store.version();
+  while (true) {
+    SamplingScheduler::Tick tick = scheduler.wait();
+
+    // A reload only swaps the snapshot pointer; the new period starts
+    // from the next deadline
+    uint64_t version = store.version();
+    const AgentConfig &live = store.current();
+    if (version != config_version) {
+      config_version = version;
+      scheduler.setPeriod(
+          static_cast<int64_t>(std::max(1, live.interval_ms)) * 1000000,
+          static_cast<int64_t>(std::max(0, live.jitter_ms)) * 1000000);
+    }
 
-    } catch (const std::exception &e) {
-      std::cerr << "Exception: " << e.what() << std::endl;
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(config.interval_ms));
+    // Generate metrics; the point is timestamped as it is acquired
+    Acquired sample;
+    {
+      StageTimer timer(metrics.stage(Stage::Generate));
+      sample.point = simulateEnvironment(scheduler.secondsAt(tick),
+                                         live.anomaly_probability, gen,
+                                         normal_dist, &sample.injected);
+    }
+    metrics.samples.add();
+    metrics.samples_missed.add(tick.missed);
+    sample.missed = tick.missed;
+    sample.dropped = dropped;
+    if (!analytics.push(sample)) {
+      ++dropped;
+      metrics.pipeline_dropped.add();
     }
   }
 
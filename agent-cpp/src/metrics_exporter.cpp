@@ -0,0 +1,121 @@
+#include "metrics_exporter.hpp"
+#include "agent_metrics.hpp"
+#include "async_logger.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    void sendAll(int fd, const std::string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+
+    std::string response(const char* status, const char* content_type, const std::string& body) {
+        std::string out = "HTTP/1.1 ";
+        out += status;
+        out += "\r\nContent-Type: ";
+        out += content_type;
+        out += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+        out += body;
+        return out;
+    }
+}
+
+MetricsExporter::MetricsExporter(const Options& options) : options_(options) {
+    if (options_.port > 0) {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+        int reuse = 1;
+        if (listen_fd_ < 0) {
+            error_ = "metrics socket: " + std::string(std::strerror(errno));
+        } else if (::inet_pton(AF_INET, options_.bind_address.c_str(), &addr.sin_addr) != 1) {
+            error_ = "metrics bind address '" + options_.bind_address + "' is not an IPv4 address";
+        } else if (::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+                   ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                   ::listen(listen_fd_, 8) != 0) {
+            error_ = "metrics endpoint " + options_.bind_address + ":" + std::to_string(options_.port) + ": " +
+                     std::strerror(errno);
+        }
+        if (!error_.empty() && listen_fd_ >= 0) {
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+        }
+    }
+    AgentMetrics::global().addGauge(this, "agent_log_dropped", "Log messages dropped because a buffer was full",
+                                    [] { return static_cast<double>(AsyncLogger::global().dropped()); });
+    if (listen_fd_ >= 0 || options_.dump_interval_s > 0) {
+        thread_ = std::thread(&MetricsExporter::run, this);
+    }
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable()) thread_.join();
+    AgentMetrics::global().removeGauges(this);
+    if (listen_fd_ >= 0) ::close(listen_fd_);
+}
+
+void MetricsExporter::run() {
+    using Clock = std::chrono::steady_clock;
+    auto next_dump = Clock::now() + std::chrono::seconds(options_.dump_interval_s);
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        // Short poll timeout so shutdown never waits long
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, listen_fd_ >= 0 ? 1 : 0, 200);
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            serveOne();
+        }
+
+        if (options_.dump_interval_s > 0 && Clock::now() >= next_dump) {
+            next_dump += std::chrono::seconds(options_.dump_interval_s);
+            AsyncLogger& logger = AsyncLogger::global();
+            for (const std::string& line : AgentMetrics::global().summaryLines()) {
+                logger.log(LogLevel::Info, LogTopic::Stats, "%s", line.c_str());
+            }
+        }
+    }
+}
+
+void MetricsExporter::serveOne() {
+    int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    // A scraper sends its request at once; don't let a stuck client hold the thread
+    timeval timeout{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+        sendAll(fd, response("200 OK", "text/plain; version=0.0.4; charset=utf-8",
+                             AgentMetrics::global().renderPrometheus()));
+    } else if (request.compare(0, 4, "GET ") == 0) {
+        sendAll(fd, response("404 Not Found", "text/plain", "Not found; try /metrics\n"));
+    } else {
+        sendAll(fd, response("405 Method Not Allowed", "text/plain", "Only GET /metrics is supported\n"));
+    }
+    ::close(fd);
+}
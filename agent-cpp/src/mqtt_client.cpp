@@ -0,0 +1,501 @@
+#include "mqtt_client.hpp"
+#include "agent_metrics.hpp"
+#include "async_logger.hpp"
+#include "thread_affinity.hpp"
+#include <algorithm>
+#include <cstdlib>
+#ifdef HAVE_MOSQUITTO
+#include <mosquitto.h>
+#endif
+
+namespace {
+// mqtt://host[:port], tcp://host[:port] or host[:port]
+bool parseBrokerUrl(const std::string &url, std::string &host, int &port) {
+  std::string rest = url;
+  size_t scheme = rest.find("://");
+  if (scheme != std::string::npos) {
+    std::string name = rest.substr(0, scheme);
+    if (name != "mqtt" && name != "tcp")
+      return false;
+    rest = rest.substr(scheme + 3);
+  }
+  if (!rest.empty() && rest.back() == '/')
+    rest.pop_back();
+  size_t colon = rest.rfind(':');
+  if (colon != std::string::npos) {
+    char *end = nullptr;
+    long value = std::strtol(rest.c_str() + colon + 1, &end, 10);
+    if (*end != '\0' || value <= 0 || value > 65535)
+      return false;
+    port = static_cast<int>(value);
+    rest.resize(colon);
+  }
+  if (rest.empty())
+    return false;
+  host = rest;
+  return true;
+}
+
+#ifdef HAVE_MOSQUITTO
+// mosquitto_lib_init/cleanup are process-wide; the gateway and tests may
+// hold several clients
+std::mutex lib_mutex;
+int lib_users = 0;
+
+void libAcquire() {
+  std::lock_guard<std::mutex> lock(lib_mutex);
+  if (lib_users++ == 0)
+    mosquitto_lib_init();
+}
+
+void libRelease() {
+  std::lock_guard<std::mutex> lock(lib_mutex);
+  if (--lib_users == 0)
+    mosquitto_lib_cleanup();
+}
+#endif
+} // namespace
+
+bool mqttAvailable() {
+#ifdef HAVE_MOSQUITTO
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::string MqttClient::topicFor(const std::string &device_id) {
+  return "sensors/" + device_id + "/metrics";
+}
+
+MqttClient::MqttClient(const std::string &broker_url,
+                       const MqttClientOptions &options)
+    : Transport(options), options_(options), encoder_(options.columnar_mantissa_bits) {
+  if (!parseBrokerUrl(broker_url, host_, port_)) {
+    error_ = "invalid MQTT broker URL '" + broker_url +
+             "' (expected mqtt://host[:port])";
+    return;
+  }
+#ifdef HAVE_MOSQUITTO
+  libAcquire();
+  struct mosquitto *mosq = mosquitto_new(
+      options_.client_id.empty() ? nullptr : options_.client_id.c_str(), true,
+      this);
+  if (!mosq) {
+    error_ = "failed to create MQTT client";
+    libRelease();
+    return;
+  }
+  mosquitto_connect_callback_set(mosq, onConnect);
+  mosquitto_disconnect_callback_set(mosq, onDisconnect);
+  mosquitto_publish_callback_set(mosq, onPublish);
+  unsigned delay = std::max(1u, options_.reconnect_min_s);
+  mosquitto_reconnect_delay_set(mosq, delay,
+                                std::max(delay, options_.reconnect_max_s), true);
+  // The worker enforces max_in_flight; libmosquitto's own window (20 by
+  // default) would only hold releasable messages back a second time
+  mosquitto_max_inflight_messages_set(
+      mosq, static_cast<unsigned>(std::max<size_t>(options_.max_in_flight, 1)));
+  mosq_ = mosq;
+#else
+  error_ = "this build has no MQTT support (libmosquitto not found)";
+  return;
+#endif
+
+  worker_thread_ = std::thread(&MqttClient::workerLoop, this);
+
+  AgentMetrics &metrics = AgentMetrics::global();
+  metrics.addGauge(this, "agent_mqtt_connected",
+                   "1 while the MQTT broker connection is up",
+                   [this] { return connected() ? 1.0 : 0.0; });
+  metrics.addGauge(this, "agent_mqtt_in_flight_messages",
+                   "QoS 1 PUBLISHes awaiting the broker's PUBACK",
+                   [this] { return static_cast<double>(inFlight()); });
+  metrics.addGauge(this, "agent_mqtt_queue_depth",
+                   "Points and requests waiting for an MQTT publish", [this] {
+                     return static_cast<double>(getQueueStats().depth);
+                   });
+}
+
+MqttClient::~MqttClient() {
+  AgentMetrics::global().removeGauges(this);
+  stop_worker_ = true;
+  task_queue_.close();
+  if (worker_thread_.joinable()) {
+    worker_thread_.join();
+  }
+#ifdef HAVE_MOSQUITTO
+  if (mosq_) {
+    // Disconnecting ends the network thread's loop, reconnects included
+    struct mosquitto *mosq = static_cast<struct mosquitto *>(mosq_);
+    mosquitto_disconnect(mosq);
+    mosquitto_loop_stop(mosq, false);
+    mosquitto_destroy(mosq);
+    libRelease();
+  }
+#endif
+}
+
+void MqttClient::onConnect(struct mosquitto *, void *self, int rc) {
+  MqttClient *client = static_cast<MqttClient *>(self);
+  AsyncLogger &logger = AsyncLogger::global();
+  if (rc != 0) {
+#ifdef HAVE_MOSQUITTO
+    client->setLastError(std::string("MQTT broker refused the connection: ") +
+                         mosquitto_connack_string(rc));
+#endif
+    logger.log(LogLevel::Warn, LogTopic::Upload, "%s",
+               client->getLastError().c_str());
+    return;
+  }
+  client->connected_ = true;
+  logger.log(LogLevel::Info, LogTopic::General, "MQTT connected to %s:%d",
+             client->host_.c_str(), client->port_);
+  client->wakeWorker();
+}
+
+void MqttClient::onDisconnect(struct mosquitto *, void *self, int rc) {
+  MqttClient *client = static_cast<MqttClient *>(self);
+  client->connected_ = false;
+  if (rc != 0 && !client->stop_worker_) {
+    // Unacknowledged QoS 1 messages are resent once the connection is back
+    client->setLastError("MQTT connection lost, reconnecting");
+    AsyncLogger::global().log(LogLevel::Warn, LogTopic::Upload,
+                              "MQTT connection to %s:%d lost, %zu messages "
+                              "in flight, reconnecting",
+                              client->host_.c_str(), client->port_,
+                              client->inFlight());
+  }
+}
+
+void MqttClient::onPublish(struct mosquitto *, void *self, int mid) {
+  MqttClient *client = static_cast<MqttClient *>(self);
+  {
+    std::lock_guard<std::mutex> lock(client->messages_mutex_);
+    auto it = client->in_flight_.find(mid);
+    if (it == client->in_flight_.end())
+      return; // QoS 0, already settled when it was queued
+    client->finished_.push_back(std::move(it->second));
+    client->in_flight_.erase(it);
+  }
+  client->wakeWorker();
+}
+
+void MqttClient::wakeWorker() {
+  // Lock-free; a wake lost to a race is caught by the bounded wait
+  task_queue_.wake();
+}
+
+size_t MqttClient::inFlight() const {
+  std::lock_guard<std::mutex> lock(messages_mutex_);
+  return in_flight_.size();
+}
+
+void MqttClient::workerLoop() {
+  std::string pin_error;
+  if (!pinCurrentThread(options_.worker_cpu, pin_error)) {
+    setLastError("MQTT worker " + pin_error + "running unpinned");
+  }
+#ifdef HAVE_MOSQUITTO
+  // Connecting here keeps a slow or unreachable broker from blocking the
+  // constructor; every later reconnect happens on the network thread
+  struct mosquitto *mosq = static_cast<struct mosquitto *>(mosq_);
+  int rc = mosquitto_connect_async(mosq, host_.c_str(), port_,
+                                   std::max(5, options_.keepalive_s));
+  if (rc != MOSQ_ERR_SUCCESS) {
+    setLastError("MQTT connect to " + host_ + ":" + std::to_string(port_) +
+                 ": " + mosquitto_strerror(rc) + ", retrying in background");
+  }
+  rc = mosquitto_loop_start(mosq);
+  if (rc != MOSQ_ERR_SUCCESS) {
+    setLastError(std::string("MQTT network thread: ") + mosquitto_strerror(rc));
+  }
+#endif
+
+  std::vector<RequestTask> drained;
+  std::vector<MetricPoint> scratch(256);
+  while (!stop_worker_) {
+    // Sleep until new data, an acknowledgement, a (re)connect or the next
+    // deadline (linger or producer poll)
+    drained.clear();
+    if (!task_queue_.drain(drained, nextWakeup()) || stop_worker_)
+      break;
+
+    for (auto &task : drained) {
+      for (auto &point : task.metrics) {
+        stagePoint(task.device_id, point);
+      }
+    }
+    drainProducers(scratch,
+                   [this](const std::string &device_id,
+                          const MetricPoint &point) {
+                     stagePoint(device_id, point);
+                   });
+    settleFinished();
+    publishDueBatches();
+    replaySpools();
+  }
+}
+
+std::chrono::steady_clock::time_point MqttClient::nextWakeup() const {
+  using Clock = std::chrono::steady_clock;
+  const auto linger = std::chrono::milliseconds(options_.max_linger_ms);
+  const auto poll = std::chrono::milliseconds(
+      std::max<long>(options_.producer_poll_ms, 1));
+
+  // Wakes from the network thread can race with the worker going to
+  // sleep, so keep the wait short whenever something is outstanding
+  auto now = Clock::now();
+  size_t in_flight = inFlight();
+  bool busy = hasProducers() || !pending_.empty() || in_flight > 0;
+  auto wake = now + (busy ? poll : std::chrono::hours(1));
+  if (!connected() ||
+      in_flight >= std::max<size_t>(options_.max_in_flight, 1)) {
+    return wake; // A connect or an acknowledgement wakes the worker
+  }
+  for (const auto &entry : pending_) {
+    if (!entry.second.metrics.empty())
+      wake = std::min(wake, entry.second.first_enqueued + linger);
+  }
+  return wake;
+}
+
+void MqttClient::stagePoint(const std::string &device_id,
+                            const MetricPoint &point) {
+  PendingBatch &batch = pending_[device_id];
+  if (batch.metrics.empty()) {
+    batch.first_enqueued = std::chrono::steady_clock::now();
+  }
+  batch.bytes += MetricsJsonWriter::kTypicalPointBytes;
+  batch.metrics.push_back(point);
+}
+
+void MqttClient::publishDueBatches() {
+  using Clock = std::chrono::steady_clock;
+  const auto linger = std::chrono::milliseconds(options_.max_linger_ms);
+  const size_t max_points = std::max<size_t>(options_.max_batch_points, 1);
+  const size_t limit = std::max<size_t>(options_.retry_buffer_points, 1);
+  const size_t window = std::max<size_t>(options_.max_in_flight, 1);
+
+  // Unlike HTTP, one connection carries any number of PUBLISHes for the
+  // same device in order, so a device's backlog goes out back to back
+  // until the window is full
+  auto now = Clock::now();
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    PendingBatch &batch = it->second;
+    if (batch.metrics.size() > limit) {
+      size_t excess = batch.metrics.size() - limit;
+      batch.metrics.erase(batch.metrics.begin(),
+                          batch.metrics.begin() + excess);
+      batch.bytes = batch.metrics.size() * MetricsJsonWriter::kTypicalPointBytes;
+      countDropped(excess);
+    }
+
+    while (!batch.metrics.empty() && connected() && inFlight() < window &&
+           (batch.metrics.size() >= max_points ||
+            batch.bytes >= options_.max_batch_bytes ||
+            now - batch.first_enqueued >= linger)) {
+      size_t count = std::min(
+          batch.metrics.size(),
+          std::max<size_t>(1, std::min(max_points,
+                                       options_.max_batch_bytes /
+                                           MetricsJsonWriter::kTypicalPointBytes)));
+      SendOutcome failure = SendOutcome::Sent;
+      if (!publish(it->first, batch.metrics.data(), count, nullptr, failure) &&
+          failure == SendOutcome::Retry) {
+        return; // Connection trouble; everything stays staged
+      }
+      // Sent, or rejected for good (counted as dropped when settled)
+      batch.metrics.erase(batch.metrics.begin(),
+                          batch.metrics.begin() + count);
+      batch.bytes = batch.metrics.size() * MetricsJsonWriter::kTypicalPointBytes;
+    }
+
+    if (batch.metrics.empty()) {
+      it = pending_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void MqttClient::replaySpools() {
+  const size_t max_points = std::max<size_t>(
+      1, std::min(options_.max_batch_points,
+                  options_.max_batch_bytes / MetricsJsonWriter::kTypicalPointBytes));
+
+  for (auto *channel : spoolChannels()) {
+    if (channel->in_flight)
+      continue; // One message per spool; its points are still unconsumed
+    Spool *spool = channel->spool.get();
+    spool->enforceRetention(epochMillisNow());
+    if (stop_worker_ || !connected() ||
+        inFlight() >= std::max<size_t>(options_.max_in_flight, 1))
+      return;
+
+    size_t n = spool->peek(replay_, max_points);
+    bool due = n > 0 && (n >= max_points ||
+                         epochMillisNow() - replay_.front().ts_ms >=
+                             options_.max_linger_ms);
+    if (!due)
+      continue;
+    channel->in_flight = true;
+    SendOutcome failure = SendOutcome::Sent;
+    if (!publish(channel->device_id, replay_.data(), n, channel, failure) &&
+        failure == SendOutcome::Retry)
+      return;
+  }
+}
+
+bool MqttClient::publish(const std::string &device_id,
+                         const MetricPoint *points, size_t count,
+                         MetricProducer::Channel *spool_channel,
+                         SendOutcome &failure) {
+  AgentMetrics &metrics = AgentMetrics::global();
+  std::string_view payload;
+  {
+    StageTimer timer(metrics.stage(Stage::Serialize));
+    payload = options_.wire_format == WireFormat::Columnar
+                  ? encoder_.encode(device_id, points, count)
+                  : writer_.write(device_id, points, count);
+  }
+  const std::string topic = topicFor(device_id);
+  const int qos = options_.qos > 0 ? 1 : 0;
+
+  Message message;
+  message.device_id = device_id;
+  message.points = count;
+  message.spool_channel = spool_channel;
+  message.started = std::chrono::steady_clock::now();
+
+#ifdef HAVE_MOSQUITTO
+  int mid = 0;
+  int rc;
+  {
+    // Record the message under the lock the PUBACK callback takes, so the
+    // network thread can never see a mid before it is known
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    rc = mosquitto_publish(static_cast<struct mosquitto *>(mosq_), &mid,
+                           topic.c_str(), static_cast<int>(payload.size()),
+                           payload.data(), qos, false);
+    if (rc == MOSQ_ERR_SUCCESS) {
+      metrics.upload_bytes.add(payload.size());
+      if (qos > 0) {
+        in_flight_.emplace(mid, std::move(message));
+      } else {
+        finished_.push_back(std::move(message));
+      }
+      return true;
+    }
+  }
+  message.error = std::string("MQTT publish: ") + mosquitto_strerror(rc);
+  if (rc == MOSQ_ERR_NO_CONN) {
+    connected_ = false;
+  }
+  bool transient = rc == MOSQ_ERR_NO_CONN || rc == MOSQ_ERR_NOMEM ||
+                   rc == MOSQ_ERR_ERRNO || rc == MOSQ_ERR_CONN_LOST;
+  failure = transient ? SendOutcome::Retry : SendOutcome::Reject;
+#else
+  (void)payload;
+  (void)qos;
+  message.error = "MQTT publish: no MQTT support in this build";
+  failure = SendOutcome::Retry;
+#endif
+  message.outcome = failure;
+  setLastError(message.error + " (" + topic + ")");
+  std::lock_guard<std::mutex> lock(messages_mutex_);
+  finished_.push_back(std::move(message));
+  return false;
+}
+
+void MqttClient::settleFinished() {
+  std::vector<Message> done;
+  {
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    done.swap(finished_);
+  }
+  if (done.empty())
+    return;
+
+  UploadCallback callback = completionCallback();
+  AgentMetrics &metrics = AgentMetrics::global();
+  auto now = std::chrono::steady_clock::now();
+  for (Message &message : done) {
+    metrics.upload_points.add(message.points);
+    switch (message.outcome) {
+    case SendOutcome::Sent:
+      metrics.uploads_sent.add();
+      if (options_.qos > 0) {
+        metrics.stage(Stage::MqttRoundTrip)
+            .record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    now - message.started)
+                    .count()));
+      }
+      break;
+    case SendOutcome::Retry:
+      metrics.uploads_retried.add();
+      metrics.transport_errors.add();
+      break;
+    case SendOutcome::Reject:
+      metrics.uploads_rejected.add();
+      metrics.transport_errors.add();
+      countDropped(message.points);
+      break;
+    }
+
+    if (MetricProducer::Channel *channel = message.spool_channel) {
+      // Retried points are simply still unconsumed on disk
+      if (message.outcome != SendOutcome::Retry) {
+        channel->spool->consume(message.points);
+      }
+      channel->in_flight = false;
+    }
+
+    if (callback) {
+      UploadResult result;
+      result.device_id = message.device_id;
+      result.points = message.points;
+      result.outcome = message.outcome;
+      result.error = message.error;
+      result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+          now - message.started);
+      result.replayed = message.spool_channel != nullptr;
+      callback(result);
+    }
+  }
+}
+
+std::unique_ptr<MqttClient>
+makeMqttTransport(const AgentConfig &config,
+                  const HttpClientOptions &http_options, std::string &error) {
+  error.clear();
+  if (config.transport == "http")
+    return nullptr;
+  if (config.transport != "mqtt") {
+    error = "Unknown transport '" + config.transport + "'";
+    return nullptr;
+  }
+
+  MqttClientOptions options;
+  static_cast<TransportOptions &>(options) = http_options;
+  options.client_id = config.device_id;
+  options.keepalive_s = config.mqtt_keepalive_s;
+  options.qos = config.mqtt_qos;
+  options.max_in_flight =
+      static_cast<size_t>(std::max(1, config.mqtt_max_in_flight));
+  options.worker_cpu = http_options.worker_cpu;
+  options.wire_format = http_options.wire_format;
+  options.columnar_mantissa_bits = http_options.columnar_mantissa_bits;
+  options.max_batch_points = http_options.max_batch_points;
+  options.max_batch_bytes = http_options.max_batch_bytes;
+  options.max_linger_ms = http_options.max_linger_ms;
+  options.retry_buffer_points = http_options.retry_buffer_points;
+
+  auto client = std::make_unique<MqttClient>(config.mqtt_broker_url, options);
+  if (!client->ok()) {
+    error = client->error();
+    return nullptr;
+  }
+  return client;
+}
@@ -0,0 +1,320 @@
+#include "spool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char kMagic[8] = {'I', 'O', 'T', 'S', 'P', 'L', '0', '1'};
+    constexpr uint32_t kCommitted = 0x434d4954; // "CMIT"
+
+    struct SegmentHeader {
+        char magic[8];
+        uint64_t seq;
+        int64_t created_ms;
+        uint64_t consumed; // Acknowledged records, updated in place
+        uint32_t record_size;
+        uint32_t capacity;
+        char reserved[24];
+    };
+    static_assert(sizeof(SegmentHeader) == 64, "segment header must stay 64 bytes");
+
+    struct Record {
+        MetricPoint point;
+        uint32_t checksum;
+        uint32_t commit; // kCommitted once the record is complete
+    };
+    static_assert(sizeof(Record) == 48, "spool record layout changed");
+
+    // FNV-1a over the point's bytes
+    uint32_t checksum(const MetricPoint& point) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(&point);
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < sizeof(MetricPoint); ++i) {
+            h = (h ^ p[i]) * 16777619u;
+        }
+        return h;
+    }
+
+    std::string segmentName(uint64_t seq) {
+        char name[40];
+        std::snprintf(name, sizeof(name), "seg-%016llu.spool", static_cast<unsigned long long>(seq));
+        return name;
+    }
+}
+
+struct Spool::Segment {
+    uint64_t seq = 0;
+    std::string path;
+    int fd = -1;
+    char* base = nullptr;
+    size_t map_bytes = 0;
+    SegmentHeader* header = nullptr;
+    Record* records = nullptr;
+    size_t capacity = 0;
+    int64_t created_ms = 0;
+
+    size_t write_pos = 0;             // Writer-only
+    std::atomic<size_t> written{0};   // Published with release after each append
+    std::atomic<bool> sealed{false};  // No more appends (set after the last one)
+    std::atomic<size_t> consumed{0};  // Reader-owned, mirrored to header->consumed
+
+    ~Segment() {
+        if (base) munmap(base, map_bytes);
+        if (fd >= 0) close(fd);
+    }
+};
+
+Spool::Spool(const Options& options)
+    : options_(options) {
+    options_.segment_bytes = std::max(options_.segment_bytes, sizeof(SegmentHeader) + 64 * sizeof(Record));
+    capacity_ = (options_.segment_bytes - sizeof(SegmentHeader)) / sizeof(Record);
+
+    std::error_code ec;
+    std::filesystem::create_directories(options_.dir, ec);
+    if (ec) {
+        error_ = "Cannot create spool directory " + options_.dir + ": " + ec.message();
+        return;
+    }
+
+    // Recover existing segments in sequence order
+    std::vector<std::pair<uint64_t, std::string>> found;
+    for (const auto& entry : std::filesystem::directory_iterator(options_.dir, ec)) {
+        std::string name = entry.path().filename().string();
+        unsigned long long seq = 0;
+        if (std::sscanf(name.c_str(), "seg-%llu.spool", &seq) == 1) {
+            found.emplace_back(seq, entry.path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    for (const auto& f : found) {
+        auto segment = openSegment(f.second, f.first, false);
+        next_seq_ = f.first + 1;
+        if (!segment) {
+            continue; // Unreadable or foreign file; leave it alone
+        }
+        segment->sealed = true;
+        if (segment->consumed >= segment->written) {
+            unlink(segment->path.c_str());
+            continue;
+        }
+        segments_.push_back(std::move(segment));
+    }
+
+    // Keep appending to the newest segment if it has room
+    if (!segments_.empty()) {
+        Segment* last = segments_.back().get();
+        if (last->write_pos < last->capacity) {
+            last->sealed = false;
+            tail_ = last;
+        }
+    }
+}
+
+Spool::~Spool() {
+    for (auto& segment : segments_) {
+        msync(segment->base, segment->map_bytes, MS_ASYNC);
+    }
+}
+
+std::unique_ptr<Spool::Segment> Spool::openSegment(const std::string& path, uint64_t seq, bool create) {
+    auto segment = std::make_unique<Segment>();
+    segment->seq = seq;
+    segment->path = path;
+
+    if (create) {
+        segment->fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (segment->fd < 0) return nullptr;
+        segment->map_bytes = sizeof(SegmentHeader) + capacity_ * sizeof(Record);
+        // Reserve the blocks now: writing a mapping past a full disk is SIGBUS
+        if (posix_fallocate(segment->fd, 0, static_cast<off_t>(segment->map_bytes)) != 0) {
+            unlink(path.c_str());
+            return nullptr;
+        }
+    } else {
+        segment->fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (segment->fd < 0) return nullptr;
+        struct stat st;
+        if (fstat(segment->fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+            return nullptr;
+        }
+        segment->map_bytes = static_cast<size_t>(st.st_size);
+    }
+
+    void* base = mmap(nullptr, segment->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    if (base == MAP_FAILED) {
+        if (create) unlink(path.c_str());
+        return nullptr;
+    }
+    segment->base = static_cast<char*>(base);
+    segment->header = reinterpret_cast<SegmentHeader*>(segment->base);
+    segment->records = reinterpret_cast<Record*>(segment->base + sizeof(SegmentHeader));
+
+    SegmentHeader* h = segment->header;
+    if (create) {
+        std::memcpy(h->magic, kMagic, sizeof(kMagic));
+        h->seq = seq;
+        h->created_ms = epochMillisNow();
+        h->consumed = 0;
+        h->record_size = sizeof(Record);
+        h->capacity = static_cast<uint32_t>(capacity_);
+        segment->capacity = capacity_;
+        segment->created_ms = h->created_ms;
+        return segment;
+    }
+
+    size_t fits = (segment->map_bytes - sizeof(SegmentHeader)) / sizeof(Record);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->record_size != sizeof(Record) ||
+        h->capacity > fits) {
+        return nullptr;
+    }
+    segment->capacity = h->capacity;
+    segment->created_ms = h->created_ms;
+
+    // Committed records with a valid checksum form the recovered prefix
+    size_t n = 0;
+    while (n < segment->capacity && segment->records[n].commit == kCommitted &&
+           segment->records[n].checksum == checksum(segment->records[n].point)) {
+        ++n;
+    }
+    segment->write_pos = n;
+    segment->written = n;
+    segment->consumed = std::min<uint64_t>(h->consumed, n);
+    return segment;
+}
+
+bool Spool::rollover() {
+    if (!ok()) return false;
+
+    if (tail_) {
+        msync(tail_->base, tail_->map_bytes, MS_ASYNC);
+        tail_->sealed.store(true, std::memory_order_release);
+        tail_ = nullptr;
+    }
+
+    uint64_t seq = next_seq_++;
+    auto segment = openSegment(options_.dir + "/" + segmentName(seq), seq, true);
+    if (!segment) return false;
+
+    tail_ = segment.get();
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    segments_.push_back(std::move(segment));
+    return true;
+}
+
+bool Spool::append(const MetricPoint& point) {
+    if (!tail_ || tail_->write_pos == tail_->capacity) {
+        if (!rollover()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed); // Retention adds to it from the worker
+            return false;
+        }
+    }
+
+    Record& r = tail_->records[tail_->write_pos];
+    r.point = point;
+    r.checksum = checksum(point);
+    std::atomic_signal_fence(std::memory_order_release);
+    r.commit = kCommitted;
+
+    tail_->written.store(++tail_->write_pos, std::memory_order_release);
+    appended_.store(appended_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void Spool::dropFront() {
+    std::unique_ptr<Segment> front;
+    {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        if (segments_.size() <= 1) return; // The newest may still be written
+        front = std::move(segments_.front());
+        segments_.pop_front();
+    }
+    unlink(front->path.c_str());
+}
+
+size_t Spool::peek(std::vector<MetricPoint>& out, size_t max) {
+    out.clear();
+    for (;;) {
+        Segment* seg;
+        bool has_next;
+        {
+            std::lock_guard<std::mutex> lock(segments_mutex_);
+            if (segments_.empty()) return 0;
+            seg = segments_.front().get();
+            has_next = segments_.size() > 1;
+        }
+
+        // Sealed must be checked before written so no final append is missed
+        bool sealed = seg->sealed.load(std::memory_order_acquire);
+        size_t written = seg->written.load(std::memory_order_acquire);
+        size_t consumed = seg->consumed.load(std::memory_order_relaxed);
+        if (consumed < written) {
+            size_t n = std::min(max, written - consumed);
+            out.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                out.push_back(seg->records[consumed + i].point);
+            }
+            return n;
+        }
+        if (!sealed || !has_next) return 0; // Caught up with the writer
+
+        dropFront();
+    }
+}
+
+void Spool::consume(size_t n) {
+    Segment* seg;
+    {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        if (segments_.empty()) return;
+        seg = segments_.front().get();
+    }
+    size_t consumed = std::min(seg->consumed.load(std::memory_order_relaxed) + n,
+                               seg->written.load(std::memory_order_acquire));
+    seg->consumed.store(consumed, std::memory_order_relaxed);
+    seg->header->consumed = consumed;
+}
+
+void Spool::enforceRetention(int64_t now_ms) {
+    for (;;) {
+        Segment* front;
+        {
+            std::lock_guard<std::mutex> lock(segments_mutex_);
+            if (segments_.size() <= 1) return;
+            uint64_t bytes = 0;
+            for (const auto& segment : segments_) {
+                bytes += segment->map_bytes;
+            }
+            // The front is sealed; everything in it predates the next segment
+            bool over_size = bytes > options_.max_bytes;
+            bool too_old = options_.max_age_ms > 0 &&
+                           segments_[1]->created_ms < now_ms - options_.max_age_ms;
+            if (!over_size && !too_old) return;
+            front = segments_.front().get();
+        }
+        size_t lost = front->written.load(std::memory_order_acquire) -
+                      front->consumed.load(std::memory_order_relaxed);
+        dropped_.fetch_add(lost, std::memory_order_relaxed);
+        dropFront();
+    }
+}
+
+Spool::Stats Spool::stats() const {
+    Stats s;
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    s.segments = segments_.size();
+    for (const auto& segment : segments_) {
+        s.bytes += segment->map_bytes;
+        s.pending += segment->written.load(std::memory_order_acquire) -
+                     segment->consumed.load(std::memory_order_relaxed);
+    }
+    s.appended = appended_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,162 @@
+#include "transport.hpp"
+#include "agent_metrics.hpp"
+#include <algorithm>
+
+bool parseWireFormat(const std::string &name, WireFormat &format) {
+  if (name == "json")
+    format = WireFormat::Json;
+  else if (name == "columnar")
+    format = WireFormat::Columnar;
+  else
+    return false;
+  return true;
+}
+
+std::string deviceSpoolDir(const std::string &spool_dir,
+                           const std::string &device_id) {
+  std::string name = device_id;
+  for (char &c : name) {
+    bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                (c >= '0' && c <= '9') || c == '-' || c == '_';
+    if (!safe)
+      c = '_';
+  }
+  return spool_dir + "/" + (name.empty() ? "_" : name);
+}
+
+bool MetricProducer::push(const MetricPoint &point) {
+  StageTimer timer(AgentMetrics::global().stage(Stage::Enqueue));
+  Channel &ch = *channel_;
+  bool stored = ch.spool ? ch.spool->append(point) : ch.ring.tryPush(point);
+  if (!stored) {
+    ch.dropped.store(ch.dropped.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    return false;
+  }
+  ch.pushed.store(ch.pushed.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+
+  // Batched wakeup; between wakeups the worker finds points by polling
+  if (++ch.unsignaled >= ch.wake_batch) {
+    ch.unsignaled = 0;
+    transport_->wakeWorker();
+  }
+  return true;
+}
+
+size_t MetricProducer::dropped() const {
+  return channel_->dropped.load(std::memory_order_relaxed);
+}
+
+Transport::Transport(const TransportOptions &options)
+    : task_queue_(options.queue_capacity, options.overflow_policy,
+                  options.queue_high_water, options.downsample_factor),
+      transport_options_(options) {}
+
+bool Transport::postMetricsAsync(const std::string &device_id,
+                                 const std::vector<MetricPoint> &metrics) {
+  bool accepted = task_queue_.push({device_id, metrics});
+  wakeWorker();
+  return accepted;
+}
+
+MetricProducer Transport::createProducer(const std::string &device_id) {
+  const TransportOptions &options = transport_options_;
+  auto channel = std::make_unique<MetricProducer::Channel>(
+      device_id, options.producer_ring_capacity,
+      std::max<size_t>(options.producer_wake_batch, 1));
+  if (!options.spool_dir.empty()) {
+    Spool::Options spool_options;
+    spool_options.dir = deviceSpoolDir(options.spool_dir, device_id);
+    spool_options.segment_bytes = options.spool_segment_bytes;
+    spool_options.max_bytes = options.spool_max_bytes;
+    spool_options.max_age_ms = options.spool_max_age_ms;
+    auto spool = std::make_unique<Spool>(spool_options);
+    if (spool->ok()) {
+      channel->spool = std::move(spool);
+    } else {
+      // Keep sampling through the in-memory ring rather than fail
+      setLastError(spool->error());
+    }
+  }
+  MetricProducer producer = producerFor(channel.get());
+  {
+    std::lock_guard<std::mutex> lock(producers_mutex_);
+    producers_.push_back(std::move(channel));
+  }
+  has_producers_ = true;
+  return producer;
+}
+
+QueueStats Transport::getQueueStats() const {
+  QueueStats stats = task_queue_.stats();
+  std::lock_guard<std::mutex> lock(producers_mutex_);
+  for (const auto &channel : producers_) {
+    stats.pushed += channel->pushed.load(std::memory_order_relaxed);
+    stats.dropped += channel->dropped.load(std::memory_order_relaxed);
+    if (channel->spool) {
+      Spool::Stats spool = channel->spool->stats();
+      stats.depth += spool.pending;
+      // Spool drops include the failed appends already counted above
+      uint64_t append_failures =
+          channel->dropped.load(std::memory_order_relaxed);
+      stats.dropped += spool.dropped - std::min(spool.dropped, append_failures);
+    }
+  }
+  stats.dropped += staging_dropped_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+Spool::Stats Transport::getSpoolStats() const {
+  Spool::Stats total;
+  std::lock_guard<std::mutex> lock(producers_mutex_);
+  for (const auto &channel : producers_) {
+    if (!channel->spool)
+      continue;
+    Spool::Stats s = channel->spool->stats();
+    total.segments += s.segments;
+    total.bytes += s.bytes;
+    total.pending += s.pending;
+    total.appended += s.appended;
+    total.dropped += s.dropped;
+  }
+  return total;
+}
+
+void Transport::setHighWaterCallback(
+    std::function<void(size_t depth)> callback) {
+  task_queue_.setHighWaterCallback(std::move(callback));
+}
+
+void Transport::setCompletionCallback(UploadCallback callback) {
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  on_complete_ = std::move(callback);
+}
+
+UploadCallback Transport::completionCallback() const {
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  return on_complete_;
+}
+
+std::string Transport::getLastError() const {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return last_error_;
+}
+
+void Transport::setLastError(const std::string &error) {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  last_error_ = error;
+}
+
+const std::vector<MetricProducer::Channel *> &Transport::spoolChannels() {
+  spool_channels_.clear();
+  if (transport_options_.spool_dir.empty() || !has_producers_)
+    return spool_channels_;
+
+  std::lock_guard<std::mutex> lock(producers_mutex_);
+  for (auto &channel : producers_) {
+    if (channel->spool)
+      spool_channels_.push_back(channel.get());
+  }
+  return spool_channels_;
+}
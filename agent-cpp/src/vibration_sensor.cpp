@@ -1,202 +1,871 @@
+#include "agent_metrics.hpp"
+#include "async_logger.hpp"
 #include "config.hpp"
+#include "config_store.hpp"
+#include "device_simulator.hpp"
 #include "http_client.hpp"
 #include "fft_analyzer.hpp"
+#include "iio_source.hpp"
+#include "interval_reducer.hpp"
 #include "local_analytics.hpp"
-#include <iostream>
+#include "metrics_exporter.hpp"
+#include "mqtt_client.hpp"
+#include "multichannel_analyzer.hpp"
+#include "pipeline_stage.hpp"
+#include "sampling_scheduler.hpp"
+#include "sensor_source.hpp"
+#include "spectral_baseline.hpp"
+#include "spectral_features.hpp"
+#include "window_function.hpp"
+#include "summary_uploader.hpp"
+#include <atomic>
 #include <chrono>
-#include <thread>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
 #include <random>
+#include <thread>
+#include <vector>
 #include <cmath>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
-
-// Get current timestamp in ISO 8601 format
-std::string getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-
-    std::ostringstream oss;
-    oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(3) << ms.count() << "Z";
-    return oss.str();
+
+namespace {
+// Logger, config reload handler and metrics exporter; live_keys are the
+// keys a reload applies without a restart
+std::unique_ptr<MetricsExporter> startServices(const AgentConfig& config, ConfigStore& store,
+                                               const std::vector<std::string>& live_keys) {
+    // Everything the loop prints goes through the asynchronous logger
+    AsyncLogger& logger = AsyncLogger::global();
+    LogOptions log_options;
+    if (!logOptionsFromConfig(config, log_options)) {
+        std::cerr << "Warning: Unknown log level '" << config.log_level << "', using info" << std::endl;
+    }
+    logger.start(log_options);
+
+    std::string watch_error;
+    bool watching = store.watch(
+        [&logger, live_keys](const AgentConfig&, const AgentConfig& current, const std::vector<std::string>& changed) {
+            logger.log(LogLevel::Info, LogTopic::General, "Config reloaded: %s",
+                       describeReload(changed, live_keys).c_str());
+            LogOptions options;
+            logOptionsFromConfig(current, options);
+            logger.setFilter(options);
+        },
+        watch_error);
+    if (!watching) {
+        logger.log(LogLevel::Warn, LogTopic::General, "%s", watch_error.c_str());
+    }
+
+    MetricsExporter::Options exporter_options;
+    exporter_options.port = config.metrics_port;
+    exporter_options.bind_address = config.metrics_bind;
+    exporter_options.dump_interval_s = config.metrics_dump_s;
+    auto exporter = std::make_unique<MetricsExporter>(exporter_options);
+    if (!exporter->ok()) {
+        logger.log(LogLevel::Warn, LogTopic::General, "%s", exporter->error().c_str());
+    }
+    return exporter;
 }
 
-// Generate vibration signal with frequency components
-double generateVibrationSignal(double t, std::mt19937& gen, std::normal_distribution<>& normal_dist) {
-    // Base vibration from rotating machinery (e.g., 30 Hz motor)
-    double base_freq = 30.0; // Hz
-    double base_amplitude = 0.02; // g
-    
-    // Normal vibration signal
-    double vibration = base_amplitude * std::sin(2.0 * M_PI * base_freq * t);
-    
-    // Add harmonics (2nd and 3rd)
-    vibration += 0.005 * std::sin(2.0 * M_PI * base_freq * 2.0 * t);
-    vibration += 0.002 * std::sin(2.0 * M_PI * base_freq * 3.0 * t);
-    
-    // Add noise
-    vibration += std::abs(normal_dist(gen) * 0.01);
-    
-    // Occasionally inject anomalies
-    std::uniform_real_distribution<> anomaly_dist(0.0, 1.0);
-    bool inject_anomaly = anomaly_dist(gen) < 0.05; // 5% probability
-    
-    if (inject_anomaly) {
-        // High-frequency resonance (bearing failure simulation)
-        if (anomaly_dist(gen) < 0.5) {
-            vibration += 0.3 * std::sin(2.0 * M_PI * 150.0 * t); // 150 Hz resonance
-            std::cout << "[FFT ANOMALY] High-frequency resonance detected!" << std::endl;
+BaselineOptions baselineOptions(const AgentConfig& config) {
+    BaselineOptions options;
+    options.alpha = config.fft_baseline_alpha;
+    options.warmup_frames = static_cast<size_t>(std::max(1, config.fft_baseline_warmup));
+    options.z_limit = config.fft_baseline_z;
+    options.min_bins = static_cast<size_t>(std::max(1, config.fft_baseline_min_bins));
+    options.relearn_frames = static_cast<size_t>(std::max(0, config.fft_baseline_relearn));
+    return options;
+}
+
+/**
+ * Multi-channel mode (vibration_channels > 1): channels sampled together,
+ * e.g. triaxial accelerometers on several machines, are analyzed in one
+ * batch per hop by a MultiChannelAnalyzer spread over vibration_threads.
+ * Each channel is a device of its own, <device_id>-chNN, and uploads its
+ * interval peak. The channels are simulated, and their verdicts come from
+ * the per-channel spectrum baselines alone (no time-domain features).
+ */
+int runMultiChannel(const AgentConfig& config, ConfigStore& store, Transport& transport) {
+    const size_t channels = static_cast<size_t>(config.vibration_channels);
+    if (config.sensor_source != "simulated") {
+        std::cerr << "Warning: Multi-channel mode simulates its channels, ignoring sensor_source '"
+                  << config.sensor_source << "'" << std::endl;
+    }
+    ReductionMode reduction = ReductionMode::Raw;
+    if (parseReductionMode(config.reduction, reduction) && reduction == ReductionMode::Aggregate) {
+        std::cerr << "Warning: Multi-channel mode has no aggregate reduction, uploading interval peaks" << std::endl;
+    }
+
+    std::vector<std::string> channel_ids;
+    std::vector<MetricProducer> producers;
+    channel_ids.reserve(channels);
+    producers.reserve(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "-ch%02zu", c);
+        channel_ids.push_back(config.device_id + suffix);
+        producers.push_back(transport.createProducer(channel_ids.back()));
+    }
+    if (!config.spool_dir.empty() && !transport.getLastError().empty()) {
+        std::cerr << "Warning: " << transport.getLastError() << ", buffering in memory only" << std::endl;
+    }
+
+    const int interval_ms = std::max(1, config.interval_ms);
+    const double sample_rate = static_cast<double>(std::max(1, config.sample_rate_hz));
+    const size_t block = static_cast<size_t>(std::max(1, config.sensor_block_samples));
+    const uint64_t samples_per_upload =
+        std::max<uint64_t>(1, static_cast<uint64_t>(sample_rate) * static_cast<uint64_t>(interval_ms) / 1000);
+    const size_t fft_size = static_cast<size_t>(std::max(8, config.fft_size));
+    const size_t threads = static_cast<size_t>(std::max(0, config.vibration_threads));
+    MultiChannelAnalyzer analyzer(channels, fft_size, sample_rate, fft_size / 2, threads);
+    std::cout << "  Channels: " << channels << " (" << channel_ids.front() << " .. " << channel_ids.back() << "), "
+              << threads << " analysis threads" << std::endl;
+    std::cout << "  Sample rate: " << sample_rate << " Hz (" << samples_per_upload << " samples per upload), "
+              << block << " samples per read" << std::endl;
+
+    // The baseline is the only verdict here, so it stays on even without
+    // fft_baseline; all channels share one file
+    BaselineOptions baseline_options = baselineOptions(config);
+    analyzer.configureBaseline(baseline_options);
+    BasicSpectralBaseline<double>& baseline = analyzer.baseline();
+    std::string baseline_path;
+    bool restored = false;
+    if (!config.baseline_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(config.baseline_dir, ec);
+        baseline_path = baselinePath(config.baseline_dir, config.device_id + "-channels");
+        std::string error;
+        restored = baseline.load(baseline_path, error);
+        if (!error.empty()) std::cerr << "Warning: " << error << std::endl;
+    }
+    auto allWarm = [&]() {
+        for (size_t c = 0; c < channels; ++c) {
+            if (!baseline.warm(c)) return false;
+        }
+        return true;
+    };
+    bool baseline_warm = allWarm();
+    std::cout << "  Baseline: " << (restored ? "restored from " + baseline_path : "learning") << ", anomaly at "
+              << baseline_options.min_bins << "+ bins beyond " << baseline_options.z_limit << " sigma" << std::endl;
+    const int64_t baseline_save_ms = static_cast<int64_t>(std::max(1, config.baseline_save_s)) * 1000;
+    int64_t baseline_saved_ms = epochMillisNow();
+    std::vector<uint64_t> relearns(channels);
+    for (size_t c = 0; c < channels; ++c) relearns[c] = baseline.relearns(c);
+
+    // Saving copies the baseline and writes it on a thread of its own, as
+    // the gateway does; a save that comes due during a write waits for it
+    std::thread baseline_writer;
+    std::atomic<bool> baseline_writing{false};
+    bool save_pending = false;
+    auto saveBaseline = [&]() {
+        if (baseline_writing.load(std::memory_order_acquire)) return false;
+        if (baseline_writer.joinable()) baseline_writer.join();
+        baseline_writing.store(true, std::memory_order_relaxed);
+        baseline_writer = std::thread([&baseline_writing, &baseline_path, snapshot = baseline]() {
+            std::string error;
+            if (!snapshot.save(baseline_path, error)) {
+                AsyncLogger::global().log(LogLevel::Warn, LogTopic::General, "%s", error.c_str());
+            }
+            baseline_writing.store(false, std::memory_order_release);
+        });
+        return true;
+    };
+
+    const std::vector<std::string> live_keys = {"log_level", "log_quiet", "log_sample_per_s", "log_anomaly_per_s"};
+    std::unique_ptr<MetricsExporter> exporter = startServices(config, store, live_keys);
+    AsyncLogger& logger = AsyncLogger::global();
+    AgentMetrics& metrics = AgentMetrics::global();
+
+    // Per-interval peaks and frame verdicts of every channel, owned by the
+    // analytics stage
+    std::vector<double> peak(channels, 0.0);
+    std::vector<int64_t> peak_ms(channels, 0);
+    std::vector<uint64_t> anomalies(channels, 0);
+    uint64_t frames = 0;
+    uint64_t interval_samples = 0;
+    uint64_t dropped_reported = 0;
+    analyzer.setFrameCallback([&](const std::vector<MultiChannelAnalyzer::ChannelResult>& results) {
+        ++frames;
+        for (size_t c = 0; c < channels; ++c) anomalies[c] += results[c].anomaly;
+    });
+
+    // Acquisition fills one slot of interleaved samples per tick and hands
+    // its index to the analytics stage. There are more slots than the stage
+    // can hold and handle at once, so a slot is never refilled while queued.
+    struct AcquiredBlock {
+        size_t slot;
+        uint64_t first;    // Index of the block's first sample
+        int64_t last_ms;   // Acquisition time of its last sample
+        uint64_t missed;   // Blocks skipped right before this one
+        uint64_t dropped;  // Blocks the analytics stage had no room for, so far
+    };
+    PipelineStage<AcquiredBlock>::Options stage_options;
+    stage_options.name = "analytics";
+    stage_options.threaded = config.pipeline_threads;
+    stage_options.cpu = config.analytics_cpu;
+    stage_options.capacity = 64; // A power of two, so the ring holds exactly this many
+    stage_options.batch = 8;
+    const size_t slots = stage_options.capacity + stage_options.batch + 1;
+    std::vector<double> acquired(slots * block * channels);
+
+    auto analyze = [&](const AcquiredBlock& item) {
+        const double* samples = acquired.data() + item.slot * block * channels;
+        for (size_t i = 0; i < block; ++i) {
+            int64_t ts_ms =
+                item.last_ms - static_cast<int64_t>(static_cast<double>(block - 1 - i) * 1000.0 / sample_rate);
+            const double* frame = samples + i * channels;
+            for (size_t c = 0; c < channels; ++c) {
+                if ((interval_samples == 0 && i == 0) || frame[c] > peak[c]) {
+                    peak[c] = frame[c];
+                    peak_ms[c] = ts_ms;
+                }
+            }
+        }
+
+        // One batch of transforms over all channels per hop
+        uint64_t fft_start_ns = monotonicNowNs();
+        if (analyzer.pushFrames(samples, block) > 0) {
+            metrics.stage(Stage::Fft).record(monotonicNowNs() - fft_start_ns);
+
+            // Same saving rules as the single-channel loop: right after a
+            // re-learn, once every channel is learned, then periodically
+            for (size_t c = 0; c < channels; ++c) {
+                if (baseline.relearns(c) == relearns[c]) continue;
+                relearns[c] = baseline.relearns(c);
+                baseline_warm = false;
+                save_pending = true;
+                logger.log(LogLevel::Warn, LogTopic::General,
+                           "%s: spectrum off its baseline for %zu frames in a row, re-learning it",
+                           channel_ids[c].c_str(), baseline_options.relearn_frames);
+            }
+            if (!baseline_warm && allWarm()) {
+                baseline_warm = true;
+                save_pending = true;
+                logger.log(LogLevel::Info, LogTopic::General, "Spectrum baselines learned on all %zu channels",
+                           channels);
+            }
+            save_pending = save_pending || (baseline_warm && item.last_ms - baseline_saved_ms >= baseline_save_ms);
+        }
+        if (save_pending && !baseline_path.empty() && saveBaseline()) {
+            save_pending = false;
+            baseline_saved_ms = item.last_ms;
+        }
+
+        if (item.dropped > dropped_reported) {
+            logger.log(LogLevel::Warn, LogTopic::Timing, "Analytics fell behind, dropped %llu blocks",
+                       static_cast<unsigned long long>(item.dropped - dropped_reported));
+            dropped_reported = item.dropped;
+        }
+        interval_samples += block * (1 + item.missed);
+        if (interval_samples < samples_per_upload) return;
+
+        // One point per channel, and one line for all of them
+        size_t flagged = 0;
+        size_t loudest = 0;
+        char flags[128] = "";
+        size_t used = 0;
+        for (size_t c = 0; c < channels; ++c) {
+            MetricPoint point{};
+            point.ts_ms = peak_ms[c];
+            point.vibration_g = peak[c];
+            if (!producers[c].push(point)) {
+                logger.log(LogLevel::Warn, LogTopic::Upload, "%s: upload buffer full, dropped point",
+                           channel_ids[c].c_str());
+            }
+            if (peak[c] > peak[loudest]) loudest = c;
+            if (anomalies[c] == 0) continue;
+            if (flagged++ < 4 && used < sizeof(flags)) {
+                int n = std::snprintf(flags + used, sizeof(flags) - used, " ch%02zu %llu/%llu", c,
+                                      static_cast<unsigned long long>(anomalies[c]),
+                                      static_cast<unsigned long long>(frames));
+                if (n > 0) used += static_cast<size_t>(n);
+            }
+        }
+        if (flagged > 0) {
+            logger.log(LogLevel::Info, LogTopic::Anomaly, "[FFT ANOMALY] %zu of %zu channels:%s%s", flagged, channels,
+                       flags, flagged > 4 ? " ..." : "");
+        }
+        logger.logAt(peak_ms[loudest], LogLevel::Info, LogTopic::Sample, "Vib peak: %.4fg on ch%02zu, %llu frames",
+                     peak[loudest], loudest, static_cast<unsigned long long>(frames));
+
+        interval_samples = 0;
+        frames = 0;
+        std::fill(anomalies.begin(), anomalies.end(), 0);
+    };
+    PipelineStage<AcquiredBlock> analytics(stage_options, [&](const AcquiredBlock* items, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            try {
+                analyze(items[i]);
+            } catch (const std::exception& e) {
+                logger.log(LogLevel::Error, LogTopic::General, "Exception: %s", e.what());
+            }
+        }
+    });
+
+    // Acquisition stage: independent generators, so channels do not inject
+    // anomalies together
+    SamplingScheduler::Options sampling;
+    sampling.period_ns = static_cast<int64_t>(1e9 * static_cast<double>(block) / sample_rate);
+    sampling.realtime_priority = config.realtime_priority;
+    sampling.cpu = config.cpu_affinity;
+    SamplingScheduler scheduler(sampling);
+    std::string sampling_error;
+    if (!scheduler.configureThread(sampling_error)) {
+        std::cerr << "Warning: " << sampling_error << "sampling with default scheduling" << std::endl;
+    }
+    std::random_device seed;
+    std::vector<std::mt19937> gens;
+    std::vector<std::normal_distribution<>> normal_dists(channels, std::normal_distribution<>(0.0, 1.0));
+    for (size_t c = 0; c < channels; ++c) gens.emplace_back(seed());
+    const double anomaly_probability =
+        0.05 / static_cast<double>(std::max<uint64_t>(1, samples_per_upload));
+
+    logger.log(LogLevel::Info, LogTopic::General, "Starting multi-channel vibration loop (%zu channels)...", channels);
+
+    uint64_t dropped = 0;
+    size_t slot = 0;
+    while (true) {
+        SamplingScheduler::Tick tick = scheduler.wait();
+        AcquiredBlock item{slot, tick.index * block, epochMillisNow(), tick.missed, dropped};
+        {
+            StageTimer timer(metrics.stage(Stage::Generate));
+            double* samples = acquired.data() + slot * block * channels;
+            for (size_t i = 0; i < block; ++i) {
+                double t = static_cast<double>(item.first + i) / sample_rate;
+                double* frame = samples + i * channels;
+                for (size_t c = 0; c < channels; ++c) {
+                    frame[c] = simulateVibration(t, anomaly_probability, gens[c], normal_dists[c]);
+                }
+            }
+        }
+        if (analytics.push(item)) {
+            slot = slot + 1 == slots ? 0 : slot + 1;
         } else {
-            // Amplitude spike (imbalance)
-            vibration += 0.5;
-            std::cout << "[FFT ANOMALY] Vibration amplitude spike detected!" << std::endl;
+            ++dropped;
+            metrics.pipeline_dropped.add();
         }
+        metrics.samples.add(block * channels);
+        metrics.samples_missed.add(tick.missed * block * channels);
     }
-    
-    return std::abs(vibration); // Vibration is always positive magnitude
+    return 0;
 }
+} // namespace
 
 int main(int argc, char* argv[]) {
     std::cout << "IoT Vibration Sensor Module - Starting..." << std::endl;
     std::cout << "Features: FFT-based anomaly detection + Local analytics" << std::endl;
 
-    // Load configuration
-    AgentConfig config;
-    
-    // Try to load from file first
-    std::string config_path = "config/agent.json";
-    if (!config.loadFromFile(config_path)) {
-        config.loadFromFile("../config/agent.json");
-    }
-    
-    // Override with environment variables
-    config.loadFromEnv();
-    
-    // Override with command line arguments
-    config.parseArgs(argc, argv);
+    // Load configuration: file, then environment variables, then command
+    // line arguments. The store reloads it on SIGHUP or when the file
+    // changes; config stays the startup snapshot
+    ConfigStore::Options store_options;
+    store_options.argc = argc;
+    store_options.argv = argv;
+    ConfigStore store(store_options);
+    const AgentConfig& config = store.current();
 
     std::cout << "Configuration:" << std::endl;
     std::cout << "  Device ID: " << config.device_id << std::endl;
     std::cout << "  API URL: " << config.api_base_url << std::endl;
     std::cout << "  Interval: " << config.interval_ms << " ms" << std::endl;
 
-    // Initialize HTTP client
-    HttpClient client(config.api_base_url);
+    // Initialize HTTP client (one persistent connection per sender)
+    HttpClientOptions http_options;
+    http_options.http2 = config.http2;
+    http_options.max_in_flight = static_cast<size_t>(std::max(1, config.max_in_flight));
+    http_options.worker_cpu = config.transport_cpu;
+    http_options.max_batch_points = static_cast<size_t>(std::max(1, config.batch_max_points));
+    http_options.max_linger_ms = config.batch_linger_ms;
+    http_options.queue_capacity = static_cast<size_t>(std::max(1, config.queue_capacity));
+    parseOverflowPolicy(config.queue_policy, http_options.overflow_policy);
+    parseWireFormat(config.wire_format, http_options.wire_format);
+    parseCompression(config.compression, http_options.compression);
+    http_options.compression_level = config.compression_level;
+    http_options.compression_min_bytes = static_cast<size_t>(std::max(0, config.compression_min_bytes));
+    http_options.zstd_dictionary_path = config.zstd_dictionary;
+    http_options.spool_dir = config.spool_dir;
+    http_options.spool_max_bytes = static_cast<uint64_t>(std::max(1, config.spool_max_mb)) * 1024 * 1024;
+    http_options.spool_max_age_ms = static_cast<int64_t>(config.spool_max_age_s) * 1000;
+    HttpClient client(config.api_base_url, http_options);
+
+    // Raw points can go over MQTT instead; summaries always use HTTP
+    std::string transport_error;
+    std::unique_ptr<MqttClient> mqtt = makeMqttTransport(config, http_options, transport_error);
+    if (!transport_error.empty()) {
+        std::cerr << "Warning: " << transport_error << ", uploading over HTTP" << std::endl;
+    }
+    Transport& transport = mqtt ? static_cast<Transport&>(*mqtt) : client;
+    if (mqtt) {
+        std::cout << "  Transport: mqtt " << config.mqtt_broker_url << " (QoS " << (config.mqtt_qos > 0 ? 1 : 0)
+                  << ", " << std::max(1, config.mqtt_max_in_flight) << " in flight)" << std::endl;
+    }
+
+    if (config.vibration_channels > 1) {
+        return runMultiChannel(config, store, transport);
+    }
+
+    // Sampling only hands points off; uploads and retries happen on the worker
+    MetricProducer producer = transport.createProducer(config.device_id);
+    if (!config.spool_dir.empty() && !transport.getLastError().empty()) {
+        std::cerr << "Warning: " << transport.getLastError() << ", buffering in memory only" << std::endl;
+    }
+
+    // Sensor: the simulator, or one channel of an IIO device read a block
+    // per syscall; the device may round the requested rate
+    const int interval_ms = std::max(1, config.interval_ms);
+    const size_t block_samples = static_cast<size_t>(std::max(0, config.sensor_block_samples));
+    std::unique_ptr<SensorSource> source;
+    std::string source_name = "simulated";
+    if (config.sensor_source == "iio") {
+        IioSource::Options iio_options;
+        iio_options.device = config.iio_device;
+        iio_options.channel = config.iio_channel;
+        iio_options.sample_rate_hz = std::max(1, config.sample_rate_hz);
+        iio_options.block = block_samples;
+        iio_options.realtime_priority = config.realtime_priority;
+        iio_options.cpu = config.cpu_affinity;
+        auto iio = std::make_unique<IioSource>(iio_options);
+        if (!iio->ok()) {
+            std::cerr << "Error: " << iio->error() << std::endl;
+            return 1;
+        }
+        source_name = "iio " + iio->devicePath() + "/" + config.iio_channel;
+        source = std::move(iio);
+    } else {
+        if (config.sensor_source != "simulated") {
+            std::cerr << "Warning: Unknown sensor_source '" << config.sensor_source << "', simulating" << std::endl;
+        }
+        // Injected anomalies keep the same rate per uploaded point at any sample rate
+        SimulatedVibrationSource::Options simulated;
+        simulated.sample_rate_hz = std::max(1, config.sample_rate_hz);
+        simulated.block = std::max<size_t>(1, block_samples);
+        simulated.anomaly_probability =
+            0.05 / static_cast<double>(std::max<int64_t>(1, static_cast<int64_t>(simulated.sample_rate_hz) *
+                                                                interval_ms / 1000));
+        simulated.realtime_priority = config.realtime_priority;
+        simulated.cpu = config.cpu_affinity;
+        source = std::make_unique<SimulatedVibrationSource>(simulated);
+    }
+
+    // Acquire at sample_rate_hz but upload one point per interval: the
+    // interval's peak, so short spikes survive the decimation
+    const double sample_rate = source->sampleRate();
+    const int sample_rate_hz = std::max(1, static_cast<int>(std::lround(sample_rate)));
+    const uint64_t samples_per_upload =
+        std::max<uint64_t>(1, static_cast<uint64_t>(sample_rate_hz) * static_cast<uint64_t>(interval_ms) / 1000);
+    std::cout << "  Sample rate: " << sample_rate << " Hz (" << samples_per_upload << " samples per upload)"
+              << std::endl;
+    std::cout << "  Sensor: " << source_name << ", " << source->blockSize() << " samples per read" << std::endl;
+
+    // Initialize FFT analyzer (50% overlap between frames)
+    const size_t fft_size = static_cast<size_t>(std::max(8, config.fft_size));
+    FFTAnalyzer fft_analyzer(fft_size, sample_rate, fft_size / 2);
+
+    // Taper and sliding DFT targets; in targets mode frames skip the FFT
+    FFTAnalyzer::SpectrumOptions spectrum_options;
+    if (!parseWindowType(config.fft_window, spectrum_options.window)) {
+        std::cerr << "Warning: Unknown fft_window '" << config.fft_window << "', using rectangular" << std::endl;
+    }
+    if (!parseFrequencyList(config.fft_target_hz, spectrum_options.target_hz)) {
+        std::cerr << "Warning: Invalid fft_target_hz '" << config.fft_target_hz << "', ignored" << std::endl;
+    }
+    if (config.fft_mode == "targets") {
+        spectrum_options.targets_only = true;
+        if (spectrum_options.target_hz.empty()) {
+            for (int h = 1; h <= 3; ++h) spectrum_options.target_hz.push_back(h * config.shaft_hz);
+        }
+    } else if (config.fft_mode != "fft") {
+        std::cerr << "Warning: Unknown fft_mode '" << config.fft_mode << "', using fft" << std::endl;
+    }
+    fft_analyzer.configureSpectrum(spectrum_options);
+    std::cout << "  Spectrum: " << (fft_analyzer.targetsOnly() ? "targets" : "fft") << ", "
+              << windowTypeName(fft_analyzer.windowType()) << " window";
+    if (!fft_analyzer.result().target_hz.empty()) {
+        std::cout << ", sliding DFT at";
+        for (double hz : fft_analyzer.result().target_hz) {
+            char text[32];
+            std::snprintf(text, sizeof(text), " %.1f", hz);
+            std::cout << text;
+        }
+        std::cout << " Hz";
+    }
+    std::cout << std::endl;
+
+    // Feature stage: band powers at the shaft harmonics (or explicit bands),
+    // an optional envelope spectrum, and the limits behind FFT verdicts
+    SpectralFeatureExtractor::Options feature_options;
+    feature_options.bands = SpectralFeatureExtractor::harmonicBands(config.shaft_hz);
+    if (!config.feature_bands_hz.empty() && !parseFeatureBands(config.feature_bands_hz, feature_options.bands)) {
+        std::cerr << "Warning: Invalid feature_bands_hz '" << config.feature_bands_hz << "', using shaft harmonics"
+                  << std::endl;
+    }
+    std::vector<FeatureBand> envelope_band;
+    if (!config.envelope_band_hz.empty()) {
+        if (parseFeatureBands(config.envelope_band_hz, envelope_band) && envelope_band.size() == 1) {
+            feature_options.envelope = envelope_band[0];
+        } else {
+            std::cerr << "Warning: Invalid envelope_band_hz '" << config.envelope_band_hz
+                      << "', envelope spectrum off" << std::endl;
+        }
+    }
+    if (!parseFrequencyList(config.bearing_defect_hz, feature_options.defect_hz)) {
+        std::cerr << "Warning: Invalid bearing_defect_hz '" << config.bearing_defect_hz << "', ignored" << std::endl;
+    }
+    FeatureLimits feature_limits;
+    feature_limits.crest_factor = config.fft_crest_limit;
+    feature_limits.kurtosis = config.fft_kurtosis_limit;
+    fft_analyzer.configureFeatures(feature_options, feature_limits);
+    std::cout << "  Features: ";
+    if (fft_analyzer.targetsOnly()) {
+        std::cout << "time-domain only";
+    } else if (feature_options.envelope.empty()) {
+        std::cout << std::min(feature_options.bands.size(), kMaxFeatureBands) << " bands, envelope off";
+    } else {
+        std::cout << std::min(feature_options.bands.size(), kMaxFeatureBands) << " bands, envelope "
+                  << feature_options.envelope.low_hz << "-" << feature_options.envelope.high_hz << " Hz";
+    }
+    std::cout << ", anomaly above crest " << feature_limits.crest_factor << " / kurtosis " << feature_limits.kurtosis
+              << std::endl;
 
-    // Initialize FFT analyzer (1000 Hz sample rate)
-    FFTAnalyzer fft_analyzer(256, 1000.0);
+    // Spectrum baseline: frames are also flagged when bins leave their
+    // learned levels; a saved baseline lets a restart skip the warmup
+    std::string baseline_path;
+    bool baseline_warm = false;
+    if (config.fft_baseline && !fft_analyzer.targetsOnly()) {
+        BaselineOptions baseline_options = baselineOptions(config);
+        fft_analyzer.configureBaseline(baseline_options);
+        SpectralBaseline& baseline = *fft_analyzer.baseline();
+
+        bool restored = false;
+        if (!config.baseline_dir.empty()) {
+            std::error_code ec;
+            std::filesystem::create_directories(config.baseline_dir, ec);
+            baseline_path = baselinePath(config.baseline_dir, config.device_id);
+            std::string error;
+            restored = baseline.load(baseline_path, error);
+            if (!error.empty()) std::cerr << "Warning: " << error << std::endl;
+        }
+        baseline_warm = baseline.warm(0);
+        std::cout << "  Baseline: ";
+        if (restored) {
+            std::cout << "restored " << baseline.frames(0) << " frames from " << baseline_path;
+        } else {
+            std::cout << "learning " << baseline_options.warmup_frames << " frames";
+        }
+        std::cout << ", anomaly at " << baseline_options.min_bins << "+ bins beyond " << baseline_options.z_limit
+                  << " sigma" << std::endl;
+    }
+    const int64_t baseline_save_ms = static_cast<int64_t>(std::max(1, config.baseline_save_s)) * 1000;
+    int64_t baseline_saved_ms = epochMillisNow();
     
     // Initialize local analytics
-    LocalAnalytics local_analytics(200, 3.0);
+    LocalAnalytics local_analytics(200, 3.0, metricBit(MetricId::Vibration));
+
+    // Aggregate mode: every sample goes into a per-interval summary (with
+    // FFT band energies) instead of one peak per upload interval; raw
+    // samples only around strong local anomalies
+    ReductionMode reduction = ReductionMode::Raw;
+    if (!parseReductionMode(config.reduction, reduction)) {
+        std::cerr << "Warning: Unknown reduction '" << config.reduction << "', uploading interval peaks" << std::endl;
+    }
+    std::unique_ptr<IntervalReducer> reducer;
+    std::unique_ptr<SummaryUploader> summaries;
+    if (reduction == ReductionMode::Aggregate) {
+        IntervalReducer::Options reducer_options;
+        reducer_options.interval_ms = std::max(1, config.reduction_interval_ms);
+        reducer_options.pre_samples =
+            static_cast<size_t>(static_cast<int64_t>(std::max(0, config.anomaly_pre_ms)) * sample_rate_hz / 1000);
+        reducer_options.post_samples =
+            static_cast<size_t>(static_cast<int64_t>(std::max(0, config.anomaly_post_ms)) * sample_rate_hz / 1000);
+        reducer_options.expected_samples =
+            static_cast<size_t>(reducer_options.interval_ms * sample_rate_hz / 1000 + 1);
+        reducer_options.metrics = metricBit(MetricId::Vibration);
+        reducer = std::make_unique<IntervalReducer>(reducer_options);
 
-    // Random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<> normal_dist(0.0, 1.0);
-    std::uniform_int_distribution<> jitter_dist(-config.jitter_ms, config.jitter_ms);
+        SummaryUploader::Options uploader_options;
+        uploader_options.device_id = config.device_id;
+        uploader_options.cpu = config.transport_cpu;
+        summaries = std::make_unique<SummaryUploader>(client, uploader_options);
+        std::cout << "  Reduction: aggregate every " << reducer_options.interval_ms << " ms, raw "
+                  << reducer_options.pre_samples << "+" << reducer_options.post_samples
+                  << " samples around anomalies (|z| >= " << config.anomaly_trigger_z << ")" << std::endl;
+    }
 
-    // Time tracking
-    auto start_time = std::chrono::steady_clock::now();
-    double t = 0.0;
+    AsyncLogger& logger = AsyncLogger::global();
+    AgentMetrics& metrics = AgentMetrics::global();
 
-    // Retry configuration
-    const int max_retries = 3;
-    const int retry_delay_ms = 1000;
+    // Per-upload interval aggregates, owned by the analytics stage
+    uint64_t interval_samples = 0;
+    double peak = 0.0;
+    int64_t peak_ms = 0;
+    double peak_z = 0.0;
+    uint64_t fft_frames = 0;
+    uint64_t fft_anomalies = 0;
+    uint64_t local_anomalies = 0;
+    int64_t max_late_ns = 0;
+    uint64_t missed_total = 0;
+    uint64_t missed_reported = 0;
+    uint64_t dropped_reported = 0;
+    uint64_t config_version = store.version();
+    double trigger_z = config.anomaly_trigger_z;
 
-    std::cout << "Starting vibration monitoring loop..." << std::endl;
-    std::cout << "FFT window: 256 samples, Local analytics window: 200 samples" << std::endl;
+    // Analytics stage: FFT, local analytics, console report and hand-off to
+    // the upload worker (which encodes and sends). With pipeline_threads it
+    // runs on its own thread, so nothing here can delay the next sample
+    struct Acquired {
+        double vibration;
+        int64_t ts_ms;            // Acquisition time
+        int64_t late_ns;          // Wake-up lateness of this sample
+        uint64_t missed;          // Samples skipped right before this one
+        uint64_t dropped;         // Samples the analytics stage had no room for, so far
+        SimulatedAnomaly injected;
+    };
+    // Reads are due once per block; waking late matters beyond half of that
+    const int64_t period_ns = static_cast<int64_t>(1e9 * static_cast<double>(source->blockSize()) / sample_rate);
+    auto analyze = [&](const Acquired& sample) {
+        // Live settings of a reloaded config; only a version check per sample
+        uint64_t version = store.version();
+        if (version != config_version) {
+            config_version = version;
+            const AgentConfig& live = store.current();
+            FeatureLimits limits;
+            limits.crest_factor = live.fft_crest_limit;
+            limits.kurtosis = live.fft_kurtosis_limit;
+            fft_analyzer.setFeatureLimits(limits);
+            trigger_z = live.anomaly_trigger_z;
+        }
 
-    while (true) {
-        try {
-            // Generate vibration signal
-            double vibration = generateVibrationSignal(t, gen, normal_dist);
-
-            // Add to FFT analyzer
-            bool fft_anomaly = fft_analyzer.addSample(vibration);
-
-            // Update local analytics
-            bool local_anomaly = local_analytics.updateMetric("vibration", vibration);
-            
-            // Get z-score from local analytics
-            double z_score = local_analytics.getZScore("vibration", vibration);
-            auto stats = local_analytics.getStats("vibration");
-
-            // Print metrics with analytics
-            std::cout << "[" << getCurrentTimestamp() << "] "
-                      << "Vib: " << std::fixed << std::setprecision(4) << vibration << "g, "
-                      << "Z-score: " << std::setprecision(2) << z_score << ", "
-                      << "Mean: " << stats.mean << ", "
-                      << "StdDev: " << stats.stddev;
-
-            // Anomaly flags
-            if (fft_anomaly || local_anomaly) {
-                std::cout << " [ANOMALY";
-                if (fft_anomaly) std::cout << " FFT";
-                if (local_anomaly) std::cout << " LOCAL";
-                std::cout << "]";
-            }
-            std::cout << std::endl;
-
-            // Perform FFT analysis periodically (every 256 samples)
-            if (fft_analyzer.getSamples().size() >= 256) {
-                auto fd = fft_analyzer.analyze();
-                std::cout << "  [FFT] Dominant freq: " << std::fixed << std::setprecision(2) 
-                          << fd.dominant_freq << " Hz, "
-                          << "Total power: " << fd.total_power << std::endl;
-            }
-
-            // Create metric point (vibration sensor only sends vibration)
-            MetricPoint point;
-            point.ts = getCurrentTimestamp();
-            point.temperature_c = 0.0; // Not measured by vibration sensor
-            point.vibration_g = vibration;
-            point.humidity_pct = 0.0; // Not measured
-            point.voltage_v = 0.0; // Not measured
-
-            // Add anomaly flags to metric (could be sent as metadata)
-            // For now, we'll send the metric and let backend detect anomalies too
-
-            // Send metrics with retry logic
-            std::vector<MetricPoint> metrics = {point};
-            bool success = false;
-
-            for (int retry = 0; retry < max_retries; retry++) {
-                if (client.postMetrics(config.device_id, metrics)) {
-                    success = true;
-                    break;
+        double vibration = sample.vibration;
+        max_late_ns = std::max(max_late_ns, sample.late_ns);
+        missed_total += sample.missed;
+        if (sample.injected == SimulatedAnomaly::Resonance) {
+            logger.log(LogLevel::Info, LogTopic::Anomaly, "[FFT ANOMALY] High-frequency resonance detected!");
+        } else if (sample.injected == SimulatedAnomaly::VibrationSpike) {
+            logger.log(LogLevel::Info, LogTopic::Anomaly, "[FFT ANOMALY] Vibration amplitude spike detected!");
+        }
+
+        // Add to FFT analyzer; the result is cached until the next frame,
+        // so only calls that ran a transform count as FFT time
+        uint64_t fft_start_ns = monotonicNowNs();
+        const auto& fft = fft_analyzer.process(vibration);
+        if (fft.fresh) metrics.stage(Stage::Fft).record(monotonicNowNs() - fft_start_ns);
+        fft_frames += fft.fresh;
+        fft_anomalies += fft.fresh && fft.anomaly;
+
+        // Save the baseline as soon as it is learned, then periodically; a
+        // re-learn is saved right away so a restart does not bring back the
+        // baseline it gave up on
+        SpectralBaseline* baseline = fft_analyzer.baseline();
+        if (baseline && fft.fresh) {
+            if (fft.baseline_relearned) {
+                baseline_warm = false;
+                logger.log(LogLevel::Warn, LogTopic::General,
+                           "Spectrum off its baseline for %zu frames in a row, re-learning it",
+                           baseline->options().relearn_frames);
+                std::string error;
+                if (!baseline_path.empty() && !baseline->save(baseline_path, error)) {
+                    logger.log(LogLevel::Warn, LogTopic::General, "%s", error.c_str());
+                }
+            }
+            if (!baseline_warm && baseline->warm(0)) {
+                baseline_warm = true;
+                baseline_saved_ms = sample.ts_ms - baseline_save_ms;
+                logger.log(LogLevel::Info, LogTopic::General, "Spectrum baseline learned (%llu frames)",
+                           static_cast<unsigned long long>(baseline->frames(0)));
+            }
+            if (baseline_warm && !baseline_path.empty() && sample.ts_ms - baseline_saved_ms >= baseline_save_ms) {
+                std::string error;
+                if (!baseline->save(baseline_path, error)) {
+                    logger.log(LogLevel::Warn, LogTopic::General, "%s", error.c_str());
+                }
+                baseline_saved_ms = sample.ts_ms;
+            }
+        }
+
+        // Update local analytics
+        bool local_anomaly;
+        {
+            StageTimer timer(metrics.stage(Stage::Analytics));
+            local_anomaly = local_analytics.updateMetric(MetricId::Vibration, vibration);
+        }
+        local_anomalies += local_anomaly;
+
+        // Aggregate mode: fold the sample (and any new frame) into the summary
+        if (reducer) {
+            if (reducer->due(sample.ts_ms) && !summaries->push(reducer->close())) {
+                logger.log(LogLevel::Warn, LogTopic::Upload, "Summary upload fell behind, dropped an interval");
+            }
+            if (fft.fresh && !fft_analyzer.targetsOnly() && fft.spectrum.frequencies.size() > 1) {
+                reducer->addSpectrum(fft.spectrum.magnitudes.data(), fft.spectrum.magnitudes.size(),
+                                     fft.spectrum.frequencies[1]);
+            }
+            if (fft.fresh) reducer->addFeatures(fft.features);
+            MetricPoint raw{};
+            raw.ts_ms = sample.ts_ms;
+            raw.vibration_g = vibration;
+            bool trigger = local_anomaly &&
+                           local_analytics.getZScore(MetricId::Vibration, vibration) >= trigger_z;
+            reducer->add(raw, trigger, [&producer](const MetricPoint& point) { producer.push(point); });
+        }
+        if (interval_samples == 0 || vibration > peak) {
+            peak = vibration;
+            peak_ms = sample.ts_ms;
+            peak_z = local_analytics.getZScore(MetricId::Vibration, vibration);
+        }
+        // Skipped samples still count, so uploads stay one per interval
+        interval_samples += 1 + sample.missed;
+        if (interval_samples < samples_per_upload) return;
+
+        // Print the interval with analytics; the logger adds the timestamp
+        if (logger.enabled(LogLevel::Info)) {
+            // Anomaly flags, with how many frames / samples raised them
+            char flags[96] = "";
+            if (fft_anomalies > 0 || local_anomalies > 0) {
+                char fft_flag[48] = "";
+                char local_flag[32] = "";
+                if (fft_anomalies > 0) {
+                    std::snprintf(fft_flag, sizeof(fft_flag), " FFT %llu/%llu",
+                                  static_cast<unsigned long long>(fft_anomalies),
+                                  static_cast<unsigned long long>(fft_frames));
                 }
+                if (local_anomalies > 0) {
+                    std::snprintf(local_flag, sizeof(local_flag), " LOCAL %llu",
+                                  static_cast<unsigned long long>(local_anomalies));
+                }
+                std::snprintf(flags, sizeof(flags), " [ANOMALY%s%s]", fft_flag, local_flag);
+            }
+            const auto& stats = local_analytics.getStats(MetricId::Vibration);
+            logger.logAt(peak_ms, LogLevel::Info, LogTopic::Sample,
+                         "Vib peak: %.4fg, Z-score: %.2f, Mean: %.2f, StdDev: %.2f%s", peak, peak_z, stats.mean,
+                         stats.stddev, flags);
 
-                if (retry < max_retries - 1) {
-                    std::cerr << "Warning: Failed to send metrics (attempt " << (retry + 1) << "/" << max_retries << "): "
-                              << client.getLastError() << std::endl;
-                    std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay_ms * (retry + 1)));
+            // Latest analyzed frame (every 128 samples once the window is full)
+            if (fft_frames > 0) {
+                const SpectralFeatures& f = fft.features;
+                if (fft_analyzer.targetsOnly()) {
+                    logger.log(LogLevel::Info, LogTopic::Sample, "  [FFT] RMS: %.4fg, Crest: %.2f, Kurtosis: %.2f",
+                               f.rms, f.crest_factor, f.kurtosis);
+                } else {
+                    logger.log(LogLevel::Info, LogTopic::Sample,
+                               "  [FFT] Dominant: %.1f Hz, Centroid: %.1f Hz, RMS: %.4fg, Crest: %.2f, Kurtosis: %.2f",
+                               f.dominant_hz, f.centroid_hz, f.rms, f.crest_factor, f.kurtosis);
+                }
+                if (!fft.target_hz.empty()) {
+                    char targets[160] = "";
+                    size_t used = 0;
+                    for (size_t i = 0; i < fft.target_hz.size() && used < sizeof(targets); ++i) {
+                        int n = std::snprintf(targets + used, sizeof(targets) - used, "%s%.1f Hz: %.4fg",
+                                              i > 0 ? ", " : "", fft.target_hz[i], fft.target_amplitude[i]);
+                        if (n < 0) break;
+                        used += static_cast<size_t>(n);
+                    }
+                    logger.log(LogLevel::Info, LogTopic::Sample, "  [SDFT] %s", targets);
+                }
+                if (f.envelope_peak_hz > 0.0) {
+                    logger.log(LogLevel::Info, LogTopic::Sample, "  [ENV] Peak: %.1f Hz (%.4fg)",
+                               f.envelope_peak_hz, f.envelope_peak);
                 }
             }
+        }
+        if (missed_total > missed_reported || max_late_ns > period_ns / 2) {
+            logger.log(LogLevel::Warn, LogTopic::Timing, "Sampling jitter up to %lld us, %llu samples missed (%llu total)",
+                       static_cast<long long>(max_late_ns / 1000),
+                       static_cast<unsigned long long>(missed_total - missed_reported),
+                       static_cast<unsigned long long>(missed_total));
+            missed_reported = missed_total;
+        }
+        if (sample.dropped > dropped_reported) {
+            logger.log(LogLevel::Warn, LogTopic::Timing, "Analytics fell behind, dropped %llu samples",
+                       static_cast<unsigned long long>(sample.dropped - dropped_reported));
+            dropped_reported = sample.dropped;
+        }
+
+        // Create metric point (vibration sensor only sends vibration)
+        MetricPoint point;
+        point.ts_ms = peak_ms;
+        point.temperature_c = 0.0; // Not measured by vibration sensor
+        point.vibration_g = peak;
+        point.humidity_pct = 0.0; // Not measured
+        point.voltage_v = 0.0; // Not measured
+
+        // Add anomaly flags to metric (could be sent as metadata)
+        // For now, we'll send the metric and let backend detect anomalies too
 
-            if (!success) {
-                std::cerr << "Error: Failed to send metrics after " << max_retries << " attempts: "
-                          << client.getLastError() << std::endl;
+        // Queue for upload; with a spool the point is on disk until acknowledged.
+        // Aggregate mode already covers the interval in its summary
+        if (!reducer && !producer.push(point)) {
+            logger.log(LogLevel::Warn, LogTopic::Upload, "Upload buffer full, dropped point (%llu dropped so far)",
+                       static_cast<unsigned long long>(producer.dropped()));
+        }
+
+        interval_samples = 0;
+        fft_frames = 0;
+        fft_anomalies = 0;
+        local_anomalies = 0;
+        max_late_ns = 0;
+    };
+    PipelineStage<Acquired>::Options stage_options;
+    stage_options.name = "analytics";
+    stage_options.threaded = config.pipeline_threads;
+    stage_options.cpu = config.analytics_cpu;
+    stage_options.capacity = std::max<size_t>(4096, static_cast<size_t>(sample_rate_hz)); // ~1 s of samples
+    stage_options.batch = 256;
+    PipelineStage<Acquired> analytics(stage_options, [&](const Acquired* samples, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            try {
+                analyze(samples[i]);
+            } catch (const std::exception& e) {
+                logger.log(LogLevel::Error, LogTopic::General, "Exception: %s", e.what());
             }
+        }
+    });
+
+    // Acquisition stage: the simulator samples on absolute deadlines with
+    // no jitter, since the FFT assumes evenly spaced samples; a device is
+    // clocked by its own trigger
+    std::string sampling_error;
+    if (!source->configureThread(sampling_error)) {
+        std::cerr << "Warning: " << sampling_error << "sampling with default scheduling" << std::endl;
+    }
 
-            // Calculate sleep time with jitter
-            int sleep_ms = config.interval_ms + jitter_dist(gen);
-            sleep_ms = std::max(100, sleep_ms); // Minimum 100ms
+    // Reloads publish a new snapshot; the analytics stage picks up its
+    // limits, the logger filter is applied by the reload handler
+    const std::vector<std::string> live_keys = {"anomaly_trigger_z", "fft_crest_limit", "fft_kurtosis_limit",
+                                                "log_level",         "log_quiet",       "log_sample_per_s",
+                                                "log_anomaly_per_s"};
+    std::unique_ptr<MetricsExporter> exporter = startServices(config, store, live_keys);
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+    logger.log(LogLevel::Info, LogTopic::General, "Starting vibration monitoring loop...");
+    logger.log(LogLevel::Info, LogTopic::General, "FFT window: %zu samples (hop %zu), Local analytics window: 200 samples",
+               fft_size, fft_size / 2);
 
-            // Update time
-            auto current_time = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                current_time - start_time).count();
-            t = elapsed / 1000.0; // Convert to seconds
+    uint64_t dropped = 0;
+    SampleBlock block;
+    std::string read_error;
+    while (true) {
+        if (!source->read(block, read_error)) {
+            logger.log(LogLevel::Warn, LogTopic::Timing, "Sensor read failed: %s", read_error.c_str());
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
 
-        } catch (const std::exception& e) {
-            std::cerr << "Exception: " << e.what() << std::endl;
-            std::this_thread::sleep_for(std::chrono::milliseconds(config.interval_ms));
+        // Fan the block out to the analytics stage, each sample stamped at
+        // its acquisition time
+        for (size_t i = 0; i < block.count; ++i) {
+            Acquired sample;
+            sample.vibration = block.values[i];
+            sample.ts_ms = block.timestampMs(i, sample_rate);
+            sample.late_ns = i == 0 ? block.late_ns : 0;
+            sample.missed = i == 0 ? block.missed : 0;
+            sample.dropped = dropped;
+            sample.injected = block.injected ? block.injected[i] : SimulatedAnomaly::None;
+            if (!analytics.push(sample)) {
+                ++dropped;
+                metrics.pipeline_dropped.add();
+            }
         }
+        metrics.samples.add(block.count);
+        metrics.samples_missed.add(block.missed);
     }
 
     return 0;
@@ -0,0 +1,69 @@
+#include "local_analytics.hpp"
+#include "rolling_window.hpp"
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+                         __LINE__, #cond);                             \
+            ++failures;                                                \
+        }                                                              \
+    } while (0)
+
+// A NaN reading must not end up in the sorted window: evicting it would
+// erase the smallest real sample instead and leave the NaN behind
+static void nanIsDroppedFromLocalAnalytics() {
+    const size_t window = 9;
+    LocalAnalytics analytics(window);
+    for (int i = 1; i <= 9; ++i) analytics.updateMetric(MetricId::Vibration, i);
+    CHECK(analytics.getStats(MetricId::Vibration).median == 5.0);
+
+    CHECK(!analytics.updateMetric(MetricId::Vibration, std::nan("")));
+    CHECK(analytics.nonFiniteCount(MetricId::Vibration) == 1);
+
+    // Every window from here on holds the last nine real samples, across
+    // and well past the point where the NaN would have been evicted
+    for (int i = 10; i <= 40; ++i) {
+        analytics.updateMetric(MetricId::Vibration, i);
+        const LocalAnalytics::Stats& stats = analytics.getStats(MetricId::Vibration);
+        CHECK(stats.count == window);
+        CHECK(stats.median == i - 4);
+        CHECK(stats.min == i - 8);
+        CHECK(stats.max == i);
+        CHECK(stats.mad == 2.0);
+        CHECK(std::abs(stats.mean - (i - 4)) < 1e-9);
+    }
+}
+
+static void infinityIsDropped() {
+    LocalAnalytics analytics(5);
+    for (int i = 1; i <= 5; ++i) analytics.updateMetric(MetricId::Humidity, i);
+    CHECK(!analytics.updateMetric(MetricId::Humidity, std::numeric_limits<double>::infinity()));
+    CHECK(!analytics.updateMetric(MetricId::Humidity, -std::numeric_limits<double>::infinity()));
+    CHECK(analytics.nonFiniteCount(MetricId::Humidity) == 2);
+    CHECK(analytics.getStats(MetricId::Humidity).max == 5.0);
+}
+
+static void nanIsDroppedFromRollingWindow() {
+    RollingWindow w(5);
+    for (int i = 1; i <= 5; ++i) w.push(i);
+    w.push(std::nan(""));
+    CHECK(w.size() == 5);
+    for (int i = 6; i <= 10; ++i) w.push(i);
+    CHECK(w.median() == 8.0);
+    CHECK(w.min() == 6.0);
+    CHECK(w.max() == 10.0);
+}
+
+int main() {
+    nanIsDroppedFromLocalAnalytics();
+    infinityIsDropped();
+    nanIsDroppedFromRollingWindow();
+    if (failures == 0) std::printf("analytics_test: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
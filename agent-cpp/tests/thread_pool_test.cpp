@@ -0,0 +1,62 @@
+#include "thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+                         __LINE__, #cond);                             \
+            ++failures;                                                \
+        }                                                              \
+    } while (0)
+
+// Covers every index exactly once across workers and the caller
+static void coversRange() {
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallelFor(hits.size(), 7, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) hits[i].fetch_add(1);
+    });
+    bool once = true;
+    for (const auto& h : hits) once = once && h.load() == 1;
+    CHECK(once);
+}
+
+// A throw on a worker or on the caller reaches the caller, and the pool
+// stays usable. Chunks are slow enough that every thread claims some.
+static void rethrowsOnCaller() {
+    ThreadPool pool(3);
+    const size_t caller_slot = pool.concurrency() - 1;
+    for (size_t thrower : {size_t(0), size_t(2), caller_slot}) {
+        bool caught = false;
+        try {
+            pool.parallelFor(200, 1, [&](size_t slot, size_t, size_t) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                if (slot == thrower) throw std::runtime_error("chunk failed");
+            });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        CHECK(caught);
+    }
+
+    std::atomic<size_t> sum{0};
+    pool.parallelFor(100, 1, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) sum += i;
+    });
+    CHECK(sum == 4950);
+}
+
+int main() {
+    coversRange();
+    rethrowsOnCaller();
+    if (failures == 0) std::printf("thread_pool_test: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+-- CreateTable
+CREATE TABLE "metric_summaries" (
+    "id" TEXT NOT NULL,
+    "deviceId" TEXT NOT NULL,
+    "tsStart" TIMESTAMP(3) NOT NULL,
+    "tsEnd" TIMESTAMP(3) NOT NULL,
+    "count" INTEGER NOT NULL,
+    "anomalies" INTEGER NOT NULL DEFAULT 0,
+    "rawPoints" INTEGER NOT NULL DEFAULT 0,
+    "stats" JSONB NOT NULL,
+    "spectrum" JSONB,
+
+    CONSTRAINT "metric_summaries_pkey" PRIMARY KEY ("id")
+);
+
+-- CreateIndex
+CREATE INDEX "metric_summaries_deviceId_tsStart_idx" ON "metric_summaries"("deviceId", "tsStart");
+
+-- AddForeignKey
+ALTER TABLE "metric_summaries" ADD CONSTRAINT "metric_summaries_deviceId_fkey" FOREIGN KEY ("deviceId") REFERENCES "devices"("id") ON DELETE CASCADE ON UPDATE CASCADE;
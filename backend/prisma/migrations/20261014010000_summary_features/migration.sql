@@ -0,0 +1,2 @@
+-- AlterTable
+ALTER TABLE "metric_summaries" ADD COLUMN "features" JSONB;
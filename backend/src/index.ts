@@ -12,6 +12,7 @@ import { initializeSocketIO, getIOServer } from './realtime';
 import { initializeMQTTBridge } from './mqtt/bridge';
 import { initializeJobs } from './jobs/cleanup';
 import { logger } from './utils/logger';
+import { zstdDecompression } from './middleware/decompress';
 import ingestRouter from './routes/ingest';
 import devicesRouter from './routes/devices';
 import metricsRouter from './routes/metrics';
@@ -24,6 +25,7 @@ const prisma = new PrismaClient();
 
 // Middleware
 app.use(cors());
+app.use(zstdDecompression);
 app.use(express.json());
 
 // Initialize Socket.IO
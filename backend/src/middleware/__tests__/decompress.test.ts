@@ -0,0 +1,43 @@
+/**
+ * Tests for zstd request decompression
+ */
+
+import zlib from 'zlib';
+import request from 'supertest';
+import express from 'express';
+import { zstdDecompression } from '../decompress';
+
+const app = express();
+app.use(zstdDecompression);
+app.use(express.json());
+app.post('/echo', (req, res) => res.json(req.body));
+
+type ZstdCompressSync = (buffer: Buffer) => Buffer;
+const zstdCompressSync = (zlib as unknown as { zstdCompressSync?: ZstdCompressSync }).zstdCompressSync;
+
+describe('zstdDecompression', () => {
+  it('should pass through uncompressed JSON', async () => {
+    const response = await request(app).post('/echo').send({ deviceId: 'd1' });
+
+    expect(response.status).toBe(200);
+    expect(response.body).toEqual({ deviceId: 'd1' });
+  });
+
+  it('should decode zstd JSON bodies or answer 415 when zstd is unavailable', async () => {
+    const json = Buffer.from(JSON.stringify({ deviceId: 'd1', metrics: [] }));
+    const body = zstdCompressSync ? zstdCompressSync(json) : json;
+
+    const response = await request(app)
+      .post('/echo')
+      .set('Content-Type', 'application/json')
+      .set('Content-Encoding', 'zstd')
+      .send(body);
+
+    if (zstdCompressSync) {
+      expect(response.status).toBe(200);
+      expect(response.body).toEqual({ deviceId: 'd1', metrics: [] });
+    } else {
+      expect(response.status).toBe(415);
+    }
+  });
+});
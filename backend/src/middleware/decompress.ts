@@ -0,0 +1,107 @@
+import zlib from 'zlib';
+import fs from 'fs';
+import { Request, Response, NextFunction } from 'express';
+import { logger } from '../utils/logger';
+import { COLUMNAR_CONTENT_TYPE } from '../utils/columnar';
+
+const MAX_COMPRESSED_BYTES = 5 * 1024 * 1024;
+const MAX_DECOMPRESSED_BYTES = 20 * 1024 * 1024;
+
+type ZstdDecompressSync = (
+    buffer: Buffer,
+    options?: { maxOutputLength?: number; dictionary?: Buffer }
+) => Buffer;
+
+// node:zlib gained zstd in Node 22.15 / 23.8; older runtimes answer 415,
+// which makes agents fall back to gzip (handled by body-parser itself)
+const zstdDecompressSync = (zlib as unknown as { zstdDecompressSync?: ZstdDecompressSync })
+    .zstdDecompressSync;
+
+let dictionary: Buffer | null | undefined;
+
+/**
+ * Shared dictionary the agents compress with (INGEST_ZSTD_DICTIONARY path)
+ */
+function zstdDictionary(): Buffer | null {
+    if (dictionary === undefined) {
+        const path = process.env.INGEST_ZSTD_DICTIONARY;
+        dictionary = null;
+        if (path) {
+            try {
+                dictionary = fs.readFileSync(path);
+            } catch (error) {
+                logger.error(`Could not read zstd dictionary ${path}:`, error);
+            }
+        }
+    }
+    return dictionary;
+}
+
+const unsupported = (res: Response, message: string) =>
+    res.status(415).json({ error: 'Unsupported Media Type', message });
+
+/**
+ * Decodes Content-Encoding: zstd request bodies
+ *
+ * body-parser inflates gzip/deflate on its own but rejects other encodings,
+ * so this runs before it and hands over an already-parsed body.
+ */
+export const zstdDecompression = (req: Request, res: Response, next: NextFunction) => {
+    const encoding = req.header('Content-Encoding');
+    if (!encoding || encoding.trim().toLowerCase() !== 'zstd') {
+        return next();
+    }
+    if (!zstdDecompressSync) {
+        return unsupported(res, 'zstd Content-Encoding is not supported by this server');
+    }
+
+    const chunks: Buffer[] = [];
+    let size = 0;
+    let tooLarge = false;
+
+    req.on('data', (chunk: Buffer) => {
+        size += chunk.length;
+        if (size > MAX_COMPRESSED_BYTES) {
+            tooLarge = true;
+            return;
+        }
+        chunks.push(chunk);
+    });
+
+    req.on('error', next);
+
+    req.on('end', () => {
+        if (tooLarge) {
+            return res.status(413).json({ error: 'Payload too large' });
+        }
+
+        let body: Buffer;
+        try {
+            const dict = zstdDictionary();
+            body = zstdDecompressSync(Buffer.concat(chunks), {
+                maxOutputLength: MAX_DECOMPRESSED_BYTES,
+                ...(dict ? { dictionary: dict } : {}),
+            });
+        } catch (error) {
+            logger.warn('Could not decode zstd request body', { error });
+            return unsupported(res, 'Could not decode zstd body');
+        }
+
+        delete req.headers['content-encoding'];
+        if (req.is(COLUMNAR_CONTENT_TYPE)) {
+            req.body = body;
+        } else if (req.is('application/json')) {
+            try {
+                req.body = JSON.parse(body.toString('utf8'));
+            } catch {
+                return res.status(400).json({ error: 'Invalid JSON body' });
+            }
+        } else {
+            return unsupported(res, 'Unsupported content type for zstd body');
+        }
+
+        // body-parser skips requests that are already parsed
+        (req as Request & { _body?: boolean })._body = true;
+        next();
+    });
+};
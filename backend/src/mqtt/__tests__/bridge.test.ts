@@ -0,0 +1,59 @@
+/**
+ * Tests for MQTT bridge payload parsing
+ */
+
+import { parsePayload } from '../bridge';
+
+// agent-cpp columnar batch of one point without a timestamp
+const COLUMNAR = Buffer.from(
+  '494f544301000164013ff0000000000000400000000000000040080000000000004010000000000000',
+  'hex'
+);
+
+const POINT = {
+  temperature_c: 22.5,
+  vibration_g: 0.02,
+  humidity_pct: 45.0,
+  voltage_v: 4.9,
+};
+
+describe('parsePayload', () => {
+  it('should accept a single agent-c point', () => {
+    const message = Buffer.from(JSON.stringify({ ts: '2025-10-09T08:53:20Z', ...POINT }));
+
+    expect(parsePayload(message)).toEqual([{ ts: '2025-10-09T08:53:20Z', ...POINT }]);
+  });
+
+  it('should reject a single point without a timestamp', () => {
+    expect(parsePayload(Buffer.from(JSON.stringify(POINT)))).toBeNull();
+  });
+
+  it('should accept a JSON batch', () => {
+    const message = Buffer.from(
+      JSON.stringify({ deviceId: 'dev-1', metrics: [POINT, { ts: '2025-10-09T08:53:21Z', ...POINT }] })
+    );
+
+    const points = parsePayload(message);
+    expect(points).toHaveLength(2);
+    expect(points![1].ts).toBe('2025-10-09T08:53:21Z');
+  });
+
+  it('should reject a batch with a malformed point', () => {
+    const message = Buffer.from(
+      JSON.stringify({ deviceId: 'dev-1', metrics: [POINT, { ...POINT, voltage_v: 'high' }] })
+    );
+
+    expect(parsePayload(message)).toBeNull();
+  });
+
+  it('should decode a columnar batch', () => {
+    const points = parsePayload(COLUMNAR);
+
+    expect(points).toEqual([{ temperature_c: 1, vibration_g: 2, humidity_pct: 3, voltage_v: 4 }]);
+  });
+
+  it('should reject invalid JSON and truncated columnar payloads', () => {
+    expect(parsePayload(Buffer.from('{not json'))).toBeNull();
+    expect(parsePayload(COLUMNAR.subarray(0, 8))).toBeNull();
+  });
+});
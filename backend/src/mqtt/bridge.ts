@@ -10,6 +10,7 @@ import { logger } from '../utils/logger';
 import { scoreBatch, checkHealth } from '../anomaly/pyservice';
 import { createAnomalyEngine } from '../anomaly';
 import { getIOServer } from '../realtime';
+import { decodeColumnar } from '../utils/columnar';
 
 const MQTT_ENABLE = process.env.MQTT_ENABLE === 'true';
 const MQTT_BROKER_URL = process.env.MQTT_BROKER_URL || 'mqtt://mosquitto:1883';
@@ -27,7 +28,7 @@ interface BufferItem {
 }
 
 interface MetricData {
-  ts: string;
+  ts?: string; // Receive time when absent (batched payloads)
   temperature_c: number;
   vibration_g: number;
   humidity_pct: number;
@@ -130,35 +131,75 @@ async function handleMQTTMessage(topic: string, message: Buffer): Promise<void>
     }
 
     const deviceId = topicParts[1];
-    const payload = JSON.parse(message.toString()) as MetricData;
-
-    // Validate payload
-    if (!payload.ts || typeof payload.temperature_c !== 'number') {
+    const points = parsePayload(message);
+    if (!points) {
       logger.warn(`Invalid payload from device ${deviceId}`);
       return;
     }
 
-    logger.debug(`Received MQTT message from device ${deviceId}`);
+    logger.debug(`Received ${points.length} MQTT metric(s) from device ${deviceId}`);
 
     // Ensure device exists
-    await ensureDeviceExists(deviceId, payload.lat, payload.lng);
+    await ensureDeviceExists(deviceId, points[0].lat, points[0].lng);
 
-    // Store metric
-    const metric = await storeMetric(deviceId, payload);
+    // Store metrics
+    const metrics = await storeMetrics(deviceId, points);
 
-    // Add to batch buffer for anomaly detection
-    addToBatch(deviceId, metric, payload);
+    for (let i = 0; i < metrics.length; i++) {
+      // Add to batch buffer for anomaly detection
+      addToBatch(deviceId, metrics[i], points[i]);
 
-    // Emit real-time update
-    emitMetricUpdate(deviceId, metric, payload);
+      // Emit real-time update
+      emitMetricUpdate(deviceId, metrics[i], points[i]);
 
-    // Process batch if ready
-    await processBatchIfReady(deviceId);
+      // Process batch if ready (per point, so a large message cannot
+      // push unscored points out of the buffer)
+      await processBatchIfReady(deviceId);
+    }
   } catch (error) {
     logger.error('Error handling MQTT message:', error);
   }
 }
 
+/**
+ * Parse a message payload into its points: one agent-c point, or a batch
+ * from agent-cpp, either the /api/ingest JSON body ({ deviceId, metrics })
+ * or a columnar batch ("IOTC" magic). Returns null if invalid.
+ */
+export function parsePayload(message: Buffer): MetricData[] | null {
+  let points: MetricData[];
+  if (message.length >= 4 && message.toString('latin1', 0, 4) === 'IOTC') {
+    try {
+      points = decodeColumnar(message).metrics;
+    } catch {
+      return null;
+    }
+  } else {
+    let payload: any;
+    try {
+      payload = JSON.parse(message.toString());
+    } catch {
+      return null;
+    }
+    if (Array.isArray(payload?.metrics)) {
+      points = payload.metrics;
+    } else {
+      // A single point must carry its timestamp
+      if (!payload?.ts) return null;
+      points = [payload];
+    }
+  }
+
+  const valid = points.every(
+    (p) =>
+      typeof p?.temperature_c === 'number' &&
+      typeof p.vibration_g === 'number' &&
+      typeof p.humidity_pct === 'number' &&
+      typeof p.voltage_v === 'number'
+  );
+  return valid && points.length > 0 ? points : null;
+}
+
 /**
  * Ensure device exists in database
  */
@@ -193,22 +234,23 @@ async function ensureDeviceExists(
 }
 
 /**
- * Store metric in database
+ * Store metrics in database, in payload order
  */
-async function storeMetric(deviceId: string, payload: MetricData) {
+async function storeMetrics(deviceId: string, points: MetricData[]) {
   if (!prisma) {
     throw new Error('Prisma client not initialized');
   }
 
-  return await prisma.metric.create({
-    data: {
+  const now = new Date();
+  return await prisma.metric.createManyAndReturn({
+    data: points.map((p) => ({
       deviceId,
-      ts: new Date(payload.ts),
-      temperature_c: payload.temperature_c,
-      vibration_g: payload.vibration_g,
-      humidity_pct: payload.humidity_pct,
-      voltage_v: payload.voltage_v,
-    },
+      ts: p.ts ? new Date(p.ts) : now,
+      temperature_c: p.temperature_c,
+      vibration_g: p.vibration_g,
+      humidity_pct: p.humidity_pct,
+      voltage_v: p.voltage_v,
+    })),
   });
 }
 
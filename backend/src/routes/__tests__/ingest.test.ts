@@ -37,5 +37,58 @@ describe('POST /api/ingest', () => {
     // Should succeed if device auto-creation is enabled
     expect([201, 404]).toContain(response.status);
   });
+
+  it('should reject malformed columnar payload', async () => {
+    const response = await request(app)
+      .post('/api/ingest')
+      .set('Content-Type', 'application/x-iot-columnar')
+      .send(Buffer.from('not a batch'));
+
+    expect(response.status).toBe(400);
+  });
 });
 
+describe('POST /api/ingest/summary', () => {
+  it('should reject invalid summary', async () => {
+    const response = await request(app)
+      .post('/api/ingest/summary')
+      .send({ deviceId: 'test-device-001', summaries: [{ count: 10 }] });
+
+    expect(response.status).toBe(400);
+  });
+
+  it('should accept valid summary', async () => {
+    const response = await request(app)
+      .post('/api/ingest/summary')
+      .send({
+        deviceId: 'test-device-001',
+        summaries: [
+          {
+            start: '2024-01-01T00:00:00.000Z',
+            end: '2024-01-01T00:00:10.000Z',
+            count: 10,
+            anomalies: 0,
+            rawPoints: 0,
+            metrics: {
+              vibration_g: { min: 0.01, max: 0.05, mean: 0.02, stddev: 0.01, p50: 0.02, p95: 0.04, p99: 0.05 },
+            },
+            spectrum: { frames: 2, bandWidthHz: 62.5, bandEnergy: [1, 0.5, 0.2, 0.1, 0.1, 0.1, 0.1, 0.1] },
+            features: {
+              frames: 2,
+              rms: 0.01,
+              peak: 0.03,
+              crestFactor: 3.1,
+              kurtosis: 2.9,
+              dominantHz: 31.25,
+              centroidHz: 105.2,
+              bandPower: [4.5e-5, 1.3e-5, 6.7e-6],
+              envelope: { peakHz: 31.25, peak: 0.0016, defectAmplitude: [0.0008] },
+            },
+          },
+        ],
+      });
+
+    // Should succeed if device auto-creation is enabled
+    expect([201, 404]).toContain(response.status);
+  });
+});
@@ -1,10 +1,14 @@
 /**
  * Ingest Route Handler
  * 
- * Handles POST /api/ingest for receiving metrics from IoT devices
+ * Handles POST /api/ingest for receiving metrics from IoT devices.
+ * Accepts JSON or the agent's binary columnar batches
+ * (Content-Type application/x-iot-columnar).
+ * POST /api/ingest/summary takes per-interval summaries from agents
+ * running in aggregate reduction mode.
  */
 
-import { Router, Request, Response } from 'express';
+import express, { Router, Request, Response } from 'express';
 import { z } from 'zod';
 import { rateLimit } from 'express-rate-limit';
 import { PrismaClient } from '@prisma/client';
@@ -12,15 +16,17 @@ import { createAnomalyEngine } from '../anomaly';
 import { emitMetricNew, emitAnomalyNew } from '../realtime';
 import { apiKeyAuth } from '../middleware/auth';
 import { logger } from '../utils/logger';
+import { COLUMNAR_CONTENT_TYPE, ColumnarDecodeError, decodeColumnar } from '../utils/columnar';
 
 const router = Router();
 const prisma = new PrismaClient();
 const anomalyEngine = createAnomalyEngine();
 
-// Rate limiting for ingest: 20 requests per minute per IP
+// Rate limiting for ingest: 20 requests per minute per IP by default;
+// gateways uploading for many devices from one address need more
 const ingestLimiter = rateLimit({
   windowMs: 1 * 60 * 1000, // 1 minute
-  max: 20,
+  max: parseInt(process.env.INGEST_RATE_LIMIT_PER_MIN || '20', 10),
   message: { error: 'Too many requests', message: 'Rate limit exceeded for ingest' },
   standardHeaders: true,
   legacyHeaders: false,
@@ -28,6 +34,7 @@ const ingestLimiter = rateLimit({
 
 router.use(ingestLimiter);
 router.use(apiKeyAuth);
+router.use(express.raw({ type: COLUMNAR_CONTENT_TYPE, limit: '5mb' }));
 
 // Validation schema
 const MetricSchema = z.object({
@@ -43,37 +50,97 @@ const IngestSchema = z.object({
   metrics: z.array(MetricSchema).min(1),
 });
 
+const METRIC_FIELDS = ['temperature_c', 'vibration_g', 'humidity_pct', 'voltage_v'] as const;
+
+const AggregateSchema = z.object({
+  min: z.number(),
+  max: z.number(),
+  mean: z.number(),
+  stddev: z.number(),
+  p50: z.number(),
+  p95: z.number(),
+  p99: z.number(),
+});
+
+const SummarySchema = z.object({
+  start: z.string().datetime(),
+  end: z.string().datetime(),
+  count: z.number().int().nonnegative(),
+  anomalies: z.number().int().nonnegative().default(0),
+  rawPoints: z.number().int().nonnegative().default(0),
+  metrics: z.record(z.enum(METRIC_FIELDS), AggregateSchema),
+  spectrum: z
+    .object({
+      frames: z.number().int().nonnegative(),
+      bandWidthHz: z.number(),
+      bandEnergy: z.array(z.number()),
+    })
+    .optional(),
+  features: z
+    .object({
+      frames: z.number().int().nonnegative(),
+      rms: z.number(),
+      peak: z.number(),
+      crestFactor: z.number(),
+      kurtosis: z.number(),
+      dominantHz: z.number(),
+      centroidHz: z.number(),
+      bandPower: z.array(z.number()),
+      envelope: z
+        .object({
+          peakHz: z.number(),
+          peak: z.number(),
+          defectAmplitude: z.array(z.number()),
+        })
+        .optional(),
+    })
+    .optional(),
+});
+
+const SummaryIngestSchema = z.object({
+  deviceId: z.string(),
+  summaries: z.array(SummarySchema).min(1),
+});
+
+// Look the device up, auto-creating it when ALLOW_AUTO_DEVICE is set;
+// null if it does not exist and may not be created
+async function resolveDevice(deviceId: string) {
+  const device = await prisma.device.findUnique({
+    where: { id: deviceId },
+  });
+  if (device || process.env.ALLOW_AUTO_DEVICE !== 'true') {
+    return device;
+  }
+
+  // Auto-create device
+  return prisma.device.create({
+    data: {
+      id: deviceId,
+      name: `Device ${deviceId}`,
+      location: null,
+    },
+  });
+}
+
 router.post('/', async (req: Request, res: Response) => {
   try {
-    logger.debug('Received ingest request', { body: req.body });
+    // Binary batches decode to the same shape as the JSON body
+    const columnar = Buffer.isBuffer(req.body);
+    const payload = columnar ? decodeColumnar(req.body) : req.body;
+    logger.debug('Received ingest request', columnar ? { bytes: req.body.length } : { body: req.body });
 
     // Validate request body
-    const body = IngestSchema.parse(req.body);
+    const body = IngestSchema.parse(payload);
     const { deviceId, metrics } = body;
 
     logger.info(`Ingesting ${metrics.length} metrics for device ${deviceId}`);
 
     // Check if device exists, create if allowed
-    let device = await prisma.device.findUnique({
-      where: { id: deviceId },
-    });
-
+    const device = await resolveDevice(deviceId);
     if (!device) {
-      const allowAutoDevice = process.env.ALLOW_AUTO_DEVICE === 'true';
-      if (!allowAutoDevice) {
-        return res.status(404).json({
-          error: 'Device not found',
-          deviceId,
-        });
-      }
-
-      // Auto-create device
-      device = await prisma.device.create({
-        data: {
-          id: deviceId,
-          name: `Device ${deviceId}`,
-          location: null,
-        },
+      return res.status(404).json({
+        error: 'Device not found',
+        deviceId,
       });
     }
 
@@ -142,6 +209,14 @@ router.post('/', async (req: Request, res: Response) => {
       deviceId,
     });
   } catch (error) {
+    if (error instanceof ColumnarDecodeError) {
+      logger.warn('Malformed columnar batch in ingest', { error: error.message });
+      return res.status(400).json({
+        error: 'Validation error',
+        details: error.message,
+      });
+    }
+
     if (error instanceof z.ZodError) {
       logger.warn('Validation error in ingest', { errors: error.errors });
       return res.status(400).json({
@@ -158,5 +233,76 @@ router.post('/', async (req: Request, res: Response) => {
   }
 });
 
+router.post('/summary', async (req: Request, res: Response) => {
+  try {
+    const { deviceId, summaries } = SummaryIngestSchema.parse(req.body);
+
+    logger.info(`Ingesting ${summaries.length} summaries for device ${deviceId}`);
+
+    const device = await resolveDevice(deviceId);
+    if (!device) {
+      return res.status(404).json({
+        error: 'Device not found',
+        deviceId,
+      });
+    }
+
+    await prisma.metricSummary.createMany({
+      data: summaries.map((s) => ({
+        deviceId,
+        tsStart: new Date(s.start),
+        tsEnd: new Date(s.end),
+        count: s.count,
+        anomalies: s.anomalies,
+        rawPoints: s.rawPoints,
+        stats: s.metrics,
+        spectrum: s.spectrum,
+        features: s.features,
+      })),
+    });
+
+    // One point of interval means per summary, so charts over the metrics
+    // table keep working; metrics the device does not report read as 0.
+    // Anomaly detection is left to the agent, which flags the interval
+    // and sends raw points around it
+    const insertedMetrics = await prisma.metric.createManyAndReturn({
+      data: summaries.map((s) => ({
+        deviceId,
+        ts: new Date(s.start),
+        temperature_c: s.metrics.temperature_c?.mean ?? 0,
+        vibration_g: s.metrics.vibration_g?.mean ?? 0,
+        humidity_pct: s.metrics.humidity_pct?.mean ?? 0,
+        voltage_v: s.metrics.voltage_v?.mean ?? 0,
+      })),
+    });
+
+    for (const metric of insertedMetrics) {
+      emitMetricNew(deviceId, metric);
+    }
+
+    logger.info(`Summary ingest complete: ${summaries.length} summaries`);
+
+    res.status(201).json({
+      success: true,
+      summariesInserted: summaries.length,
+      deviceId,
+    });
+  } catch (error) {
+    if (error instanceof z.ZodError) {
+      logger.warn('Validation error in summary ingest', { errors: error.errors });
+      return res.status(400).json({
+        error: 'Validation error',
+        details: error.errors,
+      });
+    }
+
+    logger.error('Summary ingest error:', error);
+    res.status(500).json({
+      error: 'Internal server error',
+      message: error instanceof Error ? error.message : 'Unknown error',
+    });
+  }
+});
+
 export default router;
 
@@ -0,0 +1,68 @@
+/**
+ * Tests for the columnar ingest decoder
+ *
+ * Fixtures were produced by agent-cpp's columnar::Encoder (lossless mode).
+ */
+
+import { decodeColumnar, ColumnarDecodeError } from '../columnar';
+
+const THREE_POINTS = Buffer.from(
+  '494f544301010f746573742d6465766963652d3030310300000199c82cc000e7d0b2201b40' +
+    '00000000007107bc3e7f2b9f559b3d07c9bf1c4eca624ac08ecd2df45f6f2ddff5011a0000' +
+    '00000003883e2168027333333333334e76f21c8721c87c',
+  'hex'
+);
+
+const NO_TIMESTAMP = Buffer.from(
+  '494f544301000164013ff0000000000000400000000000000040080000000000004010000000000000',
+  'hex'
+);
+
+describe('decodeColumnar', () => {
+  it('should decode timestamps and all four columns', () => {
+    const batch = decodeColumnar(THREE_POINTS);
+
+    expect(batch.deviceId).toBe('test-device-001');
+    expect(batch.metrics).toEqual([
+      {
+        ts: '2025-10-09T08:53:20.000Z',
+        temperature_c: 22.5,
+        vibration_g: 0.0213,
+        humidity_pct: 45.0,
+        voltage_v: 4.9,
+      },
+      {
+        ts: '2025-10-09T08:53:21.000Z',
+        temperature_c: 22.75,
+        vibration_g: 0.0198,
+        humidity_pct: 45.5,
+        voltage_v: 4.9,
+      },
+      {
+        ts: '2025-10-09T08:53:22.050Z',
+        temperature_c: 23.0,
+        vibration_g: 0.0305,
+        humidity_pct: 45.25,
+        voltage_v: 4.88,
+      },
+    ]);
+  });
+
+  it('should omit ts when the batch has no timestamps', () => {
+    const batch = decodeColumnar(NO_TIMESTAMP);
+
+    expect(batch.deviceId).toBe('d');
+    expect(batch.metrics).toEqual([
+      { temperature_c: 1, vibration_g: 2, humidity_pct: 3, voltage_v: 4 },
+    ]);
+  });
+
+  it('should reject payloads that are not columnar batches', () => {
+    expect(() => decodeColumnar(Buffer.from('{"deviceId":"x"}'))).toThrow(ColumnarDecodeError);
+  });
+
+  it('should reject truncated payloads', () => {
+    const truncated = THREE_POINTS.subarray(0, THREE_POINTS.length - 10);
+    expect(() => decodeColumnar(truncated)).toThrow(ColumnarDecodeError);
+  });
+});
@@ -0,0 +1,221 @@
+/**
+ * Columnar Ingest Decoder
+ *
+ * Decodes the compact binary batches sent by the edge agent with
+ * Content-Type application/x-iot-columnar (see
+ * agent-cpp/include/columnar_codec.hpp for the encoder):
+ *
+ *   "IOTC" | version u8 | flags u8 | varint len + deviceId | varint count
+ *   then an MSB-first bitstream holding delta-of-delta timestamps and
+ *   four Gorilla XOR-compressed float columns.
+ */
+
+export const COLUMNAR_CONTENT_TYPE = 'application/x-iot-columnar';
+
+const VERSION = 1;
+const FLAG_TIMESTAMPS = 1;
+const MAX_POINTS = 100000;
+
+export interface ColumnarMetric {
+  ts?: string;
+  temperature_c: number;
+  vibration_g: number;
+  humidity_pct: number;
+  voltage_v: number;
+}
+
+export interface ColumnarBatch {
+  deviceId: string;
+  metrics: ColumnarMetric[];
+}
+
+export class ColumnarDecodeError extends Error {
+  constructor(message: string) {
+    super(message);
+    this.name = 'ColumnarDecodeError';
+  }
+}
+
+class BitReader {
+  private pos: number;
+  private readonly end: number;
+
+  constructor(private readonly bytes: Uint8Array, startByte: number) {
+    this.pos = startByte * 8;
+    this.end = bytes.length * 8;
+  }
+
+  private need(n: number): void {
+    if (this.pos + n > this.end) {
+      throw new ColumnarDecodeError('Truncated bitstream');
+    }
+  }
+
+  bit(): number {
+    this.need(1);
+    const value = (this.bytes[this.pos >> 3] >> (7 - (this.pos & 7))) & 1;
+    this.pos++;
+    return value;
+  }
+
+  // Up to 32 bits as a number
+  small(n: number): number {
+    let value = 0;
+    for (let i = 0; i < n; i++) {
+      value = value * 2 + this.bit();
+    }
+    return value;
+  }
+
+  // Up to 64 bits as an unsigned bigint
+  bits(n: number): bigint {
+    this.need(n);
+    let value = 0n;
+    while (n > 0) {
+      const offset = this.pos & 7;
+      const avail = 8 - offset;
+      const take = Math.min(avail, n);
+      const chunk = (this.bytes[this.pos >> 3] >> (avail - take)) & ((1 << take) - 1);
+      value = (value << BigInt(take)) | BigInt(chunk);
+      this.pos += take;
+      n -= take;
+    }
+    return value;
+  }
+}
+
+function readVarint(bytes: Uint8Array, offset: { pos: number }): number {
+  let value = 0;
+  let scale = 1;
+  for (let i = 0; i < 8; i++) {
+    if (offset.pos >= bytes.length) {
+      throw new ColumnarDecodeError('Truncated header');
+    }
+    const byte = bytes[offset.pos++];
+    value += (byte & 0x7f) * scale;
+    if ((byte & 0x80) === 0) {
+      return value;
+    }
+    scale *= 128;
+  }
+  throw new ColumnarDecodeError('Varint too long');
+}
+
+const scratch = new DataView(new ArrayBuffer(8));
+
+function toDouble(bits: bigint): number {
+  scratch.setBigUint64(0, bits);
+  return scratch.getFloat64(0);
+}
+
+function decodeTimestamps(reader: BitReader, count: number): (string | undefined)[] {
+  const out: (string | undefined)[] = new Array(count);
+  let ts = BigInt.asIntN(64, reader.bits(64));
+  let delta = 0n;
+  out[0] = ts === 0n ? undefined : new Date(Number(ts)).toISOString();
+
+  // Bucket widths for the '0', '10', '110', '1110', '11110', '11111' prefixes
+  const widths = [7, 9, 12, 32, 64];
+  for (let i = 1; i < count; i++) {
+    let z = 0n;
+    if (reader.bit() === 1) {
+      let bucket = 0;
+      while (bucket < 4 && reader.bit() === 1) {
+        bucket++;
+      }
+      z = reader.bits(widths[bucket]);
+    }
+    const dod = (z >> 1n) ^ -(z & 1n);
+    delta = BigInt.asIntN(64, delta + dod);
+    ts = BigInt.asIntN(64, ts + delta);
+    out[i] = ts === 0n ? undefined : new Date(Number(ts)).toISOString();
+  }
+  return out;
+}
+
+function decodeColumn(reader: BitReader, count: number): number[] {
+  const out: number[] = new Array(count);
+  let prev = reader.bits(64);
+  out[0] = toDouble(prev);
+
+  let lead = -1;
+  let trail = 0;
+  for (let i = 1; i < count; i++) {
+    if (reader.bit() === 0) {
+      out[i] = out[i - 1];
+      continue;
+    }
+    if (reader.bit() === 1) {
+      lead = reader.small(5);
+      const length = reader.small(6) || 64;
+      trail = 64 - lead - length;
+      if (trail < 0) {
+        throw new ColumnarDecodeError('Invalid XOR window');
+      }
+    } else if (lead < 0) {
+      throw new ColumnarDecodeError('XOR window reused before being set');
+    }
+    const xor = reader.bits(64 - lead - trail) << BigInt(trail);
+    prev ^= xor;
+    out[i] = toDouble(prev);
+  }
+  return out;
+}
+
+/**
+ * Decode one columnar batch into the same shape as the JSON ingest body
+ */
+export function decodeColumnar(buffer: Uint8Array): ColumnarBatch {
+  if (
+    buffer.length < 6 ||
+    buffer[0] !== 0x49 || // I
+    buffer[1] !== 0x4f || // O
+    buffer[2] !== 0x54 || // T
+    buffer[3] !== 0x43 // C
+  ) {
+    throw new ColumnarDecodeError('Not a columnar batch');
+  }
+  if (buffer[4] !== VERSION) {
+    throw new ColumnarDecodeError(`Unsupported columnar version ${buffer[4]}`);
+  }
+  const flags = buffer[5];
+
+  const offset = { pos: 6 };
+  const idLength = readVarint(buffer, offset);
+  if (offset.pos + idLength > buffer.length) {
+    throw new ColumnarDecodeError('Truncated device id');
+  }
+  const deviceId = Buffer.from(buffer.subarray(offset.pos, offset.pos + idLength)).toString('utf8');
+  offset.pos += idLength;
+
+  const count = readVarint(buffer, offset);
+  if (count > MAX_POINTS) {
+    throw new ColumnarDecodeError(`Too many points (${count})`);
+  }
+  if (count === 0) {
+    return { deviceId, metrics: [] };
+  }
+
+  const reader = new BitReader(buffer, offset.pos);
+  const timestamps = flags & FLAG_TIMESTAMPS ? decodeTimestamps(reader, count) : undefined;
+  const temperature = decodeColumn(reader, count);
+  const vibration = decodeColumn(reader, count);
+  const humidity = decodeColumn(reader, count);
+  const voltage = decodeColumn(reader, count);
+
+  const metrics: ColumnarMetric[] = new Array(count);
+  for (let i = 0; i < count; i++) {
+    const metric: ColumnarMetric = {
+      temperature_c: temperature[i],
+      vibration_g: vibration[i],
+      humidity_pct: humidity[i],
+      voltage_v: voltage[i],
+    };
+    const ts = timestamps?.[i];
+    if (ts !== undefined) {
+      metric.ts = ts;
+    }
+    metrics[i] = metric;
+  }
+  return { deviceId, metrics };
+}